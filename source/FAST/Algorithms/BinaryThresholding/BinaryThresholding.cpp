@@ -32,6 +32,7 @@ void BinaryThresholding::execute() {
     Image::pointer input = getStaticInputData<Image>(0);
     Segmentation::pointer output = getStaticOutputData<Segmentation>(0);
 
+    output->enableStoragePooling(); // reuse storage of old frames when streaming
     output->createFromImage(input);
 
     if(getMainDevice()->isHost()) {
@@ -0,0 +1,132 @@
+#include "FAST/Algorithms/ConnectedComponents/ConnectedComponents.hpp"
+#include <boost/thread.hpp>
+#include <limits>
+
+namespace fast {
+
+static const uint BACKGROUND = std::numeric_limits<uint>::max();
+
+// Parents always have a smaller index than their children, so the root of a
+// component is its first voxel in memory
+static inline uint findRoot(uint* parents, uint index) {
+    while(parents[index] != index) {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
+    }
+    return index;
+}
+
+static inline void unite(uint* parents, uint a, uint b) {
+    a = findRoot(parents, a);
+    b = findRoot(parents, b);
+    if(a < b) {
+        parents[b] = a;
+    } else if(b < a) {
+        parents[a] = b;
+    }
+}
+
+// Unite the voxels in [start, end) with the neighbors which come before them
+// in memory and have an index of at least lowestNeighbor
+static void uniteWithPreviousNeighbors(
+        const uchar* mask,
+        uint* parents,
+        Vector3ui size,
+        const std::vector<Vector3i>& offsets,
+        std::size_t start,
+        std::size_t end,
+        std::size_t lowestNeighbor,
+        std::size_t highestNeighbor) {
+    const int width = size.x();
+    const int height = size.y();
+    const std::size_t sliceSize = (std::size_t)width*height;
+    for(std::size_t i = start; i < end; i++) {
+        if(mask[i] == 0)
+            continue;
+        const int x = i % width;
+        const int y = (i / width) % height;
+        const int z = i / sliceSize;
+        for(int j = 0; j < offsets.size(); j++) {
+            const int nx = x + offsets[j].x();
+            const int ny = y + offsets[j].y();
+            const int nz = z + offsets[j].z();
+            if(nx < 0 || ny < 0 || nz < 0 || nx >= width || ny >= height)
+                continue;
+            const std::size_t neighbor = nx + ny*(std::size_t)width + nz*sliceSize;
+            if(neighbor < lowestNeighbor || neighbor >= highestNeighbor || mask[neighbor] == 0)
+                continue;
+            unite(parents, i, neighbor);
+        }
+    }
+}
+
+std::vector<ConnectedComponent> labelConnectedComponents(const uchar* mask, uint* labels, Vector3ui size, bool fullConnectivity) {
+    const std::size_t width = size.x();
+    const std::size_t nrOfVoxels = width*size.y()*size.z();
+    if(nrOfVoxels >= BACKGROUND)
+        throw Exception("Volume is too large for connected component labeling");
+
+    // Neighbors which come before a voxel in memory
+    std::vector<Vector3i> offsets;
+    for(int z = -1; z < 1; z++) {
+    for(int y = -1; y < 2; y++) {
+    for(int x = -1; x < 2; x++) {
+        if(z == 0 && (y > 0 || (y == 0 && x >= 0)))
+            continue;
+        if(!fullConnectivity && abs(x)+abs(y)+abs(z) != 1)
+            continue;
+        offsets.push_back(Vector3i(x, y, z));
+    }}}
+    // No voxel has a neighbor further back than this
+    const std::size_t maxNeighborDistance = width*size.y() + width + 1;
+
+    // The labels are used as the union-find parents until the final pass.
+    // Each part is a range of rows, and only voxels in the part are united.
+    const std::size_t nrOfRows = (std::size_t)size.y()*size.z();
+    const long long nrOfParts = std::min<std::size_t>(nrOfRows, 4*std::max(1u, boost::thread::hardware_concurrency()));
+    #pragma omp parallel for
+    for(long long part = 0; part < nrOfParts; part++) {
+        const std::size_t start = (nrOfRows*part / nrOfParts)*width;
+        const std::size_t end = (nrOfRows*(part+1) / nrOfParts)*width;
+        for(std::size_t i = start; i < end; i++)
+            labels[i] = mask[i] == 0 ? BACKGROUND : i;
+        uniteWithPreviousNeighbors(mask, labels, size, offsets, start, end, start, end);
+    }
+
+    // Merge the parts through the voxels which are close to the start of each part
+    for(long long part = 1; part < nrOfParts; part++) {
+        const std::size_t start = (nrOfRows*part / nrOfParts)*width;
+        const std::size_t end = std::min(start + maxNeighborDistance, nrOfVoxels);
+        uniteWithPreviousNeighbors(mask, labels, size, offsets, start, end, 0, start);
+    }
+
+    // The parent of a voxel comes before it in memory, and has got its label
+    // already when the voxel is visited
+    std::vector<ConnectedComponent> components;
+    for(std::size_t i = 0; i < nrOfVoxels; i++) {
+        const uint parent = labels[i];
+        if(parent == BACKGROUND) {
+            labels[i] = 0;
+            continue;
+        }
+        const Vector3ui position(i % width, (i / width) % size.y(), i / (width*size.y()));
+        if(parent == i) {
+            ConnectedComponent component;
+            component.size = 0;
+            component.minimum = position;
+            component.maximum = position;
+            components.push_back(component);
+            labels[i] = components.size();
+        } else {
+            labels[i] = labels[parent];
+        }
+        ConnectedComponent& component = components[labels[i]-1];
+        component.size++;
+        component.minimum = component.minimum.cwiseMin(position);
+        component.maximum = component.maximum.cwiseMax(position);
+    }
+
+    return components;
+}
+
+} // end namespace fast
@@ -0,0 +1,106 @@
+#ifndef CONNECTED_COMPONENTS_HPP_
+#define CONNECTED_COMPONENTS_HPP_
+
+#include "FAST/Data/DataTypes.hpp"
+#include "FAST/Exception.hpp"
+#include <vector>
+
+// Host implementations of flood fill and connected component labeling of
+// 2D and 3D volumes stored as arrays with x as the fastest varying index.
+// With full connectivity, voxels are connected to all 8 (2D) or 26 (3D)
+// neighbors, otherwise only to the 4 (2D) or 6 (3D) neighbors sharing a face.
+
+namespace fast {
+
+struct ConnectedComponent {
+    std::size_t size;
+    // Bounding box of the component, both corners are inside the component
+    Vector3ui minimum;
+    Vector3ui maximum;
+};
+
+/**
+ * Labels all connected components of the nonzero voxels in mask. Background
+ * voxels get label 0, and the components get labels 1, 2, 3.. in the order
+ * their first voxel appear in memory. The returned vector has the size and
+ * bounding box of component i at position i-1.
+ * The volume is split in one part per thread which are labeled in parallel
+ * with union-find, and then merged.
+ */
+std::vector<ConnectedComponent> labelConnectedComponents(const uchar* mask, uint* labels, Vector3ui size, bool fullConnectivity);
+
+/**
+ * Flood fills from each seed, setting value in segmentation for all voxels
+ * reached through voxels which are included. A voxel is included if
+ * isIncluded(index) is true and it is 0 in segmentation. Whole spans of
+ * voxels along x are filled at a time. Returns the number of voxels filled.
+ */
+template <class Predicate>
+std::size_t scanlineFloodFill(
+        uchar* segmentation,
+        Vector3ui size,
+        bool fullConnectivity,
+        const std::vector<Vector3ui>& seeds,
+        Predicate isIncluded,
+        uchar value = 1
+        ) {
+    const int width = size.x();
+    const int height = size.y();
+    const int depth = size.z();
+    const std::size_t sliceSize = (std::size_t)width*height;
+    // Spans on diagonal rows are connected also through the voxels just outside the span
+    const int extension = fullConnectivity ? 1 : 0;
+    std::size_t nrOfFilledVoxels = 0;
+
+    std::vector<Vector3i> stack;
+    for(int i = 0; i < seeds.size(); i++) {
+        if(seeds[i].x() >= width || seeds[i].y() >= height || seeds[i].z() >= depth)
+            throw Exception("Seed given to flood fill was out of bounds");
+        stack.push_back(seeds[i].cast<int>());
+    }
+
+    while(!stack.empty()) {
+        const Vector3i position = stack.back();
+        stack.pop_back();
+        const std::size_t rowStart = position.y()*(std::size_t)width + position.z()*sliceSize;
+        if(segmentation[rowStart + position.x()] != 0 || !isIncluded(rowStart + position.x()))
+            continue;
+
+        // Find the span of the row containing the position and fill it
+        int start = position.x();
+        while(start > 0 && segmentation[rowStart + start - 1] == 0 && isIncluded(rowStart + start - 1))
+            start--;
+        int end = position.x();
+        while(end < width - 1 && segmentation[rowStart + end + 1] == 0 && isIncluded(rowStart + end + 1))
+            end++;
+        for(int x = start; x <= end; x++)
+            segmentation[rowStart + x] = value;
+        nrOfFilledVoxels += end - start + 1;
+
+        // Add one seed for each span of included voxels in the neighboring rows
+        for(int dz = -1; dz < 2; dz++) {
+        for(int dy = -1; dy < 2; dy++) {
+            if((dy == 0 && dz == 0) || (!fullConnectivity && dy != 0 && dz != 0))
+                continue;
+            const int y = position.y() + dy;
+            const int z = position.z() + dz;
+            if(y < 0 || z < 0 || y >= height || z >= depth)
+                continue;
+            const std::size_t neighborRowStart = y*(std::size_t)width + z*sliceSize;
+            const int neighborEnd = std::min(end + extension, width - 1);
+            bool inSpan = false;
+            for(int x = std::max(start - extension, 0); x <= neighborEnd; x++) {
+                const bool included = segmentation[neighborRowStart + x] == 0 && isIncluded(neighborRowStart + x);
+                if(included && !inSpan)
+                    stack.push_back(Vector3i(x, y, z));
+                inSpan = included;
+            }
+        }}
+    }
+
+    return nrOfFilledVoxels;
+}
+
+} // end namespace fast
+
+#endif /* CONNECTED_COMPONENTS_HPP_ */
@@ -0,0 +1,94 @@
+#include "FAST/Testing.hpp"
+#include "ConnectedComponents.hpp"
+#include <cstdlib>
+
+namespace fast {
+
+TEST_CASE("Connected component labeling of two objects", "[fast][ConnectedComponents]") {
+    const Vector3ui size(10, 8, 6);
+    std::vector<uchar> mask(size.prod(), 0);
+    // A box, and two voxels only connected through a corner
+    for(uint z = 1; z < 3; z++) {
+    for(uint y = 2; y < 5; y++) {
+    for(uint x = 3; x < 7; x++) {
+        mask[x + y*size.x() + z*size.x()*size.y()] = 1;
+    }}}
+    mask[8 + 6*size.x() + 4*size.x()*size.y()] = 1;
+    mask[9 + 7*size.x() + 5*size.x()*size.y()] = 1;
+
+    std::vector<uint> labels(mask.size());
+    std::vector<ConnectedComponent> components = labelConnectedComponents(mask.data(), labels.data(), size, false);
+    REQUIRE(components.size() == 3);
+    CHECK(components[0].size == 24);
+    CHECK(components[0].minimum == Vector3ui(3, 2, 1));
+    CHECK(components[0].maximum == Vector3ui(6, 4, 2));
+    CHECK(components[1].size == 1);
+    CHECK(components[2].size == 1);
+    CHECK(labels[0] == 0);
+    CHECK(labels[3 + 2*size.x() + size.x()*size.y()] == 1);
+    CHECK(labels[9 + 7*size.x() + 5*size.x()*size.y()] == 3);
+
+    components = labelConnectedComponents(mask.data(), labels.data(), size, true);
+    REQUIRE(components.size() == 2);
+    CHECK(components[1].size == 2);
+    CHECK(components[1].minimum == Vector3ui(8, 6, 4));
+    CHECK(components[1].maximum == Vector3ui(9, 7, 5));
+}
+
+TEST_CASE("Connected component labeling gives same components as flood fill", "[fast][ConnectedComponents]") {
+    const Vector3ui size(64, 48, 40);
+    std::vector<uchar> mask(size.prod());
+    std::srand(0);
+    for(uint i = 0; i < mask.size(); i++)
+        mask[i] = std::rand() % 100 < 40 ? 1 : 0;
+
+    for(int connectivity = 0; connectivity < 2; connectivity++) {
+        const bool fullConnectivity = connectivity == 1;
+        std::vector<uint> labels(mask.size());
+        std::vector<ConnectedComponent> components = labelConnectedComponents(mask.data(), labels.data(), size, fullConnectivity);
+        REQUIRE(components.size() > 0);
+
+        // Flood fill each component from its first voxel, which should give
+        // exactly the voxels with the same label. The fill values wrap around,
+        // and are never 0.
+        std::vector<uchar> filled(mask.size(), 0);
+        uint label = 0;
+        for(uint i = 0; i < mask.size(); i++) {
+            if(labels[i] != label + 1)
+                continue;
+            label++;
+            std::vector<Vector3ui> seeds;
+            seeds.push_back(Vector3ui(i % size.x(), (i / size.x()) % size.y(), i / (size.x()*size.y())));
+            std::size_t nrOfFilledVoxels = scanlineFloodFill(filled.data(), size, fullConnectivity, seeds,
+                    [&mask](std::size_t index) { return mask[index] == 1; }, label % 255 + 1);
+            CHECK(nrOfFilledVoxels == components[label-1].size);
+        }
+        CHECK(label == components.size());
+        bool equal = true;
+        for(uint i = 0; i < mask.size(); i++) {
+            if(filled[i] != (labels[i] == 0 ? 0 : labels[i] % 255 + 1))
+                equal = false;
+        }
+        CHECK(equal);
+    }
+}
+
+TEST_CASE("Flood fill in 2D with and without full connectivity", "[fast][ConnectedComponents]") {
+    const Vector3ui size(5, 5, 1);
+    // Diagonal line
+    std::vector<uchar> mask(size.prod(), 0);
+    for(uint i = 0; i < 5; i++)
+        mask[i + i*size.x()] = 1;
+    std::vector<Vector3ui> seeds;
+    seeds.push_back(Vector3ui(0, 0, 0));
+
+    std::vector<uchar> segmentation(mask.size(), 0);
+    CHECK(scanlineFloodFill(segmentation.data(), size, false, seeds, [&mask](std::size_t index) { return mask[index] == 1; }) == 1);
+    segmentation.assign(mask.size(), 0);
+    CHECK(scanlineFloodFill(segmentation.data(), size, true, seeds, [&mask](std::size_t index) { return mask[index] == 1; }) == 5);
+
+    seeds.push_back(Vector3ui(5, 0, 0));
+    CHECK_THROWS(scanlineFloodFill(segmentation.data(), size, true, seeds, [&mask](std::size_t index) { return mask[index] == 1; }));
+}
+
+} // end namespace fast
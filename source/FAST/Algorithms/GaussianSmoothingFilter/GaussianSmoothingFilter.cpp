@@ -2,6 +2,11 @@
 #include "FAST/Exception.hpp"
 #include "FAST/DeviceManager.hpp"
 #include "FAST/Data/Image.hpp"
+#include "FAST/Data/ImagePool.hpp"
+#include "FAST/Utility.hpp"
+#include <algorithm>
+#include <limits>
+#include <vector>
 using namespace fast;
 
 void GaussianSmoothingFilter::setMaskSize(unsigned char maskSize) {
@@ -39,177 +44,454 @@ GaussianSmoothingFilter::GaussianSmoothingFilter() {
     mMaskSize = -1;
     mIsModified = true;
     mRecreateMask = true;
-    mDimensionCLCodeCompiledFor = 0;
-    mMask = NULL;
+    mCLMaskSize = 0;
+    mUseRecursiveFilter = false;
     mOutputTypeSet = false;
 }
 
 GaussianSmoothingFilter::~GaussianSmoothingFilter() {
-    delete[] mMask;
 }
 
-// TODO have to set mRecreateMask to true if input change dimension
-void GaussianSmoothingFilter::createMask(Image::pointer input, uchar maskSize, bool useSeperableFilter) {
-    if(!mRecreateMask)
-        return;
+void GaussianSmoothingFilter::enableRecursiveFiltering() {
+    mUseRecursiveFilter = true;
+    mIsModified = true;
+}
 
-    unsigned char halfSize = (maskSize-1)/2;
+void GaussianSmoothingFilter::disableRecursiveFiltering() {
+    mUseRecursiveFilter = false;
+    mIsModified = true;
+}
+
+// Create a normalized 1D gaussian mask. The 2D and 3D gaussian masks are
+// products of this mask, so the filter can be applied one direction at a time.
+static std::vector<float> createSeparableMask(float stdDev, int maskSize) {
+    const int halfSize = (maskSize-1)/2;
+    std::vector<float> mask(maskSize);
     float sum = 0.0f;
+    for(int x = -halfSize; x <= halfSize; x++) {
+        float value = exp(-(float)(x*x)/(2.0f*stdDev*stdDev));
+        mask[x+halfSize] = value;
+        sum += value;
+    }
+    for(int i = 0; i < maskSize; ++i)
+        mask[i] /= sum;
 
-    if(input->getDimensions() == 2) {
-        mMask = new float[maskSize*maskSize];
-
-        for(int x = -halfSize; x <= halfSize; x++) {
-        for(int y = -halfSize; y <= halfSize; y++) {
-            float value = exp(-(float)(x*x+y*y)/(2.0f*mStdDev*mStdDev));
-            mMask[x+halfSize+(y+halfSize)*maskSize] = value;
-            sum += value;
-        }}
-
-        for(int i = 0; i < maskSize*maskSize; ++i)
-            mMask[i] /= sum;
-    } else if(input->getDimensions() == 3) {
-        // Use separable filtering for 3D
-        if(useSeperableFilter) {
-            mMask = new float[maskSize];
-
-            for(int x = -halfSize; x <= halfSize; x++) {
-                float value = exp(-(float)(x*x)/(2.0f*mStdDev*mStdDev));
-                mMask[x+halfSize] = value;
-                sum += value;
+    return mask;
+}
+
+void GaussianSmoothingFilter::createMask(OpenCLDevice::pointer device, int maskSize) {
+    if(!mRecreateMask && maskSize == mCLMaskSize && device == mCLMaskDevice)
+        return;
+
+    std::vector<float> mask = createSeparableMask(mStdDev, maskSize);
+    mCLMask = cl::Buffer(
+            device->getContext(),
+            CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+            sizeof(float)*maskSize,
+            mask.data()
+    );
+    mCLMaskSize = maskSize;
+    mCLMaskDevice = device;
+    mRecreateMask = false;
+}
+
+cl::Kernel GaussianSmoothingFilter::getKernel(OpenCLDevice::pointer device, uchar dimensions, std::string name, std::string buildOptions) {
+    if(!(device == mKernelDevice)) {
+        mKernels.clear();
+        mKernelDevice = device;
+    }
+
+    std::string programName = dimensions == 2 ? "2D" : "3D";
+    std::string key = programName + name + buildOptions;
+    if(mKernels.count(key) == 0) {
+        cl::Program program = getOpenCLProgram(device, programName, buildOptions);
+        mKernels[key] = cl::Kernel(program, name.c_str());
+    }
+    return mKernels[key];
+}
+
+// Convolve the rows of the image in the x direction. Coordinates outside the
+// image are clamped to the edge, like the sampler of the OpenCL kernels.
+template <class T>
+void convolveRows(const T* input, float* output, const std::vector<float>& mask, int width, int nrOfRows, int nrOfComponents) {
+    const int halfSize = (mask.size()-1)/2;
+    // Pixels in the interior don't need clamping
+    const int interiorStart = std::min(halfSize, width);
+    const int interiorEnd = std::max(width-halfSize, interiorStart);
+
+    #pragma omp parallel for
+    for(int row = 0; row < nrOfRows; row++) {
+        const T* in = input + (std::size_t)row*width*nrOfComponents;
+        float* out = output + (std::size_t)row*width*nrOfComponents;
+
+        // Each mask element is applied to the whole interior as one
+        // contiguous multiply-add which the compiler can vectorize
+        for(int i = interiorStart*nrOfComponents; i < interiorEnd*nrOfComponents; i++)
+            out[i] = 0.0f;
+        for(int k = -halfSize; k <= halfSize; k++) {
+            const float weight = mask[k+halfSize];
+            const T* shifted = in + k*nrOfComponents;
+            for(int i = interiorStart*nrOfComponents; i < interiorEnd*nrOfComponents; i++)
+                out[i] += weight*shifted[i];
+        }
+
+        // Borders
+        for(int x = 0; x < width; x++) {
+            if(x == interiorStart)
+                x = interiorEnd;
+            if(x >= width)
+                break;
+            for(int c = 0; c < nrOfComponents; c++) {
+                float sum = 0.0f;
+                for(int k = -halfSize; k <= halfSize; k++) {
+                    const int neighbour = std::min(std::max(x+k, 0), width-1);
+                    sum += mask[k+halfSize]*in[neighbour*nrOfComponents+c];
+                }
+                out[x*nrOfComponents+c] = sum;
             }
+        }
+    }
+}
 
-            for(int i = 0; i < maskSize; ++i)
-                mMask[i] /= sum;
-        } else {
-            mMask = new float[maskSize*maskSize*maskSize];
-
-            for(int x = -halfSize; x <= halfSize; x++) {
-            for(int y = -halfSize; y <= halfSize; y++) {
-            for(int z = -halfSize; z <= halfSize; z++) {
-                float value = exp(-(float)(x*x+y*y+z*z)/(2.0f*mStdDev*mStdDev));
-                mMask[x+halfSize+(y+halfSize)*maskSize+(z+halfSize)*maskSize*maskSize] = value;
-                sum += value;
-            }}}
-
-            for(int i = 0; i < maskSize*maskSize*maskSize; ++i)
-                mMask[i] /= sum;
+// Convolve in a direction where neighbouring pixels are whole lines apart, for
+// instance the y direction (lines are rows) or the z direction (lines are slices).
+// The image is processed as nrOfBlocks blocks of size lines with lineLength elements.
+static void convolveLines(const float* input, float* output, const std::vector<float>& mask, int size, std::size_t lineLength, int nrOfBlocks) {
+    const int halfSize = (mask.size()-1)/2;
+
+    #pragma omp parallel for
+    for(int i = 0; i < nrOfBlocks*size; i++) {
+        const int block = i / size;
+        const int position = i % size;
+        const float* in = input + (std::size_t)block*size*lineLength;
+        float* out = output + ((std::size_t)block*size + position)*lineLength;
+
+        for(std::size_t j = 0; j < lineLength; j++)
+            out[j] = 0.0f;
+        for(int k = -halfSize; k <= halfSize; k++) {
+            const float weight = mask[k+halfSize];
+            const int neighbour = std::min(std::max(position+k, 0), size-1);
+            const float* line = in + (std::size_t)neighbour*lineLength;
+            for(std::size_t j = 0; j < lineLength; j++)
+                out[j] += weight*line[j];
         }
     }
+}
 
-    ExecutionDevice::pointer device = getMainDevice();
-    if(!device->isHost()) {
-        OpenCLDevice::pointer clDevice = device;
-        uint bufferSize;
-        if(useSeperableFilter) {
-            bufferSize = maskSize;
-        } else {
-            bufferSize = input->getDimensions() == 2 ? maskSize*maskSize : maskSize*maskSize*maskSize;
+// Convert the result to the output type, integer types are rounded like in the OpenCL kernels
+template <class T>
+void convertFromFloat(const float* input, T* output, std::size_t size) {
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    const float minimum = isInteger ? (float)std::numeric_limits<T>::min() : -std::numeric_limits<float>::max();
+    const float maximum = isInteger ? (float)std::numeric_limits<T>::max() : std::numeric_limits<float>::max();
+
+    #pragma omp parallel for
+    for(long long i = 0; i < (long long)size; i++) {
+        float value = input[i];
+        if(isInteger)
+            value = std::min(std::max((float)round(value), minimum), maximum);
+        output[i] = (T)value;
+    }
+}
+
+template <class T>
+void executeAlgorithmOnHost(Image::pointer input, Image::pointer output, const std::vector<float>& mask) {
+    const int width = input->getWidth();
+    const int height = input->getHeight();
+    const int depth = input->getDepth();
+    const int nrOfComponents = input->getNrOfComponents();
+    const std::size_t size = (std::size_t)width*height*depth*nrOfComponents;
+
+    ImageAccess::pointer inputAccess = input->getImageAccess(ACCESS_READ);
+    ImageAccess::pointer outputAccess = output->getImageAccess(ACCESS_READ_WRITE);
+    const T* inputData = (const T*)inputAccess->get();
+
+    // The last pass writes directly to the output if it is float
+    std::vector<float> temp1(size);
+    std::vector<float> temp2;
+    float* result = output->getDataType() == TYPE_FLOAT ? (float*)outputAccess->get() : NULL;
+
+    if(input->getDimensions() == 2) {
+        convolveRows<T>(inputData, temp1.data(), mask, width, height, nrOfComponents);
+        if(result == NULL) {
+            temp2.resize(size);
+            result = temp2.data();
         }
-        mCLMask = cl::Buffer(
-                clDevice->getContext(),
-                CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                sizeof(float)*bufferSize,
-                mMask
-        );
+        convolveLines(temp1.data(), result, mask, height, (std::size_t)width*nrOfComponents, 1);
+    } else {
+        temp2.resize(size);
+        convolveRows<T>(inputData, temp1.data(), mask, width, height*depth, nrOfComponents);
+        convolveLines(temp1.data(), temp2.data(), mask, height, (std::size_t)width*nrOfComponents, depth);
+        if(result == NULL)
+            result = temp1.data();
+        convolveLines(temp2.data(), result, mask, depth, (std::size_t)width*height*nrOfComponents, 1);
     }
 
-    mRecreateMask = false;
+    if(output->getDataType() != TYPE_FLOAT) {
+        switch(output->getDataType()) {
+            fastSwitchTypeMacro(convertFromFloat<FAST_TYPE>(result, (FAST_TYPE*)outputAccess->get(), size))
+        }
+    }
 }
 
-void GaussianSmoothingFilter::recompileOpenCLCode(Image::pointer input) {
-    // Check if there is a need to recompile OpenCL code
-    if(input->getDimensions() == mDimensionCLCodeCompiledFor &&
-            input->getDataType() == mTypeCLCodeCompiledFor)
-        return;
+// Build option which selects how the kernels read or write images of the
+// given type. Normalized integer images are accessed as float.
+static std::string getImageTypeDefine(std::string prefix, DataType type) {
+    switch(type) {
+    case TYPE_FLOAT:
+    case TYPE_UNORM_INT16:
+    case TYPE_SNORM_INT16:
+        return " -D" + prefix + "FLOAT";
+    case TYPE_UINT8:
+    case TYPE_UINT16:
+        return " -D" + prefix + "UINT";
+    default:
+        return " -D" + prefix + "INT";
+    }
+}
 
-    OpenCLDevice::pointer device = getMainDevice();
-    std::string buildOptions = "";
-    if(!device->isWritingTo3DTexturesSupported()) {
-        buildOptions = "-DTYPE=" + getCTypeAsString(mOutputType);
+// Build option which selects the type of the kernels' output buffer
+static std::string getBufferTypeDefine(DataType type) {
+    switch(type) {
+    case TYPE_FLOAT:
+        return " -DOUTPUT_BUFFER_FLOAT";
+    case TYPE_UINT8:
+        return " -DOUTPUT_BUFFER_UINT8";
+    case TYPE_INT8:
+        return " -DOUTPUT_BUFFER_INT8";
+    case TYPE_UINT16:
+        return " -DOUTPUT_BUFFER_UINT16";
+    case TYPE_INT16:
+        return " -DOUTPUT_BUFFER_INT16";
+    case TYPE_UNORM_INT16:
+        return " -DOUTPUT_BUFFER_UNORM_INT16";
+    case TYPE_SNORM_INT16:
+        return " -DOUTPUT_BUFFER_SNORM_INT16";
     }
-    cl::Program program;
-    if(input->getDimensions() == 2) {
-        program = getOpenCLProgram(device, "2D", buildOptions);
+    throw Exception("Unknown data type in GaussianSmoothingFilter");
+}
+
+static int getNrOfChannels(cl::Image* image) {
+    cl_channel_order order = image->getImageInfo<CL_IMAGE_FORMAT>().image_channel_order;
+    if(order == CL_R)
+        return 1;
+    if(order == CL_RG)
+        return 2;
+    return 4;
+}
+
+// Set a kernel argument to an OpenCL image or buffer
+static void setMemoryArg(cl::Kernel& kernel, cl_uint index, cl::Memory* memory) {
+    cl_mem object = (*memory)();
+    kernel.setArg(index, sizeof(cl_mem), &object);
+}
+
+// Coefficients B, b1/b0, b2/b0 and b3/b0 of the recursive gaussian filter by
+// Young and van Vliet, "Recursive implementation of the Gaussian filter" (1995)
+static cl_float4 getRecursiveFilterCoefficients(float stdDev) {
+    float q;
+    if(stdDev >= 2.5f) {
+        q = 0.98711f*stdDev - 0.96330f;
     } else {
-        program = getOpenCLProgram(device, "3D", buildOptions);
+        q = 3.97156f - 4.14554f*sqrt(1.0f - 0.26891f*stdDev);
     }
-    mKernel = cl::Kernel(program, "gaussianSmoothing");
-    mDimensionCLCodeCompiledFor = input->getDimensions();
-    mTypeCLCodeCompiledFor = input->getDataType();
+    const float b0 = 1.57825f + 2.44413f*q + 1.4281f*q*q + 0.422205f*q*q*q;
+    const float b1 = 2.44413f*q + 2.85619f*q*q + 1.26661f*q*q*q;
+    const float b2 = -(1.4281f*q*q + 1.26661f*q*q*q);
+    const float b3 = 0.422205f*q*q*q;
+
+    cl_float4 coefficients;
+    coefficients.s[0] = 1.0f - (b1+b2+b3)/b0;
+    coefficients.s[1] = b1/b0;
+    coefficients.s[2] = b2/b0;
+    coefficients.s[3] = b3/b0;
+    return coefficients;
 }
 
-template <class T>
-void executeAlgorithmOnHost(Image::pointer input, Image::pointer output, float * mask, unsigned char maskSize) {
-    // TODO: this method currently only processes the first component
-    unsigned int nrOfComponents = input->getNrOfComponents();
-    ImageAccess::pointer inputAccess = input->getImageAccess(ACCESS_READ);
-    ImageAccess::pointer outputAccess = output->getImageAccess(ACCESS_READ_WRITE);
+// Work group size of the tiled kernels: pixels along the filter direction, and lines
+static const std::size_t tileLength = 32;
+static const std::size_t nrOfTileLines = 8;
+
+void GaussianSmoothingFilter::executeOnOpenCLDevice(Image::pointer input, Image::pointer output, OpenCLDevice::pointer device, int maskSize) {
+    const uchar dimensions = input->getDimensions();
+    const Vector3ui size = input->getSize();
+    const std::size_t nrOfPixels = (std::size_t)size.x()*size.y()*size.z();
+    cl::Device clDevice = device->getDevice();
+    cl::CommandQueue queue = device->getCommandQueue();
+    ImagePool& pool = ImagePool::getInstance();
+
+    bool useRecursiveFilter = mUseRecursiveFilter;
+    if(!useRecursiveFilter && sizeof(float)*maskSize > clDevice.getInfo<CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE>()) {
+        reportWarning() << "Mask of size " << maskSize << " doesn't fit in constant memory, using recursive filter in GaussianSmoothingFilter" << Reporter::end;
+        useRecursiveFilter = true;
+    }
+
+    // Use the tiled kernels if a tile fits in local memory. Not on CPUs, where local memory is no faster.
+    const std::size_t tileSize = (tileLength+maskSize-1)*nrOfTileLines*sizeof(cl_float4);
+    const bool useTiles = !useRecursiveFilter &&
+            clDevice.getInfo<CL_DEVICE_TYPE>() != CL_DEVICE_TYPE_CPU &&
+            clDevice.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() >= tileSize &&
+            clDevice.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>() >= tileLength*nrOfTileLines;
+
+    if(!useRecursiveFilter)
+        createMask(device, maskSize);
+
+    // Without 3D image writes the passes write to buffers, which are copied into images
+    const bool writeToBuffer = dimensions == 3 && !device->isWritingTo3DTexturesSupported();
+
+    OpenCLImageAccess::pointer inputAccess = input->getOpenCLImageAccess(ACCESS_READ, device);
+    OpenCLImageAccess::pointer outputImageAccess;
+    OpenCLBufferAccess::pointer outputBufferAccess;
+    cl::Memory* outputMemory;
+    if(writeToBuffer) {
+        outputBufferAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+        outputMemory = outputBufferAccess->get();
+    } else {
+        outputImageAccess = output->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
+        outputMemory = dimensions == 2 ? (cl::Memory*)outputImageAccess->get2DImage() : (cl::Memory*)outputImageAccess->get3DImage();
+    }
 
-    T * inputData = (T*)inputAccess->get();
-    T * outputData = (T*)outputAccess->get();
-
-    const unsigned char halfSize = (maskSize-1)/2;
-    unsigned int width = input->getWidth();
-    unsigned int height = input->getHeight();
-    if(input->getDimensions() == 3) {
-        unsigned int depth = input->getDepth();
-        for(unsigned int z = 0; z < depth; z++) {
-        for(unsigned int y = 0; y < height; y++) {
-        for(unsigned int x = 0; x < width; x++) {
-
-            if(x < halfSize || x >= width-halfSize ||
-            y < halfSize || y >= height-halfSize ||
-            z < halfSize || z >= depth-halfSize) {
-                // on border only copy values
-                outputData[x*nrOfComponents+y*nrOfComponents*width+z*nrOfComponents*width*height] = inputData[x*nrOfComponents+y*nrOfComponents*width+z*nrOfComponents*width*height];
-                continue;
+    cl::Buffer* scratch = NULL;
+    if(useRecursiveFilter)
+        scratch = pool.getOpenCLBuffer(device, size, TYPE_FLOAT, 4);
+    cl::Buffer* staging = NULL;
+    int stagingChannels = 0;
+
+    // One pass per direction. Passes before the last store their result in a float image.
+    cl::Image* source = dimensions == 2 ? (cl::Image*)inputAccess->get2DImage() : (cl::Image*)inputAccess->get3DImage();
+    DataType sourceType = input->getDataType();
+    std::vector<cl::Image*> intermediates;
+    for(int direction = 0; direction < dimensions; ++direction) {
+        cl::Image* intermediate = NULL;
+        cl::Memory* target;
+        DataType targetType;
+        int components;
+        if(direction == dimensions-1) {
+            target = outputMemory;
+            targetType = output->getDataType();
+            components = output->getNrOfComponents();
+        } else {
+            intermediate = pool.getOpenCLImage(device, dimensions, size, TYPE_FLOAT, input->getNrOfComponents());
+            intermediates.push_back(intermediate);
+            targetType = TYPE_FLOAT;
+            components = getNrOfChannels(intermediate);
+            target = intermediate;
+            if(writeToBuffer) {
+                if(staging == NULL) {
+                    stagingChannels = components;
+                    staging = pool.getOpenCLBuffer(device, size, TYPE_FLOAT, stagingChannels);
+                }
+                target = staging;
             }
+        }
 
-            double sum = 0.0;
-            for(int c = -halfSize; c <= halfSize; c++) {
-            for(int b = -halfSize; b <= halfSize; b++) {
-            for(int a = -halfSize; a <= halfSize; a++) {
-                sum += mask[a+halfSize+(b+halfSize)*maskSize+(c+halfSize)*maskSize*maskSize]*
-                        inputData[(x+a)*nrOfComponents+(y+b)*nrOfComponents*width+(z+c)*nrOfComponents*width*height];
-            }}}
-            outputData[x*nrOfComponents+y*nrOfComponents*width+z*nrOfComponents*width*height] = (T)sum;
-        }}}
-    } else {
-        for(unsigned int y = halfSize; y < height-halfSize; y++) {
-        for(unsigned int x = halfSize; x < width-halfSize; x++) {
-
-            if(x < halfSize || x >= width-halfSize ||
-            y < halfSize || y >= height-halfSize) {
-                // on border only copy values
-                outputData[x*nrOfComponents+y*nrOfComponents*width] = inputData[x*nrOfComponents+y*nrOfComponents*width];
-                continue;
+        std::string buildOptions = getImageTypeDefine("INPUT_", sourceType) +
+                (writeToBuffer ? getBufferTypeDefine(targetType) : getImageTypeDefine("OUTPUT_", targetType));
+        // The first pass has to wait for a non-blocking upload of the input
+        const VECTOR_CLASS<cl::Event>* waitList = direction == 0 ? inputAccess->getEventWaitList() : NULL;
+
+        if(useRecursiveFilter) {
+            cl::Kernel kernel = getKernel(device, dimensions, "recursiveGaussianSmoothing", buildOptions);
+            setMemoryArg(kernel, 0, source);
+            kernel.setArg(1, *scratch);
+            setMemoryArg(kernel, 2, target);
+            kernel.setArg(3, getRecursiveFilterCoefficients(mStdDev));
+            kernel.setArg(4, direction);
+            if(dimensions == 3)
+                kernel.setArg(5, components);
+            queue.enqueueNDRangeKernel(
+                    kernel,
+                    cl::NullRange,
+                    cl::NDRange(nrOfPixels / size[direction]),
+                    cl::NullRange,
+                    waitList
+            );
+        } else {
+            cl::Kernel kernel;
+            bool tiled = false;
+            if(useTiles) {
+                kernel = getKernel(device, dimensions, "gaussianSmoothingTiled", buildOptions);
+                tiled = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(clDevice) >= tileLength*nrOfTileLines;
+            }
+            if(!tiled)
+                kernel = getKernel(device, dimensions, "gaussianSmoothing", buildOptions);
+            setMemoryArg(kernel, 0, source);
+            kernel.setArg(1, mCLMask);
+            setMemoryArg(kernel, 2, target);
+            kernel.setArg(3, maskSize);
+            kernel.setArg(4, direction);
+            int nextArg = 5;
+            if(dimensions == 3)
+                kernel.setArg(nextArg++, components);
+
+            cl::NDRange globalSize, localSize;
+            if(tiled) {
+                kernel.setArg(nextArg, cl::__local(tileSize));
+                // The work group is a tile of lines along the direction, and the
+                // global size is rounded up to a multiple of it
+                std::size_t local[3] = {2, 2, 2};
+                if(dimensions == 2) {
+                    local[0] = local[1] = nrOfTileLines;
+                } else {
+                    local[direction == 0 ? 1 : 0] = nrOfTileLines/2;
+                }
+                local[direction] = tileLength;
+                std::size_t global[3];
+                for(int i = 0; i < 3; i++)
+                    global[i] = ((size[i]+local[i]-1)/local[i])*local[i];
+                if(dimensions == 2) {
+                    globalSize = cl::NDRange(global[0], global[1]);
+                    localSize = cl::NDRange(local[0], local[1]);
+                } else {
+                    globalSize = cl::NDRange(global[0], global[1], global[2]);
+                    localSize = cl::NDRange(local[0], local[1], local[2]);
+                }
+            } else {
+                if(dimensions == 2) {
+                    globalSize = cl::NDRange(size.x(), size.y());
+                } else {
+                    globalSize = cl::NDRange(size.x(), size.y(), size.z());
+                }
+                localSize = cl::NullRange;
             }
+            queue.enqueueNDRangeKernel(
+                    kernel,
+                    cl::NullRange,
+                    globalSize,
+                    localSize,
+                    waitList
+            );
+        }
 
-            double sum = 0.0;
-            for(int b = -halfSize; b <= halfSize; b++) {
-            for(int a = -halfSize; a <= halfSize; a++) {
-                sum += mask[a+halfSize+(b+halfSize)*maskSize]*
-                        inputData[(x+a)*nrOfComponents+(y+b)*nrOfComponents*width];
-            }}
-            outputData[x*nrOfComponents+y*nrOfComponents*width] = (T)sum;
-        }}
+        if(intermediate != NULL) {
+            if(writeToBuffer)
+                queue.enqueueCopyBufferToImage(*staging, *intermediate, 0, createOrigoRegion(), createRegion(size));
+            source = intermediate;
+            sourceType = TYPE_FLOAT;
+        }
     }
+
+    // The temporary images and buffers can be given back to the pool right
+    // away, since later commands on the device's queue execute after these
+    for(int i = 0; i < intermediates.size(); i++)
+        pool.returnOpenCLImage(intermediates[i], device, dimensions, size, TYPE_FLOAT, input->getNrOfComponents());
+    if(staging != NULL)
+        pool.returnOpenCLBuffer(staging, device, size, TYPE_FLOAT, stagingChannels);
+    if(scratch != NULL)
+        pool.returnOpenCLBuffer(scratch, device, size, TYPE_FLOAT, 4);
 }
 
 void GaussianSmoothingFilter::execute() {
     Image::pointer input = getStaticInputData<Image>(0);
     Image::pointer output = getStaticOutputData<Image>(0);
 
-    char maskSize = mMaskSize;
+    int maskSize = mMaskSize;
     if(maskSize <= 0) // If mask size is not set calculate it instead
         maskSize = ceil(2*mStdDev)*2+1;
 
-    if(maskSize > 19)
-        maskSize = 19;
-
     // Initialize output image
     ExecutionDevice::pointer device = getMainDevice();
+    output->enableStoragePooling(); // reuse storage of old frames when streaming
     if(mOutputTypeSet) {
         output->create(input->getSize(), mOutputType, input->getNrOfComponents());
         output->setSpacing(input->getSpacing());
@@ -221,87 +503,12 @@ void GaussianSmoothingFilter::execute() {
 
 
     if(device->isHost()) {
-        createMask(input, maskSize, false);
+        std::vector<float> mask = createSeparableMask(mStdDev, maskSize);
         switch(input->getDataType()) {
-            fastSwitchTypeMacro(executeAlgorithmOnHost<FAST_TYPE>(input, output, mMask, maskSize));
+            fastSwitchTypeMacro(executeAlgorithmOnHost<FAST_TYPE>(input, output, mask));
         }
     } else {
-        OpenCLDevice::pointer clDevice = device;
-
-        recompileOpenCLCode(input);
-
-        cl::NDRange globalSize;
-
-        OpenCLImageAccess::pointer inputAccess = input->getOpenCLImageAccess(ACCESS_READ, device);
-        if(input->getDimensions() == 2) {
-            createMask(input, maskSize, false);
-            mKernel.setArg(1, mCLMask);
-            mKernel.setArg(3, maskSize);
-            globalSize = cl::NDRange(input->getWidth(),input->getHeight());
-
-            OpenCLImageAccess::pointer outputAccess = output->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
-            mKernel.setArg(0, *inputAccess->get2DImage());
-            mKernel.setArg(2, *outputAccess->get2DImage());
-            clDevice->getCommandQueue().enqueueNDRangeKernel(
-                    mKernel,
-                    cl::NullRange,
-                    globalSize,
-                    cl::NullRange
-            );
-        } else {
-            // Create an auxilliary image
-            Image::pointer output2 = Image::New();
-            output2->createFromImage(output);
-
-            globalSize = cl::NDRange(input->getWidth(),input->getHeight(),input->getDepth());
-
-            if(clDevice->isWritingTo3DTexturesSupported()) {
-                createMask(input, maskSize, true);
-                mKernel.setArg(1, mCLMask);
-                mKernel.setArg(3, maskSize);
-                OpenCLImageAccess::pointer outputAccess = output->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
-                OpenCLImageAccess::pointer outputAccess2 = output2->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
-
-                cl::Image3D* image2;
-                cl::Image3D* image;
-                image = outputAccess->get3DImage();
-                image2 = outputAccess->get3DImage();
-                for(uchar direction = 0; direction < input->getDimensions(); ++direction) {
-                    if(direction == 0) {
-                        mKernel.setArg(0, *inputAccess->get3DImage());
-                        mKernel.setArg(2, *image);
-                    } else if(direction == 1) {
-                        mKernel.setArg(0, *image);
-                        mKernel.setArg(2, *image2);
-                    } else {
-                        mKernel.setArg(0, *image2);
-                        mKernel.setArg(2, *image);
-                    }
-                    mKernel.setArg(4, direction);
-                    clDevice->getCommandQueue().enqueueNDRangeKernel(
-                            mKernel,
-                            cl::NullRange,
-                            globalSize,
-                            cl::NullRange
-                    );
-                }
-            } else {
-                createMask(input, maskSize, false);
-                mKernel.setArg(1, mCLMask);
-                mKernel.setArg(3, maskSize);
-                OpenCLBufferAccess::pointer outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
-                mKernel.setArg(0, *inputAccess->get3DImage());
-                mKernel.setArg(2, *outputAccess->get());
-                clDevice->getCommandQueue().enqueueNDRangeKernel(
-                        mKernel,
-                        cl::NullRange,
-                        globalSize,
-                        cl::NullRange
-                );
-            }
-
-
-        }
+        executeOnOpenCLDevice(input, output, device, maskSize);
     }
 }
 
@@ -4,6 +4,7 @@
 #include "FAST/ProcessObject.hpp"
 #include "FAST/ExecutionDevice.hpp"
 #include "FAST/Data/Image.hpp"
+#include <map>
 
 namespace fast {
 
@@ -13,24 +14,36 @@ class GaussianSmoothingFilter : public ProcessObject {
         void setMaskSize(unsigned char maskSize);
         void setStandardDeviation(float stdDev);
         void setOutputType(DataType type);
+        /**
+         * Use a recursive approximation of the gaussian filter on OpenCL
+         * devices. Its cost does not depend on the standard deviation, which
+         * makes it suitable for large standard deviations. The mask size is
+         * not used by the recursive filter.
+         */
+        void enableRecursiveFiltering();
+        void disableRecursiveFiltering();
         ~GaussianSmoothingFilter();
     private:
         GaussianSmoothingFilter();
         void execute();
+        void executeOnOpenCLDevice(Image::pointer input, Image::pointer output, OpenCLDevice::pointer device, int maskSize);
         void waitToFinish();
-        void createMask(Image::pointer input, uchar maskSize, bool useSeperableFilter);
-        void recompileOpenCLCode(Image::pointer input);
+        void createMask(OpenCLDevice::pointer device, int maskSize);
+        cl::Kernel getKernel(OpenCLDevice::pointer device, uchar dimensions, std::string name, std::string buildOptions);
 
-        char mMaskSize;
+        int mMaskSize;
         float mStdDev;
+        bool mUseRecursiveFilter;
 
+        // 1D mask of the separable filter
         cl::Buffer mCLMask;
-        float * mMask;
+        int mCLMaskSize;
+        OpenCLDevice::pointer mCLMaskDevice;
         bool mRecreateMask;
 
-        cl::Kernel mKernel;
-        unsigned char mDimensionCLCodeCompiledFor;
-        DataType mTypeCLCodeCompiledFor;
+        // Kernels for each combination of dimension, name and build options
+        std::map<std::string, cl::Kernel> mKernels;
+        OpenCLDevice::pointer mKernelDevice;
         DataType mOutputType;
         bool mOutputTypeSet;
 
@@ -1,35 +1,136 @@
+// The kernels are specialized for the data types at build time.
+// INPUT_FLOAT, INPUT_UINT or INPUT_INT selects how the input image is read,
+// and OUTPUT_FLOAT, OUTPUT_UINT or OUTPUT_INT how the output image is written.
+#ifdef INPUT_FLOAT
+#define READ_IMAGE(image, pos) read_imagef(image, sampler, pos)
+#elif defined(INPUT_UINT)
+#define READ_IMAGE(image, pos) convert_float4(read_imageui(image, sampler, pos))
+#else
+#define READ_IMAGE(image, pos) convert_float4(read_imagei(image, sampler, pos))
+#endif
+
+#ifdef OUTPUT_FLOAT
+#define WRITE_IMAGE(image, pos, value) write_imagef(image, pos, value)
+#elif defined(OUTPUT_UINT)
+#define WRITE_IMAGE(image, pos, value) write_imageui(image, pos, convert_uint4_sat_rte(value))
+#else
+#define WRITE_IMAGE(image, pos, value) write_imagei(image, pos, convert_int4_sat_rte(value))
+#endif
+
 __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
 
+// One pass of the separable gaussian filter, direction 0 is x and 1 is y
 __kernel void gaussianSmoothing(
         __read_only image2d_t input,
         __constant float * mask,
         __write_only image2d_t output,
-        __private unsigned char maskSize
+        __private int maskSize,
+        __private int direction
         ) {
 
     const int2 pos = {get_global_id(0), get_global_id(1)};
-    const unsigned char halfSize = (maskSize-1)/2;
-
-    float sum = 0.0f;
-    int dataType = get_image_channel_data_type(input);
-    for(int x = -halfSize; x <= halfSize; x++) {
-    for(int y = -halfSize; y <= halfSize; y++) {
-        const int2 offset = {x,y};
-        if(dataType == CLK_FLOAT) {
-            sum += mask[x+halfSize+(y+halfSize)*maskSize]*read_imagef(input, sampler, pos+offset).x;
-        } else if(dataType == CLK_UNSIGNED_INT8 || dataType == CLK_UNSIGNED_INT16) {
-            sum += mask[x+halfSize+(y+halfSize)*maskSize]*read_imageui(input, sampler, pos+offset).x;
-        } else {
-            sum += mask[x+halfSize+(y+halfSize)*maskSize]*read_imagei(input, sampler, pos+offset).x;
-        }
-    }}
-
-    int outputDataType = get_image_channel_data_type(output);
-    if(outputDataType == CLK_FLOAT) {
-        write_imagef(output, pos, sum);
-    } else if(outputDataType == CLK_UNSIGNED_INT8 || outputDataType == CLK_UNSIGNED_INT16) {
-        write_imageui(output, pos, round(sum));
-    } else {
-        write_imagei(output, pos, round(sum));
+    const int2 step = {direction == 0, direction == 1};
+    const int halfSize = (maskSize-1)/2;
+
+    float4 sum = 0.0f;
+    for(int i = -halfSize; i <= halfSize; ++i)
+        sum += mask[i+halfSize]*READ_IMAGE(input, pos+i*step);
+
+    WRITE_IMAGE(output, pos, sum);
+}
+
+// Same as gaussianSmoothing, but each work group first reads the pixels it
+// needs into local memory. Each line of the work group along the direction
+// needs get_local_size(direction)+maskSize-1 float4 elements of the tile.
+// The global size may be rounded up to a multiple of the work group size.
+__kernel void gaussianSmoothingTiled(
+        __read_only image2d_t input,
+        __constant float * mask,
+        __write_only image2d_t output,
+        __private int maskSize,
+        __private int direction,
+        __local float4 * tile
+        ) {
+
+    const int2 pos = {get_global_id(0), get_global_id(1)};
+    const int2 step = {direction == 0, direction == 1};
+    const int halfSize = (maskSize-1)/2;
+    const int localPos = get_local_id(direction);
+    const int localSize = get_local_size(direction);
+    const int tileWidth = localSize+2*halfSize;
+    __local float4 * tileLine = tile + get_local_id(1-direction)*tileWidth;
+
+    // Read the pixels of the line and the mask radius on each side of it
+    const int2 lineStart = pos - (localPos+halfSize)*step;
+    for(int i = localPos; i < tileWidth; i += localSize)
+        tileLine[i] = READ_IMAGE(input, lineStart+i*step);
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    float4 sum = 0.0f;
+    for(int i = 0; i < maskSize; ++i)
+        sum += mask[i]*tileLine[localPos+i];
+
+    if(pos.x < get_image_width(output) && pos.y < get_image_height(output))
+        WRITE_IMAGE(output, pos, sum);
+}
+
+// Initial values of the backward recursive pass, for a line which continues
+// with its last value. From Triggs and Sdika, "Boundary conditions for
+// Young-van Vliet recursive filtering" (2006).
+void getBackwardInitialValues(float4 coefficients, float4 edge, float4 w1, float4 w2, float4 w3, float4* y1, float4* y2, float4* y3) {
+    const float a1 = -coefficients.y;
+    const float a2 = -coefficients.z;
+    const float a3 = -coefficients.w;
+    const float scale = 1.0f/((1.0f+a1-a2+a3)*(1.0f-a1-a2-a3)*(1.0f+a2+(a1-a3)*a3));
+    const float4 d1 = w1 - edge;
+    const float4 d2 = w2 - edge;
+    const float4 d3 = w3 - edge;
+    *y1 = edge + scale*((-a3*a1+1.0f-a3*a3-a2)*d1 + (a3+a1)*(a2+a3*a1)*d2 + a3*(a1+a3*a2)*d3);
+    *y2 = edge + scale*((a1+a3*a2)*d1 - (a2-1.0f)*(a2+a3*a1)*d2 - a3*(a3*a1+a3*a3+a2-1.0f)*d3);
+    *y3 = edge + scale*((a3*a1+a2+a1*a1-a2*a2)*d1 + (a1*a2+a3*a2*a2-a1*a3*a3-a3*a3*a3-a3*a2+a3)*d2 + a3*(a1+a3*a2)*d3);
+}
+
+// Recursive approximation of the gaussian filter (Young and van Vliet) for
+// large standard deviations. Each work item filters one line in the direction,
+// forwards into the scratch buffer and then backwards into the output.
+// The coefficients are B, b1/b0, b2/b0 and b3/b0.
+__kernel void recursiveGaussianSmoothing(
+        __read_only image2d_t input,
+        __global float4 * scratch,
+        __write_only image2d_t output,
+        __private float4 coefficients,
+        __private int direction
+        ) {
+
+    const int line = get_global_id(0);
+    const int nrOfLines = get_global_size(0);
+    const int2 step = {direction == 0, direction == 1};
+    const int2 lineStart = {direction == 0 ? 0 : line, direction == 0 ? line : 0};
+    const int length = direction == 0 ? get_image_width(input) : get_image_height(input);
+
+    // Edges are treated as constant, like the clamping of the other kernels
+    float4 w1 = READ_IMAGE(input, lineStart);
+    float4 w2 = w1;
+    float4 w3 = w1;
+    float4 edge;
+    for(int n = 0; n < length; ++n) {
+        edge = READ_IMAGE(input, lineStart+n*step);
+        const float4 w = coefficients.x*edge + coefficients.y*w1 + coefficients.z*w2 + coefficients.w*w3;
+        scratch[(size_t)n*nrOfLines+line] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    float4 y1, y2, y3;
+    getBackwardInitialValues(coefficients, edge, w1, w2, w3, &y1, &y2, &y3);
+    WRITE_IMAGE(output, lineStart+(length-1)*step, y1);
+    for(int n = length-2; n >= 0; --n) {
+        const float4 y = coefficients.x*scratch[(size_t)n*nrOfLines+line] +
+                coefficients.y*y1 + coefficients.z*y2 + coefficients.w*y3;
+        WRITE_IMAGE(output, lineStart+n*step, y);
+        y3 = y2;
+        y2 = y1;
+        y1 = y;
     }
 }
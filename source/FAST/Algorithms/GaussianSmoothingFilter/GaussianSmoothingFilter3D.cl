@@ -1,75 +1,208 @@
+#ifdef cl_khr_3d_image_writes
+#pragma OPENCL EXTENSION cl_khr_3d_image_writes : enable
+#endif
+
+// The kernels are specialized for the data types at build time.
+// INPUT_FLOAT, INPUT_UINT or INPUT_INT selects how the input image is read.
+// OUTPUT_FLOAT, OUTPUT_UINT or OUTPUT_INT selects how the output image is
+// written. On devices without 3D image writes OUTPUT_BUFFER_<type> is used
+// instead, and the output is a buffer with components values per pixel.
+#ifdef INPUT_FLOAT
+#define READ_IMAGE(image, pos) read_imagef(image, sampler, pos)
+#elif defined(INPUT_UINT)
+#define READ_IMAGE(image, pos) convert_float4(read_imageui(image, sampler, pos))
+#else
+#define READ_IMAGE(image, pos) convert_float4(read_imagei(image, sampler, pos))
+#endif
+
+#if defined(OUTPUT_BUFFER_FLOAT)
+#define OUTPUT_BUFFER
+#define BUFFER_TYPE float
+#define CONVERT(value) (value)
+#elif defined(OUTPUT_BUFFER_UINT8)
+#define OUTPUT_BUFFER
+#define BUFFER_TYPE uchar
+#define CONVERT(value) convert_uchar4_sat_rte(value)
+#elif defined(OUTPUT_BUFFER_INT8)
+#define OUTPUT_BUFFER
+#define BUFFER_TYPE char
+#define CONVERT(value) convert_char4_sat_rte(value)
+#elif defined(OUTPUT_BUFFER_UINT16)
+#define OUTPUT_BUFFER
+#define BUFFER_TYPE ushort
+#define CONVERT(value) convert_ushort4_sat_rte(value)
+#elif defined(OUTPUT_BUFFER_INT16)
+#define OUTPUT_BUFFER
+#define BUFFER_TYPE short
+#define CONVERT(value) convert_short4_sat_rte(value)
+#elif defined(OUTPUT_BUFFER_UNORM_INT16)
+#define OUTPUT_BUFFER
+#define BUFFER_TYPE ushort
+#define CONVERT(value) convert_ushort4_sat_rte(value*65535.0f)
+#elif defined(OUTPUT_BUFFER_SNORM_INT16)
+#define OUTPUT_BUFFER
+#define BUFFER_TYPE short
+#define CONVERT(value) convert_short4_sat_rte(value*32767.0f)
+#endif
+
+#ifdef OUTPUT_BUFFER
+#define OUTPUT_TYPE __global BUFFER_TYPE *
+#define WRITE(output, pos, value) writeToBuffer(output, pos, value, components, get_image_width(input), get_image_height(input))
+
+void writeToBuffer(__global BUFFER_TYPE * output, int4 pos, float4 value, int components, int width, int height) {
+    const size_t index = (pos.x + pos.y*(size_t)width + pos.z*(size_t)width*height)*components;
+    output[index] = CONVERT(value).x;
+    if(components > 1)
+        output[index+1] = CONVERT(value).y;
+    if(components > 2)
+        output[index+2] = CONVERT(value).z;
+    if(components > 3)
+        output[index+3] = CONVERT(value).w;
+}
+#else
+#define OUTPUT_TYPE __write_only image3d_t
+#ifdef OUTPUT_FLOAT
+#define WRITE(output, pos, value) write_imagef(output, pos, value)
+#elif defined(OUTPUT_UINT)
+#define WRITE(output, pos, value) write_imageui(output, pos, convert_uint4_sat_rte(value))
+#else
+#define WRITE(output, pos, value) write_imagei(output, pos, convert_int4_sat_rte(value))
+#endif
+#endif
+
 __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
 
-#ifdef cl_khr_3d_image_writes
+// One pass of the separable gaussian filter, direction 0 is x, 1 is y and 2 is z.
+// The components argument is only used when writing to a buffer.
 __kernel void gaussianSmoothing(
         __read_only image3d_t input,
         __constant float * mask,
-        __write_only image3d_t output,
-        __private unsigned char maskSize,
-        __private unsigned char direction
+        OUTPUT_TYPE output,
+        __private int maskSize,
+        __private int direction,
+        __private int components
         ) {
 
     const int4 pos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
-    const unsigned char halfSize = (maskSize-1)/2;
-
-    float sum = 0.0f;
-    int dataType = get_image_channel_data_type(input);
-    for(int i = -halfSize; i <= halfSize; ++i) {
-        int4 offset = {0,0,0,0};
-        if(direction == 0) {
-            offset.x = i;
-        } else if(direction == 1) {
-            offset.y = i;
-        } else {
-            offset.z = i;
-        }
-        const uchar maskOffset = halfSize + i;
-        if(dataType == CLK_FLOAT) {
-            sum += mask[maskOffset]*read_imagef(input, sampler, pos+offset).x;
-        } else if(dataType == CLK_UNSIGNED_INT8 || dataType == CLK_UNSIGNED_INT16) {
-            sum += mask[maskOffset]*read_imageui(input, sampler, pos+offset).x;
-        } else {
-            sum += mask[maskOffset]*read_imagei(input, sampler, pos+offset).x;
-        }
-    }
+    const int4 step = {direction == 0, direction == 1, direction == 2, 0};
+    const int halfSize = (maskSize-1)/2;
 
-    int outputDataType = get_image_channel_data_type(output);
-    if(outputDataType == CLK_FLOAT) {
-        write_imagef(output, pos, sum);
-    } else if(outputDataType == CLK_UNSIGNED_INT8 || outputDataType == CLK_UNSIGNED_INT16) {
-        write_imageui(output, pos, round(sum));
-    } else {
-        write_imagei(output, pos, round(sum));
-    }
+    float4 sum = 0.0f;
+    for(int i = -halfSize; i <= halfSize; ++i)
+        sum += mask[i+halfSize]*READ_IMAGE(input, pos+i*step);
+
+    WRITE(output, pos, sum);
 }
 
-#else
-__kernel void gaussianSmoothing(
+// Same as gaussianSmoothing, but each work group first reads the pixels it
+// needs into local memory. Each line of the work group along the direction
+// needs get_local_size(direction)+maskSize-1 float4 elements of the tile.
+// The global size may be rounded up to a multiple of the work group size.
+__kernel void gaussianSmoothingTiled(
         __read_only image3d_t input,
         __constant float * mask,
-        __global TYPE* output,
-        __private unsigned char maskSize
+        OUTPUT_TYPE output,
+        __private int maskSize,
+        __private int direction,
+        __private int components,
+        __local float4 * tile
         ) {
 
     const int4 pos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
-    const unsigned char halfSize = (maskSize-1)/2;
-
-    float sum = 0.0f;
-    int dataType = get_image_channel_data_type(input);
-    for(int x = -halfSize; x <= halfSize; x++) {
-    for(int y = -halfSize; y <= halfSize; y++) {
-    for(int z = -halfSize; z <= halfSize; z++) {
-        const int4 offset = {x,y,z,0};
-        const uint maskOffset = x+halfSize+(y+halfSize)*maskSize+(z+halfSize)*maskSize*maskSize;
-        if(dataType == CLK_FLOAT) {
-            sum += mask[maskOffset]*read_imagef(input, sampler, pos+offset).x;
-        } else if(dataType == CLK_UNSIGNED_INT8 || dataType == CLK_UNSIGNED_INT16) {
-            sum += mask[maskOffset]*read_imageui(input, sampler, pos+offset).x;
-        } else {
-            sum += mask[maskOffset]*read_imagei(input, sampler, pos+offset).x;
-        }
-    }}}
-
-    output[pos.x+pos.y*get_global_size(0)+pos.z*get_global_size(0)*get_global_size(1)] = sum;
+    const int4 step = {direction == 0, direction == 1, direction == 2, 0};
+    const int halfSize = (maskSize-1)/2;
+    const int localPos = get_local_id(direction);
+    const int localSize = get_local_size(direction);
+    const int tileWidth = localSize+2*halfSize;
+    // The two other directions identify the line within the work group
+    const int a = direction == 0 ? 1 : 0;
+    const int b = direction == 2 ? 1 : 2;
+    const int line = get_local_id(a) + get_local_id(b)*get_local_size(a);
+    __local float4 * tileLine = tile + line*tileWidth;
+
+    // Read the pixels of the line and the mask radius on each side of it
+    const int4 lineStart = pos - (localPos+halfSize)*step;
+    for(int i = localPos; i < tileWidth; i += localSize)
+        tileLine[i] = READ_IMAGE(input, lineStart+i*step);
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    float4 sum = 0.0f;
+    for(int i = 0; i < maskSize; ++i)
+        sum += mask[i]*tileLine[localPos+i];
+
+    if(pos.x < get_image_width(input) && pos.y < get_image_height(input) && pos.z < get_image_depth(input))
+        WRITE(output, pos, sum);
+}
+
+// Initial values of the backward recursive pass, for a line which continues
+// with its last value. From Triggs and Sdika, "Boundary conditions for
+// Young-van Vliet recursive filtering" (2006).
+void getBackwardInitialValues(float4 coefficients, float4 edge, float4 w1, float4 w2, float4 w3, float4* y1, float4* y2, float4* y3) {
+    const float a1 = -coefficients.y;
+    const float a2 = -coefficients.z;
+    const float a3 = -coefficients.w;
+    const float scale = 1.0f/((1.0f+a1-a2+a3)*(1.0f-a1-a2-a3)*(1.0f+a2+(a1-a3)*a3));
+    const float4 d1 = w1 - edge;
+    const float4 d2 = w2 - edge;
+    const float4 d3 = w3 - edge;
+    *y1 = edge + scale*((-a3*a1+1.0f-a3*a3-a2)*d1 + (a3+a1)*(a2+a3*a1)*d2 + a3*(a1+a3*a2)*d3);
+    *y2 = edge + scale*((a1+a3*a2)*d1 - (a2-1.0f)*(a2+a3*a1)*d2 - a3*(a3*a1+a3*a3+a2-1.0f)*d3);
+    *y3 = edge + scale*((a3*a1+a2+a1*a1-a2*a2)*d1 + (a1*a2+a3*a2*a2-a1*a3*a3-a3*a3*a3-a3*a2+a3)*d2 + a3*(a1+a3*a2)*d3);
+}
+
+// Recursive approximation of the gaussian filter (Young and van Vliet) for
+// large standard deviations. Each work item filters one line in the direction,
+// forwards into the scratch buffer and then backwards into the output.
+// The coefficients are B, b1/b0, b2/b0 and b3/b0.
+__kernel void recursiveGaussianSmoothing(
+        __read_only image3d_t input,
+        __global float4 * scratch,
+        OUTPUT_TYPE output,
+        __private float4 coefficients,
+        __private int direction,
+        __private int components
+        ) {
+
+    const int line = get_global_id(0);
+    const int nrOfLines = get_global_size(0);
+    const int4 size = {get_image_width(input), get_image_height(input), get_image_depth(input), 0};
+    const int4 step = {direction == 0, direction == 1, direction == 2, 0};
+    int4 lineStart;
+    int length;
+    if(direction == 0) {
+        lineStart = (int4)(0, line % size.y, line / size.y, 0);
+        length = size.x;
+    } else if(direction == 1) {
+        lineStart = (int4)(line % size.x, 0, line / size.x, 0);
+        length = size.y;
+    } else {
+        lineStart = (int4)(line % size.x, line / size.x, 0, 0);
+        length = size.z;
+    }
+
+    // Edges are treated as constant, like the clamping of the other kernels
+    float4 w1 = READ_IMAGE(input, lineStart);
+    float4 w2 = w1;
+    float4 w3 = w1;
+    float4 edge;
+    for(int n = 0; n < length; ++n) {
+        edge = READ_IMAGE(input, lineStart+n*step);
+        const float4 w = coefficients.x*edge + coefficients.y*w1 + coefficients.z*w2 + coefficients.w*w3;
+        scratch[(size_t)n*nrOfLines+line] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    float4 y1, y2, y3;
+    getBackwardInitialValues(coefficients, edge, w1, w2, w3, &y1, &y2, &y3);
+    WRITE(output, lineStart+(length-1)*step, y1);
+    for(int n = length-2; n >= 0; --n) {
+        const float4 y = coefficients.x*scratch[(size_t)n*nrOfLines+line] +
+                coefficients.y*y1 + coefficients.z*y2 + coefficients.w*y3;
+        WRITE(output, lineStart+n*step, y);
+        y3 = y2;
+        y2 = y1;
+        y1 = y;
+    }
 }
-#endif
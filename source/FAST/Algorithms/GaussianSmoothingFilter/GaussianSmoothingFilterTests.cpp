@@ -24,6 +24,158 @@ TEST_CASE("Even input as mask size throws exception in GaussianSmoothingFilter",
     CHECK_THROWS(filter->setMaskSize(2));
 }
 
+TEST_CASE("Constant image stays constant with GaussianSmoothingFilter on Host", "[fast][GaussianSmoothingFilter]") {
+    Image::pointer image = Image::New();
+    image->create(16, 12, 8, TYPE_FLOAT, 1);
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+    float* data = (float*)access->get();
+    for(unsigned int i = 0; i < 16*12*8; i++)
+        data[i] = 3.5f;
+    access->release();
+
+    GaussianSmoothingFilter::pointer filter = GaussianSmoothingFilter::New();
+    filter->setMainDevice(Host::getInstance());
+    filter->setStandardDeviation(2.0);
+    filter->setInputData(image);
+    Image::pointer output = filter->getOutputData<Image>();
+    filter->update();
+
+    ImageAccess::pointer outputAccess = output->getImageAccess(ACCESS_READ);
+    float* result = (float*)outputAccess->get();
+    for(unsigned int i = 0; i < 16*12*8; i++)
+        CHECK(result[i] == Approx(3.5f));
+}
+
+TEST_CASE("GaussianSmoothingFilter on Host smooths all components of a 3D uint8 image", "[fast][GaussianSmoothingFilter]") {
+    const int width = 13, height = 9, depth = 7, components = 3;
+    const int maskSize = 5;
+    const float stdDev = 1.0f;
+    Image::pointer image = Image::New();
+    image->create(width, height, depth, TYPE_UINT8, components);
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+    uchar* data = (uchar*)access->get();
+    for(int i = 0; i < width*height*depth*components; i++)
+        data[i] = (i*37) % 256;
+    access->release();
+
+    GaussianSmoothingFilter::pointer filter = GaussianSmoothingFilter::New();
+    filter->setMainDevice(Host::getInstance());
+    filter->setMaskSize(maskSize);
+    filter->setStandardDeviation(stdDev);
+    filter->setInputData(image);
+    Image::pointer output = filter->getOutputData<Image>();
+    filter->update();
+
+    CHECK(output->getDataType() == TYPE_UINT8);
+    CHECK(output->getNrOfComponents() == components);
+
+    // Compare with a direct 3D convolution which clamps coordinates to the edge
+    float mask[maskSize];
+    float sum = 0.0f;
+    for(int i = 0; i < maskSize; i++) {
+        mask[i] = exp(-(float)((i-2)*(i-2))/(2.0f*stdDev*stdDev));
+        sum += mask[i];
+    }
+    for(int i = 0; i < maskSize; i++)
+        mask[i] /= sum;
+
+    ImageAccess::pointer outputAccess = output->getImageAccess(ACCESS_READ);
+    uchar* result = (uchar*)outputAccess->get();
+    int nrOfErrors = 0;
+    for(int z = 0; z < depth; z++) {
+    for(int y = 0; y < height; y++) {
+    for(int x = 0; x < width; x++) {
+    for(int c = 0; c < components; c++) {
+        float truth = 0.0f;
+        for(int a = -2; a <= 2; a++) {
+        for(int b = -2; b <= 2; b++) {
+        for(int d = -2; d <= 2; d++) {
+            int nx = std::min(std::max(x+a, 0), width-1);
+            int ny = std::min(std::max(y+b, 0), height-1);
+            int nz = std::min(std::max(z+d, 0), depth-1);
+            truth += mask[a+2]*mask[b+2]*mask[d+2]*data[(nx+ny*width+nz*width*height)*components+c];
+        }}}
+        int value = result[(x+y*width+z*width*height)*components+c];
+        if(abs(value - (int)round(truth)) > 1)
+            nrOfErrors++;
+    }}}}
+    CHECK(nrOfErrors == 0);
+}
+
+static Image::pointer runGaussianSmoothingFilter(Image::pointer image, ExecutionDevice::pointer device, float stdDev, bool recursive = false, uchar maskSize = 0) {
+    GaussianSmoothingFilter::pointer filter = GaussianSmoothingFilter::New();
+    filter->setMainDevice(device);
+    filter->setStandardDeviation(stdDev);
+    if(maskSize > 0)
+        filter->setMaskSize(maskSize);
+    if(recursive)
+        filter->enableRecursiveFiltering();
+    filter->setInputData(image);
+    Image::pointer output = filter->getOutputData<Image>();
+    filter->update();
+    return output;
+}
+
+static float getMaximumDifference(Image::pointer a, Image::pointer b) {
+    ImageAccess::pointer accessA = a->getImageAccess(ACCESS_READ);
+    ImageAccess::pointer accessB = b->getImageAccess(ACCESS_READ);
+    const std::size_t size = (std::size_t)a->getWidth()*a->getHeight()*a->getDepth();
+    float maximum = 0.0f;
+    for(std::size_t i = 0; i < size; i++) {
+        for(uchar c = 0; c < a->getNrOfComponents(); c++)
+            maximum = std::max(maximum, (float)fabs(accessA->getScalar(i, c) - accessB->getScalar(i, c)));
+    }
+    return maximum;
+}
+
+TEST_CASE("GaussianSmoothingFilter on OpenCL device matches Host with masks larger than 19", "[fast][GaussianSmoothingFilter]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+
+    Image::pointer image2D = Image::New();
+    image2D->create(97, 61, TYPE_FLOAT, 1);
+    ImageAccess::pointer access = image2D->getImageAccess(ACCESS_READ_WRITE);
+    float* data = (float*)access->get();
+    for(int i = 0; i < 97*61; i++)
+        data[i] = (i*37) % 101;
+    access->release();
+    CHECK(getMaximumDifference(
+            runGaussianSmoothingFilter(image2D, device, 6.0f),
+            runGaussianSmoothingFilter(image2D, Host::getInstance(), 6.0f)) < 0.01f);
+
+    Image::pointer image3D = Image::New();
+    image3D->create(41, 37, 29, TYPE_UINT8, 1);
+    ImageAccess::pointer access3D = image3D->getImageAccess(ACCESS_READ_WRITE);
+    uchar* data3D = (uchar*)access3D->get();
+    for(int i = 0; i < 41*37*29; i++)
+        data3D[i] = (i*37) % 256;
+    access3D->release();
+    CHECK(getMaximumDifference(
+            runGaussianSmoothingFilter(image3D, device, 5.0f),
+            runGaussianSmoothingFilter(image3D, Host::getInstance(), 5.0f)) <= 1.0f);
+}
+
+TEST_CASE("Recursive GaussianSmoothingFilter approximates the gaussian for large standard deviations", "[fast][GaussianSmoothingFilter]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+
+    // A smooth ramp with a bright square, so that the result is not constant
+    Image::pointer image = Image::New();
+    image->create(128, 96, TYPE_FLOAT, 1);
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+    float* data = (float*)access->get();
+    for(int y = 0; y < 96; y++) {
+    for(int x = 0; x < 128; x++) {
+        data[x+y*128] = x + (x > 40 && x < 80 && y > 30 && y < 60 ? 100.0f : 0.0f);
+    }}
+    access->release();
+
+    Image::pointer recursive = runGaussianSmoothingFilter(image, device, 8.0f, true);
+    // The default mask is cut off at two standard deviations, use a wider mask as reference
+    Image::pointer reference = runGaussianSmoothingFilter(image, Host::getInstance(), 8.0f, false, 65);
+    CHECK(getMaximumDifference(recursive, reference) < 5.0f);
+}
+
 /*
 TEST_CASE("Correct output with small 3x3 2D image as input to GaussianSmoothingFilter on OpenCLDevice", "[fast][GaussianSmoothingFilter]") {
     DeviceManager& deviceManager = DeviceManager::getInstance();
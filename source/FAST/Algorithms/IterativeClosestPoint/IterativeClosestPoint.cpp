@@ -3,18 +3,31 @@
 #undef min
 #undef max
 #include <limits>
+#include <random>
+#include <algorithm>
+#include <boost/chrono.hpp>
 
 namespace fast {
 
 IterativeClosestPoint::IterativeClosestPoint() {
     createInputPort<PointSet>(0);
     createInputPort<PointSet>(1);
+    // The output is dynamic data when the moving point set is
+    createOutputPort<AffineTransformation>(0, OUTPUT_DEPENDS_ON_INPUT, 1);
     mMaxIterations = 100;
+    mMaxRuntime = 0;
     mMinErrorChange = 1e-5;
     mError = -1;
+    mNrOfIterations = 0;
+    mOutlierRejectionFactor = 0;
+    mNrOfSamples = 0;
     mTransformationType = IterativeClosestPoint::RIGID;
+    mDistanceMetric = IterativeClosestPoint::POINT_TO_POINT;
+    mSamplingMode = IterativeClosestPoint::NO_SAMPLING;
     mIsModified = true;
     mTransformation = AffineTransformation::New();
+    mWarmStart = true;
+    mHasPreviousTransformation = false;
 }
 
 
@@ -39,37 +52,14 @@ float IterativeClosestPoint::getError() const {
     return mError;
 }
 
-/**
- * Create a new matrix which is matrix A rearranged.
- * This matrix has the same size as B
- */
-inline MatrixXf rearrangeMatrixToClosestPoints(const MatrixXf A, const MatrixXf B) {
-    MatrixXf result = MatrixXf::Constant(B.rows(), B.cols(), 0);
-
-    // For each point in B, find the closest point in A
-    for(uint b = 0; b < B.cols(); b++) {
-        Vector3f pointInB = B.col(b);
-        float minDistance = std::numeric_limits<float>::max();
-        uint closestPoint = 0;
-        for(uint a = 0; a < A.cols(); a++) {
-            Vector3f pointInA = A.col(a);
-            float distance = (pointInA-pointInB).norm();
-            if(distance < minDistance) {
-                minDistance = distance;
-                closestPoint = a;
-            }
-        }
-        result.col(b) = A.col(closestPoint);
-    }
-
-    return result;
-
+uint IterativeClosestPoint::getNrOfIterations() const {
+    return mNrOfIterations;
 }
 
 /*
  * Get centroid
  */
-Vector3f getCentroid(const MatrixXf m) {
+Vector3f getCentroid(const MatrixXf& m) {
     return m.rowwise().sum() / m.cols();
 }
 
@@ -89,69 +79,217 @@ void IterativeClosestPoint::setTransformationType(
     mIsModified = true;
 }
 
+void IterativeClosestPoint::setDistanceMetric(
+        const IterativeClosestPoint::DistanceMetric metric) {
+    mDistanceMetric = metric;
+    mIsModified = true;
+}
+
+void IterativeClosestPoint::setSampling(
+        const IterativeClosestPoint::SamplingMode mode, uint nrOfSamples) {
+    if(mode != IterativeClosestPoint::NO_SAMPLING && nrOfSamples < 3)
+        throw Exception("At least 3 samples are needed in IterativeClosestPoint");
+    mSamplingMode = mode;
+    mNrOfSamples = nrOfSamples;
+    mIsModified = true;
+}
+
+void IterativeClosestPoint::setOutlierRejectionFactor(float factor) {
+    if(factor < 0)
+        throw Exception("Outlier rejection factor of IterativeClosestPoint can't be negative");
+    mOutlierRejectionFactor = factor;
+    mIsModified = true;
+}
+
+void IterativeClosestPoint::setMaximumNumberOfIterations(uint iterations) {
+    if(iterations == 0)
+        throw Exception("Maximum number of iterations of IterativeClosestPoint must be at least 1");
+    mMaxIterations = iterations;
+    mIsModified = true;
+}
+
+void IterativeClosestPoint::setMaximumRuntime(float milliseconds) {
+    if(milliseconds < 0)
+        throw Exception("Maximum runtime of IterativeClosestPoint can't be negative");
+    mMaxRuntime = milliseconds;
+    mIsModified = true;
+}
+
+void IterativeClosestPoint::setWarmStart(bool warmStart) {
+    mWarmStart = warmStart;
+    mHasPreviousTransformation = false;
+    mIsModified = true;
+}
+
+/*
+ * Indices of the points of the point set to use. The samples are the same
+ * each time, so that registrations can be repeated.
+ */
+std::vector<uint> IterativeClosestPoint::getSamples(PointSet::pointer pointSet) const {
+    const uint nrOfPoints = pointSet->getNrOfPoints();
+    std::vector<uint> samples;
+    if(mSamplingMode == IterativeClosestPoint::NO_SAMPLING || mNrOfSamples >= nrOfPoints) {
+        for(uint i = 0; i < nrOfPoints; i++)
+            samples.push_back(i);
+        return samples;
+    }
+
+    std::mt19937 generator(0);
+    if(mSamplingMode == IterativeClosestPoint::RANDOM_SAMPLING) {
+        for(uint i = 0; i < nrOfPoints; i++)
+            samples.push_back(i);
+        std::shuffle(samples.begin(), samples.end(), generator);
+        samples.resize(mNrOfSamples);
+    } else {
+        // Put the points in bins by the direction of their normals, and pick
+        // points from each bin in turn. The sign of the normals is arbitrary,
+        // so the normals are flipped to point in positive z direction.
+        const int nrOfInclinationBins = 4;
+        const int nrOfAzimuthBins = 8;
+        const std::vector<Vector3f>& normals = pointSet->getIndex()->getNormals();
+        std::vector<std::vector<uint> > bins(nrOfInclinationBins*nrOfAzimuthBins);
+        for(uint i = 0; i < nrOfPoints; i++) {
+            const Vector3f normal = normals[i].z() < 0 ? -normals[i] : normals[i];
+            const float inclination = acos(std::min(normal.z(), 1.0f)) / (0.5f*M_PI);
+            const float azimuth = (atan2(normal.y(), normal.x()) + M_PI) / (2.0f*M_PI);
+            const int inclinationBin = std::min((int)(inclination*nrOfInclinationBins), nrOfInclinationBins - 1);
+            const int azimuthBin = std::min((int)(azimuth*nrOfAzimuthBins), nrOfAzimuthBins - 1);
+            bins[inclinationBin*nrOfAzimuthBins + azimuthBin].push_back(i);
+        }
+        for(uint i = 0; i < bins.size(); i++)
+            std::shuffle(bins[i].begin(), bins[i].end(), generator);
+        for(uint j = 0; samples.size() < mNrOfSamples; j++) {
+            for(uint i = 0; i < bins.size() && samples.size() < mNrOfSamples; i++) {
+                if(j < bins[i].size())
+                    samples.push_back(bins[i][j]);
+            }
+        }
+    }
+
+    return samples;
+}
+
 void IterativeClosestPoint::execute() {
     float error = std::numeric_limits<float>::max(), previousError;
     uint iterations = 0;
+    const boost::chrono::steady_clock::time_point startTime = boost::chrono::steady_clock::now();
 
-    // Get access to the two point sets
-    PointSetAccess::pointer accessFixedSet = ((PointSet::pointer)getStaticInputData<PointSet>(0))->getAccess(ACCESS_READ);
-    PointSetAccess::pointer accessMovingSet = ((PointSet::pointer)getStaticInputData<PointSet>(1))->getAccess(ACCESS_READ);
+    PointSet::pointer fixedSet = getStaticInputData<PointSet>(0);
+    PointSet::pointer movingSet = getStaticInputData<PointSet>(1);
+    const bool isStreaming = getInputData(1)->isDynamicData();
 
     // Get transformations of point sets
-    AffineTransformation::pointer fixedPointTransform2 = SceneGraph::getAffineTransformationFromData(getStaticInputData<PointSet>(0));
+    AffineTransformation::pointer fixedPointTransform2 = SceneGraph::getAffineTransformationFromData(fixedSet);
     Eigen::Affine3f fixedPointTransform;
     fixedPointTransform.matrix() = fixedPointTransform2->matrix();
-    AffineTransformation::pointer initialMovingTransform2 = SceneGraph::getAffineTransformationFromData(getStaticInputData<PointSet>(1));
+    AffineTransformation::pointer initialMovingTransform2 = SceneGraph::getAffineTransformationFromData(movingSet);
     Eigen::Affine3f initialMovingTransform;
     initialMovingTransform.matrix() = initialMovingTransform2->matrix();
 
-    // These matrices are Nx3
-    MatrixXf fixedPoints = accessFixedSet->getPointSetAsMatrix();
-    MatrixXf movingPoints = accessMovingSet->getPointSetAsMatrix();
+    // The closest fixed points are found with the index of the fixed point
+    // set, which is in the coordinate system of the fixed point set. The index
+    // is kept by the point set, so it is only built again if it changes.
+    mRuntimeManager->startRegularTimer("index");
+    PointSetIndex::pointer fixedIndex = fixedSet->getIndex();
+    if(fixedIndex->getNrOfPoints() == 0)
+        throw Exception("Fixed point set given to IterativeClosestPoint is empty");
+    const Eigen::Affine3f fixedPointTransformInverse = fixedPointTransform.inverse();
+    std::vector<Vector3f> fixedNormals;
+    if(mDistanceMetric == IterativeClosestPoint::POINT_TO_PLANE)
+        fixedNormals = fixedIndex->getNormals();
+    const Matrix3f normalTransform = fixedPointTransform.linear().inverse().transpose();
+    const std::vector<uint> samples = getSamples(movingSet);
+    mRuntimeManager->stopRegularTimer("index");
+
+    // These matrices are 3xN
+    MatrixXf movingPoints(3, samples.size());
+    {
+        PointSetAccess::pointer accessMovingSet = movingSet->getAccess(ACCESS_READ);
+        for(uint i = 0; i < samples.size(); i++)
+            movingPoints.col(i) = accessMovingSet->getPoint(samples[i]);
+    }
+    if(movingPoints.cols() < 3)
+        throw Exception("Moving point set given to IterativeClosestPoint has less than 3 points");
+
+    // Apply initial transformation
+    movingPoints = initialMovingTransform*movingPoints.colwise().homogeneous();
 
     Eigen::Affine3f currentTransformation = Eigen::Affine3f::Identity();
+    if(isStreaming && mWarmStart && mHasPreviousTransformation)
+        currentTransformation = mPreviousTransformation;
 
-    // Want to choose the smallest one as moving
-    bool invertTransform = false;
-    if(false && fixedPoints.cols() < movingPoints.cols()) {
-        reportInfo() << "switching fixed and moving" << Reporter::end;
-        // Switch fixed and moving
-        MatrixXf temp = fixedPoints;
-        fixedPoints = movingPoints;
-        movingPoints = temp;
-        invertTransform = true;
-
-        // Apply initial transformations
-        //currentTransformation = fixedPointTransform.getTransform();
-        movingPoints = fixedPointTransform*movingPoints.colwise().homogeneous();
-        fixedPoints = initialMovingTransform*fixedPoints.colwise().homogeneous();
-    } else {
-        // Apply initial transformations
-        //currentTransformation = initialMovingTransform.getTransform();
-        movingPoints = initialMovingTransform*movingPoints.colwise().homogeneous();
-        fixedPoints = fixedPointTransform*fixedPoints.colwise().homogeneous();
-    }
+    std::vector<uint> closestPoints;
+    std::vector<float> squaredDistances;
+    boost::chrono::duration<float, boost::milli> runtime;
     do {
+        mRuntimeManager->startRegularTimer("iteration");
         previousError = error;
         MatrixXf movedPoints = currentTransformation*(movingPoints.colwise().homogeneous());
 
         // Match closest points using current transformation
-        MatrixXf rearrangedFixedPoints = rearrangeMatrixToClosestPoints(
-                fixedPoints, movedPoints);
+        fixedIndex->findNearestNeighbors(fixedPointTransformInverse*(movedPoints.colwise().homogeneous()), closestPoints, squaredDistances);
+
+        // Reject correspondences which are far apart compared to the median
+        float maximumSquaredDistance = std::numeric_limits<float>::max();
+        if(mOutlierRejectionFactor > 0) {
+            std::vector<float> sortedDistances = squaredDistances;
+            std::nth_element(sortedDistances.begin(), sortedDistances.begin() + sortedDistances.size()/2, sortedDistances.end());
+            maximumSquaredDistance = sortedDistances[sortedDistances.size()/2]*mOutlierRejectionFactor*mOutlierRejectionFactor;
+        }
+        std::vector<uint> correspondences;
+        for(uint i = 0; i < closestPoints.size(); i++) {
+            if(squaredDistances[i] <= maximumSquaredDistance)
+                correspondences.push_back(i);
+        }
+        if(correspondences.size() < 3)
+            throw Exception("Less than 3 corresponding points left after outlier rejection in IterativeClosestPoint");
+
+        MatrixXf matchedMovedPoints(3, correspondences.size());
+        MatrixXf rearrangedFixedPoints(3, correspondences.size());
+        for(uint i = 0; i < correspondences.size(); i++) {
+            matchedMovedPoints.col(i) = movedPoints.col(correspondences[i]);
+            rearrangedFixedPoints.col(i) = fixedPointTransform*fixedIndex->getPoint(closestPoints[correspondences[i]]);
+        }
 
         // Get centroids
         Vector3f centroidFixed = getCentroid(rearrangedFixedPoints);
-        //reportInfo() << "Centroid fixed: " << Reporter::end;
-        //reportInfo() << centroidFixed << Reporter::end;
-        Vector3f centroidMoving = getCentroid(movedPoints);
-        //reportInfo() << "Centroid moving: " << Reporter::end;
-        //reportInfo() << centroidMoving << Reporter::end;
+        Vector3f centroidMoving = getCentroid(matchedMovedPoints);
 
         Eigen::Transform<float, 3, Eigen::Affine> updateTransform = Eigen::Transform<float, 3, Eigen::Affine>::Identity();
 
-        if(mTransformationType == IterativeClosestPoint::RIGID) {
+        MatrixXf matchedNormals;
+        if(mDistanceMetric == IterativeClosestPoint::POINT_TO_PLANE) {
+            matchedNormals.resize(3, correspondences.size());
+            // Minimize the sum of ((R*p + T - q) . n)^2 with the rotation
+            // linearized as R = I + [r]x, which is valid for small rotations
+            Eigen::Matrix<double, 6, 6> AtA = Eigen::Matrix<double, 6, 6>::Zero();
+            Eigen::Matrix<double, 6, 1> Atb = Eigen::Matrix<double, 6, 1>::Zero();
+            for(uint i = 0; i < correspondences.size(); i++) {
+                const Vector3f p = matchedMovedPoints.col(i);
+                const Vector3f q = rearrangedFixedPoints.col(i);
+                const Vector3f n = (normalTransform*fixedNormals[closestPoints[correspondences[i]]]).normalized();
+                matchedNormals.col(i) = n;
+                Eigen::Matrix<double, 6, 1> a;
+                a << p.cross(n).cast<double>(), n.cast<double>();
+                AtA += a*a.transpose();
+                Atb += a*(double)(q - p).dot(n);
+            }
+            if(mTransformationType == IterativeClosestPoint::RIGID) {
+                Eigen::Matrix<double, 6, 1> x = AtA.ldlt().solve(Atb);
+                Matrix3f R;
+                R = Eigen::AngleAxisf(x(2), Vector3f::UnitZ())
+                  * Eigen::AngleAxisf(x(1), Vector3f::UnitY())
+                  * Eigen::AngleAxisf(x(0), Vector3f::UnitX());
+                updateTransform.linear() = R;
+                updateTransform.translation() = x.tail<3>().cast<float>();
+            } else {
+                Eigen::Matrix3d A = AtA.bottomRightCorner<3, 3>();
+                Eigen::Vector3d b = Atb.tail<3>();
+                updateTransform.translation() = A.ldlt().solve(b).cast<float>();
+            }
+        } else if(mTransformationType == IterativeClosestPoint::RIGID) {
             // Create correlation matrix H of the deviations from centroid
-            MatrixXf H = (movedPoints.colwise() - centroidMoving)*
+            MatrixXf H = (matchedMovedPoints.colwise() - centroidMoving)*
                     (rearrangedFixedPoints.colwise() - centroidFixed).transpose();
 
             // Do SVD on H
@@ -177,26 +315,42 @@ void IterativeClosestPoint::execute() {
         // Update current transformation
         currentTransformation = updateTransform*currentTransformation;
 
-        // Calculate RMS error
-        MatrixXf distance = rearrangedFixedPoints - currentTransformation*(movingPoints.colwise().homogeneous());
+        // Calculate RMS error of the minimized distance, which is the distance
+        // along the normal of the fixed point for the point to plane metric
+        MatrixXf updatedPoints = updateTransform*(matchedMovedPoints.colwise().homogeneous());
+        MatrixXf distance = rearrangedFixedPoints - updatedPoints;
         error = 0;
         for(uint i = 0; i < distance.cols(); i++) {
-            error += pow(distance.col(i).norm(),2);
+            if(mDistanceMetric == IterativeClosestPoint::POINT_TO_PLANE) {
+                error += pow(distance.col(i).dot(matchedNormals.col(i)),2);
+            } else {
+                error += pow(distance.col(i).norm(),2);
+            }
         }
         error = sqrt(error / distance.cols());
 
         iterations++;
+        mRuntimeManager->stopRegularTimer("iteration");
         reportInfo() << "Error: " << error << Reporter::end;
-        // To continue, change in error has to be above min error change and nr of iterations less than max iterations
-    } while(previousError-error > mMinErrorChange && iterations < mMaxIterations);
-
-
-    if(invertTransform){
-        currentTransformation = currentTransformation.inverse();
-    }
+        runtime = boost::chrono::steady_clock::now() - startTime;
+        // To continue, change in error has to be above min error change, nr of iterations less than max iterations
+        // and the runtime less than the max runtime
+    } while(previousError-error > mMinErrorChange && iterations < mMaxIterations && (mMaxRuntime == 0 || runtime.count() < mMaxRuntime));
 
     mError = error;
+    mNrOfIterations = iterations;
     mTransformation->matrix() = currentTransformation.matrix();
+    mPreviousTransformation = currentTransformation;
+    mHasPreviousTransformation = true;
+
+    // Each frame gets its own transformation object when the output is dynamic
+    if(isStreaming) {
+        AffineTransformation::pointer transformation = AffineTransformation::New();
+        transformation->matrix() = currentTransformation.matrix();
+        setStaticOutputData<AffineTransformation>(0, transformation);
+    } else {
+        setStaticOutputData<AffineTransformation>(0, mTransformation);
+    }
 }
 
 
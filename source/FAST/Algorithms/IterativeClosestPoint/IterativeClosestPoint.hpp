@@ -11,22 +11,67 @@ class IterativeClosestPoint : public ProcessObject {
     FAST_OBJECT(IterativeClosestPoint)
     public:
         typedef enum { RIGID, TRANSLATION } TransformationType;
+        typedef enum { POINT_TO_POINT, POINT_TO_PLANE } DistanceMetric;
+        typedef enum { NO_SAMPLING, RANDOM_SAMPLING, NORMAL_SPACE_SAMPLING } SamplingMode;
         void setFixedPointSetPort(ProcessObjectPort port);
         void setFixedPointSet(PointSet::pointer data);
         void setMovingPointSetPort(ProcessObjectPort port);
         void setMovingPointSet(PointSet::pointer data);
         void setTransformationType(const IterativeClosestPoint::TransformationType type);
+        /**
+         * With point to plane, the distances along the normals of the fixed
+         * point set are minimized. The normals are estimated from the fixed points.
+         * The convergence test and getError then use the RMS of these distances.
+         */
+        void setDistanceMetric(const IterativeClosestPoint::DistanceMetric metric);
+        /**
+         * Only use nrOfSamples of the moving points. Normal space sampling
+         * picks points with normals spread as evenly as possible over all directions.
+         */
+        void setSampling(const IterativeClosestPoint::SamplingMode mode, uint nrOfSamples);
+        /**
+         * Ignore corresponding points which are further apart than factor
+         * times the median distance of all corresponding points.
+         * Default is 0, which uses all corresponding points.
+         */
+        void setOutlierRejectionFactor(float factor);
+        /**
+         * Maximum number of iterations of each registration. Default is 100.
+         */
+        void setMaximumNumberOfIterations(uint iterations);
+        /**
+         * Stop iterating when a registration has run for this many
+         * milliseconds. Default is 0, which means no limit.
+         */
+        void setMaximumRuntime(float milliseconds);
+        /**
+         * When the moving point set is dynamic data, each frame is registered
+         * starting from the transformation found for the previous frame,
+         * instead of from the identity. Default is true.
+         */
+        void setWarmStart(bool warmStart);
         AffineTransformation::pointer getOutputTransformation();
         float getError() const;
+        uint getNrOfIterations() const;
     private:
         IterativeClosestPoint();
         void execute();
+        std::vector<uint> getSamples(PointSet::pointer pointSet) const;
 
         float mMinErrorChange;
         uint mMaxIterations;
+        float mMaxRuntime;
+        uint mNrOfIterations;
         float mError;
+        float mOutlierRejectionFactor;
+        uint mNrOfSamples;
         AffineTransformation::pointer mTransformation;
+        bool mWarmStart;
+        bool mHasPreviousTransformation;
+        Eigen::Affine3f mPreviousTransformation;
         IterativeClosestPoint::TransformationType mTransformationType;
+        IterativeClosestPoint::DistanceMetric mDistanceMetric;
+        IterativeClosestPoint::SamplingMode mSamplingMode;
 };
 
 } // end namespace fast
@@ -1,6 +1,7 @@
 #include "FAST/Testing.hpp"
 #include "FAST/Algorithms/IterativeClosestPoint/IterativeClosestPoint.hpp"
 #include "FAST/Importers/VTKPointSetFileImporter.hpp"
+#include "FAST/Streamers/Streamer.hpp"
 
 namespace fast {
 
@@ -169,4 +170,170 @@ TEST_CASE("ICP on two point sets which are already transformed by scene graph",
 
 
 
+// Register the LV surface to a rotated and translated copy of itself with the given settings
+static void registerTransformedSurface(IterativeClosestPoint::pointer icp, Vector3f translation, Vector3f rotation, uint nrOfOutliers = 0) {
+    VTKPointSetFileImporter::pointer importerA = VTKPointSetFileImporter::New();
+    importerA->setFilename(std::string(FAST_TEST_DATA_DIR) + "Surface_LV.vtk");
+    VTKPointSetFileImporter::pointer importerB = VTKPointSetFileImporter::New();
+    importerB->setFilename(std::string(FAST_TEST_DATA_DIR) + "Surface_LV.vtk");
+
+    AffineTransformation::pointer transformation = AffineTransformation::New();
+    transformation->translate(translation);
+    Matrix3f R;
+    R = Eigen::AngleAxisf(rotation.x(), Vector3f::UnitX())
+    * Eigen::AngleAxisf(rotation.y(), Vector3f::UnitY())
+    * Eigen::AngleAxisf(rotation.z(), Vector3f::UnitZ());
+    transformation->rotate(R);
+    importerB->update();
+    PointSet::pointer B = importerB->getOutputData<PointSet>(0);
+    B->getSceneGraphNode()->setTransformation(transformation);
+
+    importerA->update();
+    PointSet::pointer A = importerA->getOutputData<PointSet>(0);
+    if(nrOfOutliers > 0) {
+        PointSetAccess::pointer access = A->getAccess(ACCESS_READ_WRITE);
+        for(uint i = 0; i < nrOfOutliers; i++)
+            access->addPoint(access->getPoint(i) + Vector3f(1, 1, 1));
+    }
+
+    icp->setMovingPointSet(A);
+    icp->setFixedPointSet(B);
+    icp->update();
+
+    Vector3f detectedRotation = icp->getOutputTransformation()->getEulerAngles();
+    Vector3f detectedTranslation = icp->getOutputTransformation()->translation();
+    for(uint i = 0; i < 3; i++) {
+        CHECK(detectedTranslation[i] == Approx(translation[i]).epsilon(0.001));
+        CHECK(detectedRotation[i] == Approx(rotation[i]).epsilon(0.01));
+    }
+}
+
+TEST_CASE("ICP with point to plane distance", "[fast][IterativeClosestPoint][icp]") {
+    IterativeClosestPoint::pointer icp = IterativeClosestPoint::New();
+    icp->setDistanceMetric(IterativeClosestPoint::POINT_TO_PLANE);
+    registerTransformedSurface(icp, Vector3f(0.01, 0, 0.01), Vector3f(0.2, 0, 0));
+    CHECK(icp->getNrOfIterations() > 0);
+    CHECK(icp->getError() < 0.001);
+}
+
+TEST_CASE("ICP with random and normal space sampling", "[fast][IterativeClosestPoint][icp]") {
+    IterativeClosestPoint::pointer icp = IterativeClosestPoint::New();
+    icp->setSampling(IterativeClosestPoint::RANDOM_SAMPLING, 500);
+    registerTransformedSurface(icp, Vector3f(0.01, 0, 0.01), Vector3f(0.2, 0, 0));
+
+    icp = IterativeClosestPoint::New();
+    icp->setSampling(IterativeClosestPoint::NORMAL_SPACE_SAMPLING, 500);
+    icp->setDistanceMetric(IterativeClosestPoint::POINT_TO_PLANE);
+    registerTransformedSurface(icp, Vector3f(0.01, 0, 0.01), Vector3f(0.2, 0, 0));
+}
+
+TEST_CASE("ICP with outlier rejection", "[fast][IterativeClosestPoint][icp]") {
+    IterativeClosestPoint::pointer icp = IterativeClosestPoint::New();
+    icp->setOutlierRejectionFactor(3);
+    registerTransformedSurface(icp, Vector3f(0.01, 0, 0.01), Vector3f(0.2, 0, 0), 20);
+}
+
+TEST_CASE("ICP with invalid settings throws exception", "[fast][IterativeClosestPoint][icp]") {
+    IterativeClosestPoint::pointer icp = IterativeClosestPoint::New();
+    CHECK_THROWS(icp->setSampling(IterativeClosestPoint::RANDOM_SAMPLING, 2));
+    CHECK_THROWS(icp->setOutlierRejectionFactor(-1));
+}
+
+TEST_CASE("ICP stops at maximum number of iterations", "[fast][IterativeClosestPoint][icp]") {
+    VTKPointSetFileImporter::pointer importerA = VTKPointSetFileImporter::New();
+    importerA->setFilename(std::string(FAST_TEST_DATA_DIR) + "Surface_LV.vtk");
+    importerA->update();
+    PointSet::pointer A = importerA->getOutputData<PointSet>(0);
+    VTKPointSetFileImporter::pointer importerB = VTKPointSetFileImporter::New();
+    importerB->setFilename(std::string(FAST_TEST_DATA_DIR) + "Surface_LV.vtk");
+    importerB->update();
+    PointSet::pointer B = importerB->getOutputData<PointSet>(0);
+    AffineTransformation::pointer transformation = AffineTransformation::New();
+    transformation->translate(Vector3f(0.01, 0, 0.01));
+    Matrix3f R;
+    R = Eigen::AngleAxisf(0.5, Vector3f::UnitX());
+    transformation->rotate(R);
+    B->getSceneGraphNode()->setTransformation(transformation);
+
+    // Converging needs more than one iteration
+    IterativeClosestPoint::pointer icp = IterativeClosestPoint::New();
+    icp->setMovingPointSet(A);
+    icp->setFixedPointSet(B);
+    icp->update();
+    REQUIRE(icp->getNrOfIterations() > 1);
+
+    icp = IterativeClosestPoint::New();
+    icp->setMaximumNumberOfIterations(1);
+    icp->setMovingPointSet(A);
+    icp->setFixedPointSet(B);
+    icp->update();
+    CHECK(icp->getNrOfIterations() == 1);
+    CHECK_THROWS(icp->setMaximumNumberOfIterations(0));
+}
+
+class PointSetTestStreamer : public Streamer, public ProcessObject {
+    FAST_OBJECT(PointSetTestStreamer)
+    public:
+        void producerStream() {};
+        bool hasReachedEnd() const { return false; };
+        uint getNrOfFrames() const { return 0; };
+    private:
+        PointSetTestStreamer() {};
+        void execute() {};
+};
+
+static PointSet::pointer createTransformedPointSet(PointSet::pointer pointSet, const Eigen::Affine3f& transform) {
+    std::vector<Vector3f> points;
+    PointSetAccess::pointer access = pointSet->getAccess(ACCESS_READ);
+    for(uint i = 0; i < pointSet->getNrOfPoints(); i++)
+        points.push_back(transform*access->getPoint(i));
+    PointSet::pointer result = PointSet::New();
+    result->create(points);
+    return result;
+}
+
+// Register each frame of a stream of moving point sets, which move a little
+// bit more for each frame, and return the total number of iterations
+static uint registerStream(IterativeClosestPoint::pointer icp, PointSet::pointer fixed) {
+    PointSetTestStreamer::pointer streamer = PointSetTestStreamer::New();
+    streamer->setStreamingMode(STREAMING_MODE_NEWEST_FRAME_ONLY);
+    DynamicData::pointer stream = DynamicData::New();
+    stream->setStreamer(streamer);
+    icp->setFixedPointSet(fixed);
+    icp->setInputData(1, stream);
+
+    uint nrOfIterations = 0;
+    for(int frame = 1; frame <= 4; frame++) {
+        Eigen::Affine3f motion = Eigen::Affine3f::Identity();
+        motion.translate(Vector3f(0.005*frame, 0, 0));
+        motion.rotate(Eigen::AngleAxisf(0.1*frame, Vector3f::UnitX()));
+        stream->addFrame(createTransformedPointSet(fixed, motion.inverse()));
+        icp->update();
+        nrOfIterations += icp->getNrOfIterations();
+
+        Vector3f detectedTranslation = icp->getOutputTransformation()->translation();
+        Vector3f detectedRotation = icp->getOutputTransformation()->getEulerAngles();
+        CHECK(detectedTranslation.x() == Approx(0.005*frame).epsilon(0.001));
+        CHECK(detectedRotation.x() == Approx(0.1*frame).epsilon(0.01));
+    }
+    CHECK(icp->getOutputData<AffineTransformation>(0)->isDynamicData());
+    return nrOfIterations;
+}
+
+TEST_CASE("Streaming ICP warm starts from the transformation of the previous frame", "[fast][IterativeClosestPoint][icp]") {
+    VTKPointSetFileImporter::pointer importer = VTKPointSetFileImporter::New();
+    importer->setFilename(std::string(FAST_TEST_DATA_DIR) + "Surface_LV.vtk");
+    importer->update();
+    PointSet::pointer fixed = importer->getOutputData<PointSet>(0);
+
+    IterativeClosestPoint::pointer icp = IterativeClosestPoint::New();
+    const uint nrOfIterationsWithWarmStart = registerStream(icp, fixed);
+
+    icp = IterativeClosestPoint::New();
+    icp->setWarmStart(false);
+    const uint nrOfIterationsWithoutWarmStart = registerStream(icp, fixed);
+
+    CHECK(nrOfIterationsWithWarmStart < nrOfIterationsWithoutWarmStart);
+}
+
 } // end namespace fast
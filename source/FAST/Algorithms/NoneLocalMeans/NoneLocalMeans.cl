@@ -0,0 +1,206 @@
+// None local means for 2D and 3D images stored in buffers.
+//
+// Each work group filters one tile. For every offset in the search window the
+// patch distances of all pixels in the tile are computed at once: the terms of
+// the tile and its halo are stored in local memory and summed over the patch
+// with separable box sums, one direction at a time. This is the same
+// algorithm as executeAlgorithmOnHost in NoneLocalMeans.cpp.
+//
+// Build options:
+// DIMENSIONS 2 or 3, GROUP is the half patch size
+// TILE_X, TILE_Y, TILE_Z size of the work group
+// INPUT_TYPE, INPUT_MAX, OUTPUT_TYPE, OUTPUT_MAX, CONVERT_OUTPUT data types,
+// intensities of integer types are normalized by their maximum value
+// KVERSION and EUCLID select the weighting, see NoneLocalMeans.hpp
+// HALF_ACCUMULATION sums the patch terms with half precision
+//
+// The half search window size is the kernel argument window, so that it can
+// be changed between frames without building the program again.
+//
+// When streaming, patches are also searched for in the previous frames, which
+// are stored in a ring of ringSize frames where newestFrame is the last one.
+// The search window in a previous frame is centered at the motion of the tile
+// found in the previous frame, scaled by the age of the frame. The motion of
+// each tile is the average offset of the best matches in the last frame. It
+// is the only state kept between frames, the weights are not reused.
+
+#ifdef HALF_ACCUMULATION
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+typedef half accumulator;
+#else
+typedef float accumulator;
+#endif
+
+#if DIMENSIONS == 3
+#define GROUP_Z GROUP
+#else
+#define GROUP_Z 0
+#endif
+
+#define PATCH_SIZE (2*GROUP+1)
+#define PATCH_SIZE_Z (2*GROUP_Z+1)
+#define HALO_X (TILE_X+2*GROUP)
+#define HALO_Y (TILE_Y+2*GROUP)
+#define HALO_Z (TILE_Z+2*GROUP_Z)
+#define HALO_SIZE (HALO_X*HALO_Y*HALO_Z)
+#define TILE_SIZE (TILE_X*TILE_Y*TILE_Z)
+
+float readIntensity(__global const INPUT_TYPE* input, int4 position, int4 size) {
+    position = clamp(position, (int4)(0, 0, 0, 0), size - 1);
+    return (float)input[position.x + (position.y + position.z*size.y)*size.x]*(1.0f/INPUT_MAX);
+}
+
+int4 getHaloPosition(int i) {
+    return (int4)(i % HALO_X, (i / HALO_X) % HALO_Y, i / (HALO_X*HALO_Y), 0);
+}
+
+__kernel void noneLocalMeans(
+        __global const INPUT_TYPE* input,
+        __global OUTPUT_TYPE* output,
+        __private int width,
+        __private int height,
+        __private int depth,
+        __private float strength2,
+        __private float sigma2,
+        __global const INPUT_TYPE* previousFrames,
+        __private int ringSize,
+        __private int newestFrame,
+        __private int nrOfPreviousFrames,
+        __global const int* previousMotion,
+        __global int* motion,
+        __private int window
+        ) {
+    __local float center[HALO_SIZE];
+    __local int motionSum[4];
+    __local accumulator terms[HALO_SIZE];
+    __local accumulator xSums[TILE_X*HALO_Y*HALO_Z];
+    __local accumulator ySums[TILE_X*TILE_Y*HALO_Z];
+
+    const int4 size = {width, height, depth, 1};
+    const int4 origin = {get_group_id(0)*TILE_X, get_group_id(1)*TILE_Y, get_group_id(2)*TILE_Z, 0};
+    const int4 localPosition = {get_local_id(0), get_local_id(1), get_local_id(2), 0};
+    const int4 pos = origin + localPosition;
+    const int localId = localPosition.x + (localPosition.y + localPosition.z*TILE_Y)*TILE_X;
+    const int4 haloOrigin = origin - (int4)(GROUP, GROUP, GROUP_Z, 0);
+    const int tileIndex = get_group_id(0) + (get_group_id(1) + get_group_id(2)*get_num_groups(1))*get_num_groups(0);
+    const int frameSize = width*height*depth;
+    const int windowZ = DIMENSIONS == 3 ? window : 0;
+
+    for(int i = localId; i < HALO_SIZE; i += TILE_SIZE)
+        center[i] = readIntensity(input, haloOrigin + getHaloPosition(i), size);
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+#if KVERSION == 1
+    const float K = 1.0f / sigma2;
+#elif KVERSION == 2
+    const float K = 1.0f;
+#else
+    const float K = 1.0f / (PATCH_SIZE*PATCH_SIZE*PATCH_SIZE_Z);
+#endif
+
+    float weightSum = 0.0f;
+    float weightedSum = 0.0f;
+    float maxWeight = 0.0f;
+    float bestWeight = -1.0f;
+    int4 bestOffset = {0, 0, 0, 0};
+    const int4 tileMotion = nrOfPreviousFrames > 0 ?
+            (int4)(previousMotion[tileIndex*4], previousMotion[tileIndex*4+1], previousMotion[tileIndex*4+2], 0) :
+            (int4)(0, 0, 0, 0);
+    for(int age = 0; age <= nrOfPreviousFrames; age++) {
+    __global const INPUT_TYPE* frame = age == 0 ? input :
+            previousFrames + ((newestFrame - age + 1 + ringSize) % ringSize)*frameSize;
+    const int4 searchCenter = age*tileMotion;
+    for(int dz = -windowZ; dz <= windowZ; dz++) {
+    for(int dy = -window; dy <= window; dy++) {
+    for(int dx = -window; dx <= window; dx++) {
+        if(age == 0 && dx == 0 && dy == 0 && dz == 0)
+            continue;
+        const int4 offset = searchCenter + (int4)(dx, dy, dz, 0);
+
+        for(int i = localId; i < HALO_SIZE; i += TILE_SIZE) {
+            const float difference = center[i] - readIntensity(frame, haloOrigin + getHaloPosition(i) + offset, size);
+#if EUCLID == 0
+            terms[i] = difference*difference;
+#else
+            terms[i] = native_exp(-native_divide(difference*difference, strength2));
+#endif
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for(int i = localId; i < TILE_X*HALO_Y*HALO_Z; i += TILE_SIZE) {
+            const int x = i % TILE_X;
+            const int row = i / TILE_X;
+            accumulator sum = 0;
+            for(int k = 0; k < PATCH_SIZE; k++)
+                sum += terms[row*HALO_X + x + k];
+            xSums[i] = sum;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for(int i = localId; i < TILE_X*TILE_Y*HALO_Z; i += TILE_SIZE) {
+            const int x = i % TILE_X;
+            const int y = (i / TILE_X) % TILE_Y;
+            const int z = i / (TILE_X*TILE_Y);
+            accumulator sum = 0;
+            for(int k = 0; k < PATCH_SIZE; k++)
+                sum += xSums[(z*HALO_Y + y + k)*TILE_X + x];
+            ySums[i] = sum;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        accumulator patchSum = 0;
+        for(int k = 0; k < PATCH_SIZE_Z; k++)
+            patchSum += ySums[((localPosition.z + k)*TILE_Y + localPosition.y)*TILE_X + localPosition.x];
+
+        const float distance2 = offset.x*offset.x + offset.y*offset.y + offset.z*offset.z;
+#if EUCLID == 1
+        const float weight = (float)patchSum + native_divide(native_exp(-native_divide(native_sqrt(distance2), 2.0f*sigma2)), 2.0f*M_PI_F*sigma2);
+#elif EUCLID == 2
+        const float weight = (float)patchSum*native_divide(native_exp(-native_divide(distance2, 2.0f*sigma2)), 2.0f*sigma2);
+#else
+        const float weight = native_exp(-native_divide(max((float)patchSum, 0.0f)*K, strength2));
+#endif
+        weightSum += weight;
+        weightedSum += weight*readIntensity(frame, pos + offset, size);
+        maxWeight = max(maxWeight, weight);
+        if(age == 1 && weight > bestWeight) {
+            bestWeight = weight;
+            bestOffset = offset;
+        }
+
+        // The local memory is overwritten for the next offset
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }}}}
+
+    // Motion of the tile, used as search center for the next frame
+    const bool inside = pos.x < width && pos.y < height && pos.z < depth;
+    if(nrOfPreviousFrames > 0) {
+        if(localId == 0) {
+            motionSum[0] = 0;
+            motionSum[1] = 0;
+            motionSum[2] = 0;
+            motionSum[3] = 0;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if(inside) {
+            atomic_add(&motionSum[0], bestOffset.x);
+            atomic_add(&motionSum[1], bestOffset.y);
+            atomic_add(&motionSum[2], bestOffset.z);
+            atomic_inc(&motionSum[3]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if(localId == 0) {
+            for(int k = 0; k < 3; k++)
+                motion[tileIndex*4+k] = (int)round((float)motionSum[k] / motionSum[3]);
+        }
+    }
+
+    // The pixel itself is weighted as the most similar of the other pixels
+    if(maxWeight == 0.0f)
+        maxWeight = 1.0f;
+    const float value = center[((localPosition.z + GROUP_Z)*HALO_Y + localPosition.y + GROUP)*HALO_X + localPosition.x + GROUP];
+    const float result = (weightedSum + maxWeight*value) / (weightSum + maxWeight);
+
+    if(inside)
+        output[pos.x + (pos.y + pos.z*height)*width] = CONVERT_OUTPUT(result*OUTPUT_MAX);
+}
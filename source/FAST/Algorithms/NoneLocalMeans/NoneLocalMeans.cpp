@@ -2,32 +2,35 @@
 #include "FAST/Exception.hpp"
 #include "FAST/DeviceManager.hpp"
 #include "FAST/Data/Image.hpp"
-#include <numeric>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 using namespace fast;
 
 NoneLocalMeans::NoneLocalMeans() {
 	createInputPort<Image>(0);
 	createOutputPort<Image>(0, OUTPUT_DEPENDS_ON_INPUT, 0);
-    createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "Algorithms/NoneLocalMeans/NoneLocalMeans2Dgs.cl", "2D");
-    //createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "Algorithms/NoneLocalMeans/NoneLocalMeans2Dgaussian.cl", "2Dg");
-    createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "Algorithms/NoneLocalMeans/NoneLocalMeans3Dgs.cl", "3D");
+    createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "Algorithms/NoneLocalMeans/NoneLocalMeans.cl", "NLM");
 	windowSize = 11;
 	groupSize = 3;
 	sigma = 0.3f;
 	denoiseStrength = 0.15f;
-	mDimensionCLCodeCompiledFor = 0;
     k = 0;
     euclid = 0;
+    mHalfPrecisionAccumulation = false;
+    mCurrentWindowSize = windowSize;
+    mFrameBudget = 0;
+    mKernelRebuilt = false;
+    mTemporalFrames = 0;
+    resetFrameRing();
 	mOutputTypeSet = false;
     mIsModified = true;
-    recompile = true;
 }
 
 void NoneLocalMeans::setOutputType(DataType type){
 	mOutputType = type;
 	mOutputTypeSet = true;
 	mIsModified = true;
-    recompile = true;
 }
 void NoneLocalMeans::setK(unsigned char newK){
     if (newK < 0){
@@ -35,16 +38,14 @@ void NoneLocalMeans::setK(unsigned char newK){
     }
     k = newK;
     mIsModified = true;
-    recompile = true;
 }
 
 void NoneLocalMeans::setEuclid(unsigned char e){
     if (e < 0){
         throw Exception("NoneLocalMeans Euclid must be greater then 0.");
     }
-    e = euclid;
+    euclid = e;
     mIsModified = true;
-    recompile = true;
 }
 
 void NoneLocalMeans::setWindowSize(unsigned char wS) {
@@ -54,8 +55,8 @@ void NoneLocalMeans::setWindowSize(unsigned char wS) {
 		throw Exception("NoneLocalMeans window size must be odd.");
 
 	windowSize = wS;
+    mCurrentWindowSize = wS;
     mIsModified = true;
-	recompile = true;
 }
 
 void NoneLocalMeans::setGroupSize(unsigned char gS) {
@@ -66,7 +67,6 @@ void NoneLocalMeans::setGroupSize(unsigned char gS) {
 
 	groupSize = gS;
     mIsModified = true;
-	recompile = true;
 }
 
 void NoneLocalMeans::setDenoiseStrength(float dS){
@@ -75,7 +75,43 @@ void NoneLocalMeans::setDenoiseStrength(float dS){
 
 	denoiseStrength = dS;
     mIsModified = true;
-	//recompile = true;
+}
+
+void NoneLocalMeans::setHalfPrecisionAccumulation(bool halfPrecision) {
+    mHalfPrecisionAccumulation = halfPrecision;
+    mIsModified = true;
+}
+
+void NoneLocalMeans::setTemporalFrames(int frames) {
+    if(frames < 0)
+        throw Exception("NoneLocalMeans number of temporal frames can't be negative.");
+    mTemporalFrames = frames;
+    resetFrameRing();
+    mIsModified = true;
+}
+
+void NoneLocalMeans::setFrameBudget(float milliseconds) {
+    mFrameBudget = milliseconds;
+    mCurrentWindowSize = windowSize;
+    if(milliseconds > 0)
+        enableRuntimeMeasurements();
+    mIsModified = true;
+}
+
+int NoneLocalMeans::getCurrentWindowSize() {
+    return mCurrentWindowSize;
+}
+
+Vector3f NoneLocalMeans::getAverageMotion() {
+    Vector3f average = Vector3f::Zero();
+    if(!mFrameRingDevice.isValid() || !mHasMotion)
+        return average;
+
+    std::vector<int> motion(mFrameRingNrOfTiles*4);
+    mFrameRingDevice->getCommandQueue().enqueueReadBuffer(mMotion[mMotionIndex], CL_TRUE, 0, motion.size()*sizeof(int), motion.data());
+    for(int i = 0; i < mFrameRingNrOfTiles; i++)
+        average += Vector3f(motion[i*4], motion[i*4+1], motion[i*4+2]);
+    return average / mFrameRingNrOfTiles;
 }
 
 void NoneLocalMeans::setSigma(float s){
@@ -84,180 +120,359 @@ void NoneLocalMeans::setSigma(float s){
     
     sigma = s;
     mIsModified = true;
-    recompile = true;
 }
 
 
 
+// Intensities of integer types are normalized by the maximum value of the type
+static float getIntensityMaximum(DataType type) {
+    switch(type) {
+    case TYPE_INT8:
+        return 127.0f;
+    case TYPE_UINT8:
+        return 255.0f;
+    case TYPE_INT16:
+    case TYPE_SNORM_INT16:
+        return 32767.0f;
+    case TYPE_UINT16:
+    case TYPE_UNORM_INT16:
+        return 65535.0f;
+    default:
+        return 1.0f;
+    }
+}
+
 template <class T>
-void executeAlgorithmOnHost(Image::pointer input, Image::pointer output, unsigned char group, unsigned char window, float strength, unsigned char sigma) {
-	throw Exception("This is on host, does not work atm");
-    
-    ImageAccess::pointer inputAccess = input->getImageAccess(ACCESS_READ);
-    ImageAccess::pointer outputAccess = output->getImageAccess(ACCESS_READ_WRITE);
-
-    T * inputData = (T*)inputAccess->get();
-    T * outputData = (T*)outputAccess->get();
-
-    unsigned int width = input->getWidth();
-    unsigned int height = input->getHeight();
-    //Window is window-1/2
-    //group is group-1/2
-    //strength is strength*strength
-    //sigma is sigma*sigma
-    //Not working atm with the T
-    //Does not work with outofbounds atm
-    //So this code is for all pixels inbound, meaning x + group + window < width / x - group - window > 0 //same for y
-    for (int x = 0; x < width; x++){
-        for (int y = 0; y < height; y++){
-            
-            double normSum = 0.0;
-            double totSum = 0.0;
-            double indi = 0.0;
-            double groupTot = 0.0;
-            double value = 0.0;
-
-            for (int i = x - window; i <= x + window; i++){
-                for (int j = y - window; j <= y + window; j++){
-                    if (i != x && j != y){
-
-                        int mX = x - group;
-                        int mY = y - group;
-                        for (int k = i - group; k <= i + group; k++, mX++){
-                            for (int l = j - group; l <= j + group; l++, mY++){
-                                //This is wrong, need to fix T
-                                //indi = inputData[mX][mY] - inputData[k][l];
-                                indi = abs(indi*indi);
-                                indi = exp( - (indi/strength));
-                                groupTot += indi;
-                            }
+void readNormalizedIntensities(Image::pointer input, std::vector<float>& image) {
+    ImageAccess::pointer access = input->getImageAccess(ACCESS_READ);
+    const T* data = (const T*)access->get();
+    const float scale = 1.0f / getIntensityMaximum(input->getDataType());
+    #pragma omp parallel for
+    for(long long i = 0; i < (long long)image.size(); i++)
+        image[i] = data[i]*scale;
+}
+
+// Integer types are rounded and saturated like in the OpenCL kernel
+template <class T>
+void writeNormalizedIntensities(const std::vector<float>& result, Image::pointer output) {
+    ImageAccess::pointer access = output->getImageAccess(ACCESS_READ_WRITE);
+    T* data = (T*)access->get();
+    const float scale = getIntensityMaximum(output->getDataType());
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    #pragma omp parallel for
+    for(long long i = 0; i < (long long)result.size(); i++) {
+        float value = result[i]*scale;
+        if(isInteger)
+            value = std::min(std::max((float)round(value), (float)std::numeric_limits<T>::min()), (float)std::numeric_limits<T>::max());
+        data[i] = (T)value;
+    }
+}
+
+static inline float getClampedIntensity(const std::vector<float>& image, int x, int y, int z, int width, int height, int depth) {
+    x = std::min(std::max(x, 0), width-1);
+    y = std::min(std::max(y, 0), height-1);
+    z = std::min(std::max(z, 0), depth-1);
+    return image[x + ((std::size_t)y + (std::size_t)z*height)*width];
+}
+
+// Sums over x and y of the patch terms of rows startY to startY+rows of slice
+// z, for the offset (dx, dy, dz) into frame. x is summed with a running sum.
+static void sumPatchTermsOfSlice(
+        const std::vector<float>& image,
+        const std::vector<float>& frame,
+        int width, int height, int depth,
+        int z, int startY, int rows, int group,
+        int dx, int dy, int dz,
+        int euclid,
+        float strength2,
+        float* terms,
+        float* xSums,
+        float* ySums) {
+    const int patchSize = 2*group+1;
+    const int haloWidth = width + 2*group;
+    const int haloHeight = rows + 2*group;
+    for(int b = 0; b < haloHeight; b++) {
+        const int y = startY + b - group;
+        float* line = &terms[(std::size_t)b*haloWidth];
+        for(int a = 0; a < haloWidth; a++) {
+            const int x = a - group;
+            const float difference = getClampedIntensity(image, x, y, z, width, height, depth) -
+                    getClampedIntensity(frame, x+dx, y+dy, z+dz, width, height, depth);
+            line[a] = euclid == 0 ? difference*difference : std::exp(-difference*difference/strength2);
+        }
+
+        float* xLine = &xSums[(std::size_t)b*width];
+        float sum = 0.0f;
+        for(int a = 0; a < patchSize; a++)
+            sum += line[a];
+        xLine[0] = sum;
+        for(int x = 1; x < width; x++) {
+            sum += line[x+patchSize-1] - line[x-1];
+            xLine[x] = sum;
+        }
+    }
+
+    for(int b = 0; b < rows; b++) {
+        float* yLine = &ySums[(std::size_t)b*width];
+        for(int x = 0; x < width; x++)
+            yLine[x] = 0.0f;
+        for(int j = 0; j < patchSize; j++) {
+            const float* xLine = &xSums[(std::size_t)(b + j)*width];
+            for(int x = 0; x < width; x++)
+                yLine[x] += xLine[x];
+        }
+    }
+}
+
+// Same algorithm as NoneLocalMeans.cl. Blocks of rows and slices are
+// filtered in parallel, and for each offset in the search window the patch
+// distances of the whole block are computed with separable box sums. The sums
+// over x and y of each slice are computed once per offset and kept in a ring
+// of the slices of the patch, which gives a running sum over z through the
+// slices of the block. The previous frames, newest first, are searched with
+// the same window but without following the motion.
+static void executeAlgorithmOnHost(
+        const std::vector<float>& image,
+        const std::vector<const std::vector<float>*>& previousFrames,
+        std::vector<float>& result,
+        int width, int height, int depth,
+        int dimensions,
+        int group,
+        int window,
+        int k,
+        int euclid,
+        float strength2,
+        float sigma2) {
+    const int groupZ = dimensions == 3 ? group : 0;
+    const int windowZ = dimensions == 3 ? window : 0;
+    const int patchSize = 2*group+1;
+    const int patchSizeZ = 2*groupZ+1;
+    float K = 1.0f / (patchSize*patchSize*patchSizeZ);
+    if(k == 1) {
+        K = 1.0f / sigma2;
+    } else if(k == 2) {
+        K = 1.0f;
+    }
+    const int blockHeight = 16;
+    const int blockDepth = 8;
+    const int blocksPerSlice = (height + blockHeight - 1) / blockHeight;
+    const int blocksInDepth = (depth + blockDepth - 1) / blockDepth;
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int block = 0; block < blocksPerSlice*blocksInDepth; block++) {
+        const int startZ = (block / blocksPerSlice)*blockDepth;
+        const int slices = std::min(blockDepth, depth - startZ);
+        const int startY = (block % blocksPerSlice)*blockHeight;
+        const int rows = std::min(blockHeight, height - startY);
+        const std::size_t planeSize = (std::size_t)width*rows;
+        std::vector<float> terms((std::size_t)(width + 2*group)*(rows + 2*group));
+        std::vector<float> xSums((std::size_t)width*(rows + 2*group));
+        std::vector<float> ySums(planeSize*patchSizeZ);
+        std::vector<float> patchSums(planeSize);
+        std::vector<float> weightSums(planeSize*slices, 0.0f);
+        std::vector<float> weightedSums(planeSize*slices, 0.0f);
+        std::vector<float> maxWeights(planeSize*slices, 0.0f);
+
+        for(int age = 0; age <= previousFrames.size(); age++) {
+        const std::vector<float>& frame = age == 0 ? image : *previousFrames[age-1];
+        for(int dz = -windowZ; dz <= windowZ; dz++) {
+        for(int dy = -window; dy <= window; dy++) {
+        for(int dx = -window; dx <= window; dx++) {
+            if(age == 0 && dx == 0 && dy == 0 && dz == 0)
+                continue;
+
+            // Slice startZ - groupZ + m is stored in the ring at m % patchSizeZ
+            std::fill(patchSums.begin(), patchSums.end(), 0.0f);
+            for(int c = 0; c < patchSizeZ; c++) {
+                float* plane = &ySums[c*planeSize];
+                sumPatchTermsOfSlice(image, frame, width, height, depth, startZ + c - groupZ, startY, rows, group,
+                        dx, dy, dz, euclid, strength2, terms.data(), xSums.data(), plane);
+                for(std::size_t i = 0; i < planeSize; i++)
+                    patchSums[i] += plane[i];
+            }
+
+            const float distance2 = dx*dx + dy*dy + dz*dz;
+            for(int s = 0; s < slices; s++) {
+                const int z = startZ + s;
+                if(s > 0) {
+                    // The slice z+groupZ replaces the slice z-1-groupZ
+                    float* plane = &ySums[((s-1) % patchSizeZ)*planeSize];
+                    for(std::size_t i = 0; i < planeSize; i++)
+                        patchSums[i] -= plane[i];
+                    sumPatchTermsOfSlice(image, frame, width, height, depth, z + groupZ, startY, rows, group,
+                            dx, dy, dz, euclid, strength2, terms.data(), xSums.data(), plane);
+                    for(std::size_t i = 0; i < planeSize; i++)
+                        patchSums[i] += plane[i];
+                }
+
+                for(int b = 0; b < rows; b++) {
+                    for(int x = 0; x < width; x++) {
+                        const float patchSum = patchSums[x + b*width];
+                        float weight;
+                        if(euclid == 1) {
+                            weight = patchSum + std::exp(-std::sqrt(distance2)/(2.0f*sigma2))/(2.0f*(float)M_PI*sigma2);
+                        } else if(euclid == 2) {
+                            weight = patchSum*std::exp(-distance2/(2.0f*sigma2))/(2.0f*sigma2);
+                        } else {
+                            weight = std::exp(-std::max(patchSum, 0.0f)*K/strength2);
                         }
-                        //This is wrong, need to fix T
-                        //value = inputData[i][j];
-                        double pA[] = {i,j};
-                        double pB[] = {x,y};
-                        //double dist = i, j - x, y;
-                        double dist = std::inner_product(std::begin(pA), std::end(pA), std::begin(pB), 0.0);
-                        
-                        double gaussWeight = exp(-(dist / (2.0 * sigma)));
-                        gaussWeight = gaussWeight / (2.0 * sigma);
-                        groupTot *= gaussWeight;
-
-                        normSum += groupTot;
-                        totSum += groupTot * value;
-                        groupTot = 0.0;
+                        const std::size_t i = x + b*width + s*planeSize;
+                        weightSums[i] += weight;
+                        weightedSums[i] += weight*getClampedIntensity(frame, x+dx, startY+b+dy, z+dz, width, height, depth);
+                        maxWeights[i] = std::max(maxWeights[i], weight);
                     }
                 }
             }
-            value = totSum / normSum;
-            /*
-            Not sure it needed
-            if (value < 0){
-                value = 0;
-            }
-            if (value > 1.0){
-                value = 1.0f;
+        }}}}
+
+        // The pixel itself is weighted as the most similar of the other pixels
+        for(int s = 0; s < slices; s++) {
+            for(int b = 0; b < rows; b++) {
+                for(int x = 0; x < width; x++) {
+                    const std::size_t i = x + b*width + s*planeSize;
+                    const float maxWeight = maxWeights[i] == 0.0f ? 1.0f : maxWeights[i];
+                    const std::size_t position = x + ((std::size_t)startY + b + (std::size_t)(startZ + s)*height)*width;
+                    result[position] = (weightedSums[i] + maxWeight*image[position]) / (weightSums[i] + maxWeight);
+                }
             }
-            */
-            //This is wrong, need to fix T
-            //outputData[x][y] = (T)value;
-            
         }
     }
 }
 
-void NoneLocalMeans::recompileOpenCLCode(Image::pointer input) {
-    // Check if there is a need to recompile OpenCL code
-    if(input->getDimensions() == mDimensionCLCodeCompiledFor &&
-       input->getDataType() == mTypeCLCodeCompiledFor && !recompile)
-        return;
-    
-    recompile = false;
-    OpenCLDevice::pointer device = getMainDevice();
-    std::string buildOptions = "";
-    if(!device->isWritingTo3DTexturesSupported()) {
-        buildOptions = "-DTYPE=" + getCTypeAsString(mOutputType);
+cl::Kernel NoneLocalMeans::getKernel(OpenCLDevice::pointer device, Image::pointer input, Image::pointer output) {
+    const int dimensions = input->getDimensions();
+    const int group = (groupSize-1)/2;
+    const int groupZ = dimensions == 3 ? group : 0;
+    bool halfPrecision = mHalfPrecisionAccumulation;
+    if(halfPrecision && device->getDevice().getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp16") == std::string::npos) {
+        reportWarning() << "Device does not support half precision, NoneLocalMeans accumulates with single precision instead" << Reporter::end;
+        halfPrecision = false;
+    }
+
+    // Use the largest tile for which the local memory of the kernel fits on the device
+    std::vector<Vector3i> tileSizes;
+    if(dimensions == 3) {
+        tileSizes.push_back(Vector3i(8, 8, 4));
+        tileSizes.push_back(Vector3i(8, 8, 2));
+        tileSizes.push_back(Vector3i(8, 4, 2));
+        tileSizes.push_back(Vector3i(4, 4, 2));
+        tileSizes.push_back(Vector3i(4, 4, 1));
+    } else {
+        tileSizes.push_back(Vector3i(16, 16, 1));
+        tileSizes.push_back(Vector3i(16, 8, 1));
+        tileSizes.push_back(Vector3i(8, 8, 1));
+        tileSizes.push_back(Vector3i(4, 4, 1));
     }
-    buildOptions += " -D WINDOW=";
-    buildOptions += std::to_string((windowSize-1)/2);
-    buildOptions += " -D GROUP=";
-    buildOptions += std::to_string((groupSize-1)/2);
-    buildOptions += " -D KVERSION=";
-    buildOptions += std::to_string(k);
-    buildOptions += " -D EUCLID=";
-    buildOptions += std::to_string(k);
-    cl::Program program;
-    if(input->getDimensions() == 2) {
-        program = getOpenCLProgram(device, "2D", buildOptions);
+    const cl_ulong localMemorySize = device->getDevice().getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+    const std::size_t maxWorkGroupSize = device->getDevice().getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const std::size_t accumulatorSize = halfPrecision ? 2 : sizeof(float);
+    Vector3i tileSize(0, 0, 0);
+    for(int i = 0; i < tileSizes.size(); i++) {
+        const Vector3i tile = tileSizes[i];
+        const std::size_t haloX = tile.x() + 2*group;
+        const std::size_t haloY = tile.y() + 2*group;
+        const std::size_t haloZ = tile.z() + 2*groupZ;
+        const std::size_t localMemory = haloX*haloY*haloZ*(sizeof(float) + accumulatorSize) +
+                (tile.x()*haloY*haloZ + tile.x()*tile.y()*haloZ)*accumulatorSize;
+        if(localMemory <= localMemorySize && (std::size_t)tile.prod() <= maxWorkGroupSize) {
+            tileSize = tile;
+            break;
+        }
+    }
+    if(tileSize.x() == 0)
+        throw Exception("The group size of NoneLocalMeans is too large for the local memory of the device");
+    mTileSize = tileSize;
+
+    const DataType outputType = output->getDataType();
+    std::string buildOptions = "-D DIMENSIONS=" + std::to_string(dimensions);
+    buildOptions += " -D GROUP=" + std::to_string(group);
+    buildOptions += " -D KVERSION=" + std::to_string(k);
+    buildOptions += " -D EUCLID=" + std::to_string(euclid);
+    buildOptions += " -D TILE_X=" + std::to_string(tileSize.x());
+    buildOptions += " -D TILE_Y=" + std::to_string(tileSize.y());
+    buildOptions += " -D TILE_Z=" + std::to_string(tileSize.z());
+    buildOptions += " -D INPUT_TYPE=" + getCTypeAsString(input->getDataType());
+    buildOptions += " -D INPUT_MAX=" + std::to_string(getIntensityMaximum(input->getDataType())) + "f";
+    buildOptions += " -D OUTPUT_TYPE=" + getCTypeAsString(outputType);
+    buildOptions += " -D OUTPUT_MAX=" + std::to_string(getIntensityMaximum(outputType)) + "f";
+    if(outputType == TYPE_FLOAT) {
+        buildOptions += " -D CONVERT_OUTPUT=convert_float";
     } else {
-        //createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "Algorithms/NoneLocalMeans/NoneLocalMeans3Dgs.cl", "3D");
-        program = getOpenCLProgram(device, "3D", buildOptions);
+        buildOptions += " -D CONVERT_OUTPUT=convert_" + getCTypeAsString(outputType) + "_sat_rte";
+    }
+    if(halfPrecision)
+        buildOptions += " -D HALF_ACCUMULATION";
+
+    if(device != mKernelDevice || buildOptions != mKernelBuildOptions) {
+        cl::Program program = getOpenCLProgram(device, "NLM", buildOptions);
+        mKernel = cl::Kernel(program, "noneLocalMeans");
+        mKernelBuildOptions = buildOptions;
+        mKernelDevice = device;
+        mKernelRebuilt = true;
     }
-    mKernel = cl::Kernel(program, "noneLocalMeans");
-    mDimensionCLCodeCompiledFor = input->getDimensions();
-    mTypeCLCodeCompiledFor = input->getDataType();
+    return mKernel;
 }
-/*
-void NoneLocalMeans::recompileOpenCLCode(Image::pointer input) {
-	// Check if there is a need to recompile OpenCL code
-	if (input->getDimensions() == mDimensionCLCodeCompiledFor &&
-		input->getDataType() == mTypeCLCodeCompiledFor && !recompile)
-		return;
-
-	OpenCLDevice::pointer device = getMainDevice();
-    recompile = false;
-	std::string buildOptions = "";
-	const bool writingTo3DTextures = device->getDevice().getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_3d_image_writes") != std::string::npos;
-	if (!writingTo3DTextures) {
-		switch (mOutputType) {
-		case TYPE_FLOAT:
-			buildOptions += " -DTYPE=float";
-			break;
-		case TYPE_INT8:
-			buildOptions += " -DTYPE=char";
-			break;
-		case TYPE_UINT8:
-			buildOptions += " -DTYPE=uchar";
-			break;
-		case TYPE_INT16:
-			buildOptions += " -DTYPE=short";
-			break;
-		case TYPE_UINT16:
-			buildOptions += " -DTYPE=ushort";
-			break;
-		}
-	}
-    buildOptions += " -D WINDOW=";
-    buildOptions += std::to_string((windowSize-1)/2);
-	buildOptions += " -D GROUP=";
-    buildOptions += std::to_string((groupSize-1)/2);
-    
-	std::string filename;
-	//might have to seperate color vs gray here, for better runtime
-	if (input->getDimensions() == 2) {
-        if(k == 0){
-            filename = "Algorithms/NoneLocalMeans/NoneLocalMeans2Dconstant.cl";
-        }else if(k == 1){
-            filename = "Algorithms/NoneLocalMeans/NoneLocalMeans2Dgaussian.cl";
-        }else{
-            filename = "Algorithms/NoneLocalMeans/NoneLocalMeans2Dconstant.cl";
+
+void NoneLocalMeans::resetFrameRing() {
+    mNrOfPreviousFrames = 0;
+    mNewestFrame = 0;
+    mMotionIndex = 0;
+    mHasMotion = false;
+    mFrameRingDevice = OpenCLDevice::pointer();
+    mFrameRingNrOfTiles = 0;
+    mHostFrames.clear();
+}
+
+// The frames in the ring must have the same size and type, and the motion
+// buffers have one value per tile
+void NoneLocalMeans::updateFrameRing(OpenCLDevice::pointer device, Image::pointer input, int nrOfTiles) {
+    const Vector3i size(input->getWidth(), input->getHeight(), input->getDimensions() == 3 ? input->getDepth() : 1);
+    if(mFrameRingDevice == device && mFrameRingImageSize == size &&
+            mFrameRingDataType == input->getDataType() && mFrameRingNrOfTiles == nrOfTiles)
+        return;
+
+    resetFrameRing();
+    const std::size_t frameSize = getSizeOfDataType(input->getDataType(), 1)*size.prod();
+    // The kernel always needs a buffer
+    mFrameRing = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, mTemporalFrames > 0 ? frameSize*mTemporalFrames : sizeof(float));
+    std::vector<int> zeros(nrOfTiles*4, 0);
+    for(int i = 0; i < 2; i++)
+        mMotion[i] = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, zeros.size()*sizeof(int), zeros.data());
+    mFrameRingDevice = device;
+    mFrameRingImageSize = size;
+    mFrameRingDataType = input->getDataType();
+    mFrameRingNrOfTiles = nrOfTiles;
+}
+
+// The runtime of the last frame is measured by update()
+void NoneLocalMeans::adaptWindowSize(Image::pointer input) {
+    const bool kernelRebuilt = mKernelRebuilt;
+    mKernelRebuilt = false;
+    if(mFrameBudget <= 0 || kernelRebuilt)
+        return;
+    const double frameTime = getRuntime()->getLastSample();
+    if(frameTime <= 0)
+        return;
+
+    if(frameTime > mFrameBudget && mCurrentWindowSize > 3) {
+        mCurrentWindowSize -= 2;
+        reportInfo() << "Frame budget of NoneLocalMeans exceeded, window size reduced to " << (int)mCurrentWindowSize << Reporter::end;
+    } else if(mCurrentWindowSize < windowSize) {
+        // The runtime is proportional to the number of offsets in the search window
+        const double predictedTime = frameTime*std::pow((mCurrentWindowSize + 2.0) / mCurrentWindowSize, (int)input->getDimensions());
+        if(predictedTime < 0.9*mFrameBudget) {
+            mCurrentWindowSize += 2;
+            reportInfo() << "NoneLocalMeans window size increased to " << (int)mCurrentWindowSize << Reporter::end;
         }
-		//filename = "Algorithms/NoneLocalMeans/NoneLocalMeans2DgsPixelWise.cl";
-		//filename = "Algorithms/NoneLocalMeans/NoneLocalMeans2Dgs.cl";
-        //filename = "Algorithms/NoneLocalMeans/NoneLocalMeans2Dc.cl";
-	}
-	else {
-		filename = "Algorithms/NoneLocalMeans/NoneLocalMeans3Dgs.cl";
-	}
-	int programNr = device->createProgramFromSource(std::string(FAST_SOURCE_DIR) + filename, buildOptions);
-	mKernel = cl::Kernel(device->getProgram(programNr), "noneLocalMeans");
-	mDimensionCLCodeCompiledFor = input->getDimensions();
-	mTypeCLCodeCompiledFor = input->getDataType();
-}*/
+    }
+}
+
 void NoneLocalMeans::execute() {
     Image::pointer input = getStaticInputData<Image>(0);
     Image::pointer output = getStaticOutputData<Image>(0);
-    
+    if(input->getNrOfComponents() != 1)
+        throw Exception("NoneLocalMeans only supports images with one component");
+
     // Initialize output image
     ExecutionDevice::pointer device = getMainDevice();
     if(mOutputTypeSet) {
@@ -268,147 +483,86 @@ void NoneLocalMeans::execute() {
     }
     mOutputType = output->getDataType();
     SceneGraph::setParentNode(output, input);
-    
-    
+    adaptWindowSize(input);
+
+    const int width = input->getWidth();
+    const int height = input->getHeight();
+    const int depth = input->getDimensions() == 3 ? input->getDepth() : 1;
+    const float strength2 = denoiseStrength*denoiseStrength;
+    const float sigma2 = sigma*sigma;
+
     if(device->isHost()) {
+        std::vector<float> image((std::size_t)width*height*depth);
+        std::vector<float> result(image.size());
         switch(input->getDataType()) {
-                fastSwitchTypeMacro(executeAlgorithmOnHost<FAST_TYPE>(input, output, groupSize, windowSize, denoiseStrength, sigma));
+            fastSwitchTypeMacro(readNormalizedIntensities<FAST_TYPE>(input, image));
+        }
+        if(!mHostFrames.empty() && mHostFrames.front().size() != image.size())
+            mHostFrames.clear();
+        std::vector<const std::vector<float>*> previousFrames;
+        for(int i = 0; i < mHostFrames.size(); i++)
+            previousFrames.push_back(&mHostFrames[i]);
+        executeAlgorithmOnHost(image, previousFrames, result, width, height, depth, input->getDimensions(),
+                (groupSize-1)/2, (mCurrentWindowSize-1)/2, k, euclid, strength2, sigma2);
+        switch(output->getDataType()) {
+            fastSwitchTypeMacro(writeNormalizedIntensities<FAST_TYPE>(result, output));
+        }
+
+        if(mTemporalFrames > 0) {
+            mHostFrames.push_front(image);
+            if(mHostFrames.size() > mTemporalFrames)
+                mHostFrames.pop_back();
         }
     } else {
         OpenCLDevice::pointer clDevice = device;
-        
-        recompileOpenCLCode(input);
-        
-        cl::NDRange globalSize;
-        
-        OpenCLImageAccess::pointer inputAccess = input->getOpenCLImageAccess(ACCESS_READ, device);
-        if(input->getDimensions() == 2) {
-            OpenCLImageAccess::pointer outputAccess = output->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
-            mKernel.setArg(2, (denoiseStrength*denoiseStrength));
-            mKernel.setArg(3, (sigma*sigma));
-            globalSize = cl::NDRange(input->getWidth(),input->getHeight());
-            mKernel.setArg(0, *inputAccess->get2DImage());
-            mKernel.setArg(1, *outputAccess->get2DImage());
-            clDevice->getCommandQueue().enqueueNDRangeKernel(
-                    mKernel,
-                    cl::NullRange,
-                    globalSize,
-                    cl::NullRange
-            );
-        } else {
-            // Create an auxilliary image
-            //Image::pointer output2 = Image::New();
-            //output2->createFromImage(output);
-            
-            globalSize = cl::NDRange(input->getWidth(),input->getHeight(),input->getDepth());
-            
-            if(clDevice->isWritingTo3DTexturesSupported()) {
-                mKernel.setArg(2, (denoiseStrength*denoiseStrength));
-                mKernel.setArg(3, (sigma*sigma));
-                OpenCLImageAccess::pointer outputAccess = output->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
-                //OpenCLImageAccess::pointer outputAccess2 = output2->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
-                
-                //cl::Image3D* image2;
-                cl::Image3D* image;
-                image = outputAccess->get3DImage();
-                //image2 = outputAccess->get3DImage();
-                mKernel.setArg(0, *inputAccess->get3DImage());
-                mKernel.setArg(1, *image);
-                clDevice->getCommandQueue().enqueueNDRangeKernel(
-                        mKernel,
-                        cl::NullRange,
-                        globalSize,
-                        cl::NullRange
-                );
-            }else{
-                mKernel.setArg(2, (denoiseStrength*denoiseStrength));
-                mKernel.setArg(3, (sigma*sigma));
-                OpenCLBufferAccess::pointer outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
-                mKernel.setArg(0, *inputAccess->get3DImage());
-                mKernel.setArg(1, *outputAccess->get());
-                clDevice->getCommandQueue().enqueueNDRangeKernel(
-                        mKernel,
-                        cl::NullRange,
-                        globalSize,
-                        cl::NullRange
-                );
-            }
-            
-            
+        cl::Kernel kernel = getKernel(clDevice, input, output);
+
+        OpenCLBufferAccess::pointer inputAccess = input->getOpenCLBufferAccess(ACCESS_READ, clDevice);
+        OpenCLBufferAccess::pointer outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, clDevice);
+        kernel.setArg(0, *inputAccess->get());
+        kernel.setArg(1, *outputAccess->get());
+        kernel.setArg(2, width);
+        kernel.setArg(3, height);
+        kernel.setArg(4, depth);
+        kernel.setArg(5, strength2);
+        kernel.setArg(6, sigma2);
+
+        // Whole tiles, the work items outside of the image don't write
+        const Vector3i tile = mTileSize;
+        const Vector3i nrOfTiles(
+                (width + tile.x() - 1) / tile.x(),
+                (height + tile.y() - 1) / tile.y(),
+                (depth + tile.z() - 1) / tile.z()
+        );
+        updateFrameRing(clDevice, input, nrOfTiles.prod());
+        kernel.setArg(7, mFrameRing);
+        kernel.setArg(8, std::max(mTemporalFrames, 1));
+        kernel.setArg(9, mNewestFrame);
+        kernel.setArg(10, mNrOfPreviousFrames);
+        kernel.setArg(11, mMotion[mMotionIndex]);
+        kernel.setArg(12, mMotion[1-mMotionIndex]);
+        kernel.setArg(13, (int)(mCurrentWindowSize-1)/2);
+
+        cl::CommandQueue queue = clDevice->getCommandQueue();
+        queue.enqueueNDRangeKernel(
+                kernel,
+                cl::NullRange,
+                cl::NDRange(nrOfTiles.x()*tile.x(), nrOfTiles.y()*tile.y(), nrOfTiles.z()*tile.z()),
+                cl::NDRange(tile.x(), tile.y(), tile.z())
+        );
+
+        if(mTemporalFrames > 0) {
+            // Store the frame in the ring, the motion found is used for the next frame
+            const std::size_t frameSize = getSizeOfDataType(input->getDataType(), 1)*width*height*depth;
+            mNewestFrame = (mNewestFrame + 1) % mTemporalFrames;
+            queue.enqueueCopyBuffer(*inputAccess->get(), mFrameRing, 0, mNewestFrame*frameSize, frameSize);
+            mHasMotion = mNrOfPreviousFrames > 0;
+            mNrOfPreviousFrames = std::min(mNrOfPreviousFrames + 1, mTemporalFrames);
+            mMotionIndex = 1 - mMotionIndex;
         }
     }
 }
 
-/*
-void NoneLocalMeans::execute() {
-	Image::pointer input = getStaticInputData<Image>(0);
-	Image::pointer output = getStaticOutputData<Image>(0);
-    
-	// Initialize output image
-	ExecutionDevice::pointer device = getMainDevice();
-    
-	if (mOutputTypeSet) {
-        output->create(input->getSize(), mOutputType, input->getNrOfComponents());
-        output->setSpacing(input->getSpacing());
-	}else {
-		output->createFromImage(input);
-	}
-	mOutputType = output->getDataType();
-
-	if (device->isHost()) {
-		switch (input->getDataType()) {
-			fastSwitchTypeMacro(executeAlgorithmOnHost<FAST_TYPE>(input, output, groupSize, windowSize, denoiseStrength, sigma));
-		}
-	}
-	else {
-		OpenCLDevice::pointer clDevice = device;
-
-		recompileOpenCLCode(input);
-		cl::NDRange globalSize;
-		if (input->getDimensions() == 2) {
-			globalSize = cl::NDRange(input->getWidth(), input->getHeight());
-
-			OpenCLImageAccess::pointer inputAccess = input->getOpenCLImageAccess(ACCESS_READ, device);
-			OpenCLImageAccess::pointer outputAccess = output->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
-            
-            //Her trenger jeg og legge til sym image
-            //Det skal ta input, og extends sidene likt
-            //MinX/MinY = 0 - ((window-1)/2) - ((group-1)/2)
-            //MaxX/MaxY = max + ((window-1)/2) + ((group-1)/2)
-                        
-			mKernel.setArg(0, *inputAccess->get2DImage());
-			mKernel.setArg(1, *outputAccess->get2DImage());
-		}
-		else {
-			globalSize = cl::NDRange(input->getWidth(), input->getHeight(), input->getDepth());
-
-			const bool writingTo3DTextures = clDevice->getDevice().getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_3d_image_writes") != std::string::npos;
-			OpenCLImageAccess::pointer inputAccess = input->getOpenCLImageAccess(ACCESS_READ, device);
-			mKernel.setArg(0, *inputAccess->get3DImage());
-			if (writingTo3DTextures) {
-				OpenCLImageAccess::pointer outputAccess = output->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
-				mKernel.setArg(1, *outputAccess->get3DImage());
-			}
-			else {
-				OpenCLBufferAccess::pointer outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
-				mKernel.setArg(1, *outputAccess->get());
-			}
-		}
-
-		//mKernel.setArg(2, groupSize);
-		//mKernel.setArg(3, windowSize);
-		mKernel.setArg(2, (denoiseStrength*denoiseStrength));
-		mKernel.setArg(3, sigma);
-        //mKernel.setArg(4, k);
-
-		clDevice->getCommandQueue().enqueueNDRangeKernel(
-			mKernel,
-			cl::NullRange,
-			globalSize,
-			cl::NullRange
-		);
-	}
-}*/
 float NoneLocalMeans::getSigma(){
     return sigma;
 }
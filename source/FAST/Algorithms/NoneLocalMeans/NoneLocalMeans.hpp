@@ -4,9 +4,25 @@
 #include "FAST/ProcessObject.hpp"
 #include "FAST/ExecutionDevice.hpp"
 #include "FAST/Data/Image.hpp"
+#include <deque>
 
 namespace fast {
 
+/**
+ * None local means filter for 2D and 3D images with one component.
+ * Intensities of integer images are normalized to [0, 1] ([-1, 1] for signed
+ * types), so the denoise strength is relative to the range of the data type.
+ *
+ * The weight of each pixel in the search window is given by euclid:
+ * 0: exp(-K*patch distance/strength^2), where K is given by k:
+ *    0: 1/patch size, 1: 1/sigma^2, 2: 1
+ * 1: sum of exp(-difference^2/strength^2) over the patch plus a spatial weight
+ * 2: sum of exp(-difference^2/strength^2) over the patch times a gaussian
+ *    spatial weight with standard deviation sigma
+ *
+ * For streams, patches can also be searched for in the previous frames, see
+ * setTemporalFrames. Each execution is then treated as a new frame.
+ */
 class NoneLocalMeans : public ProcessObject {
 	FAST_OBJECT(NoneLocalMeans)
 	public:
@@ -18,6 +34,32 @@ class NoneLocalMeans : public ProcessObject {
 		void setDenoiseStrength(float dS);
 		void setOutputType(DataType type);
         void setEuclid(unsigned char e);
+        // Sum the patch distances with half precision on devices which support it
+        void setHalfPrecisionAccumulation(bool halfPrecision);
+        /**
+         * Number of previous frames which are searched for similar patches,
+         * 0 (default) only searches the current frame. On OpenCL devices the
+         * search window of a previous frame follows the motion found in the
+         * frame before. Only this motion is carried over between frames, the
+         * weights are calculated again for every frame. Keeping them would
+         * need one weight per pixel and offset, and pruning offsets per tile
+         * would change the result of pixels with small weights.
+         */
+        void setTemporalFrames(int frames);
+        /**
+         * Reduce the search window when the runtime of the last frame exceeds
+         * the budget, and increase it again up to the window size when there
+         * is time. Enables runtime measurements. 0 (default) disables it.
+         */
+        void setFrameBudget(float milliseconds);
+        // Search window size used for the last frame
+        int getCurrentWindowSize();
+        /**
+         * Average over the tiles of the motion found between the last two
+         * frames on an OpenCL device, as the offset into the previous frame
+         * in voxels. Zero before the second frame and on the host.
+         */
+        Vector3f getAverageMotion();
         float getSigma();
         int getK();
         int getGroupSize();
@@ -27,7 +69,10 @@ class NoneLocalMeans : public ProcessObject {
 	private:
 		NoneLocalMeans();
 		void execute();
-		void recompileOpenCLCode(Image::pointer input);
+		cl::Kernel getKernel(OpenCLDevice::pointer device, Image::pointer input, Image::pointer output);
+		void updateFrameRing(OpenCLDevice::pointer device, Image::pointer input, int nrOfTiles);
+		void resetFrameRing();
+		void adaptWindowSize(Image::pointer input);
 
 		unsigned char windowSize;
 		unsigned char groupSize;
@@ -36,14 +81,30 @@ class NoneLocalMeans : public ProcessObject {
 		//unsigned char sigma;
         float sigma;
         float denoiseStrength;
-
-		//bool gray;
-		//bool mIsModified;
-		bool recompile;
+        bool mHalfPrecisionAccumulation;
+        unsigned char mCurrentWindowSize;
+        float mFrameBudget;
 
 		cl::Kernel mKernel;
-		unsigned char mDimensionCLCodeCompiledFor;
-		DataType mTypeCLCodeCompiledFor;
+		std::string mKernelBuildOptions;
+		OpenCLDevice::pointer mKernelDevice;
+		// The runtime of the last frame includes building the program
+		bool mKernelRebuilt;
+		Vector3i mTileSize;
+
+		// Previous frames, on the device stored in a ring buffer
+		int mTemporalFrames;
+		int mNrOfPreviousFrames;
+		int mNewestFrame;
+		cl::Buffer mFrameRing;
+		cl::Buffer mMotion[2]; // Motion of each tile in the last and current frame
+		int mMotionIndex;
+		bool mHasMotion; // The motion was found in the last frame
+		OpenCLDevice::pointer mFrameRingDevice;
+		Vector3i mFrameRingImageSize;
+		DataType mFrameRingDataType;
+		int mFrameRingNrOfTiles;
+		std::deque<std::vector<float> > mHostFrames;
 		DataType mOutputType;
 		bool mOutputTypeSet;
 
@@ -51,4 +112,4 @@ class NoneLocalMeans : public ProcessObject {
 }; //emd class
 } //end namespace
 
-#endif //NONELOCALMEANS_HPP_
\ No newline at end of file
+#endif //NONELOCALMEANS_HPP_
@@ -1,6 +1,7 @@
 #include "FAST/Tests/catch.hpp"
 #include "FAST/Algorithms/NoneLocalMeans/NoneLocalMeans.hpp"
 #include "FAST/DeviceManager.hpp"
+#include <cmath>
 
 namespace fast{
 
@@ -32,4 +33,227 @@ namespace fast{
         CHECK_THROWS(filter->setWindowSize(2));
         CHECK_THROWS(filter->setGroupSize(2));
     }
-}
\ No newline at end of file
+
+    // Deterministic noisy image with edges, the noise is different for each frame
+    static Image::pointer createNoisyImage(int width, int height, int depth, DataType type, int frame = 0) {
+        Image::pointer image = Image::New();
+        if(depth == 1) {
+            image->create(width, height, type, 1);
+        } else {
+            image->create(width, height, depth, type, 1);
+        }
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+        for(int i = 0; i < width*height*depth; i++) {
+            const int x = i % width;
+            const float value = (x < width/2 ? 0.3f : 0.7f) + ((i*37 + frame*11) % 23 - 11)*0.01f;
+            if(type == TYPE_UINT8) {
+                ((uchar*)access->get())[i] = (uchar)(value*255);
+            } else {
+                ((float*)access->get())[i] = value;
+            }
+        }
+        return image;
+    }
+
+    static std::vector<float> getIntensities(Image::pointer output) {
+        const int size = output->getWidth()*output->getHeight()*output->getDepth();
+        std::vector<float> result(size);
+        ImageAccess::pointer access = output->getImageAccess(ACCESS_READ);
+        for(int i = 0; i < size; i++) {
+            if(output->getDataType() == TYPE_UINT8) {
+                result[i] = ((uchar*)access->get())[i];
+            } else {
+                result[i] = ((float*)access->get())[i];
+            }
+        }
+        return result;
+    }
+
+    static std::vector<float> runNoneLocalMeans(Image::pointer image, ExecutionDevice::pointer device, bool halfPrecision = false) {
+        NoneLocalMeans::pointer filter = NoneLocalMeans::New();
+        filter->setMainDevice(device);
+        filter->setWindowSize(5);
+        filter->setGroupSize(3);
+        filter->setHalfPrecisionAccumulation(halfPrecision);
+        filter->setInputData(image);
+        Image::pointer output = filter->getOutputData<Image>();
+        filter->update();
+        return getIntensities(output);
+    }
+
+    // Filters the frames with one filter and returns the result of the last frame
+    static std::vector<float> runStreamingNoneLocalMeans(std::vector<Image::pointer> frames, ExecutionDevice::pointer device, int temporalFrames) {
+        NoneLocalMeans::pointer filter = NoneLocalMeans::New();
+        filter->setMainDevice(device);
+        filter->setWindowSize(5);
+        filter->setGroupSize(3);
+        filter->setTemporalFrames(temporalFrames);
+        Image::pointer output;
+        for(int i = 0; i < frames.size(); i++) {
+            filter->setInputData(frames[i]);
+            output = filter->getOutputData<Image>();
+            filter->update();
+        }
+        return getIntensities(output);
+    }
+
+    // Sum of differences between neighbors in the left half of a 2D image
+    static float getVariation(const std::vector<float>& data, int width, int height) {
+        float variation = 0.0f;
+        for(int y = 0; y < height; y++) {
+            for(int x = 1; x < width/2; x++)
+                variation += fabs(data[x+y*width] - data[x-1+y*width]);
+        }
+        return variation;
+    }
+
+    TEST_CASE("Constant image stays constant with NoneLocalMeans on Host", "[fast][NonLocalMeans]") {
+        Image::pointer image = Image::New();
+        image->create(20, 15, TYPE_FLOAT, 1);
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+        float* data = (float*)access->get();
+        for(int i = 0; i < 20*15; i++)
+            data[i] = 0.5f;
+        access->release();
+
+        std::vector<float> result = runNoneLocalMeans(image, Host::getInstance());
+        for(int i = 0; i < 20*15; i++)
+            CHECK(result[i] == Approx(0.5f));
+    }
+
+    TEST_CASE("NoneLocalMeans reduces noise on Host", "[fast][NonLocalMeans]") {
+        const int width = 40, height = 30;
+        Image::pointer image = createNoisyImage(width, height, 1, TYPE_FLOAT);
+        std::vector<float> result = runNoneLocalMeans(image, Host::getInstance());
+
+        // Variation within the left half of the image
+        float inputVariation = 0.0f, outputVariation = 0.0f;
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+        float* data = (float*)access->get();
+        for(int y = 0; y < height; y++) {
+            for(int x = 1; x < width/2; x++) {
+                inputVariation += fabs(data[x+y*width] - data[x-1+y*width]);
+                outputVariation += fabs(result[x+y*width] - result[x-1+y*width]);
+            }
+        }
+        CHECK(outputVariation < inputVariation*0.5f);
+        // The edge is preserved
+        const float edge = result[width/2+5*width] - result[width/2-1+5*width];
+        CHECK(edge > 0.2f);
+    }
+
+    TEST_CASE("NoneLocalMeans on OpenCL devices gives the same result as on Host", "[fast][NonLocalMeans]") {
+        Image::pointer image2D = createNoisyImage(37, 29, 1, TYPE_UINT8);
+        Image::pointer image3D = createNoisyImage(19, 14, 11, TYPE_FLOAT);
+        std::vector<float> host2D = runNoneLocalMeans(image2D, Host::getInstance());
+        std::vector<float> host3D = runNoneLocalMeans(image3D, Host::getInstance());
+
+        std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+        for(int i = 0; i < devices.size(); i++) {
+            INFO("Device " << devices[i]->getName());
+            std::vector<float> device2D = runNoneLocalMeans(image2D, devices[i]);
+            for(int j = 0; j < host2D.size(); j++)
+                CHECK(fabs(device2D[j] - host2D[j]) <= 1.0f);
+
+            std::vector<float> device3D = runNoneLocalMeans(image3D, devices[i]);
+            for(int j = 0; j < host3D.size(); j++)
+                CHECK(device3D[j] == Approx(host3D[j]).epsilon(0.001));
+
+            // Half precision patch distances, or single precision if not supported
+            std::vector<float> half3D = runNoneLocalMeans(image3D, devices[i], true);
+            for(int j = 0; j < host3D.size(); j++)
+                CHECK(half3D[j] == Approx(host3D[j]).epsilon(0.02));
+        }
+    }
+
+    TEST_CASE("Negative number of temporal frames throws exception in NonLocalMeans", "[fast][NonLocalMeans]") {
+        NoneLocalMeans::pointer filter = NoneLocalMeans::New();
+        CHECK_THROWS(filter->setTemporalFrames(-1));
+        CHECK_NOTHROW(filter->setTemporalFrames(0));
+    }
+
+    TEST_CASE("NoneLocalMeans with temporal frames reduces noise more on Host", "[fast][NonLocalMeans]") {
+        const int width = 40, height = 30;
+        std::vector<Image::pointer> frames;
+        for(int i = 0; i < 3; i++)
+            frames.push_back(createNoisyImage(width, height, 1, TYPE_FLOAT, i));
+
+        std::vector<float> spatial = runStreamingNoneLocalMeans(frames, Host::getInstance(), 0);
+        std::vector<float> temporal = runStreamingNoneLocalMeans(frames, Host::getInstance(), 2);
+        CHECK(getVariation(temporal, width, height) < getVariation(spatial, width, height));
+        const float edge = temporal[width/2+5*width] - temporal[width/2-1+5*width];
+        CHECK(edge > 0.2f);
+    }
+
+    TEST_CASE("Streaming NoneLocalMeans on OpenCL devices gives the same result as on Host", "[fast][NonLocalMeans]") {
+        // The frames are equal, so the motion found on the devices is zero
+        Image::pointer image = createNoisyImage(37, 29, 1, TYPE_FLOAT);
+        std::vector<Image::pointer> frames(4, image);
+        std::vector<float> host = runStreamingNoneLocalMeans(frames, Host::getInstance(), 2);
+
+        std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+        for(int i = 0; i < devices.size(); i++) {
+            INFO("Device " << devices[i]->getName());
+            std::vector<float> device = runStreamingNoneLocalMeans(frames, devices[i], 2);
+            for(int j = 0; j < host.size(); j++)
+                CHECK(device[j] == Approx(host[j]).epsilon(0.001));
+        }
+    }
+
+    // Copy of the image moved shift pixels in the x direction
+    static Image::pointer createShiftedImage(Image::pointer image, int shift) {
+        const int width = image->getWidth();
+        const int height = image->getHeight();
+        Image::pointer shifted = Image::New();
+        shifted->create(width, height, TYPE_FLOAT, 1);
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+        ImageAccess::pointer shiftedAccess = shifted->getImageAccess(ACCESS_READ_WRITE);
+        for(int y = 0; y < height; y++) {
+            for(int x = 0; x < width; x++) {
+                const int sourceX = std::min(std::max(x - shift, 0), width-1);
+                ((float*)shiftedAccess->get())[x + y*width] = ((float*)access->get())[sourceX + y*width];
+            }
+        }
+        return shifted;
+    }
+
+    TEST_CASE("Streaming NoneLocalMeans on OpenCL devices follows the motion of the frames", "[fast][NonLocalMeans]") {
+        // Each frame moves 2 pixels, so from the third frame the search
+        // window in the previous frame is centered at the motion found before
+        Image::pointer image = createNoisyImage(37, 29, 1, TYPE_FLOAT);
+        std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+        for(int i = 0; i < devices.size(); i++) {
+            INFO("Device " << devices[i]->getName());
+            NoneLocalMeans::pointer filter = NoneLocalMeans::New();
+            filter->setMainDevice(devices[i]);
+            filter->setWindowSize(5);
+            filter->setGroupSize(3);
+            filter->setTemporalFrames(1);
+            for(int frame = 0; frame < 4; frame++) {
+                filter->setInputData(createShiftedImage(image, frame*2));
+                filter->update();
+                if(frame == 0)
+                    CHECK(filter->getAverageMotion().isZero());
+            }
+            const Vector3f motion = filter->getAverageMotion();
+            CHECK(motion.x() == Approx(-2).epsilon(0.25));
+            CHECK(std::fabs(motion.y()) < 0.5f);
+        }
+    }
+
+    TEST_CASE("NoneLocalMeans reduces the window size when the frame budget is exceeded", "[fast][NonLocalMeans]") {
+        Image::pointer image = createNoisyImage(40, 30, 1, TYPE_FLOAT);
+        NoneLocalMeans::pointer filter = NoneLocalMeans::New();
+        filter->setMainDevice(Host::getInstance());
+        filter->setWindowSize(7);
+        filter->setGroupSize(3);
+        filter->setFrameBudget(0.001f);
+        CHECK(filter->getCurrentWindowSize() == 7);
+        for(int i = 0; i < 3; i++) {
+            filter->setInputData(image);
+            filter->update();
+        }
+        CHECK(filter->getCurrentWindowSize() < 7);
+        CHECK(filter->getCurrentWindowSize() >= 3);
+    }
+}
@@ -1,20 +1,57 @@
 #include "FAST/Algorithms/SeededRegionGrowing/SeededRegionGrowing.hpp"
+#include "FAST/Algorithms/ConnectedComponents/ConnectedComponents.hpp"
 #include "FAST/DeviceManager.hpp"
 #include "FAST/SceneGraph.hpp"
-#include <stack>
+#include <boost/lexical_cast.hpp>
 #include "FAST/Data/Segmentation.hpp"
 
 namespace fast {
 
 void SeededRegionGrowing::setIntensityRange(float min, float max) {
+    mIntensityRanges.clear();
+    addIntensityRange(min, max);
+}
+
+void SeededRegionGrowing::addIntensityRange(float min, float max) {
     if(min >= max)
         throw Exception("Min must be smaller than max intensity range in SeededRegionGrowing");
 
-    mMinimumIntensity = min;
-    mMaximumIntensity = max;
+    mIntensityRanges.push_back(Vector2f(min, max));
+    mIsModified = true;
+}
+
+void SeededRegionGrowing::setConnectivity(uint nrOfNeighbors) {
+    if(nrOfNeighbors != 4 && nrOfNeighbors != 8 && nrOfNeighbors != 6 && nrOfNeighbors != 26)
+        throw Exception("Connectivity given to SeededRegionGrowing must be 4, 8, 6 or 26");
+
+    mConnectivity = nrOfNeighbors;
     mIsModified = true;
 }
 
+void SeededRegionGrowing::setConvergenceCheckInterval(uint iterations) {
+    if(iterations == 0)
+        throw Exception("Convergence check interval of SeededRegionGrowing must be at least 1");
+
+    mConvergenceCheckInterval = iterations;
+    mIsModified = true;
+}
+
+uint SeededRegionGrowing::getNrOfIterations() const {
+    return mNrOfIterations;
+}
+
+uint SeededRegionGrowing::getConnectivity(uchar dimensions) const {
+    if(mConnectivity == 0)
+        return dimensions == 2 ? 8 : 6;
+
+    if(dimensions == 2 && mConnectivity != 4 && mConnectivity != 8)
+        throw Exception("Connectivity of SeededRegionGrowing must be 4 or 8 for 2D images");
+    if(dimensions == 3 && mConnectivity != 6 && mConnectivity != 26)
+        throw Exception("Connectivity of SeededRegionGrowing must be 6 or 26 for 3D images");
+
+    return mConnectivity;
+}
+
 void SeededRegionGrowing::addSeedPoint(uint x, uint y) {
     Vector3ui pos;
     pos[0] = x;
@@ -33,18 +70,25 @@ void SeededRegionGrowing::addSeedPoint(uint x, uint y, uint z) {
 
 void SeededRegionGrowing::addSeedPoint(Vector3ui position) {
     mSeedPoints.push_back(position);
+    mIsModified = true;
 }
 
 SeededRegionGrowing::SeededRegionGrowing() {
     createInputPort<Image>(0);
     createOutputPort<Segmentation>(0, OUTPUT_DEPENDS_ON_INPUT, 0);
+    mConnectivity = 0;
+    mConvergenceCheckInterval = 16;
+    mNrOfIterations = 0;
     mDimensionCLCodeCompiledFor = 0;
+    mConnectivityCLCodeCompiledFor = 0;
 }
 
 void SeededRegionGrowing::recompileOpenCLCode(Image::pointer input) {
+    const uint connectivity = getConnectivity(input->getDimensions());
     // Check if there is a need to recompile OpenCL code
     if(input->getDimensions() == mDimensionCLCodeCompiledFor &&
-            input->getDataType() == mTypeCLCodeCompiledFor)
+            input->getDataType() == mTypeCLCodeCompiledFor &&
+            connectivity == mConnectivityCLCodeCompiledFor)
         return;
 
     OpenCLDevice::pointer device = getMainDevice();
@@ -56,75 +100,179 @@ void SeededRegionGrowing::recompileOpenCLCode(Image::pointer input) {
     } else {
         buildOptions = "-DTYPE_UINT";
     }
+    buildOptions += " -DCONNECTIVITY=" + boost::lexical_cast<std::string>(connectivity);
     std::string filename;
     if(input->getDimensions() == 2) {
         filename = "Algorithms/SeededRegionGrowing/SeededRegionGrowing2D.cl";
     } else {
         filename = "Algorithms/SeededRegionGrowing/SeededRegionGrowing3D.cl";
     }
-    int programNr = device->createProgramFromSource(std::string(FAST_SOURCE_DIR) + filename, buildOptions);
-    mKernel = cl::Kernel(device->getProgram(programNr), "seededRegionGrowing");
+    std::string sourceFilename = std::string(FAST_SOURCE_DIR) + filename;
+    std::string programName = sourceFilename + buildOptions;
+    if(!device->hasProgram(programName))
+        device->createProgramFromSourceWithName(programName, sourceFilename, buildOptions);
+    cl::Program program = device->getProgram(programName);
+    mInitializeKernel = cl::Kernel(program, "initializeSegmentation");
+    mSeedKernel = cl::Kernel(program, "addSeeds");
+    mGrowKernel = cl::Kernel(program, "growRegion");
+    mCollectKernel = cl::Kernel(program, "collectFront");
     mDimensionCLCodeCompiledFor = input->getDimensions();
     mTypeCLCodeCompiledFor = input->getDataType();
+    mConnectivityCLCodeCompiledFor = connectivity;
+}
+
+static inline bool isInIntensityRange(float value, const std::vector<Vector2f>& ranges) {
+    for(int i = 0; i < ranges.size(); i++) {
+        if(value >= ranges[i].x() && value <= ranges[i].y())
+            return true;
+    }
+    return false;
 }
 
 template <class T>
 void SeededRegionGrowing::executeOnHost(T* input, Image::pointer output) {
     ImageAccess::pointer outputAccess = output->getImageAccess(ACCESS_READ_WRITE);
     uchar* outputData = (uchar*)outputAccess->get();
+    const Vector3ui size = output->getSize();
     // initialize output to all zero
-    memset(outputData, 0, output->getWidth()*output->getHeight()*output->getDepth());
-    std::stack<Vector3ui> queue;
+    memset(outputData, 0, (std::size_t)size.x()*size.y()*size.z());
+    const uint connectivity = getConnectivity(output->getDimensions());
 
-    // Add seeds to queue
+    for(int i = 0; i < mSeedPoints.size(); i++) {
+        Vector3ui pos = mSeedPoints[i];
+        if(pos.x() >= size.x() || pos.y() >= size.y() || pos.z() >= size.z())
+            throw Exception("One of the seed points given to SeededRegionGrowing was out of bounds.");
+    }
+
+    const std::vector<Vector2f>& ranges = mIntensityRanges;
+    scanlineFloodFill(outputData, size, connectivity == 8 || connectivity == 26, mSeedPoints,
+            [input, &ranges](std::size_t index) { return isInIntensityRange(input[index], ranges); });
+}
+
+void SeededRegionGrowing::executeOnDevice(Image::pointer input, Image::pointer output) {
+    OpenCLDevice::pointer device = getMainDevice();
+    recompileOpenCLCode(input);
+    cl::CommandQueue queue = device->getCommandQueue();
+
+    const std::size_t width = output->getWidth();
+    const std::size_t height = output->getHeight();
+    const std::size_t depth = output->getDepth();
+    const std::size_t nrOfVoxels = width*height*depth;
+    std::vector<cl_uint> seeds;
     for(int i = 0; i < mSeedPoints.size(); i++) {
         Vector3ui pos = mSeedPoints[i];
 
         // Check if seed point is in bounds
-        if(pos.x() < 0 || pos.y() < 0 || pos.z() < 0 ||
-            pos.x() >= output->getWidth() || pos.y() >= output->getHeight() || pos.z() >= output->getDepth())
+        if(pos.x() >= width || pos.y() >= height || pos.z() >= depth)
             throw Exception("One of the seed points given to SeededRegionGrowing was out of bounds.");
 
-        queue.push(pos);
+        seeds.push_back(pos.x() + (pos.y() + pos.z()*height)*width);
     }
 
-    // Process queue
-    while(!queue.empty()) {
-        Vector3ui pos = queue.top();
-        queue.pop();
-
-        // Add neighbors to queue
-        for(int a = -1; a < 2; a++) {
-        for(int b = -1; b < 2; b++) {
-        for(int c = -1; c < 2; c++) {
-            if(abs(a)+abs(b)+abs(c) != 1) // connectivity
-                continue;
-            Vector3ui neighbor(pos.x()+a,pos.y()+b,pos.z()+c);
-            // Check for out of bounds
-            if(neighbor.x() < 0 || neighbor.y() < 0 || neighbor.z() < 0 ||
-                neighbor.x() >= output->getWidth() || neighbor.y() >= output->getHeight() || neighbor.z() >= output->getDepth())
-                continue;
-
-            // Check that voxel is not already segmented
-            if(outputData[neighbor.x()+neighbor.y()*output->getWidth()+neighbor.z()*output->getWidth()*output->getHeight()] == 1)
-                continue;
-
-            // Check condition
-            T value = input[neighbor.x()+neighbor.y()*output->getWidth()+neighbor.z()*output->getWidth()*output->getHeight()];
-            if(value >= mMinimumIntensity && value <= mMaximumIntensity) {
-                // add it to segmentation
-                outputData[neighbor.x()+neighbor.y()*output->getWidth()+neighbor.z()*output->getWidth()*output->getHeight()] = 1;
-
-                // Add to queue
-                queue.push(neighbor);
-            }
-        }}}
+    // Only the voxels on the front of the region are processed in each iteration.
+    // The fronts are smaller than the image, and voxels which don't fit are
+    // kept in the segmentation and collected when the front has been emptied.
+    std::size_t capacity = std::min(nrOfVoxels, std::max(nrOfVoxels/8, (std::size_t)1 << 20));
+    capacity = std::min(capacity, (std::size_t)device->getDevice().getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>()/sizeof(cl_uint));
+    cl::Buffer fronts[2];
+    for(int i = 0; i < 2; i++)
+        fronts[i] = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, capacity*sizeof(cl_uint));
+    cl::Buffer seedBuffer(
+            device->getContext(),
+            CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+            seeds.size()*sizeof(cl_uint),
+            seeds.data()
+    );
+    cl::Buffer rangeBuffer(
+            device->getContext(),
+            CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+            mIntensityRanges.size()*2*sizeof(float),
+            mIntensityRanges.data()
+    );
+    // Sizes of the three fronts and the overflow flag
+    cl_uint state[4] = {0, 0, 0, 0};
+    cl::Buffer stateBuffer(
+            device->getContext(),
+            CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+            sizeof(state),
+            state
+    );
+
+    OpenCLImageAccess::pointer inputAccess = input->getOpenCLImageAccess(ACCESS_READ, device);
+    OpenCLBufferAccess::pointer outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+    cl::Buffer* segmentation = outputAccess->get();
+    if(input->getDimensions() == 2) {
+        mSeedKernel.setArg(0, *inputAccess->get2DImage());
+        mGrowKernel.setArg(0, *inputAccess->get2DImage());
+    } else {
+        mSeedKernel.setArg(0, *inputAccess->get3DImage());
+        mGrowKernel.setArg(0, *inputAccess->get3DImage());
+    }
+
+    // The kernels which loop over the image or the front use a fixed number of
+    // work items, so that they can be enqueued without knowing the front size
+    const cl::NDRange globalSize(1024*device->getDevice().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>());
+
+    mRuntimeManager->startRegularTimer("region growing");
+    mInitializeKernel.setArg(0, *segmentation);
+    mInitializeKernel.setArg(1, (cl_ulong)nrOfVoxels);
+    queue.enqueueNDRangeKernel(mInitializeKernel, cl::NullRange, globalSize, cl::NullRange);
+
+    mSeedKernel.setArg(1, *segmentation);
+    mSeedKernel.setArg(2, seedBuffer);
+    mSeedKernel.setArg(3, fronts[0]);
+    mSeedKernel.setArg(4, stateBuffer);
+    mSeedKernel.setArg(5, (cl_uint)capacity);
+    mSeedKernel.setArg(6, rangeBuffer);
+    mSeedKernel.setArg(7, (int)mIntensityRanges.size());
+    queue.enqueueNDRangeKernel(mSeedKernel, cl::NullRange, cl::NDRange(seeds.size()), cl::NullRange);
+
+    mGrowKernel.setArg(1, *segmentation);
+    mGrowKernel.setArg(4, stateBuffer);
+    mGrowKernel.setArg(6, (cl_uint)capacity);
+    mGrowKernel.setArg(7, rangeBuffer);
+    mGrowKernel.setArg(8, (int)mIntensityRanges.size());
+
+    mCollectKernel.setArg(0, *segmentation);
+    mCollectKernel.setArg(1, (cl_ulong)nrOfVoxels);
+    mCollectKernel.setArg(3, stateBuffer);
+    mCollectKernel.setArg(5, (cl_uint)capacity);
+
+    int iteration = 0;
+    while(true) {
+        // Iterations after the region has stopped growing only read the size of an empty front
+        for(int i = 0; i < mConvergenceCheckInterval; i++) {
+            mGrowKernel.setArg(2, fronts[iteration % 2]);
+            mGrowKernel.setArg(3, fronts[(iteration + 1) % 2]);
+            mGrowKernel.setArg(5, iteration);
+            queue.enqueueNDRangeKernel(mGrowKernel, cl::NullRange, globalSize, cl::NullRange);
+            iteration++;
+        }
+
+        queue.enqueueReadBuffer(stateBuffer, CL_TRUE, 0, sizeof(state), state);
+        if(state[iteration % 3] > 0)
+            continue;
+        if(state[3] == 0)
+            break;
+
+        // Some voxels didn't fit in the fronts, add them to the current front
+        state[3] = 0;
+        queue.enqueueWriteBuffer(stateBuffer, CL_TRUE, 3*sizeof(cl_uint), sizeof(cl_uint), &state[3]);
+        mCollectKernel.setArg(2, fronts[iteration % 2]);
+        mCollectKernel.setArg(4, iteration);
+        queue.enqueueNDRangeKernel(mCollectKernel, cl::NullRange, globalSize, cl::NullRange);
     }
+    mRuntimeManager->stopRegularTimer("region growing");
+
+    mNrOfIterations = iteration;
+    reportInfo() << "SeededRegionGrowing finished after " << iteration << " iterations" << Reporter::end;
 }
 
 void SeededRegionGrowing::execute() {
     if(mSeedPoints.size() == 0)
         throw Exception("No seed points supplied to SeededRegionGrowing");
+    if(mIntensityRanges.size() == 0)
+        throw Exception("No intensity range supplied to SeededRegionGrowing");
 
     Image::pointer input = getStaticInputData<Image>();
     if(input->getNrOfComponents() != 1)
@@ -142,70 +290,8 @@ void SeededRegionGrowing::execute() {
             fastSwitchTypeMacro(executeOnHost<FAST_TYPE>((FAST_TYPE*)inputData, output));
         }
     } else {
-        OpenCLDevice::pointer device = getMainDevice();
-
-        recompileOpenCLCode(input);
-
-        ImageAccess::pointer access = output->getImageAccess(ACCESS_READ_WRITE);
-        uchar* outputData = (uchar*)access->get();
-        // Initialize to all 0s
-        memset(outputData,0,sizeof(uchar)*output->getWidth()*output->getHeight()*output->getDepth());
-
-        // Add sedd points
-        for(int i = 0; i < mSeedPoints.size(); i++) {
-            Vector3ui pos = mSeedPoints[i];
-
-            // Check if seed point is in bounds
-            if(pos.x() < 0 || pos.y() < 0 || pos.z() < 0 ||
-                pos.x() >= output->getWidth() || pos.y() >= output->getHeight() || pos.z() >= output->getDepth())
-                throw Exception("One of the seed points given to SeededRegionGrowing was out of bounds.");
-
-            outputData[pos.x() + pos.y()*output->getWidth() + pos.z()*output->getWidth()*output->getHeight()] = 2;
-        }
-        access->release();
-
-        cl::NDRange globalSize;
-        OpenCLImageAccess::pointer inputAccess = input->getOpenCLImageAccess(ACCESS_READ, device);
-        if(output->getDimensions() == 2) {
-            globalSize = cl::NDRange(input->getWidth(),input->getHeight());
-            mKernel.setArg(0, *inputAccess->get2DImage());
-        } else {
-            globalSize = cl::NDRange(input->getWidth(),input->getHeight(), input->getDepth());
-            mKernel.setArg(0, *inputAccess->get3DImage());
-        }
-
-        OpenCLBufferAccess::pointer outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
-        cl::Buffer stopGrowingBuffer = cl::Buffer(
-                device->getContext(),
-                CL_MEM_READ_WRITE,
-                sizeof(char));
-        cl::CommandQueue queue = device->getCommandQueue();
-        mKernel.setArg(1, *outputAccess->get());
-        mKernel.setArg(2, stopGrowingBuffer);
-        mKernel.setArg(3, mMinimumIntensity);
-        mKernel.setArg(4, mMaximumIntensity);
-
-        bool stopGrowing = false;
-        char stopGrowingInit = 1;
-        char * stopGrowingResult = new char;
-        int iterations = 0;
-        do {
-            iterations++;
-            queue.enqueueWriteBuffer(stopGrowingBuffer, CL_TRUE, 0, sizeof(char), &stopGrowingInit);
-
-            queue.enqueueNDRangeKernel(
-                    mKernel,
-                    cl::NullRange,
-                    globalSize,
-                    cl::NullRange
-            );
-
-            queue.enqueueReadBuffer(stopGrowingBuffer, CL_TRUE, 0, sizeof(char), stopGrowingResult);
-            if(*stopGrowingResult == 1)
-                stopGrowing = true;
-        } while(!stopGrowing);
+        executeOnDevice(input, output);
     }
-
 }
 
 void SeededRegionGrowing::waitToFinish() {
@@ -10,7 +10,27 @@ namespace fast {
 class SeededRegionGrowing : public ProcessObject {
     FAST_OBJECT(SeededRegionGrowing)
     public:
+        /**
+         * Set the intensity range of the region, replacing all ranges added before
+         */
         void setIntensityRange(float min, float max);
+        /**
+         * Add an intensity range. Voxels with an intensity in any of the ranges
+         * are included in the region.
+         */
+        void addIntensityRange(float min, float max);
+        /**
+         * Number of neighbors of each voxel; 4 or 8 in 2D and 6 or 26 in 3D.
+         * Default is 8 in 2D and 6 in 3D.
+         */
+        void setConnectivity(uint nrOfNeighbors);
+        /**
+         * Number of iterations the OpenCL implementation runs between each
+         * time it checks if the region has stopped growing. Default is 16.
+         */
+        void setConvergenceCheckInterval(uint iterations);
+        // Number of iterations the last execution needed on the OpenCL device
+        uint getNrOfIterations() const;
         void addSeedPoint(uint x, uint y);
         void addSeedPoint(uint x, uint y, uint z);
         void addSeedPoint(Vector3ui position);
@@ -19,15 +39,24 @@ class SeededRegionGrowing : public ProcessObject {
         void execute();
         void waitToFinish();
         void recompileOpenCLCode(Image::pointer input);
+        void executeOnDevice(Image::pointer input, Image::pointer output);
         template <class T>
         void executeOnHost(T* input, Image::pointer output);
+        uint getConnectivity(uchar dimensions) const;
 
-        float mMinimumIntensity, mMaximumIntensity;
+        std::vector<Vector2f> mIntensityRanges;
         std::vector<Vector3ui> mSeedPoints;
+        uint mConnectivity;
+        uint mConvergenceCheckInterval;
+        uint mNrOfIterations;
 
-        cl::Kernel mKernel;
+        cl::Kernel mInitializeKernel;
+        cl::Kernel mSeedKernel;
+        cl::Kernel mGrowKernel;
+        cl::Kernel mCollectKernel;
         unsigned char mDimensionCLCodeCompiledFor;
         DataType mTypeCLCodeCompiledFor;
+        uint mConnectivityCLCodeCompiledFor;
 
 };
 
@@ -1,4 +1,3 @@
-
 __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_FILTER_NEAREST | CLK_ADDRESS_NONE;
 
 #ifdef TYPE_FLOAT
@@ -9,49 +8,120 @@ __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_FILTER_NEAREST
 #define READ_IMAGE(image, pos) (float)read_imageui(image, sampler, pos).x
 #endif
 
-__kernel void seededRegionGrowing(
+#ifndef CONNECTIVITY
+#define CONNECTIVITY 8
+#endif
+
+// The segmentation is 1 for pixels in the region, and 2 for pixels in the
+// region which neighbors have not been visited yet.
+// The state buffer holds the sizes of three fronts, which are used in turn, and
+// an overflow flag which is set when a pixel didn't fit in the front.
+
+bool isInRange(float intensity, __constant float2* ranges, int nrOfRanges) {
+    for(int i = 0; i < nrOfRanges; i++) {
+        if(intensity >= ranges[i].x && intensity <= ranges[i].y)
+            return true;
+    }
+    return false;
+}
+
+// If the front is full, the pixel stays queued in the segmentation and is
+// collected when the front has been emptied
+void addToFront(uint index, __global uint* front, __global uint* frontSize, __private uint capacity, __global uint* overflow) {
+    const uint position = atomic_inc(frontSize);
+    if(position < capacity) {
+        front[position] = index;
+    } else {
+        *overflow = 1;
+    }
+}
+
+__kernel void initializeSegmentation(
+        __global uchar* segmentation,
+        __private ulong nrOfPixels
+        ) {
+    for(ulong i = get_global_id(0); i < nrOfPixels; i += get_global_size(0))
+        segmentation[i] = 0;
+}
+
+__kernel void addSeeds(
         __read_only image2d_t image,
-        __global char* segmentation,
-        __global char* stopGrowing,
-        __private float min,
-        __private float max
+        __global uchar* segmentation,
+        __global const uint* seeds,
+        __global uint* front,
+        __global uint* state,
+        __private uint capacity,
+        __constant float2* ranges,
+        __private int nrOfRanges
         ) {
-    const int2 pos = {get_global_id(0), get_global_id(1)};
-    const uint linearPos = pos.x + pos.y*get_global_size(0);
-    
-    // Define neighborhood offsets
-    int2 offset[8] = {
-            {1,0},
-            {0,1},
-            {1,1},
-            {-1,0},
-            {0,-1},
-            {-1,-1},
-            {-1,1},
-            {1,-1}
-    };
-    
-    if(segmentation[linearPos] == 2) { // pixel is in queue
-        float intensity = READ_IMAGE(image, pos);
-        if(intensity >= min && intensity <= max) {
-            segmentation[linearPos] = 1; // add pixel to segmentation
-            // Add neighbor pixels to queue
-            for(int i = 0; i < 8; i++) {
-                // Out of bounds check
-                int2 neighborPos = pos + offset[i];
-                if(neighborPos.x < 0 || neighborPos.y < 0 || 
-                    neighborPos.x >= get_global_size(0) || neighborPos.y >= get_global_size(1))
-                    continue;
-                uint neighborLinearPos = neighborPos.x + neighborPos.y*get_global_size(0);
-                if(segmentation[neighborLinearPos] == 0) {
-                    segmentation[neighborLinearPos] = 2; // add to queue
-                    stopGrowing[0] = 0;
-                }
+    const uint index = seeds[get_global_id(0)];
+    const int width = get_image_width(image);
+    const int2 pos = {index % width, index / width};
+    if(isInRange(READ_IMAGE(image, pos), ranges, nrOfRanges)) {
+        segmentation[index] = 2;
+        addToFront(index, front, &state[0], capacity, &state[3]);
+    }
+}
+
+// Each work item visits every global size'th pixel of the current front, so
+// the kernel can be enqueued without knowing the size of the front
+__kernel void growRegion(
+        __read_only image2d_t image,
+        __global uchar* segmentation,
+        __global const uint* currentFront,
+        __global uint* nextFront,
+        __global uint* state,
+        __private int iteration,
+        __private uint capacity,
+        __constant float2* ranges,
+        __private int nrOfRanges
+        ) {
+    // The front of the previous iteration is not used anymore, and will be
+    // the next front of the next iteration
+    if(get_global_id(0) == 0)
+        state[(iteration+2) % 3] = 0;
+    __global uint* nextFrontSize = &state[(iteration+1) % 3];
+    const uint frontSize = min(state[iteration % 3], capacity);
+
+    const int width = get_image_width(image);
+    const int height = get_image_height(image);
+    for(uint i = get_global_id(0); i < frontSize; i += get_global_size(0)) {
+        const uint index = currentFront[i];
+        const int2 pos = {index % width, index / width};
+        for(int y = -1; y < 2; y++) {
+        for(int x = -1; x < 2; x++) {
+#if CONNECTIVITY == 4
+            if(abs(x)+abs(y) != 1)
+                continue;
+#else
+            if(x == 0 && y == 0)
+                continue;
+#endif
+            const int2 neighborPos = pos + (int2)(x, y);
+            if(neighborPos.x < 0 || neighborPos.y < 0 || neighborPos.x >= width || neighborPos.y >= height)
+                continue;
+            const uint neighborIndex = neighborPos.x + neighborPos.y*width;
+            // Two work items may add the same pixel, which only leads to it being visited twice
+            if(segmentation[neighborIndex] == 0 && isInRange(READ_IMAGE(image, neighborPos), ranges, nrOfRanges)) {
+                segmentation[neighborIndex] = 2;
+                addToFront(neighborIndex, nextFront, nextFrontSize, capacity, &state[3]);
             }
-        } else {
-            segmentation[linearPos] = 0; // Remove pixel
-        }
+        }}
+        segmentation[index] = 1;
+    }
+}
+
+// Add the queued pixels which didn't fit in the front to the current front
+__kernel void collectFront(
+        __global const uchar* segmentation,
+        __private ulong nrOfPixels,
+        __global uint* front,
+        __global uint* state,
+        __private int iteration,
+        __private uint capacity
+        ) {
+    for(ulong i = get_global_id(0); i < nrOfPixels; i += get_global_size(0)) {
+        if(segmentation[i] == 2)
+            addToFront(i, front, &state[iteration % 3], capacity, &state[3]);
     }
 }
-        
-            
\ No newline at end of file
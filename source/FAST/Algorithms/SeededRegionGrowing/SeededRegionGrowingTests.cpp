@@ -94,4 +94,75 @@ TEST_CASE("3D Seeded region growing on Host", "[fast][SeededRegionGrowing]") {
     CHECK(4106484 == sum);
 }
 
+// Volume with a diagonal line of voxels, which are only connected through
+// their corners. The first half of the line has intensity 100, and the second 200.
+static Image::pointer createDiagonalLineVolume() {
+    const uint size = 32;
+    std::vector<uchar> data(size*size*size, 0);
+    for(uint i = 0; i < 20; i++)
+        data[i + i*size + i*size*size] = i < 10 ? 100 : 200;
+    Image::pointer image = Image::New();
+    image->create(size, size, size, TYPE_UINT8, 1, Host::getInstance(), data.data());
+    return image;
+}
+
+static int countSegmentedVoxels(Segmentation::pointer result) {
+    ImageAccess::pointer access = result->getImageAccess(ACCESS_READ);
+    uchar* data = (uchar*)access->get();
+    int sum = 0;
+    for(int i = 0; i < result->getWidth()*result->getHeight()*result->getDepth(); i++) {
+        if(data[i] == 1)
+            sum++;
+    }
+    return sum;
+}
+
+TEST_CASE("3D Seeded region growing with several intensity ranges and 26 connectivity", "[fast][SeededRegionGrowing]") {
+    std::vector<ExecutionDevice::pointer> devices;
+    devices.push_back(Host::getInstance());
+    std::vector<OpenCLDevice::pointer> openCLDevices = DeviceManager::getInstance().getAllDevices();
+    devices.insert(devices.end(), openCLDevices.begin(), openCLDevices.end());
+    for(int i = 0; i < devices.size(); i++) {
+        Image::pointer image = createDiagonalLineVolume();
+
+        SeededRegionGrowing::pointer algorithm = SeededRegionGrowing::New();
+        algorithm->setInputData(image);
+        algorithm->addSeedPoint(0,0,0);
+        algorithm->setIntensityRange(90, 110);
+        algorithm->setMainDevice(devices[i]);
+        algorithm->update();
+        CHECK(countSegmentedVoxels(algorithm->getOutputData<Segmentation>()) == 1);
+
+        algorithm->setConnectivity(26);
+        algorithm->update();
+        CHECK(countSegmentedVoxels(algorithm->getOutputData<Segmentation>()) == 10);
+
+        algorithm->addIntensityRange(190, 210);
+        algorithm->setConvergenceCheckInterval(3);
+        algorithm->update();
+        CHECK(countSegmentedVoxels(algorithm->getOutputData<Segmentation>()) == 20);
+    }
+}
+
+TEST_CASE("Seeded region growing with seed outside of intensity range gives empty segmentation", "[fast][SeededRegionGrowing]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        Image::pointer image = createDiagonalLineVolume();
+
+        SeededRegionGrowing::pointer algorithm = SeededRegionGrowing::New();
+        algorithm->setInputData(image);
+        algorithm->addSeedPoint(1,0,0);
+        algorithm->setIntensityRange(90, 110);
+        algorithm->setConnectivity(26);
+        algorithm->setMainDevice(devices[i]);
+        algorithm->update();
+        CHECK(countSegmentedVoxels(algorithm->getOutputData<Segmentation>()) == 0);
+    }
+}
+
+TEST_CASE("Seeded region growing with invalid connectivity throws exception", "[fast][SeededRegionGrowing]") {
+    SeededRegionGrowing::pointer algorithm = SeededRegionGrowing::New();
+    CHECK_THROWS(algorithm->setConnectivity(5));
+}
+
 } // end namespace fast
@@ -3,92 +3,272 @@
 #include "FAST/Utility.hpp"
 #include "FAST/SceneGraph.hpp"
 #include "FAST/Data/Segmentation.hpp"
+#include "FAST/Data/LineSet.hpp"
+#include <cstdlib>
 
 namespace fast {
 
 Skeletonization::Skeletonization() {
     createInputPort<Segmentation>(0);
     createOutputPort<Image>(0, OUTPUT_DEPENDS_ON_INPUT, 0);
+    createOutputPort<LineSet>(1, OUTPUT_DEPENDS_ON_INPUT, 0);
+    createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "Algorithms/Skeletonization/Skeletonization2D.cl", "2D");
+    createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "Algorithms/Skeletonization/Skeletonization3D.cl", "3D");
+    mConvergenceCheckInterval = 4;
+    mIterations = 0;
+    mScratchImageSize = Vector3i::Zero();
+    mStateSize = Vector3i::Zero();
+    mWorkListCapacity = 0;
 }
 
-void Skeletonization::execute() {
-    Segmentation::pointer input = getStaticInputData<Segmentation>();
-    Image::pointer output = getStaticOutputData<Image>();
-    SceneGraph::setParentNode(output, input);
+void Skeletonization::setConvergenceCheckInterval(int iterations) {
+    if(iterations <= 0)
+        throw Exception("Convergence check interval in Skeletonization must be larger than 0.");
+    mConvergenceCheckInterval = iterations;
+    mIsModified = true;
+}
 
-    if(input->getDimensions() != 2)
-        throw Exception("The skeletonization algorithm currently only support 2D images");
+int Skeletonization::getIterations() {
+    return mIterations;
+}
 
-    // Initialize output image
-    output->createFromImage(input);
+void Skeletonization::createKernels(OpenCLDevice::pointer device) {
+    if(device == mDevice)
+        return;
 
-    OpenCLDevice::pointer device = getMainDevice();
+    cl::Program program2D = getOpenCLProgram(device, "2D");
+    mThinningStep1Kernel = cl::Kernel(program2D, "thinningStep1");
+    mThinningStep2Kernel = cl::Kernel(program2D, "thinningStep2");
+    cl::Program program3D = getOpenCLProgram(device, "3D");
+    mInitializeKernel = cl::Kernel(program3D, "initialize");
+    mCreateWorkListKernel = cl::Kernel(program3D, "createWorkList");
+    mThinSubfieldKernel = cl::Kernel(program3D, "thinSubfield");
+    mUpdateWorkListKernel = cl::Kernel(program3D, "updateWorkList");
+    mWriteSkeletonKernel = cl::Kernel(program3D, "writeSkeleton");
 
-    // Create kernel
-    int programNr = device->createProgramFromSource(std::string(FAST_SOURCE_DIR) + "Algorithms/Skeletonization/Skeletonization2D.cl");
-    cl::Program program = device->getProgram(programNr);
-    cl::Kernel kernel1(program, "thinningStep1");
-    cl::Kernel kernel2(program, "thinningStep2");
+    mLastChange = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, sizeof(int));
+    mCounts = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, 3*sizeof(int));
+    mScratchImageSize = Vector3i::Zero();
+    mStateSize = Vector3i::Zero();
+    mWorkListCapacity = 0;
+    mDevice = device;
+}
 
-    // Create buffer for check if stop
-    cl::Buffer stopGrowingBuffer = cl::Buffer(
-            device->getContext(),
-            CL_MEM_READ_WRITE,
-            sizeof(char));
+// The kernels set lastChange to the last iteration where a pixel was
+// deleted, so it only has to be read when checking for convergence
+bool Skeletonization::hasConverged(cl::CommandQueue queue, int iteration) {
+    if(iteration % mConvergenceCheckInterval != 0)
+        return false;
+    int lastChange;
+    queue.enqueueReadBuffer(mLastChange, CL_TRUE, 0, sizeof(int), &lastChange);
+    return lastChange < iteration;
+}
+
+void Skeletonization::execute2D(OpenCLDevice::pointer device, Image::pointer input, Image::pointer output) {
+    const Vector3i size(output->getWidth(), output->getHeight(), 1);
+    if(size != mScratchImageSize) {
+        mScratchImage = cl::Image2D(device->getContext(), CL_MEM_READ_WRITE, cl::ImageFormat(CL_R, CL_UNSIGNED_INT8), size.x(), size.y());
+        mScratchImageSize = size;
+    }
 
-    cl::Image2D image2(device->getContext(), CL_MEM_READ_WRITE, cl::ImageFormat(CL_R, CL_UNSIGNED_INT8), output->getWidth(), output->getHeight());
     OpenCLImageAccess::pointer access = input->getOpenCLImageAccess(ACCESS_READ, device);
     cl::Image2D* image = access->get2DImage();
     OpenCLImageAccess::pointer access2 = output->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
     cl::Image2D* image1 = access2->get2DImage();
 
-    kernel1.setArg(0, *image1);
-    kernel1.setArg(1, image2);
-    kernel1.setArg(2, stopGrowingBuffer);
-
-    kernel2.setArg(0, image2);
-    kernel2.setArg(1, *image1);
-    kernel2.setArg(2, stopGrowingBuffer);
+    mThinningStep1Kernel.setArg(0, *image1);
+    mThinningStep1Kernel.setArg(1, mScratchImage);
+    mThinningStep1Kernel.setArg(2, mLastChange);
 
-    cl::NDRange globalSize(output->getWidth(), output->getHeight());
+    mThinningStep2Kernel.setArg(0, mScratchImage);
+    mThinningStep2Kernel.setArg(1, *image1);
+    mThinningStep2Kernel.setArg(2, mLastChange);
 
-    bool stopGrowing = false;
-    char stopGrowingInit = 1;
-    char* stopGrowingResult = new char;
-    int iterations = 0;
+    cl::NDRange globalSize(size.x(), size.y());
     cl::CommandQueue queue = device->getCommandQueue();
 
+    const int lastChange = 0;
+    queue.enqueueWriteBuffer(mLastChange, CL_TRUE, 0, sizeof(int), &lastChange);
     queue.enqueueCopyImage(
             *image,
             *image1,
             createOrigoRegion(),
             createOrigoRegion(),
-            createRegion(output->getWidth(), output->getHeight(), 1)
+            createRegion(size.x(), size.y(), 1)
     );
 
+    int iteration = 0;
     do {
-        iterations++;
-        queue.enqueueWriteBuffer(stopGrowingBuffer, CL_FALSE, 0, sizeof(char), &stopGrowingInit);
-
+        iteration++;
+        mThinningStep1Kernel.setArg(3, iteration);
+        mThinningStep2Kernel.setArg(3, iteration);
         queue.enqueueNDRangeKernel(
-                kernel1,
+                mThinningStep1Kernel,
                 cl::NullRange,
                 globalSize,
                 cl::NullRange
         );
 
         queue.enqueueNDRangeKernel(
-                kernel2,
+                mThinningStep2Kernel,
                 cl::NullRange,
                 globalSize,
                 cl::NullRange
         );
+    } while(!hasConverged(queue, iteration));
+    mIterations = iteration;
+}
+
+void Skeletonization::execute3D(OpenCLDevice::pointer device, Image::pointer input, Image::pointer output) {
+    const Vector3i size(output->getWidth(), output->getHeight(), output->getDepth());
+    const int nrOfVoxels = size.prod();
+    if(size != mStateSize) {
+        mState = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, nrOfVoxels*sizeof(int));
+        mStateSize = size;
+    }
+
+    OpenCLBufferAccess::pointer inputAccess = input->getOpenCLBufferAccess(ACCESS_READ, device);
+    OpenCLBufferAccess::pointer outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+    cl::CommandQueue queue = device->getCommandQueue();
+
+    // Static, as the writes are not blocking
+    static const int zeros[3] = {0, 0, 0};
+    queue.enqueueWriteBuffer(mCounts, CL_FALSE, 0, 3*sizeof(int), zeros);
+    queue.enqueueWriteBuffer(mLastChange, CL_FALSE, 0, sizeof(int), zeros);
+    mInitializeKernel.setArg(0, *inputAccess->get());
+    mInitializeKernel.setArg(1, mState);
+    mInitializeKernel.setArg(2, mCounts);
+    queue.enqueueNDRangeKernel(mInitializeKernel, cl::NullRange, cl::NDRange(nrOfVoxels), cl::NullRange);
+    int nrOfForegroundVoxels;
+    queue.enqueueReadBuffer(mCounts, CL_TRUE, 2*sizeof(int), sizeof(int), &nrOfForegroundVoxels);
+    // The work lists can at most contain all the foreground voxels
+    if(nrOfForegroundVoxels > mWorkListCapacity) {
+        for(int i = 0; i < 2; i++)
+            mWorkList[i] = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, nrOfForegroundVoxels*sizeof(int));
+        mWorkListCapacity = nrOfForegroundVoxels;
+    }
+
+    int iteration = 0;
+    if(nrOfForegroundVoxels > 0) {
+        mCreateWorkListKernel.setArg(0, mState);
+        mCreateWorkListKernel.setArg(1, mWorkList[0]);
+        mCreateWorkListKernel.setArg(2, mCounts);
+        mCreateWorkListKernel.setArg(3, size.x());
+        mCreateWorkListKernel.setArg(4, size.y());
+        mCreateWorkListKernel.setArg(5, size.z());
+        queue.enqueueNDRangeKernel(mCreateWorkListKernel, cl::NullRange, cl::NDRange(nrOfVoxels), cl::NullRange);
 
-        queue.enqueueReadBuffer(stopGrowingBuffer, CL_TRUE, 0, sizeof(char), stopGrowingResult);
-        if(*stopGrowingResult == 1)
-            stopGrowing = true;
-    } while(!stopGrowing);
-    reportInfo() << "SKELETONIZATION EXECUTED" << Reporter::end;
+        mThinSubfieldKernel.setArg(0, mState);
+        mThinSubfieldKernel.setArg(2, mCounts);
+        mThinSubfieldKernel.setArg(6, mLastChange);
+        mThinSubfieldKernel.setArg(7, size.x());
+        mThinSubfieldKernel.setArg(8, size.y());
+        mThinSubfieldKernel.setArg(9, size.z());
+        mUpdateWorkListKernel.setArg(0, mState);
+        mUpdateWorkListKernel.setArg(3, mCounts);
+        mUpdateWorkListKernel.setArg(5, size.x());
+        mUpdateWorkListKernel.setArg(6, size.y());
+        mUpdateWorkListKernel.setArg(7, size.z());
+
+        // The size of the work list is only known on the device, so enough
+        // work items for all foreground voxels are started
+        const cl::NDRange globalSize(nrOfForegroundVoxels);
+        int listIndex = 0;
+        do {
+            iteration++;
+            mThinSubfieldKernel.setArg(1, mWorkList[listIndex]);
+            mThinSubfieldKernel.setArg(3, listIndex);
+            mThinSubfieldKernel.setArg(5, iteration);
+            for(int subfield = 0; subfield < 8; subfield++) {
+                mThinSubfieldKernel.setArg(4, subfield);
+                queue.enqueueNDRangeKernel(mThinSubfieldKernel, cl::NullRange, globalSize, cl::NullRange);
+            }
+
+            queue.enqueueWriteBuffer(mCounts, CL_FALSE, (1-listIndex)*sizeof(int), sizeof(int), zeros);
+            mUpdateWorkListKernel.setArg(1, mWorkList[listIndex]);
+            mUpdateWorkListKernel.setArg(2, mWorkList[1-listIndex]);
+            mUpdateWorkListKernel.setArg(4, listIndex);
+            queue.enqueueNDRangeKernel(mUpdateWorkListKernel, cl::NullRange, globalSize, cl::NullRange);
+            listIndex = 1 - listIndex;
+        } while(!hasConverged(queue, iteration));
+    }
+    mIterations = iteration;
+
+    mWriteSkeletonKernel.setArg(0, mState);
+    mWriteSkeletonKernel.setArg(1, *outputAccess->get());
+    queue.enqueueNDRangeKernel(mWriteSkeletonKernel, cl::NullRange, cl::NDRange(nrOfVoxels), cl::NullRange);
+}
+
+// Lines between neighboring skeleton pixels. Diagonal neighbors are only
+// connected if no other skeleton pixel is between them, to avoid triangles.
+static void createLineSet(Image::pointer skeleton, LineSet::pointer lineSet) {
+    const Vector3i size(skeleton->getWidth(), skeleton->getHeight(), skeleton->getDepth());
+    const Vector3f spacing = skeleton->getSpacing();
+    ImageAccess::pointer access = skeleton->getImageAccess(ACCESS_READ);
+    const uchar* data = (const uchar*)access->get();
+
+    std::vector<Vector3f> vertices;
+    std::vector<Vector2ui> lines;
+    std::vector<int> vertexIndex(size.prod(), -1);
+    for(int i = 0; i < size.prod(); i++) {
+        if(data[i] == 0)
+            continue;
+        vertexIndex[i] = vertices.size();
+        const Vector3i position(i % size.x(), (i / size.x()) % size.y(), i / (size.x()*size.y()));
+        vertices.push_back(position.cast<float>().cwiseProduct(spacing));
+    }
+
+    for(int i = 0; i < size.prod(); i++) {
+        if(vertexIndex[i] == -1)
+            continue;
+        const Vector3i position(i % size.x(), (i / size.x()) % size.y(), i / (size.x()*size.y()));
+        // Only the neighbors after this pixel, so that each line is added once
+        for(int j = 14; j < 27; j++) {
+            const Vector3i offset(j % 3 - 1, (j / 3) % 3 - 1, j / 9 - 1);
+            const Vector3i neighbor = position + offset;
+            if((neighbor.array() < 0).any() || (neighbor.array() >= size.array()).any())
+                continue;
+            const int neighborIndex = neighbor.x() + (neighbor.y() + neighbor.z()*size.y())*size.x();
+            if(vertexIndex[neighborIndex] == -1)
+                continue;
+
+            // Other skeleton pixels in the box spanned by the two pixels
+            bool between = false;
+            for(int z = 0; z <= std::abs(offset.z()); z++) {
+            for(int y = 0; y <= std::abs(offset.y()); y++) {
+            for(int x = 0; x <= std::abs(offset.x()); x++) {
+                const Vector3i corner = position + Vector3i(x*offset.x(), y*offset.y(), z*offset.z());
+                if(corner == position || corner == neighbor)
+                    continue;
+                if(data[corner.x() + (corner.y() + corner.z()*size.y())*size.x()] > 0)
+                    between = true;
+            }}}
+            if(!between)
+                lines.push_back(Vector2ui(vertexIndex[i], vertexIndex[neighborIndex]));
+        }
+    }
+    lineSet->create(vertices, lines);
+}
+
+void Skeletonization::execute() {
+    Segmentation::pointer input = getStaticInputData<Segmentation>();
+    Image::pointer output = getStaticOutputData<Image>(0);
+    LineSet::pointer lineSet = getStaticOutputData<LineSet>(1);
+    SceneGraph::setParentNode(output, input);
+    SceneGraph::setParentNode(lineSet, input);
+
+    // Initialize output image
+    output->createFromImage(input);
+
+    OpenCLDevice::pointer device = getMainDevice();
+    createKernels(device);
+    if(input->getDimensions() == 2) {
+        execute2D(device, input, output);
+    } else {
+        execute3D(device, input, output);
+    }
+    createLineSet(output, lineSet);
+    reportInfo() << "Skeletonization finished after " << mIterations << " iterations" << Reporter::end;
 }
 
 } // end namespace fast
@@ -2,15 +2,57 @@
 #define SKELETONIZATION_HPP
 
 #include "FAST/ProcessObject.hpp"
+#include "FAST/ExecutionDevice.hpp"
+#include "FAST/Data/Image.hpp"
 
 namespace fast {
 
+/**
+ * Thinning of 2D and 3D segmentations. 3D segmentations are thinned to a
+ * curve skeleton with a topology preserving subfield algorithm.
+ *
+ * Output port 0 is the skeleton as an image, and output port 1 is the
+ * skeleton as a line set, with lines between neighboring skeleton pixels,
+ * as the centerlines of RidgeTraversalCenterlineExtraction.
+ */
 class Skeletonization : public ProcessObject {
     FAST_OBJECT(Skeletonization)
     public:
+        /**
+         * Number of iterations between each check for convergence, which
+         * waits for the device. Default is 4.
+         */
+        void setConvergenceCheckInterval(int iterations);
+        // Number of iterations in the last execute
+        int getIterations();
     private:
         Skeletonization();
         void execute();
+        void execute2D(OpenCLDevice::pointer device, Image::pointer input, Image::pointer output);
+        void execute3D(OpenCLDevice::pointer device, Image::pointer input, Image::pointer output);
+        void createKernels(OpenCLDevice::pointer device);
+        bool hasConverged(cl::CommandQueue queue, int iteration);
+
+        int mConvergenceCheckInterval;
+        int mIterations;
+
+        // Kernels and scratch buffers are kept between executions
+        OpenCLDevice::pointer mDevice;
+        cl::Kernel mThinningStep1Kernel;
+        cl::Kernel mThinningStep2Kernel;
+        cl::Kernel mInitializeKernel;
+        cl::Kernel mCreateWorkListKernel;
+        cl::Kernel mThinSubfieldKernel;
+        cl::Kernel mUpdateWorkListKernel;
+        cl::Kernel mWriteSkeletonKernel;
+        cl::Buffer mLastChange;
+        cl::Buffer mCounts;
+        cl::Image2D mScratchImage;
+        Vector3i mScratchImageSize;
+        cl::Buffer mState;
+        Vector3i mStateSize;
+        cl::Buffer mWorkList[2];
+        int mWorkListCapacity;
 };
 
 } // end namespace fast
@@ -5,7 +5,8 @@ void checkNeighborhood(
         const int2 position,
         __read_only image2d_t readImage,
         __write_only image2d_t writeImage,
-        __global char* stop,
+        __global int* lastChange,
+        int iteration,
         uchar add
         ) {
     const int2 offsets[9] = {
@@ -49,7 +50,7 @@ void checkNeighborhood(
                 neighbors[3-add]*neighbors[5]*neighbors[7] == 0) {
             // Delete pixel
             write_imageui(writeImage, position, 0);
-            stop[0] = 0; // A pixel was deleted, continue
+            lastChange[0] = iteration; // A pixel was deleted, continue
         } else {
             write_imageui(writeImage, position, 1);
         }
@@ -61,17 +62,19 @@ void checkNeighborhood(
 __kernel void thinningStep1(
         __read_only image2d_t readImage,
         __write_only image2d_t writeImage,
-        __global char* stop
+        __global int* lastChange,
+        __private int iteration
         ) {
     const int2 position = {get_global_id(0), get_global_id(1)};
-    checkNeighborhood(position, readImage, writeImage, stop, 0);
+    checkNeighborhood(position, readImage, writeImage, lastChange, iteration, 0);
 }
 
 __kernel void thinningStep2(
         __read_only image2d_t readImage,
         __write_only image2d_t writeImage,
-        __global char* stop
+        __global int* lastChange,
+        __private int iteration
         ) {
     const int2 position = {get_global_id(0), get_global_id(1)};
-    checkNeighborhood(position, readImage, writeImage, stop, 2);
+    checkNeighborhood(position, readImage, writeImage, lastChange, iteration, 2);
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+// Topology preserving thinning of 3D segmentations.
+//
+// The voxels are divided into 8 subfields by the parity of their coordinates.
+// No two voxels of a subfield are 26-adjacent, so all simple voxels of one
+// subfield can be deleted in parallel without changing the topology. One
+// iteration thins the 8 subfields in turn. End points, voxels with one
+// neighbor, are kept, which gives a curve skeleton.
+//
+// Only border voxels, which have a 6-neighbor in the background, can be
+// deleted. These are kept in a work list, and when a voxel is deleted its
+// 6-neighbors are added to the next work list.
+//
+// The state of each voxel is 0: background, 1: foreground or 2: foreground
+// and border. counts holds the sizes of the two work lists and the number of
+// foreground voxels. lastChange is set to the last iteration where a voxel
+// was deleted.
+
+#define CENTER 13
+#define NEIGHBORS_26 (0x7FFFFFF & ~(1u << CENTER))
+#define CORNERS ((1u << 0) | (1u << 2) | (1u << 6) | (1u << 8) | (1u << 18) | (1u << 20) | (1u << 24) | (1u << 26))
+#define NEIGHBORS_18 (NEIGHBORS_26 & ~CORNERS)
+#define FACES ((1u << 4) | (1u << 10) | (1u << 12) | (1u << 14) | (1u << 16) | (1u << 22))
+
+int4 getPosition(int index, int4 size) {
+    return (int4)(index % size.x, (index / size.x) % size.y, index / (size.x*size.y), 0);
+}
+
+int getIndex(int4 position, int4 size) {
+    return position.x + (position.y + position.z*size.y)*size.x;
+}
+
+bool isInside(int4 position, int4 size) {
+    return all(position.xyz >= 0) && all(position.xyz < size.xyz);
+}
+
+// Bit i is set if neighbor (i%3-1, (i/3)%3-1, i/9-1) is foreground, voxels
+// outside the image are background
+uint getNeighborhood(__global const int* state, int4 position, int4 size) {
+    uint neighborhood = 0;
+    for(int i = 0; i < 27; i++) {
+        const int4 neighbor = position + (int4)(i % 3 - 1, (i / 3) % 3 - 1, i / 9 - 1, 0);
+        if(isInside(neighbor, size) && state[getIndex(neighbor, size)] > 0)
+            neighborhood |= 1u << i;
+    }
+    return neighborhood;
+}
+
+int countBits(uint mask) {
+    int count = 0;
+    for(; mask != 0; mask &= mask - 1)
+        count++;
+    return count;
+}
+
+// Neighbors of bit i within the 3x3x3 neighborhood
+uint getAdjacent(int i, bool sixConnected) {
+    const int x = i % 3, y = (i / 3) % 3, z = i / 9;
+    uint mask = 0;
+    for(int j = 0; j < 27; j++) {
+        const int dx = abs(j % 3 - x), dy = abs((j / 3) % 3 - y), dz = abs(j / 9 - z);
+        if(j != i && dx <= 1 && dy <= 1 && dz <= 1 && (!sixConnected || dx + dy + dz == 1))
+            mask |= 1u << j;
+    }
+    return mask;
+}
+
+// Number of connected components of set which contain at least one of the seeds
+int countComponents(uint set, uint seeds, bool sixConnected) {
+    int components = 0;
+    while((set & seeds) != 0) {
+        uint component = 1u << (31 - clz(set & seeds));
+        uint previous = 0;
+        while(component != previous) {
+            previous = component;
+            for(uint remaining = component; remaining != 0; ) {
+                const int i = 31 - clz(remaining);
+                remaining &= ~(1u << i);
+                component |= getAdjacent(i, sixConnected) & set;
+            }
+        }
+        set &= ~component;
+        components++;
+    }
+    return components;
+}
+
+// A voxel is simple if the foreground in its 26-neighborhood is one
+// 26-connected component, and the background in its 18-neighborhood has one
+// 6-connected component which is 6-adjacent to the voxel
+bool isSimple(uint neighborhood) {
+    const uint foreground = neighborhood & NEIGHBORS_26;
+    if(countComponents(foreground, foreground, false) != 1)
+        return false;
+    const uint background = ~neighborhood & NEIGHBORS_18;
+    return countComponents(background, FACES, true) == 1;
+}
+
+__kernel void initialize(
+        __global const uchar* segmentation,
+        __global int* state,
+        __global int* counts
+        ) {
+    const int index = get_global_id(0);
+    if(segmentation[index] > 0) {
+        state[index] = 1;
+        atomic_inc(&counts[2]);
+    } else {
+        state[index] = 0;
+    }
+}
+
+__kernel void createWorkList(
+        __global int* state,
+        __global int* list,
+        __global int* counts,
+        __private int width,
+        __private int height,
+        __private int depth
+        ) {
+    const int4 size = {width, height, depth, 1};
+    const int index = get_global_id(0);
+    if(state[index] == 0)
+        return;
+
+    if((getNeighborhood(state, getPosition(index, size), size) & FACES) != FACES) {
+        state[index] = 2;
+        list[atomic_inc(&counts[0])] = index;
+    }
+}
+
+__kernel void thinSubfield(
+        __global int* state,
+        __global const int* list,
+        __global const int* counts,
+        __private int listIndex,
+        __private int subfield,
+        __private int iteration,
+        __global int* lastChange,
+        __private int width,
+        __private int height,
+        __private int depth
+        ) {
+    const int4 size = {width, height, depth, 1};
+    if(get_global_id(0) >= counts[listIndex])
+        return;
+
+    const int index = list[get_global_id(0)];
+    const int4 position = getPosition(index, size);
+    if(((position.x & 1) | (position.y & 1) << 1 | (position.z & 1) << 2) != subfield)
+        return;
+
+    const uint neighborhood = getNeighborhood(state, position, size);
+    if(countBits(neighborhood & NEIGHBORS_26) > 1 && isSimple(neighborhood)) {
+        state[index] = 0;
+        lastChange[0] = iteration;
+    }
+}
+
+__kernel void updateWorkList(
+        __global int* state,
+        __global const int* list,
+        __global int* newList,
+        __global int* counts,
+        __private int listIndex,
+        __private int width,
+        __private int height,
+        __private int depth
+        ) {
+    const int4 size = {width, height, depth, 1};
+    if(get_global_id(0) >= counts[listIndex])
+        return;
+
+    const int index = list[get_global_id(0)];
+    const int4 position = getPosition(index, size);
+    __global int* newCount = &counts[1 - listIndex];
+    if(state[index] == 0) {
+        // Deleted, the 6-neighbors in the foreground are now border voxels
+        const int4 offsets[6] = {
+            {1, 0, 0, 0}, {-1, 0, 0, 0},
+            {0, 1, 0, 0}, {0, -1, 0, 0},
+            {0, 0, 1, 0}, {0, 0, -1, 0}
+        };
+        for(int i = 0; i < 6; i++) {
+            const int4 neighbor = position + offsets[i];
+            if(!isInside(neighbor, size))
+                continue;
+            const int neighborIndex = getIndex(neighbor, size);
+            if(atomic_cmpxchg(&state[neighborIndex], 1, 2) == 1)
+                newList[atomic_inc(newCount)] = neighborIndex;
+        }
+    } else if(countBits(getNeighborhood(state, position, size) & NEIGHBORS_26) > 1) {
+        // End points are never deleted and are removed from the work list
+        newList[atomic_inc(newCount)] = index;
+    }
+}
+
+__kernel void writeSkeleton(
+        __global const int* state,
+        __global uchar* skeleton
+        ) {
+    const int index = get_global_id(0);
+    skeleton[index] = state[index] > 0 ? 1 : 0;
+}
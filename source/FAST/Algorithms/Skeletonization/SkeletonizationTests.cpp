@@ -4,6 +4,8 @@
 #include "FAST/Visualization/ImageRenderer/ImageRenderer.hpp"
 #include "FAST/Visualization/SimpleWindow.hpp"
 #include "FAST/Algorithms/BinaryThresholding/BinaryThresholding.hpp"
+#include "FAST/Data/Segmentation.hpp"
+#include "FAST/Data/LineSet.hpp"
 
 using namespace fast;
 
@@ -29,3 +31,107 @@ TEST_CASE("Skeletonization on 2D image", "[fast][Skeletonization][visual]") {
     window->start();
     skeletonization->getRuntime()->print();
 }
+
+// A solid bar along the x axis
+static Segmentation::pointer createBar(int width, int height, int depth, int margin) {
+    Image::pointer image = Image::New();
+    image->create(width, height, depth, TYPE_UINT8, 1);
+    Segmentation::pointer segmentation = Segmentation::New();
+    segmentation->createFromImage(image);
+    ImageAccess::pointer access = segmentation->getImageAccess(ACCESS_READ_WRITE);
+    uchar* data = (uchar*)access->get();
+    for(int z = 0; z < depth; z++) {
+    for(int y = 0; y < height; y++) {
+    for(int x = 0; x < width; x++) {
+        const bool inside = x >= margin && x < width-margin && y >= margin && y < height-margin && z >= margin && z < depth-margin;
+        data[x + (y + z*height)*width] = inside ? 1 : 0;
+    }}}
+    return segmentation;
+}
+
+static std::vector<uchar> getSkeleton(Image::pointer image) {
+    const int size = image->getWidth()*image->getHeight()*image->getDepth();
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+    const uchar* data = (const uchar*)access->get();
+    return std::vector<uchar>(data, data + size);
+}
+
+// Number of connected components of the lines
+static int countComponents(LineSet::pointer lineSet) {
+    LineSetAccess::pointer access = lineSet->getAccess(ACCESS_READ);
+    std::vector<int> component(access->getNrOfPoints());
+    for(int i = 0; i < component.size(); i++)
+        component[i] = i;
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(int i = 0; i < access->getNrOfLines(); i++) {
+            const Vector2ui line = access->getLine(i);
+            const int smallest = std::min(component[line.x()], component[line.y()]);
+            if(component[line.x()] != smallest || component[line.y()] != smallest) {
+                component[line.x()] = smallest;
+                component[line.y()] = smallest;
+                changed = true;
+            }
+        }
+    }
+    int components = 0;
+    for(int i = 0; i < component.size(); i++) {
+        if(component[i] == i)
+            components++;
+    }
+    return components;
+}
+
+TEST_CASE("Skeletonization with convergence check interval 0 throws exception", "[fast][Skeletonization]") {
+    Skeletonization::pointer skeletonization = Skeletonization::New();
+    CHECK_THROWS(skeletonization->setConvergenceCheckInterval(0));
+    CHECK_NOTHROW(skeletonization->setConvergenceCheckInterval(1));
+}
+
+TEST_CASE("Skeletonization of 3D bar gives connected centerline", "[fast][Skeletonization]") {
+    const int width = 30, height = 13, depth = 13, margin = 3;
+    Segmentation::pointer bar = createBar(width, height, depth, margin);
+    std::vector<uchar> input = getSkeleton(bar);
+
+    Skeletonization::pointer skeletonization = Skeletonization::New();
+    skeletonization->setInputData(bar);
+    Image::pointer output = skeletonization->getOutputData<Image>(0);
+    LineSet::pointer lineSet = skeletonization->getOutputData<LineSet>(1);
+    skeletonization->update();
+
+    std::vector<uchar> skeleton = getSkeleton(output);
+    int nrOfSkeletonVoxels = 0;
+    for(int i = 0; i < skeleton.size(); i++) {
+        if(skeleton[i] > 0) {
+            nrOfSkeletonVoxels++;
+            CHECK(input[i] > 0);
+        }
+    }
+    // A thin line along the bar
+    CHECK(nrOfSkeletonVoxels > 0);
+    CHECK(nrOfSkeletonVoxels < 2*(width - 2*margin));
+    CHECK(countComponents(lineSet) == 1);
+    CHECK(skeletonization->getIterations() > 0);
+
+    // The result does not depend on how often convergence is checked
+    skeletonization->setConvergenceCheckInterval(1);
+    output = skeletonization->getOutputData<Image>(0);
+    skeletonization->update();
+    CHECK(getSkeleton(output) == skeleton);
+}
+
+TEST_CASE("Skeletonization of empty 3D segmentation is empty", "[fast][Skeletonization]") {
+    Segmentation::pointer empty = createBar(10, 10, 10, 5);
+
+    Skeletonization::pointer skeletonization = Skeletonization::New();
+    skeletonization->setInputData(empty);
+    Image::pointer output = skeletonization->getOutputData<Image>(0);
+    LineSet::pointer lineSet = skeletonization->getOutputData<LineSet>(1);
+    skeletonization->update();
+
+    std::vector<uchar> skeleton = getSkeleton(output);
+    for(int i = 0; i < skeleton.size(); i++)
+        CHECK(skeleton[i] == 0);
+    CHECK(lineSet->getAccess(ACCESS_READ)->getNrOfPoints() == 0);
+}
@@ -8,20 +8,38 @@
 
 namespace fast {
 
+// Nr of output buffers kept for reuse, in addition to the ones in use
+static const uint MAX_NR_OF_OUTPUT_BUFFERS = 4;
+
 void SurfaceExtraction::setThreshold(float threshold) {
     mThreshold = threshold;
     mIsModified = true;
 }
 
+void SurfaceExtraction::setIndexedOutput(bool indexed) {
+    mIndexedOutput = indexed;
+    mIsModified = true;
+}
+
 inline unsigned int getRequiredHistogramPyramidSize(Image::pointer input) {
     unsigned int largestSize = fast::max(fast::max(input->getWidth(), input->getHeight()), input->getDepth());
-    int i = 1;
+    // The traversal kernels use at least six levels
+    int i = 6;
     while(largestSize > pow(2,i)) {
         i++;
     }
     return (unsigned int)pow(2,i);
 }
 
+inline unsigned int roundUpToMultiple(unsigned int size, unsigned int multiple) {
+    return ((size + multiple - 1) / multiple)*multiple;
+}
+
+// Allocate more than needed, so that the buffers can be reused when the size increases
+inline unsigned int getCapacity(unsigned int size) {
+    return roundUpToMultiple(std::max(size + size/4, 1024u), 64);
+}
+
 void SurfaceExtraction::execute() {
     Image::pointer input = getStaticInputData<Image>(0);
 
@@ -34,103 +52,165 @@ void SurfaceExtraction::execute() {
 #else
     const bool writingTo3DTextures = device->isWritingTo3DTexturesSupported();
 #endif
-    cl::Context clContext = device->getContext();
     const unsigned int SIZE = getRequiredHistogramPyramidSize(input);
 
-    if(mHPSize != SIZE) {
+    // The commands of the previous execution are finished before these are enqueued
+    addStageTimings(true);
+
+    // The base level of the HP images has the size of the volume
+    if(mHPSize != SIZE || mHPDevice != device || (writingTo3DTextures && (
+            images[0].getImageInfo<CL_IMAGE_WIDTH>() != input->getWidth() ||
+            images[0].getImageInfo<CL_IMAGE_HEIGHT>() != input->getHeight() ||
+            images[0].getImageInfo<CL_IMAGE_DEPTH>() != input->getDepth()))) {
         // Have to recreate the HP
-        images.clear();
-        buffers.clear();
-        std::string programName = "";
-        // create new HP (if necessary)
-        if(writingTo3DTextures) {
-            // Create images for the HistogramPyramid
-            int bufferSize = SIZE;
-            cl_channel_order order1, order2;
-            if(device->isImageFormatSupported(CL_R, CL_UNSIGNED_INT8, CL_MEM_OBJECT_IMAGE3D) && device->isImageFormatSupported(CL_RG, CL_UNSIGNED_INT8, CL_MEM_OBJECT_IMAGE3D)) {
-            	order1 = CL_R;
-            	order2 = CL_RG;
-            } else {
-            	order1 = CL_RGBA;
-            	order2 = CL_RGBA;
-            }
-
-            // Make the two first buffers use INT8
-            images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order2, CL_UNSIGNED_INT8), input->getWidth(), input->getHeight(), input->getDepth()));
-            bufferSize /= 2;
-            images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT8), bufferSize, bufferSize, bufferSize));
-            bufferSize /= 2;
-            // And the third, fourth and fifth INT16
-            images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT16), bufferSize, bufferSize, bufferSize));
-            bufferSize /= 2;
-            images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT16), bufferSize, bufferSize, bufferSize));
-            bufferSize /= 2;
-            images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT16), bufferSize, bufferSize, bufferSize));
-            bufferSize /= 2;
-            // The rest will use INT32
-            for(int i = 5; i < (log2((float)SIZE)); i ++) {
-                if(bufferSize == 1)
-                    bufferSize = 2; // Image cant be 1x1x1
-                images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT32), bufferSize, bufferSize, bufferSize));
-                bufferSize /= 2;
-            }
-
-            // If writing to 3D textures is not supported we to create buffers to write to
-       } else {
-            programName = "no_3d_write";
-            int bufferSize = SIZE*SIZE*SIZE;
-            buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(char)*bufferSize));
-            bufferSize /= 8;
-            buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(char)*bufferSize));
-            bufferSize /= 8;
-            buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(short)*bufferSize));
-            bufferSize /= 8;
-            buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(short)*bufferSize));
-            bufferSize /= 8;
-            buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(short)*bufferSize));
-            bufferSize /= 8;
-            for(int i = 5; i < (log2((float)SIZE)); i ++) {
-                buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(int)*bufferSize));
-                bufferSize /= 8;
-            }
-
-            cubeIndexesBuffer = cl::Buffer(clContext, CL_MEM_WRITE_ONLY, sizeof(char)*SIZE*SIZE*SIZE);
-            cubeIndexesImage = cl::Image3D(clContext, CL_MEM_READ_ONLY,
-                    cl::ImageFormat(CL_R, CL_UNSIGNED_INT8),
-                    SIZE, SIZE, SIZE);
-        }
+        createHistogramPyramid(device, input, SIZE, writingTo3DTextures);
+    }
 
-        // Compile program
-        mHPSize = SIZE;
-        char buffer[255];
-        sprintf(buffer,"-DSIZE=%d", SIZE);
-        std::string buildOptions(buffer);
-        if(input->getDataType() == TYPE_FLOAT) {
-            buildOptions += " -DTYPE_FLOAT";
-        } else if(input->getDataType() == TYPE_INT8 || input->getDataType() == TYPE_INT16) {
-            buildOptions += " -DTYPE_INT";
-        } else {
-            buildOptions += " -DTYPE_UINT";
-        }
+    char buffer[255];
+    sprintf(buffer,"-DSIZE=%d", SIZE);
+    std::string buildOptions(buffer);
+    if(input->getDataType() == TYPE_FLOAT) {
+        buildOptions += " -DTYPE_FLOAT";
+    } else if(input->getDataType() == TYPE_INT8 || input->getDataType() == TYPE_INT16) {
+        buildOptions += " -DTYPE_INT";
+    } else {
+        buildOptions += " -DTYPE_UINT";
+    }
 #if defined(__APPLE__) || defined(__MACOSX)
-        buildOptions += " -DMAC_HACK";
+    buildOptions += " -DMAC_HACK";
 #endif
+    if(mIndexedOutput)
+        buildOptions += " -DINDEXED";
+    if(buildOptions != mBuildOptions) {
+        // Compile program
+        std::string programName = writingTo3DTextures ? "" : "no_3d_write";
         program = getOpenCLProgram(device, programName, buildOptions);
+        if(mIndexedOutput)
+            mWeldingProgram = getOpenCLProgram(device, "welding", buildOptions);
+        mBuildOptions = buildOptions;
     }
 
-    cl::Kernel constructHPLevelKernel(program, "constructHPLevel");
-    cl::Kernel classifyCubesKernel(program, "classifyCubes");
-    cl::Kernel traverseHPKernel(program, "traverseHP");
-
     OpenCLImageAccess::pointer access = input->getOpenCLImageAccess(ACCESS_READ, device);
     cl::Image3D* clImage = access->get3DImage();
 
+    enqueueStageMarker(device, "");
+    constructHistogramPyramid(device, clImage, writingTo3DTextures);
+
+    Mesh::pointer output = getStaticOutputData<Mesh>(0);
+    SceneGraph::setParentNode(output, input);
+    BoundingBox box = input->getBoundingBox();
+    // Apply spacing scaling to BB
+    AffineTransformation::pointer T = AffineTransformation::New();
+    T->scale(input->getSpacing());
+    output->setBoundingBox(box.getTransformedBoundingBox(T));
+
+    // Traverse HP to create triangles and put them in an OpenCL buffer.
+    // The mesh creates the VBO from this buffer if it is rendered, thus no OpenGL context is needed here.
+    cl::Kernel traverseHPKernel(program, "traverseHP");
+    const uint argumentIndex = setHistogramPyramidArguments(traverseHPKernel, clImage, writingTo3DTextures);
+    if(mIndexedOutput) {
+        createIndexedMesh(device, traverseHPKernel, argumentIndex, input, clImage, output);
+    } else {
+        createMesh(device, traverseHPKernel, argumentIndex, input, output);
+    }
+
+    if(output->getNrOfTriangles() == 0) {
+        reportInfo() << "No triangles were extracted. Check isovalue." << Reporter::end;
+    } else {
+        reportInfo() << output->getNrOfTriangles() << " nr of triangles were extracted with the SurfaceExtraction algorithm." << reportEnd();
+    }
+
+    // The timings are added now if the device is done, and otherwise in the next execution
+    addStageTimings(false);
+}
+
+void SurfaceExtraction::createHistogramPyramid(OpenCLDevice::pointer device, Image::pointer input, uint SIZE, bool writingTo3DTextures) {
+    cl::Context clContext = device->getContext();
+    images.clear();
+    buffers.clear();
+    // create new HP (if necessary)
+    if(writingTo3DTextures) {
+        // Create images for the HistogramPyramid
+        int bufferSize = SIZE;
+        cl_channel_order order1, order2;
+        if(device->isImageFormatSupported(CL_R, CL_UNSIGNED_INT8, CL_MEM_OBJECT_IMAGE3D) && device->isImageFormatSupported(CL_RG, CL_UNSIGNED_INT8, CL_MEM_OBJECT_IMAGE3D)) {
+            order1 = CL_R;
+            order2 = CL_RG;
+        } else {
+            order1 = CL_RGBA;
+            order2 = CL_RGBA;
+        }
+
+        // Make the two first buffers use INT8
+        images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order2, CL_UNSIGNED_INT8), input->getWidth(), input->getHeight(), input->getDepth()));
+        bufferSize /= 2;
+        images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT8), bufferSize, bufferSize, bufferSize));
+        bufferSize /= 2;
+        // And the third, fourth and fifth INT16
+        images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT16), bufferSize, bufferSize, bufferSize));
+        bufferSize /= 2;
+        images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT16), bufferSize, bufferSize, bufferSize));
+        bufferSize /= 2;
+        images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT16), bufferSize, bufferSize, bufferSize));
+        bufferSize /= 2;
+        // The rest will use INT32
+        for(int i = 5; i < (log2((float)SIZE)); i ++) {
+            if(bufferSize == 1)
+                bufferSize = 2; // Image cant be 1x1x1
+            images.push_back(cl::Image3D(clContext, CL_MEM_READ_WRITE, cl::ImageFormat(order1, CL_UNSIGNED_INT32), bufferSize, bufferSize, bufferSize));
+            bufferSize /= 2;
+        }
+
+        // If writing to 3D textures is not supported we to create buffers to write to
+    } else {
+        int bufferSize = SIZE*SIZE*SIZE;
+        buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(char)*bufferSize));
+        bufferSize /= 8;
+        buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(char)*bufferSize));
+        bufferSize /= 8;
+        buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(short)*bufferSize));
+        bufferSize /= 8;
+        buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(short)*bufferSize));
+        bufferSize /= 8;
+        buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(short)*bufferSize));
+        bufferSize /= 8;
+        for(int i = 5; i < (log2((float)SIZE)); i ++) {
+            buffers.push_back(cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(int)*bufferSize));
+            bufferSize /= 8;
+        }
+
+        cubeIndexesBuffer = cl::Buffer(clContext, CL_MEM_WRITE_ONLY, sizeof(char)*SIZE*SIZE*SIZE);
+        cubeIndexesImage = cl::Image3D(clContext, CL_MEM_READ_ONLY,
+                cl::ImageFormat(CL_R, CL_UNSIGNED_INT8),
+                SIZE, SIZE, SIZE);
+    }
+
+    if(mHPDevice != device) {
+        // Buffers of another device can't be reused
+        mCountBuffer = cl::Buffer(clContext, CL_MEM_READ_WRITE, sizeof(uint)*2);
+        mOutputBuffers.clear();
+        mWeldingCapacity = 0;
+        mStageMarkers.clear();
+        mStageNames.clear();
+        mBuildOptions = "";
+    }
+    mHPSize = SIZE;
+    mHPDevice = device;
+}
+
+void SurfaceExtraction::constructHistogramPyramid(OpenCLDevice::pointer device, cl::Image3D* clImage, bool writingTo3DTextures) {
+    const unsigned int SIZE = mHPSize;
+    cl::CommandQueue queue = device->getCommandQueue();
+    cl::Kernel constructHPLevelKernel(program, "constructHPLevel");
+    cl::Kernel classifyCubesKernel(program, "classifyCubes");
+    cl::Kernel writeTotalSumKernel(program, "writeTotalSum");
+
     // update scalar field
     if(writingTo3DTextures) {
         classifyCubesKernel.setArg(0, images[0]);
         classifyCubesKernel.setArg(1, *clImage);
         classifyCubesKernel.setArg(2, mThreshold);
-        device->getCommandQueue().enqueueNDRangeKernel(
+        queue.enqueueNDRangeKernel(
                 classifyCubesKernel,
                 cl::NullRange,
                 cl::NDRange(SIZE, SIZE, SIZE),
@@ -141,7 +221,7 @@ void SurfaceExtraction::execute() {
         classifyCubesKernel.setArg(1, cubeIndexesBuffer);
         classifyCubesKernel.setArg(2, *clImage);
         classifyCubesKernel.setArg(3, mThreshold);
-        device->getCommandQueue().enqueueNDRangeKernel(
+        queue.enqueueNDRangeKernel(
                 classifyCubesKernel,
                 cl::NullRange,
                 cl::NDRange(SIZE, SIZE, SIZE),
@@ -158,12 +238,11 @@ void SurfaceExtraction::execute() {
         region[2] = SIZE;
 
         // Copy buffer to image
-        device->getCommandQueue().enqueueCopyBufferToImage(cubeIndexesBuffer, cubeIndexesImage, 0, offset, region);
+        queue.enqueueCopyBufferToImage(cubeIndexesBuffer, cubeIndexesImage, 0, offset, region);
     }
+    enqueueStageMarker(device, "classification");
 
     // Construct HP
-    cl::CommandQueue queue = device->getCommandQueue();
-
     if(writingTo3DTextures) {
         // Run base to first level
         constructHPLevelKernel.setArg(0, images[0]);
@@ -189,6 +268,7 @@ void SurfaceExtraction::execute() {
                 cl::NullRange
             );
         }
+        writeTotalSumKernel.setArg(0, images[images.size()-1]);
     } else {
         cl::Kernel constructHPLevelCharCharKernel(program, "constructHPLevelCharChar");
         cl::Kernel constructHPLevelCharShortKernel(program, "constructHPLevelCharShort");
@@ -268,108 +348,304 @@ void SurfaceExtraction::execute() {
                 cl::NullRange
             );
         }
+        writeTotalSumKernel.setArg(0, buffers[buffers.size()-1]);
     }
 
-    // Create VBO using the sum
-    // Read top of histoPyramid an use this size to allocate VBO below
-    unsigned int totalSum = 0;
+    // Sum the top of the HP on the device, so that the traversal can be
+    // enqueued before the nr of triangles is read
+    writeTotalSumKernel.setArg(1, mCountBuffer);
+    queue.enqueueNDRangeKernel(writeTotalSumKernel, cl::NullRange, cl::NDRange(1), cl::NullRange);
+    enqueueStageMarker(device, "histogram pyramid");
+}
+
+uint SurfaceExtraction::setHistogramPyramidArguments(cl::Kernel kernel, cl::Image3D* clImage, bool writingTo3DTextures) {
+    unsigned int i = 0;
     if(writingTo3DTextures) {
-    	int* sum;
-        if(device->isImageFormatSupported(CL_R, CL_UNSIGNED_INT32, CL_MEM_OBJECT_IMAGE3D)) {
-            sum = new int[8];
-        } else {
-        	// A 4 channel texture/image has been used
-        	sum = new int[8*4];
-        }
-        cl::size_t<3> origin = createOrigoRegion();
-        cl::size_t<3> region = createRegion(2,2,2);
-        queue.enqueueReadImage(images[images.size()-1], CL_TRUE, origin, region, 0, 0, sum);
-        if(device->isImageFormatSupported(CL_R, CL_UNSIGNED_INT8, CL_MEM_OBJECT_IMAGE3D)) {
-            totalSum = sum[0] + sum[1] + sum[2] + sum[3] + sum[4] + sum[5] + sum[6] + sum[7] ;
-        } else {
-            totalSum = sum[0] + sum[4] + sum[8] + sum[12] + sum[16] + sum[20] + sum[24] + sum[28] ;
+        kernel.setArg(0, *clImage);
+        for(i = 0; i < images.size(); i++) {
+            kernel.setArg(i+1, images[i]);
         }
-        delete[] sum;
+        i += 1;
     } else {
-        int* sum = new int[8];
-        queue.enqueueReadBuffer(buffers[buffers.size()-1], CL_TRUE, 0, sizeof(int)*8, sum);
-        totalSum = sum[0] + sum[1] + sum[2] + sum[3] + sum[4] + sum[5] + sum[6] + sum[7] ;
-        delete[] sum;
+        kernel.setArg(0, *clImage);
+        kernel.setArg(1, cubeIndexesImage);
+        for(i = 0; i < buffers.size(); i++) {
+            kernel.setArg(i+2, buffers[i]);
+        }
+        i += 2;
     }
+    return i;
+}
 
-    Mesh::pointer output = getStaticOutputData<Mesh>(0);
-    SceneGraph::setParentNode(output, input);
-    BoundingBox box = input->getBoundingBox();
-    // Apply spacing scaling to BB
-    AffineTransformation::pointer T = AffineTransformation::New();
-    T->scale(input->getSpacing());
-    output->setBoundingBox(box.getTransformedBoundingBox(T));
-    output->create(totalSum);
+void SurfaceExtraction::enqueueTraversal(
+        OpenCLDevice::pointer device,
+        cl::Kernel kernel,
+        uint argumentIndex,
+        cl::Buffer output,
+        uint capacity,
+        Image::pointer input) {
+    kernel.setArg(argumentIndex, output);
+    kernel.setArg(argumentIndex+1, mThreshold);
+    kernel.setArg(argumentIndex+2, mCountBuffer);
+    kernel.setArg(argumentIndex+3, input->getSpacing().x());
+    kernel.setArg(argumentIndex+4, input->getSpacing().y());
+    kernel.setArg(argumentIndex+5, input->getSpacing().z());
+
+    // Run a NDRange kernel over this buffer which traverses back to the base level.
+    // The capacity is a multiple of 64, and the kernel stops at the nr of triangles.
+    device->getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(capacity), cl::NDRange(64));
+}
 
-    if(totalSum == 0) {
-        reportInfo() << "No triangles were extracted. Check isovalue." << Reporter::end;
-        return;
+void SurfaceExtraction::readCounts(OpenCLDevice::pointer device, cl::Event* event) {
+    device->getCommandQueue().enqueueReadBuffer(mCountBuffer, CL_FALSE, 0, sizeof(uint)*2, mCounts, NULL, event);
+}
+
+void SurfaceExtraction::waitForCounts(cl::Event event) {
+    mRuntimeManager->startRegularTimer("waiting for device");
+    event.wait();
+    mRuntimeManager->stopRegularTimer("waiting for device");
+}
+
+void SurfaceExtraction::createMesh(
+        OpenCLDevice::pointer device,
+        cl::Kernel traverseHPKernel,
+        uint argumentIndex,
+        Image::pointer input,
+        Mesh::pointer output) {
+    // The read is enqueued before the traversal, so it is done while the triangles are created
+    cl::Event countEvent;
+    readCounts(device, &countEvent);
+    if(mTriangleCapacity == 0) {
+        // Nothing is known about the size of the mesh before the first execution
+        waitForCounts(countEvent);
+        mTriangleCapacity = getCapacity(mCounts[0]);
     }
-    reportInfo() << totalSum << " nr of triangles were extracted with the SurfaceExtraction algorithm." << reportEnd();
 
+    OutputBuffers* outputBuffers = &getOutputBuffers(device, mTriangleCapacity*3, 0);
+    enqueueTraversal(device, traverseHPKernel, argumentIndex, outputBuffers->vertices, mTriangleCapacity, input);
+    waitForCounts(countEvent);
+    const uint nrOfTriangles = mCounts[0];
+    if(nrOfTriangles > mTriangleCapacity) {
+        // Not all triangles fit, do the traversal again with larger buffers
+        mTriangleCapacity = getCapacity(nrOfTriangles);
+        outputBuffers = &getOutputBuffers(device, mTriangleCapacity*3, 0);
+        enqueueTraversal(device, traverseHPKernel, argumentIndex, outputBuffers->vertices, mTriangleCapacity, input);
+    }
+    enqueueStageMarker(device, "traversal");
 
-    // Traverse HP to create triangles and put them in the VBO
-    // Make OpenCL buffer from OpenGL buffer
-    unsigned int i = 0;
-    if(writingTo3DTextures) {
-        traverseHPKernel.setArg(0, *clImage);
-        for(i = 0; i < images.size(); i++) {
-            traverseHPKernel.setArg(i+1, images[i]);
+    // The in-order queue makes sure that the traversal is done before the buffer is used
+    output->create(nrOfTriangles, outputBuffers->vertices, device);
+    assignOutputBuffers(output);
+}
+
+void SurfaceExtraction::createIndexedMesh(
+        OpenCLDevice::pointer device,
+        cl::Kernel traverseHPKernel,
+        uint argumentIndex,
+        Image::pointer input,
+        cl::Image3D* clImage,
+        Mesh::pointer output) {
+    cl::CommandQueue queue = device->getCommandQueue();
+    cl::Event countEvent;
+    if(mTriangleCapacity == 0) {
+        // Nothing is known about the size of the mesh before the first execution
+        readCounts(device, &countEvent);
+        waitForCounts(countEvent);
+        mTriangleCapacity = getCapacity(mCounts[0]);
+    }
+
+    cl::Kernel initializeKernel(mWeldingProgram, "initializeEdgeTable");
+    cl::Kernel insertKernel(mWeldingProgram, "insertEdges");
+    while(true) {
+        createWeldingBuffers(device, mTriangleCapacity);
+
+        // Write the key of the cube edge of each triangle vertex
+        enqueueTraversal(device, traverseHPKernel, argumentIndex, mEdgeKeys, mTriangleCapacity, input);
+        enqueueStageMarker(device, "traversal");
+
+        initializeKernel.setArg(0, mTableKeys);
+        initializeKernel.setArg(1, mTableSize);
+        queue.enqueueNDRangeKernel(initializeKernel, cl::NullRange, cl::NDRange(mTableSize), cl::NullRange);
+
+        insertKernel.setArg(0, mEdgeKeys);
+        insertKernel.setArg(1, mCountBuffer);
+        insertKernel.setArg(2, mTableKeys);
+        insertKernel.setArg(3, mTableValues);
+        insertKernel.setArg(4, mTableSize);
+        insertKernel.setArg(5, mSlots);
+        insertKernel.setArg(6, mVertexKeys);
+        queue.enqueueNDRangeKernel(insertKernel, cl::NullRange, cl::NDRange(mTriangleCapacity*3), cl::NullRange);
+
+        // The nr of vertices is needed to size the output
+        readCounts(device, &countEvent);
+        waitForCounts(countEvent);
+        if(mCounts[0] <= mTriangleCapacity)
+            break;
+
+        // Not all triangles fit, do the traversal again with larger buffers
+        mTriangleCapacity = getCapacity(mCounts[0]);
+        static const uint zero = 0;
+        queue.enqueueWriteBuffer(mCountBuffer, CL_FALSE, sizeof(uint), sizeof(uint), &zero);
+    }
+    const uint nrOfTriangles = mCounts[0];
+    const uint nrOfVertices = mCounts[1];
+    const uint nrOfKeys = nrOfTriangles*3;
+    if(nrOfVertices > mVertexCapacity)
+        mVertexCapacity = getCapacity(nrOfVertices);
+    OutputBuffers& outputBuffers = getOutputBuffers(device, mVertexCapacity, mTriangleCapacity);
+
+    cl::Kernel resolveKernel(mWeldingProgram, "resolveIndices");
+    resolveKernel.setArg(0, mSlots);
+    resolveKernel.setArg(1, nrOfKeys);
+    resolveKernel.setArg(2, mTableValues);
+    resolveKernel.setArg(3, outputBuffers.indices);
+    queue.enqueueNDRangeKernel(resolveKernel, cl::NullRange, cl::NDRange(roundUpToMultiple(std::max(nrOfKeys, 1u), 64)), cl::NullRange);
+
+    cl::Kernel createVerticesKernel(mWeldingProgram, "createVertices");
+    createVerticesKernel.setArg(0, *clImage);
+    createVerticesKernel.setArg(1, mVertexKeys);
+    createVerticesKernel.setArg(2, nrOfVertices);
+    createVerticesKernel.setArg(3, outputBuffers.vertices);
+    createVerticesKernel.setArg(4, mThreshold);
+    createVerticesKernel.setArg(5, input->getSpacing().x());
+    createVerticesKernel.setArg(6, input->getSpacing().y());
+    createVerticesKernel.setArg(7, input->getSpacing().z());
+    queue.enqueueNDRangeKernel(createVerticesKernel, cl::NullRange, cl::NDRange(roundUpToMultiple(std::max(nrOfVertices, 1u), 64)), cl::NullRange);
+    enqueueStageMarker(device, "welding");
+
+    output->create(nrOfVertices, nrOfTriangles, outputBuffers.vertices, outputBuffers.indices, device);
+    assignOutputBuffers(output);
+    reportInfo() << nrOfVertices << " vertices are shared by the triangles." << reportEnd();
+}
+
+void SurfaceExtraction::createWeldingBuffers(OpenCLDevice::pointer device, uint triangleCapacity) {
+    if(mWeldingCapacity >= triangleCapacity)
+        return;
+
+    cl::Context context = device->getContext();
+    const uint nrOfKeys = triangleCapacity*3;
+    // At most half of the hash table is used, to keep the probing short
+    mTableSize = getPowerOfTwoSize(nrOfKeys*2);
+    mEdgeKeys = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(uint)*nrOfKeys);
+    mTableKeys = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(uint)*mTableSize);
+    mTableValues = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(uint)*mTableSize);
+    mSlots = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(uint)*nrOfKeys);
+    mVertexKeys = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(uint)*nrOfKeys);
+    mWeldingCapacity = triangleCapacity;
+}
+
+SurfaceExtraction::OutputBuffers& SurfaceExtraction::getOutputBuffers(
+        OpenCLDevice::pointer device,
+        uint vertexCapacity,
+        uint triangleCapacity) {
+    // Buffers which a mesh still uses are never written to, as a renderer may
+    // be copying them. This includes the buffers of the output mesh, which is
+    // used until it is created again, so the output alternates between two
+    // sets of buffers.
+    int index = -1;
+    for(int i = 0; i < mOutputBuffers.size(); i++) {
+        if(mOutputBuffers[i].pending) {
+            index = i;
+            break;
         }
-        i += 1;
-    } else {
-        traverseHPKernel.setArg(0, *clImage);
-        traverseHPKernel.setArg(1, cubeIndexesImage);
-        for(i = 0; i < buffers.size(); i++) {
-            traverseHPKernel.setArg(i+2, buffers[i]);
+        if(!mOutputBuffers[i].mesh.lock().isValid() && index == -1)
+            index = i;
+    }
+    if(index == -1) {
+        if(mOutputBuffers.size() == MAX_NR_OF_OUTPUT_BUFFERS) {
+            // The meshes keep their buffers, they are just not reused
+            mOutputBuffers.erase(mOutputBuffers.begin());
+        }
+        OutputBuffers newBuffers;
+        newBuffers.vertexCapacity = 0;
+        newBuffers.triangleCapacity = 0;
+        newBuffers.pending = false;
+        mOutputBuffers.push_back(newBuffers);
+        index = mOutputBuffers.size()-1;
+    }
+
+    OutputBuffers& buffers = mOutputBuffers[index];
+    if(buffers.vertexCapacity < vertexCapacity) {
+        buffers.vertices = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, sizeof(float)*vertexCapacity*6);
+        buffers.vertexCapacity = vertexCapacity;
+    }
+    if(buffers.triangleCapacity < triangleCapacity) {
+        buffers.indices = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, sizeof(uint)*triangleCapacity*3);
+        buffers.triangleCapacity = triangleCapacity;
+    }
+    buffers.pending = true;
+    return buffers;
+}
+
+void SurfaceExtraction::assignOutputBuffers(Mesh::pointer output) {
+    // The output now uses the pending buffers, and the buffers it used
+    // before can be reused
+    for(int i = 0; i < mOutputBuffers.size(); i++) {
+        OutputBuffers& buffers = mOutputBuffers[i];
+        if(buffers.pending) {
+            buffers.mesh = output;
+            buffers.pending = false;
+        } else if(buffers.mesh.lock() == output) {
+            buffers.mesh = WeakPointer<Mesh>();
         }
-        i += 2;
     }
+}
+
+void SurfaceExtraction::enqueueStageMarker(OpenCLDevice::pointer device, std::string stage) {
+    if(!mRuntimeManager->isEnabled())
+        return;
+    cl::CommandQueue queue = device->getCommandQueue();
+    if((queue.getInfo<CL_QUEUE_PROPERTIES>() & CL_QUEUE_PROFILING_ENABLE) == 0)
+        return;
+
+    cl::Event marker;
+#if !defined(CL_VERSION_1_2) || defined(CL_USE_DEPRECATED_OPENCL_1_1_APIS)
+    // Use deprecated API
+    queue.enqueueMarker(&marker);
+#else
+    queue.enqueueMarkerWithWaitList(NULL, &marker);
+#endif
+    mStageMarkers.push_back(marker);
+    mStageNames.push_back(stage);
+}
 
-    VertexBufferObjectAccess::pointer VBOaccess = output->getVertexBufferObjectAccess(ACCESS_READ_WRITE, device);
-    GLuint* VBO_ID = VBOaccess->get();
-    cl::BufferGL VBOBuffer = cl::BufferGL(device->getContext(), CL_MEM_WRITE_ONLY, *VBO_ID);
-    traverseHPKernel.setArg(i, VBOBuffer);
-    traverseHPKernel.setArg(i+1, mThreshold);
-    traverseHPKernel.setArg(i+2, totalSum);
-    traverseHPKernel.setArg(i+3, input->getSpacing().x());
-    traverseHPKernel.setArg(i+4, input->getSpacing().y());
-    traverseHPKernel.setArg(i+5, input->getSpacing().z());
-    //cl_event syncEvent = clCreateEventFromGLsyncKHR((cl_context)context(), (cl_GLsync)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), 0);
-    //glFinish();
-    std::vector<cl::Memory> v;
-    v.push_back(VBOBuffer);
-    //vector<Event> events;
-    //Event e;
-    //events.push_back(Event(syncEvent));
-    queue.enqueueAcquireGLObjects(&v);
-
-    // Increase the global_work_size so that it is divideable by 64
-    int global_work_size = totalSum + 64 - (totalSum - 64*(totalSum / 64));
-    // Run a NDRange kernel over this buffer which traverses back to the base level
-    queue.enqueueNDRangeKernel(traverseHPKernel, cl::NullRange, cl::NDRange(global_work_size), cl::NDRange(64));
-
-    cl::Event traversalEvent;
-    queue.enqueueReleaseGLObjects(&v, 0, &traversalEvent);
-//  traversalSync = glCreateSyncFromCLeventARB((cl_context)context(), (cl_event)traversalEvent(), 0); // Need the GL_ARB_cl_event extension
-    queue.finish();
+void SurfaceExtraction::addStageTimings(bool wait) {
+    if(mStageMarkers.size() == 0)
+        return;
 
+    if(wait) {
+        cl::Event::waitForEvents(mStageMarkers);
+    } else if(mStageMarkers.back().getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() != CL_COMPLETE) {
+        return;
+    }
+
+    // Each stage lasts from the marker of the previous stage to its own marker
+    cl_ulong previous;
+    mStageMarkers[0].getProfilingInfo<cl_ulong>(CL_PROFILING_COMMAND_START, &previous);
+    for(int i = 1; i < mStageMarkers.size(); i++) {
+        cl_ulong current;
+        mStageMarkers[i].getProfilingInfo<cl_ulong>(CL_PROFILING_COMMAND_START, &current);
+        mRuntimeManager->getTiming(mStageNames[i])->addSample((current - previous) * 1.0e-6);
+        previous = current;
+    }
+    mStageMarkers.clear();
+    mStageNames.clear();
 }
 
 SurfaceExtraction::SurfaceExtraction() {
     mThreshold = 0.0f;
+    mIndexedOutput = false;
     mHPSize = 0;
+    mTriangleCapacity = 0;
+    mVertexCapacity = 0;
+    mWeldingCapacity = 0;
+    mTableSize = 0;
     createInputPort<Image>(0);
     createOutputPort<Mesh>(0, OUTPUT_DEPENDS_ON_INPUT, 0);
     createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "/Algorithms/SurfaceExtraction/SurfaceExtraction.cl");
     createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "/Algorithms/SurfaceExtraction/SurfaceExtraction_no_3d_write.cl", "no_3d_write");
+    createOpenCLProgram(std::string(FAST_SOURCE_DIR) + "/Algorithms/SurfaceExtraction/SurfaceExtractionWelding.cl", "welding");
 }
 
 
 } // end namespace fast
-
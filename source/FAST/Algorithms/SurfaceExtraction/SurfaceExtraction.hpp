@@ -2,26 +2,96 @@
 #define SURFACEEXTRACTION_HPP_
 
 #include "FAST/ProcessObject.hpp"
+#include "FAST/Data/Image.hpp"
+#include "FAST/Data/Mesh.hpp"
 
 namespace fast {
 
+/**
+ * Marching cubes on the device using a histogram pyramid. The pyramid and
+ * the output buffers are kept between executions, so that streams of volumes
+ * can be processed without allocations or waiting for the device in between.
+ * If runtime measurements are enabled, the device time of the stages
+ * "classification", "histogram pyramid", "traversal" and "welding" is measured.
+ */
 class SurfaceExtraction : public ProcessObject {
     FAST_OBJECT(SurfaceExtraction)
     public:
+        /**
+         * Changing the threshold only runs the extraction again, the volume
+         * which is already on the device is not transferred again.
+         */
         void setThreshold(float threshold);
+        /**
+         * Create an indexed mesh where the triangles share vertices, instead
+         * of three vertices for each triangle. This is done on the device by
+         * hashing the cube edges of the vertices. Default is false.
+         */
+        void setIndexedOutput(bool indexed);
     private:
+        // Buffers given to output meshes, which are reused when the mesh is
+        // deleted or has been created again with other buffers
+        struct OutputBuffers {
+            cl::Buffer vertices;
+            cl::Buffer indices;
+            uint vertexCapacity;
+            uint triangleCapacity;
+            WeakPointer<Mesh> mesh;
+            // Being written to for the output of the current execution
+            bool pending;
+        };
+
         SurfaceExtraction();
         void execute();
+        void createHistogramPyramid(OpenCLDevice::pointer device, Image::pointer input, uint size, bool writingTo3DTextures);
+        void constructHistogramPyramid(OpenCLDevice::pointer device, cl::Image3D* clImage, bool writingTo3DTextures);
+        uint setHistogramPyramidArguments(cl::Kernel kernel, cl::Image3D* clImage, bool writingTo3DTextures);
+        void enqueueTraversal(OpenCLDevice::pointer device, cl::Kernel kernel, uint argumentIndex, cl::Buffer output, uint capacity, Image::pointer input);
+        void readCounts(OpenCLDevice::pointer device, cl::Event* event);
+        void waitForCounts(cl::Event event);
+        void createMesh(OpenCLDevice::pointer device, cl::Kernel traverseHPKernel, uint argumentIndex, Image::pointer input, Mesh::pointer output);
+        void createIndexedMesh(OpenCLDevice::pointer device, cl::Kernel traverseHPKernel, uint argumentIndex, Image::pointer input, cl::Image3D* clImage, Mesh::pointer output);
+        void createWeldingBuffers(OpenCLDevice::pointer device, uint triangleCapacity);
+        OutputBuffers& getOutputBuffers(OpenCLDevice::pointer device, uint vertexCapacity, uint triangleCapacity);
+        void assignOutputBuffers(Mesh::pointer output);
+        void enqueueStageMarker(OpenCLDevice::pointer device, std::string stage);
+        void addStageTimings(bool wait);
 
         float mThreshold;
+        bool mIndexedOutput;
         unsigned int mHPSize;
+        OpenCLDevice::pointer mHPDevice;
         cl::Program program;
+        // Options the program was compiled with
+        std::string mBuildOptions;
+        cl::Program mWeldingProgram;
         // HP
         std::vector<cl::Image3D> images;
         std::vector<cl::Buffer> buffers;
 
         cl::Buffer cubeIndexesBuffer;
         cl::Image3D cubeIndexesImage;
+
+        // Nr of triangles and vertices, written on the device and read asynchronously
+        cl::Buffer mCountBuffer;
+        uint mCounts[2];
+        // Nr of triangles and vertices the buffers are allocated for, based on previous executions
+        uint mTriangleCapacity;
+        uint mVertexCapacity;
+        std::vector<OutputBuffers> mOutputBuffers;
+
+        // Hash table and temporary buffers of the indexed output
+        uint mWeldingCapacity;
+        uint mTableSize;
+        cl::Buffer mEdgeKeys;
+        cl::Buffer mTableKeys;
+        cl::Buffer mTableValues;
+        cl::Buffer mSlots;
+        cl::Buffer mVertexKeys;
+
+        // Markers at the end of each stage, which are timed when they are finished
+        std::vector<cl::Event> mStageMarkers;
+        std::vector<std::string> mStageNames;
 };
 
 } // end namespace fast
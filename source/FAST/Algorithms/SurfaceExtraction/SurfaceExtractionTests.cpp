@@ -0,0 +1,167 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Algorithms/SurfaceExtraction/SurfaceExtraction.hpp"
+#include "FAST/Data/Image.hpp"
+#include "FAST/Data/Mesh.hpp"
+#include "FAST/DeviceManager.hpp"
+#include <algorithm>
+
+using namespace fast;
+
+// Volume where each voxel has the distance to the center as intensity
+static Image::pointer createDistanceVolume(uint size) {
+    std::vector<float> data(size*size*size);
+    const Vector3f center(size/2, size/2, size/2);
+    for(uint z = 0; z < size; z++) {
+    for(uint y = 0; y < size; y++) {
+    for(uint x = 0; x < size; x++) {
+        data[x + y*size + z*size*size] = (Vector3f(x, y, z) - center).norm();
+    }}}
+    Image::pointer image = Image::New();
+    image->create(size, size, size, TYPE_FLOAT, 1, Host::getInstance(), data.data());
+    return image;
+}
+
+TEST_CASE("SurfaceExtraction of a sphere can be read on the host without OpenGL", "[fast][SurfaceExtraction]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        const uint size = 32;
+        const float radius = 10;
+        SurfaceExtraction::pointer extractor = SurfaceExtraction::New();
+        extractor->setInputData(createDistanceVolume(size));
+        extractor->setThreshold(radius);
+        extractor->setMainDevice(devices[i]);
+        extractor->update();
+        Mesh::pointer mesh = extractor->getOutputData<Mesh>();
+        CHECK(mesh->getNrOfTriangles() > 0);
+
+        MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+        std::vector<MeshVertex> vertices = access->getVertices();
+        std::vector<Vector3ui> triangles = access->getTriangles();
+        CHECK(triangles.size() == mesh->getNrOfTriangles());
+        CHECK(vertices.size() < triangles.size()*3);
+        const Vector3f center(size/2, size/2, size/2);
+        for(int j = 0; j < vertices.size(); j++) {
+            CHECK((vertices[j].position - center).norm() == Approx(radius).epsilon(0.1));
+        }
+    }
+}
+
+TEST_CASE("SurfaceExtraction with threshold outside of intensity range gives empty mesh", "[fast][SurfaceExtraction]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        SurfaceExtraction::pointer extractor = SurfaceExtraction::New();
+        extractor->setInputData(createDistanceVolume(16));
+        extractor->setThreshold(1000);
+        extractor->setMainDevice(devices[i]);
+        extractor->update();
+        Mesh::pointer mesh = extractor->getOutputData<Mesh>();
+        CHECK(mesh->getNrOfTriangles() == 0);
+        MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+        CHECK(access->getVertices().size() == 0);
+    }
+}
+
+TEST_CASE("SurfaceExtraction with indexed output gives closed sphere with shared vertices", "[fast][SurfaceExtraction]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        const uint size = 32;
+        const float radius = 10;
+        SurfaceExtraction::pointer extractor = SurfaceExtraction::New();
+        extractor->setInputData(createDistanceVolume(size));
+        extractor->setThreshold(radius);
+        extractor->setMainDevice(devices[i]);
+        extractor->update();
+        Mesh::pointer unindexedMesh = extractor->getOutputData<Mesh>();
+        const uint nrOfTriangles = unindexedMesh->getNrOfTriangles();
+
+        extractor->setIndexedOutput(true);
+        extractor->update();
+        Mesh::pointer mesh = extractor->getOutputData<Mesh>();
+        CHECK(mesh->isIndexed() == true);
+        CHECK(mesh->getNrOfTriangles() == nrOfTriangles);
+        // Euler characteristic of a closed surface with genus 0 is 2, and each edge has two triangles
+        CHECK(mesh->getNrOfVertices() == nrOfTriangles/2 + 2);
+
+        MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+        std::vector<MeshVertex> vertices = access->getVertices();
+        std::vector<Vector3ui> triangles = access->getTriangles();
+        REQUIRE(vertices.size() == mesh->getNrOfVertices());
+        const Vector3f center(size/2, size/2, size/2);
+        for(int j = 0; j < vertices.size(); j++) {
+            CHECK((vertices[j].position - center).norm() == Approx(radius).epsilon(0.1));
+            CHECK(vertices[j].triangles.size() >= 3);
+        }
+        for(int j = 0; j < triangles.size(); j++) {
+            CHECK(triangles[j].maxCoeff() < vertices.size());
+        }
+    }
+}
+
+// Corner positions of all triangles, sorted so that meshes with different
+// vertex order can be compared
+static std::vector<std::vector<float> > getSortedTriangleCorners(Mesh::pointer mesh) {
+    MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+    std::vector<Vector3ui> triangles = access->getTriangles();
+    std::vector<std::vector<float> > corners(triangles.size());
+    for(int i = 0; i < triangles.size(); i++) {
+        for(int j = 0; j < 3; j++) {
+            Vector3f position = access->getPosition(triangles[i][j]);
+            corners[i].push_back(position.x());
+            corners[i].push_back(position.y());
+            corners[i].push_back(position.z());
+        }
+    }
+    std::sort(corners.begin(), corners.end());
+    return corners;
+}
+
+TEST_CASE("SurfaceExtraction executed again with new thresholds and volumes gives the same meshes as a new extractor", "[fast][SurfaceExtraction]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        for(int indexed = 0; indexed < 2; indexed++) {
+            INFO("Indexed output " << indexed);
+            SurfaceExtraction::pointer extractor = SurfaceExtraction::New();
+            extractor->setIndexedOutput(indexed == 1);
+            extractor->setMainDevice(devices[i]);
+            // The mesh grows larger than the buffers allocated in the first execution
+            const uint sizes[] = {32, 32, 36, 32};
+            const float radii[] = {4, 14, 10, 6};
+            for(int j = 0; j < 4; j++) {
+                INFO("Radius " << radii[j] << " in volume of size " << sizes[j]);
+                extractor->setInputData(createDistanceVolume(sizes[j]));
+                extractor->setThreshold(radii[j]);
+                extractor->update();
+                Mesh::pointer mesh = extractor->getOutputData<Mesh>();
+
+                SurfaceExtraction::pointer newExtractor = SurfaceExtraction::New();
+                newExtractor->setIndexedOutput(indexed == 1);
+                newExtractor->setMainDevice(devices[i]);
+                newExtractor->setInputData(createDistanceVolume(sizes[j]));
+                newExtractor->setThreshold(radii[j]);
+                newExtractor->update();
+                Mesh::pointer expectedMesh = newExtractor->getOutputData<Mesh>();
+                REQUIRE(mesh->getNrOfTriangles() == expectedMesh->getNrOfTriangles());
+                if(indexed == 1)
+                    CHECK(mesh->getNrOfVertices() == expectedMesh->getNrOfVertices());
+                std::vector<std::vector<float> > corners = getSortedTriangleCorners(mesh);
+                std::vector<std::vector<float> > expectedCorners = getSortedTriangleCorners(expectedMesh);
+                REQUIRE(corners.size() == expectedCorners.size());
+                for(int k = 0; k < corners.size(); k++) {
+                    for(int l = 0; l < 9; l++)
+                        CHECK(corners[k][l] == Approx(expectedCorners[k][l]));
+                }
+
+                MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+                std::vector<MeshVertex> vertices = access->getVertices();
+                const Vector3f center(sizes[j]/2, sizes[j]/2, sizes[j]/2);
+                for(int k = 0; k < vertices.size(); k++) {
+                    CHECK((vertices[k].position - center).norm() == Approx(radii[j]).epsilon(0.1));
+                }
+            }
+        }
+    }
+}
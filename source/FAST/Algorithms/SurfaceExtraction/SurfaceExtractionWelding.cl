@@ -0,0 +1,115 @@
+// Creates an indexed mesh from the edge keys of each triangle vertex written
+// by traverseHP. The keys are inserted in a hash table to give each edge one
+// vertex, and the vertices are calculated once per edge.
+
+__constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP | CLK_FILTER_NEAREST;
+
+#ifdef TYPE_UINT
+#define READ_RAW_DATA (float)read_imageui
+#elif TYPE_INT
+#define READ_RAW_DATA (float)read_imagei
+#else
+#define READ_RAW_DATA read_imagef
+#endif
+
+#define EMPTY_KEY 0xFFFFFFFF
+
+__kernel void initializeEdgeTable(
+        __global uint * tableKeys,
+        __private uint tableSize
+        ) {
+    const uint id = get_global_id(0);
+    if(id < tableSize)
+        tableKeys[id] = EMPTY_KEY;
+}
+
+// Linear probing in a table with a power of two size. The work item which
+// inserts a key first gives the edge the next vertex index. The counts are
+// the nr of triangles and vertices, written by writeTotalSum.
+__kernel void insertEdges(
+        __global const uint * edgeKeys,
+        __global uint * counts,
+        __global uint * tableKeys,
+        __global uint * tableValues,
+        __private uint tableSize,
+        __global uint * slots,
+        __global uint * vertexKeys
+        ) {
+    const uint id = get_global_id(0);
+    if(id >= counts[0]*3)
+        return;
+
+    const uint key = edgeKeys[id];
+    uint slot = (key*2654435761u) & (tableSize-1);
+    while(true) {
+        const uint previous = atomic_cmpxchg(&tableKeys[slot], EMPTY_KEY, key);
+        if(previous == EMPTY_KEY) {
+            const uint index = atomic_inc(&counts[1]);
+            tableValues[slot] = index;
+            vertexKeys[index] = key;
+            break;
+        }
+        if(previous == key)
+            break;
+        slot = (slot + 1) & (tableSize-1);
+    }
+    slots[id] = slot;
+}
+
+__kernel void resolveIndices(
+        __global const uint * slots,
+        __private uint nrOfKeys,
+        __global const uint * tableValues,
+        __global uint * indices
+        ) {
+    const uint id = get_global_id(0);
+    if(id < nrOfKeys)
+        indices[id] = tableValues[slots[id]];
+}
+
+float3 gradient(__read_only image3d_t rawData, int3 point) {
+    return (float3)(
+            (-READ_RAW_DATA(rawData, sampler, (int4)(point.x+1, point.y, point.z, 0)).x+READ_RAW_DATA(rawData, sampler, (int4)(point.x-1, point.y, point.z, 0)).x),
+            (-READ_RAW_DATA(rawData, sampler, (int4)(point.x, point.y+1, point.z, 0)).x+READ_RAW_DATA(rawData, sampler, (int4)(point.x, point.y-1, point.z, 0)).x),
+            (-READ_RAW_DATA(rawData, sampler, (int4)(point.x, point.y, point.z+1, 0)).x+READ_RAW_DATA(rawData, sampler, (int4)(point.x, point.y, point.z-1, 0)).x)
+        );
+}
+
+// Interpolate the vertex on each edge, always from the grid point with the
+// smallest coordinates, so that each edge gives the same vertex
+__kernel void createVertices(
+        __read_only image3d_t rawData,
+        __global const uint * vertexKeys,
+        __private uint nrOfVertices,
+        __global float * vertexBuffer,
+        __private float isolevel,
+        __private float spacing_x,
+        __private float spacing_y,
+        __private float spacing_z
+        ) {
+    const uint id = get_global_id(0);
+    if(id >= nrOfVertices)
+        return;
+
+    const uint key = vertexKeys[id];
+    const uint axis = key % 3;
+    const uint position = key / 3;
+    const int3 point0 = (int3)(position % (SIZE+1), (position / (SIZE+1)) % (SIZE+1), position / ((SIZE+1)*(SIZE+1)));
+    const int3 point1 = point0 + (int3)(axis == 0, axis == 1, axis == 2);
+
+    const float3 spacing = {spacing_x, spacing_y, spacing_z};
+    const float3 gradient0 = gradient(rawData, point0);
+    const float3 gradient1 = gradient(rawData, point1);
+    const float value0 = READ_RAW_DATA(rawData, sampler, (int4)(point0.x, point0.y, point0.z, 0)).x;
+    const float diff = native_divide(
+        isolevel-value0,
+        READ_RAW_DATA(rawData, sampler, (int4)(point1.x, point1.y, point1.z, 0)).x - value0);
+
+    const float3 point0f = (float3)(point0.x, point0.y, point0.z);
+    const float3 point1f = (float3)(point1.x, point1.y, point1.z);
+    const float3 vertex = (point0f + (point1f-point0f)*diff)*spacing;
+    const float3 normal = normalize(gradient0 + diff*(gradient1-gradient0));
+
+    vstore3(vertex, id*2, vertexBuffer);
+    vstore3(normal, id*2 + 1, vertexBuffer);
+}
@@ -150,6 +150,20 @@ __kernel void constructHPLevel(
     writeHistoPyramid[writePos] = writeValue;
 }
 
+// Sum the top level on the device, so that the host doesn't have to wait
+// for the histogram pyramid before the traversal is enqueued
+__kernel void writeTotalSum(
+        __global const int * topLevel,
+        __global uint * counts
+        ) {
+    uint sum = 0;
+    for(int i = 0; i < 8; i++)
+        sum += topLevel[i];
+    counts[0] = sum;
+    // Nr of vertices of indexed meshes
+    counts[1] = 0;
+}
+
 int4 scanHPLevelShort(int target, __global ushort * hp, int4 current) {
 
     int8 neighbors = {
@@ -599,6 +613,13 @@ __constant char triTable[4096] =
 #define READ_RAW_DATA read_imagef
 #endif
 
+// Unique key of the edge between two neighbouring grid points
+uint getEdgeKey(int3 point0, int3 point1) {
+    const int3 owner = min(point0, point1);
+    const uint axis = point0.x != point1.x ? 0 : (point0.y != point1.y ? 1 : 2);
+    return (((uint)owner.z*(SIZE+1) + owner.y)*(SIZE+1) + owner.x)*3 + axis;
+}
+
 __kernel void traverseHP(
         __read_only image3d_t rawData,
         __read_only image3d_t cubeIndexes,
@@ -620,17 +641,23 @@ __kernel void traverseHP(
         #if SIZE > 512
         __global int * hp9,
         #endif
-        __global float * VBOBuffer,
+#ifdef INDEXED
+        __global uint * edgeKeys,
+#else
+        __global float * vertexBuffer,
+#endif
         __private float isolevel,
-        __private int sum,
+        __global const uint * counts,
         __private float spacing_x,
         __private float spacing_y,
         __private float spacing_z
         ) {
 
-    int target = get_global_id(0);
-    if(target >= sum)
-        target = 0;
+    // The nr of triangles is written by writeTotalSum, the output buffer is
+    // at least as large as the global size
+    const int target = get_global_id(0);
+    if(target >= counts[0])
+        return;
 
     int4 cubePosition = {0,0,0,0}; // x,y,z,sum
     #if SIZE > 512
@@ -664,6 +691,10 @@ __kernel void traverseHP(
         const int3 point0 = (int3)(cubePosition.x + offsets3[edge*6], cubePosition.y + offsets3[edge*6+1], cubePosition.z + offsets3[edge*6+2]);
         const int3 point1 = (int3)(cubePosition.x + offsets3[edge*6+3], cubePosition.y + offsets3[edge*6+4], cubePosition.z + offsets3[edge*6+5]);
 
+#ifdef INDEXED
+        // The vertices are created for each edge afterwards, so that triangles sharing an edge share the vertex
+        edgeKeys[target*3 + vertexNr] = getEdgeKey(point0, point1);
+#else
         // Store vertex in VBO
 
         // TODO Should use spacing in these calculations:
@@ -697,8 +728,9 @@ __kernel void traverseHP(
 #endif
 
 
-        vstore3(vertex, target*6 + vertexNr*2, VBOBuffer);
-        vstore3(normal, target*6 + vertexNr*2 + 1, VBOBuffer);
+        vstore3(vertex, target*6 + vertexNr*2, vertexBuffer);
+        vstore3(normal, target*6 + vertexNr*2 + 1, vertexBuffer);
+#endif
 
 
         ++vertexNr;
@@ -714,9 +746,19 @@ __kernel void classifyCubes(
         __private float isolevel
         ) {
     int4 pos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
+    uint writePos = EncodeMorton3(pos.x,pos.y,pos.z);
+    const uint cubeIndexPos = pos.x+pos.y*get_global_size(0)+pos.z*get_global_size(0)*get_global_size(1);
+
+    // Cubes outside of the volume are part of the pyramid, but have no triangles
+    const int4 size = get_image_dim(rawData);
+    if(pos.x >= size.x || pos.y >= size.y || pos.z >= size.z) {
+        histoPyramid[writePos] = 0;
+        cubeIndexes[cubeIndexPos] = 0;
+        return;
+    }
 
     // Find cube class nr
-    const uchar first = READ_RAW_DATA(rawData, sampler, pos).x;
+    const float first = READ_RAW_DATA(rawData, sampler, pos).x;
     const uchar cubeindex =
     ((first > isolevel)) |
     ((READ_RAW_DATA(rawData, sampler2, pos + cubeOffsets[1]).x > isolevel) << 1) |
@@ -728,7 +770,6 @@ __kernel void classifyCubes(
     ((READ_RAW_DATA(rawData, sampler2, pos + cubeOffsets[6]).x > isolevel) << 7);
 
     // Store number of triangles and index
-    uint writePos = EncodeMorton3(pos.x,pos.y,pos.z);
     histoPyramid[writePos] = nrOfTriangles[cubeindex];
-    cubeIndexes[pos.x+pos.y*get_global_size(0)+pos.z*get_global_size(0)*get_global_size(1)] = cubeindex;
+    cubeIndexes[cubeIndexPos] = cubeindex;
 }
@@ -2,6 +2,7 @@
 #include "FAST/Data/Image.hpp"
 #include "FAST/Data/Segmentation.hpp"
 #include "FAST/Utility.hpp"
+#include <cstring>
 
 namespace fast {
 
@@ -21,15 +22,171 @@ InverseGradientSegmentation::InverseGradientSegmentation() {
     createOutputPort<Segmentation>(0, OUTPUT_DEPENDS_ON_INPUT, 0);
 }
 
+static inline std::size_t getClampedIndex(Vector3i position, const Vector3i& size) {
+    position = position.cwiseMax(Vector3i::Zero()).cwiseMin(size - Vector3i::Ones());
+    return position.x() + ((std::size_t)position.y() + (std::size_t)position.z()*size.y())*size.x();
+}
+
+static inline Vector3i getPosition(std::size_t index, const Vector3i& size) {
+    return Vector3i(index % size.x(), (index / size.x()) % size.y(), index / ((std::size_t)size.x()*size.y()));
+}
+
+// Runs the grow kernel on the host with the view type of the vector field.
+// All voxels marked with 2 are processed in each iteration and the result is
+// applied afterwards, as with the two volumes on the device, but only the
+// marked voxels are visited instead of the whole volume.
+struct GrowingVisitor {
+    uchar* segmentation;
+    int iterations;
+
+    template <class View>
+    void operator()(const View& vectorField) {
+        const Vector3i size = vectorField.getSize();
+        const std::size_t nrOfVoxels = vectorField.getNrOfVoxels();
+
+        // The 26 neighbors in the order of the kernel
+        std::vector<Vector3i> neighbors;
+        std::vector<Vector3f> directions;
+        for(int a = -1; a < 2; a++) {
+        for(int b = -1; b < 2; b++) {
+        for(int c = -1; c < 2; c++) {
+            if(a == 0 && b == 0 && c == 0)
+                continue;
+            neighbors.push_back(Vector3i(a, b, c));
+            directions.push_back(Vector3f(a, b, c).normalized());
+        }}}
+
+        std::vector<std::size_t> active;
+        for(std::size_t i = 0; i < nrOfVoxels; i++) {
+            if(segmentation[i] == 2)
+                active.push_back(i);
+        }
+
+        iterations = 0;
+        while(!active.empty()) {
+            std::vector<uchar> accepted(active.size(), 0);
+            std::vector<std::size_t> marked;
+            for(std::size_t i = 0; i < active.size(); i++) {
+                const Vector3i X = getPosition(active[i], size);
+                const float FNXw = vectorField.getVector(X).norm();
+                for(int j = 0; j < neighbors.size(); j++) {
+                    const Vector3i Y = X + neighbors[j];
+                    const std::size_t indexY = getClampedIndex(Y, size);
+                    if(segmentation[indexY] == 1)
+                        continue;
+                    Vector3f FNY = vectorField.getVector(getPosition(indexY, size));
+                    const float FNYw = FNY.norm();
+                    if(FNYw <= FNXw)
+                        continue;
+                    FNY /= FNYw;
+
+                    // Neighbor of Y which the vector field of Y points to
+                    int Z = 0;
+                    float maxDotProduct = -2.0f;
+                    for(int k = 0; k < directions.size(); k++) {
+                        const float dotProduct = FNY.dot(directions[k]);
+                        if(dotProduct > maxDotProduct) {
+                            maxDotProduct = dotProduct;
+                            Z = k;
+                        }
+                    }
+                    if(Y + neighbors[Z] == X) {
+                        accepted[i] = 1;
+                        if((Y.array() >= 0).all() && (Y.array() < size.array()).all())
+                            marked.push_back(indexY);
+                    }
+                }
+            }
+
+            for(std::size_t i = 0; i < active.size(); i++)
+                segmentation[active[i]] = accepted[i];
+            // The voxels which were accepted in this iteration are kept
+            active.clear();
+            for(std::size_t i = 0; i < marked.size(); i++) {
+                if(segmentation[marked[i]] != 1 && segmentation[marked[i]] != 2) {
+                    segmentation[marked[i]] = 2;
+                    active.push_back(marked[i]);
+                }
+            }
+            iterations++;
+        }
+    }
+};
+
+void InverseGradientSegmentation::executeOnHost(Segmentation::pointer centerline, Image::pointer vectorField, Segmentation::pointer segmentation) {
+    const Vector3i size = centerline->getSize().cast<int>();
+    const std::size_t nrOfVoxels = (std::size_t)size.x()*size.y()*size.z();
+    ImageAccess::pointer centerlineAccess = centerline->getImageAccess(ACCESS_READ);
+    ImageAccess::pointer segmentationAccess = segmentation->getImageAccess(ACCESS_READ_WRITE);
+    const uchar* centerlineData = (const uchar*)centerlineAccess->get();
+    uchar* segmentationData = (uchar*)segmentationAccess->get();
+    memcpy(segmentationData, centerlineData, nrOfVoxels);
+
+    // Same as the initGrowing kernel
+    for(std::size_t i = 0; i < nrOfVoxels; i++) {
+        const uint radius = centerlineData[i];
+        if(radius == 0)
+            continue;
+        const int N = radius > 7 ? std::min(std::max(1, (int)radius), 5) : 1;
+        const Vector3i position = getPosition(i, size);
+        for(int a = -N; a < N+1; a++) {
+        for(int b = -N; b < N+1; b++) {
+        for(int c = -N; c < N+1; c++) {
+            const Vector3i n = position + Vector3i(a, b, c);
+            if(centerlineData[getClampedIndex(n, size)] == 0 && Vector3f(a, b, c).norm() <= N &&
+                    (n.array() >= 0).all() && (n.array() < size.array()).all())
+                segmentationData[getClampedIndex(n, size)] = 2;
+        }}}
+    }
+
+    GrowingVisitor visitor = {segmentationData, 0};
+    {
+        ImageAccess::pointer vectorFieldAccess = vectorField->getImageAccess(ACCESS_READ);
+        vectorFieldAccess->visit<3>(visitor);
+    }
+    std::cout << "segmentation result grown in " << visitor.iterations << " iterations" << std::endl;
+
+    // Same as the dilate and erode kernels
+    std::vector<uchar> dilated(segmentationData, segmentationData + nrOfVoxels);
+    for(std::size_t i = 0; i < nrOfVoxels; i++) {
+        if(segmentationData[i] != 1)
+            continue;
+        const Vector3i position = getPosition(i, size);
+        for(int a = -1; a < 2; a++) {
+        for(int b = -1; b < 2; b++) {
+        for(int c = -1; c < 2; c++) {
+            const Vector3i n = position + Vector3i(a, b, c);
+            if((n.array() >= 0).all() && (n.array() < size.array()).all())
+                dilated[getClampedIndex(n, size)] = 1;
+        }}}
+    }
+    #pragma omp parallel for
+    for(long long i = 0; i < (long long)nrOfVoxels; i++) {
+        bool keep = dilated[i] == 1;
+        const Vector3i position = getPosition(i, size);
+        for(int a = -1; a < 2 && keep; a++) {
+        for(int b = -1; b < 2 && keep; b++) {
+        for(int c = -1; c < 2 && keep; c++) {
+            keep = dilated[getClampedIndex(position + Vector3i(a, b, c), size)] == 1;
+        }}}
+        segmentationData[i] = keep ? 1 : 0;
+    }
+}
+
 void InverseGradientSegmentation::execute() {
-    OpenCLDevice::pointer device = getMainDevice();
-    bool no3Dwrite = !device->isWritingTo3DTexturesSupported();
     Segmentation::pointer centerline = getStaticInputData<Segmentation>(0);
     Vector3ui size = centerline->getSize();
     Image::pointer vectorField = getStaticInputData<Image>(1);
     Segmentation::pointer segmentation = getStaticOutputData<Segmentation>(0);
     segmentation->createFromImage(centerline);
     SceneGraph::setParentNode(segmentation, centerline);
+    if(getMainDevice()->isHost()) {
+        executeOnHost(centerline, vectorField, segmentation);
+        return;
+    }
+
+    OpenCLDevice::pointer device = getMainDevice();
+    bool no3Dwrite = !device->isWritingTo3DTexturesSupported();
     Segmentation::pointer segmentation2 = Segmentation::New();
     segmentation2->createFromImage(centerline);
 
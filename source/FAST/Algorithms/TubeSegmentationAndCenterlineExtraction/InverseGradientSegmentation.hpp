@@ -2,6 +2,7 @@
 #define INVERSE_GRADIENT_SEGMENTATION_HPP
 
 #include "FAST/ProcessObject.hpp"
+#include "FAST/Data/Segmentation.hpp"
 
 namespace fast {
 
@@ -13,6 +14,8 @@ class InverseGradientSegmentation : public ProcessObject {
     private:
         InverseGradientSegmentation();
         void execute();
+        // Used when the main device is the host, for volumes which don't fit in device memory
+        void executeOnHost(Segmentation::pointer centerline, Image::pointer vectorField, Segmentation::pointer segmentation);
 
 };
 
@@ -52,22 +52,27 @@ typedef struct CenterlinePoint {
 #define LPOS(a,b,c) (a)+(b)*(size.x())+(c)*(size.x()*size.y())
 #define POS(pos) pos.x()+pos.y()*size.x()+pos.z()*size.x()*size.y()
 
-float squaredMagnitude(ImageAccess::pointer& vectorFieldAccess, Vector3i position) {
-    Vector3f vector = vectorFieldAccess->getVector(position).head(3);
-    float magnitude = vector.norm();
-    return magnitude;
+// The vector field is read through a typed ImageView with 3 components in
+// the functions below, as they are called in the innermost loops of the
+// traversal
+
+template <class View>
+inline float squaredMagnitude(const View& vectorField, const Vector3i& position) {
+    return vectorField.getVector(position).norm();
 }
 
-float getNormalizedValue(ImageAccess::pointer& vectorField, Vector3i pos, uint component) {
+template <class View>
+inline float getNormalizedValue(const View& vectorField, const Vector3i& pos, uint component) {
     float magnitude = squaredMagnitude(vectorField, pos);
     if(magnitude == 0) {
         return 0;
     } else {
-        return vectorField->getScalar(pos, component) ;/// magnitude;
+        return vectorField.getScalar(pos, component) ;/// magnitude;
     }
 }
 
-Vector3f gradientNormalized(ImageAccess::pointer& vectorField, Vector3i pos, int volumeComponent, int dimensions) {
+template <class View>
+Vector3f gradientNormalized(const View& vectorField, Vector3i pos, int volumeComponent, int dimensions) {
     float f100, f_100, f010 = 0, f0_10 = 0, f001 = 0, f00_1 = 0;
     Vector3i npos = pos;
     npos.x() += 1;
@@ -95,26 +100,27 @@ Vector3f gradientNormalized(ImageAccess::pointer& vectorField, Vector3i pos, int
     return grad;
 }
 
-Vector3f gradient(ImageAccess::pointer& vectorField, Vector3i pos, int volumeComponent, int dimensions) {
+template <class View>
+Vector3f gradient(const View& vectorField, Vector3i pos, int volumeComponent, int dimensions) {
     float f100, f_100, f010 = 0, f0_10 = 0, f001 = 0, f00_1 = 0;
     Vector3i npos = pos;
     npos.x() += 1;
-    f100 = vectorField->getScalar(npos, volumeComponent);
+    f100 = vectorField.getScalar(npos, volumeComponent);
     npos.x() -= 2;
-    f_100 = vectorField->getScalar(npos, volumeComponent);
+    f_100 = vectorField.getScalar(npos, volumeComponent);
     if(dimensions > 1) {
         npos = pos;
         npos.y() += 1;
-        f010 = vectorField->getScalar(npos, volumeComponent);
+        f010 = vectorField.getScalar(npos, volumeComponent);
         npos.y() -= 2;
-        f0_10 = vectorField->getScalar(npos, volumeComponent);
+        f0_10 = vectorField.getScalar(npos, volumeComponent);
     }
     if(dimensions > 2) {
         npos = pos;
         npos.z() += 1;
-        f001 = vectorField->getScalar(npos, volumeComponent);
+        f001 = vectorField.getScalar(npos, volumeComponent);
         npos.z() -= 2;
-        f00_1 = vectorField->getScalar(npos, volumeComponent);
+        f00_1 = vectorField.getScalar(npos, volumeComponent);
     }
 
     Vector3f grad(0.5f*(f100-f_100), 0.5f*(f010-f0_10), 0.5f*(f001-f00_1));
@@ -152,7 +158,8 @@ void sortEigenvaluesAndVectors(Vector3f* eigenvaluesOut, Matrix3f* eigenvectorsO
 }
 
 
-Vector3f getTubeDirection(ImageAccess::pointer& vectorField, Vector3i pos, Vector3ui size, bool normalize) {
+template <class View>
+Vector3f getTubeDirection(const View& vectorField, Vector3i pos, Vector3ui size, bool normalize) {
 
     // Do gradient on Fx, Fy and Fz and normalization
     Vector3f Fx, Fy, Fz;
@@ -181,7 +188,8 @@ Vector3f getTubeDirection(ImageAccess::pointer& vectorField, Vector3i pos, Vecto
     return eigenvectors.col(0);
 }
 
-void doEigen(ImageAccess::pointer& vectorField, Vector3i pos, Vector3ui size, bool normalize, Vector3f* lambda, Vector3f* e1, Vector3f* e2, Vector3f* e3) {
+template <class View>
+void doEigen(const View& vectorField, Vector3i pos, Vector3ui size, bool normalize, Vector3f* lambda, Vector3f* e1, Vector3f* e2, Vector3f* e3) {
 
     // Do gradient on Fx, Fy and Fz and normalization
     Vector3f Fx, Fy, Fz;
@@ -226,24 +234,20 @@ void copyToLineSet(std::stack<CenterlinePoint> points, std::vector<Vector3f>& ve
     }
 }
 
+// Label of the next centerline, shared by all extractions
+static int counter = 1;
+
+template <class View>
 void extractCenterlines(
-        Image::pointer TDF,
-        Image::pointer vectorField,
-        Image::pointer radius,
+        const ImageView<float>& TDF,
+        const View& vectorField,
         int* centerlines,
         unordered_map<int, int>& centerlineDistances,
         unordered_map<int, std::stack<CenterlinePoint> >& centerlineStacks,
-        std::vector<Vector3f>& vertices,
-        std::vector<Vector2ui>& lines,
         int maxBelowTlow,
         bool* useFirstRadius
     ) {
-    ImageAccess::pointer TDFaccess = TDF->getImageAccess(ACCESS_READ);
-    ImageAccess::pointer vectorFieldAccess = vectorField->getImageAccess(ACCESS_READ);
-    const Vector3ui size = TDF->getSize();
-    const Vector3f spacing = vectorField->getSpacing();
-
-    static int counter = 1;
+    const Vector3ui size = TDF.getSize().cast<uint>();
     float Thigh = 0.5;
     int Dmin = 10;//getParam(parameters, "min-distance");
     float Mlow = 0.1;
@@ -251,38 +255,23 @@ void extractCenterlines(
     float minMeanTube = maxBelowTlow > 0 ? 0.4 : 0.5;
     const int totalSize = size.x()*size.y()*size.z();
 
-    Vector3i neighborhood[26];
-    uint i = 0;
-    for(int a = -1; a < 2; a++) {
-        for(int b = -1; b < 2; b++) {
-            for(int c = -1; c < 2; c++) {
-                if(a == 0 && b == 0 && c == 0)
-                    continue;
-                neighborhood[i] = Vector3i(a,b,c);
-                i++;
-            }
-        }
-    }
-
         // Create queue
     std::priority_queue<point, std::vector<point>, PointComparison> queue;
 
     std::cout << "Getting valid start points for centerline extraction.." << std::endl;
-    float* TDFarray = (float*)TDFaccess->get();
     // Collect all valid start points
     #pragma omp parallel for
     for(int z = 2; z < size.z()-2; z++) {
         for(int y = 2; y < size.y()-2; y++) {
             for(int x = 2; x < size.x()-2; x++) {
-                if(TDFarray[x + y*size.x() + z*size.x()*size.y()] < Thigh)
-                //if(TDFaccess->getScalar(Vector3i(x,y,z)) < Thigh) // This is reaaaaallllly slow
+                if(TDF(x,y,z) < Thigh)
                     continue;
 
                 Vector3i pos(x,y,z);
                 bool valid = true;
-                for(int i = 0; i < 26; ++i) {
-                    Vector3i nPos = pos + neighborhood[i];
-                    if(squaredMagnitude(vectorFieldAccess, nPos) < squaredMagnitude(vectorFieldAccess, pos)) {
+                const float magnitude = squaredMagnitude(vectorField, pos);
+                for(typename View::Neighborhood n = vectorField.beginNeighborhood(pos); n != vectorField.endNeighborhood(pos); ++n) {
+                    if(n.getVector().norm() < magnitude) {
                         valid = false;
                         break;
                     }
@@ -290,7 +279,7 @@ void extractCenterlines(
 
                 if(valid) {
                     point p;
-                    p.value = TDFaccess->getScalar(Vector3i(x,y,z));
+                    p.value = TDF(x,y,z);
                     p.x = x;
                     p.y = y;
                     p.z = z;
@@ -321,7 +310,7 @@ void extractCenterlines(
         int connections = 0;
         int prevConnection = -1;
         int secondConnection = -1;
-        float meanTube = TDFaccess->getScalar(Vector3i(p.x,p.y,p.z));
+        float meanTube = TDF(p.x,p.y,p.z);
 
         // Create new stack for this centerline
         std::stack<CenterlinePoint> stack;
@@ -338,7 +327,7 @@ void extractCenterlines(
             Vector3i previous = startPoint.pos;
             int belowTlow = 0;
             Vector3i position(p.x,p.y,p.z);
-            Vector3f t_i = getTubeDirection(vectorFieldAccess, position, size, maxBelowTlow > 0)*direction;
+            Vector3f t_i = getTubeDirection(vectorField, position, size, maxBelowTlow > 0)*direction;
             Vector3f t_i_1 = t_i;
 
 
@@ -367,12 +356,12 @@ void extractCenterlines(
                             // Is magnitude smaller than previous
                             if(maxPoint == Vector3i(0,0,0)) {
                                 maxPoint = n;
-                            } else if(1 - squaredMagnitude(vectorFieldAccess, n) > 1 - squaredMagnitude(vectorFieldAccess, maxPoint)) {
+                            } else if(1 - squaredMagnitude(vectorField, n) > 1 - squaredMagnitude(vectorField, maxPoint)) {
                                 maxPoint = n;
                             }
                             /*
                             } else {
-                                if(TDFaccess->getScalar(n)*(1-squaredMagnitude(vectorFieldAccess, n)) > TDFaccess->getScalar(maxPoint)*(1-squaredMagnitude(vectorFieldAccess, maxPoint)))
+                                if(TDF(n)*(1-squaredMagnitude(vectorField, n)) > TDF(maxPoint)*(1-squaredMagnitude(vectorField, maxPoint)))
                                 maxPoint = n;
                             }
                             */
@@ -395,7 +384,7 @@ void extractCenterlines(
                             stack.push(p);
                             distance ++;
                             newCenterlines.insert(POS(maxPoint));
-                            meanTube += TDFaccess->getScalar(maxPoint);
+                            meanTube += TDF(maxPoint);
                         } else {
                             if(prevConnection == centerlines[POS(maxPoint)]) {
                                 // A loop has occured, reject this centerline
@@ -410,11 +399,11 @@ void extractCenterlines(
                                 stack.push(p);
                                 distance ++;
                                 newCenterlines.insert(POS(maxPoint));
-                                meanTube += TDFaccess->getScalar(maxPoint);
+                                meanTube += TDF(maxPoint);
                             }
                         }
                         break;
-                    } else if(1 - squaredMagnitude(vectorFieldAccess, maxPoint) < Mlow || (belowTlow > maxBelowTlow && TDFaccess->getScalar(maxPoint) < Tlow)) {
+                    } else if(1 - squaredMagnitude(vectorField, maxPoint) < Mlow || (belowTlow > maxBelowTlow && TDF(maxPoint) < Tlow)) {
                         // New point is below thresholds
                         break;
                     } else if(newCenterlines.count(POS(maxPoint)) > 0) {
@@ -422,7 +411,7 @@ void extractCenterlines(
                         break;
                     } else {
                         // Point is OK, proceed to add it and continue
-                        if(TDFaccess->getScalar(maxPoint) < Tlow) {
+                        if(TDF(maxPoint) < Tlow) {
                             belowTlow++;
                         } else {
                             belowTlow = 0;
@@ -433,7 +422,7 @@ void extractCenterlines(
 
                         //TODO: check if all eigenvalues are negative, if so find the egeinvector that best matches
                         Vector3f lambda, e1, e2, e3;
-                        doEigen(vectorFieldAccess, maxPoint, size, maxBelowTlow > 0, &lambda, &e1, &e2, &e3);
+                        doEigen(vectorField, maxPoint, size, maxBelowTlow > 0, &lambda, &e1, &e2, &e3);
                         if((lambda.x() < 0 && lambda.y() < 0 && lambda.z() < 0)) {
                             if(fabs(t_i.dot(e3)) > fabs(t_i.dot(e2))) {
                                 if(fabs(t_i.dot(e3)) > fabs(t_i.dot(e1))) {
@@ -457,7 +446,7 @@ void extractCenterlines(
                         position = maxPoint;
                         distance ++;
                         newCenterlines.insert(POS(maxPoint));
-                        meanTube += TDFaccess->getScalar(maxPoint);
+                        meanTube += TDF(maxPoint);
 
                         // Create centerline point
                         CenterlinePoint p;
@@ -544,6 +533,37 @@ void extractCenterlines(
     std::cout << "Finished traversal" << std::endl;
 }
 
+// Runs the extraction with the view type of the vector field
+struct CenterlineExtractionVisitor {
+    const ImageView<float>& TDF;
+    int* centerlines;
+    unordered_map<int, int>& centerlineDistances;
+    unordered_map<int, std::stack<CenterlinePoint> >& centerlineStacks;
+    int maxBelowTlow;
+    bool* useFirstRadius;
+
+    template <class View>
+    void operator()(const View& vectorField) {
+        extractCenterlines(TDF, vectorField, centerlines, centerlineDistances, centerlineStacks, maxBelowTlow, useFirstRadius);
+    }
+};
+
+void extractCenterlines(
+        Image::pointer TDF,
+        Image::pointer vectorField,
+        int* centerlines,
+        unordered_map<int, int>& centerlineDistances,
+        unordered_map<int, std::stack<CenterlinePoint> >& centerlineStacks,
+        int maxBelowTlow,
+        bool* useFirstRadius
+    ) {
+    ImageAccess::pointer TDFaccess = TDF->getImageAccess(ACCESS_READ);
+    ImageAccess::pointer vectorFieldAccess = vectorField->getImageAccess(ACCESS_READ);
+    const ImageView<float> TDFview = TDFaccess->getView<float, 1>();
+    CenterlineExtractionVisitor visitor = {TDFview, centerlines, centerlineDistances, centerlineStacks, maxBelowTlow, useFirstRadius};
+    vectorFieldAccess->visit<3>(visitor);
+}
+
 void RidgeTraversalCenterlineExtraction::execute() {
 
     LineSet::pointer centerlineOutput = getStaticOutputData<LineSet>(0);
@@ -572,7 +592,7 @@ void RidgeTraversalCenterlineExtraction::execute() {
     Image::pointer radius = getStaticInputData<Image>(2);
     {
         Image::pointer vectorField = getStaticInputData<Image>(1);
-        extractCenterlines(TDF, vectorField, radius, centerlines, centerlineDistances, centerlineStacks, vertices, lines, 12, useFirstRadius);
+        extractCenterlines(TDF, vectorField, centerlines, centerlineDistances, centerlineStacks, 12, useFirstRadius);
         // TODO do inverse gradient segmentation here?
     }
 
@@ -583,7 +603,7 @@ void RidgeTraversalCenterlineExtraction::execute() {
         Image::pointer TDF = getStaticInputData<Image>(3);
         Image::pointer vectorField = getStaticInputData<Image>(4);
         radius2 = getStaticInputData<Image>(5);
-        extractCenterlines(TDF, vectorField, radius2, centerlines, centerlineDistances, centerlineStacks, vertices, lines, 0, useFirstRadius);
+        extractCenterlines(TDF, vectorField, centerlines, centerlineDistances, centerlineStacks, 0, useFirstRadius);
 
         // TODO do dilation segmentation here?
     }
@@ -621,6 +641,7 @@ void RidgeTraversalCenterlineExtraction::execute() {
 
     uchar * returnCenterlines = new uchar[totalSize]();
     ImageAccess::pointer radiusAccess = radius->getImageAccess(ACCESS_READ);
+    const ImageView<float> radiusView = radiusAccess->getView<float, 1>();
     ImageAccess::pointer radius2Access;
     if(radius2.isValid())
         radius2Access = radius2->getImageAccess(ACCESS_READ);
@@ -633,7 +654,7 @@ void RidgeTraversalCenterlineExtraction::execute() {
             if(centerlines[i] == *it2) {
                 // Store radius in centerline volume
                 if(useFirstRadius[i]) {
-                    returnCenterlines[i] = round(radiusAccess->getScalar(i));
+                    returnCenterlines[i] = round(radiusView[i]);
                 } else {
                     returnCenterlines[i] = 1;//round(radius2Access->getScalar(i));
                 }
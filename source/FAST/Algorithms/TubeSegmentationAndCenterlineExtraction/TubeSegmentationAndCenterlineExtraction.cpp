@@ -7,7 +7,9 @@
 #include "FAST/Algorithms/GradientVectorFlow/MultigridGradientVectorFlow.hpp"
 #include "RidgeTraversalCenterlineExtraction.hpp"
 #include "InverseGradientSegmentation.hpp"
-#include <stack>
+#include "FAST/Algorithms/ConnectedComponents/ConnectedComponents.hpp"
+#include "FAST/SceneGraph.hpp"
+#include <cstring>
 
 namespace fast {
 
@@ -28,6 +30,8 @@ TubeSegmentationAndCenterlineExtraction::TubeSegmentationAndCenterlineExtraction
     mSegmentation = true;
     mThresholdCropping = false;
     mLungCropping = false;
+    mCroppingThreshold = -std::numeric_limits<float>::max();
+    mTileSize = 0;
     mMinimumIntensity = -std::numeric_limits<float>::max();
     mMaximumIntensity = std::numeric_limits<float>::max();
     // Blur has to be adapted to noise level in image
@@ -102,6 +106,14 @@ void TubeSegmentationAndCenterlineExtraction::enableAutomaticCropping(
     }
 }
 
+void TubeSegmentationAndCenterlineExtraction::setCroppingThreshold(float threshold) {
+    mCroppingThreshold = threshold;
+}
+
+void TubeSegmentationAndCenterlineExtraction::setTileSize(uint size) {
+    mTileSize = size;
+}
+
 ProcessObjectPort TubeSegmentationAndCenterlineExtraction::getSegmentationOutputPort() {
     return getOutputPort(0);
 }
@@ -114,64 +126,29 @@ ProcessObjectPort TubeSegmentationAndCenterlineExtraction::getTDFOutputPort() {
     return getOutputPort(2);
 }
 
-inline void floodFill(ImageAccess::pointer& access, Vector3ui size, Vector3i startPosition, std::vector<Vector3i>& largestObject) {
-    std::vector<Vector3i> thisObject;
-
-    std::stack<Vector3i> stack;
-    stack.push(startPosition);
-    uchar* segmentation = (uchar*)access->get();
-    while(!stack.empty()) {
-        Vector3i currentPosition = stack.top();
-        stack.pop();
-        thisObject.push_back(currentPosition);
-
-        for(int a = -1; a < 2; a++) {
-        for(int b = -1; b < 2; b++) {
-        for(int c = -1; c < 2; c++) {
-            Vector3i position = currentPosition + Vector3i(a,b,c);
-            try {
-                uchar value = access->getScalar(position); // need out of bounds check here
-                if(value == 1) {
-                    segmentation[position.x() + position.y()*size.x() + position.z()*size.x()*size.y()] = 0;
-                    stack.push(position);
-                }
-            } catch(Exception &e) {
-                // Out of bounds..
-            }
-        }}}
-    }
-
-    if(thisObject.size() > largestObject.size()) {
-        largestObject = thisObject;
-    }
-}
-
 inline void keepLargestObject(Segmentation::pointer segmentation, LineSet::pointer& centerlines) {
     ImageAccess::pointer access = segmentation->getImageAccess(ACCESS_READ_WRITE);
-    const int width = segmentation->getWidth();
-    const int height = segmentation->getHeight();
-    const int depth = segmentation->getDepth();
-    Vector3ui size = segmentation->getSize();
-
-    std::vector<Vector3i> largestObject;
+    const Vector3ui size = segmentation->getSize();
+    const std::size_t nrOfVoxels = (std::size_t)size.x()*size.y()*size.z();
     uchar* segmentationArray = (uchar*)access->get();
-    // Go through each voxel
-    for(int z = 0; z < depth; ++z) {
-    for(int y = 0; y < height; ++y) {
-    for(int x = 0; x < width; ++x) {
-        // If label found, do flood fill, count size, and keep all voxels in a structure
-        Vector3i position(x,y,z);
-        uchar value = segmentationArray[position.x() + position.y()*size.x() + position.z()*size.x()*size.y()];
-        if(value == 1) {
-            floodFill(access, size, position, largestObject);
+
+    std::vector<uint> labels(nrOfVoxels);
+    std::vector<ConnectedComponent> components = labelConnectedComponents(segmentationArray, labels.data(), size, true);
+    uint largestLabel = 0;
+    std::size_t largestSize = 0;
+    for(uint i = 0; i < components.size(); i++) {
+        if(components[i].size > largestSize) {
+            largestLabel = i + 1;
+            largestSize = components[i].size;
         }
-    }}}
+    }
 
-    Reporter::info() << "Size of largest object: " << largestObject.size() << Reporter::end;
+    Reporter::info() << "Size of largest object: " << largestSize << Reporter::end;
 
     // Store the largest object
-    for(Vector3i position : largestObject) {
-        segmentationArray[position.x() + position.y()*size.x() + position.z()*size.x()*size.y()] = 1;
+    #pragma omp parallel for
+    for(long long i = 0; i < (long long)nrOfVoxels; i++) {
+        segmentationArray[i] = largestLabel != 0 && labels[i] == largestLabel ? 1 : 0;
     }
 
     LineSet::pointer newCenterlines = LineSet::New();
@@ -199,6 +176,162 @@ inline void keepLargestObject(Segmentation::pointer segmentation, LineSet::point
     SceneGraph::setParentNode(centerlines, segmentation);
 }
 
+// Part of a volume which is processed separately. The core regions of the
+// tiles cover the volume without overlap, and each tile is the core plus a
+// halo, clamped to the volume. The volume is only split along the axes where
+// it is larger than the tile size.
+struct Tile {
+    Vector3ui offset;
+    Vector3ui size;
+    Vector3ui coreOffset;
+    Vector3ui coreSize;
+};
+
+static std::vector<Tile> createTiles(Vector3ui volumeSize, uint tileSize, uint halo) {
+    Vector3ui coreSize;
+    for(int i = 0; i < 3; i++) {
+        if(volumeSize[i] <= tileSize) {
+            coreSize[i] = volumeSize[i];
+        } else if(tileSize <= 2*halo) {
+            throw Exception("The tile size in TubeSegmentationAndCenterlineExtraction must be larger than " + std::to_string(2*halo) + " voxels");
+        } else {
+            coreSize[i] = tileSize - 2*halo;
+        }
+    }
+    const Vector3ui nrOfTiles = (volumeSize + coreSize - Vector3ui::Ones()).cwiseQuotient(coreSize);
+
+    std::vector<Tile> tiles;
+    for(uint z = 0; z < nrOfTiles.z(); z++) {
+    for(uint y = 0; y < nrOfTiles.y(); y++) {
+    for(uint x = 0; x < nrOfTiles.x(); x++) {
+        Tile tile;
+        tile.coreOffset = Vector3ui(x, y, z).cwiseProduct(coreSize);
+        tile.coreSize = (volumeSize - tile.coreOffset).cwiseMin(coreSize);
+        for(int i = 0; i < 3; i++) {
+            tile.offset[i] = tile.coreOffset[i] > halo ? tile.coreOffset[i] - halo : 0;
+            tile.size[i] = std::min(tile.coreOffset[i] + tile.coreSize[i] + halo, volumeSize[i]) - tile.offset[i];
+        }
+        tiles.push_back(tile);
+    }}}
+    return tiles;
+}
+
+// Copy a region of the volume to a new image on the host, placed as with Image::crop
+template <class T>
+static typename T::pointer extractRegion(Image::pointer volume, Vector3ui offset, Vector3ui size) {
+    const Vector3ui volumeSize = volume->getSize();
+    const std::size_t voxelSize = getSizeOfDataType(volume->getDataType(), volume->getNrOfComponents());
+    std::vector<char> data(voxelSize*size.x()*size.y()*size.z());
+    {
+        ImageAccess::pointer access = volume->getImageAccess(ACCESS_READ);
+        const char* volumeData = (const char*)access->get();
+        for(uint z = 0; z < size.z(); z++) {
+            for(uint y = 0; y < size.y(); y++) {
+                const std::size_t source = offset.x() + ((std::size_t)offset.y() + y + ((std::size_t)offset.z() + z)*volumeSize.y())*volumeSize.x();
+                memcpy(&data[voxelSize*(y + z*size.y())*size.x()], volumeData + voxelSize*source, voxelSize*size.x());
+            }
+        }
+    }
+
+    typename T::pointer region = T::New();
+    region->create(size, volume->getDataType(), volume->getNrOfComponents(), Host::getInstance(), data.data());
+    region->setSpacing(volume->getSpacing());
+    AffineTransformation::pointer transformation = AffineTransformation::New();
+    transformation->translation() = volume->getSpacing().cwiseProduct(offset.cast<float>());
+    region->getSceneGraphNode()->setTransformation(transformation);
+    SceneGraph::setParentNode(region, volume);
+    return region;
+}
+
+// Copy the core region of a processed tile to the volume. If the volume is
+// not valid, it is created on the host with the type of the tile.
+static void insertTileCore(Image::pointer tileImage, const Tile& tile, Image::pointer& volume, Vector3ui volumeSize) {
+    if(!volume.isValid()) {
+        volume = Image::New();
+        volume->create(volumeSize, tileImage->getDataType(), tileImage->getNrOfComponents());
+        volume->setSpacing(tileImage->getSpacing());
+    }
+    const std::size_t voxelSize = getSizeOfDataType(tileImage->getDataType(), tileImage->getNrOfComponents());
+    const Vector3ui coreStart = tile.coreOffset - tile.offset;
+    ImageAccess::pointer tileAccess = tileImage->getImageAccess(ACCESS_READ);
+    ImageAccess::pointer volumeAccess = volume->getImageAccess(ACCESS_READ_WRITE);
+    const char* tileData = (const char*)tileAccess->get();
+    char* volumeData = (char*)volumeAccess->get();
+    for(uint z = 0; z < tile.coreSize.z(); z++) {
+        for(uint y = 0; y < tile.coreSize.y(); y++) {
+            const std::size_t source = coreStart.x() + ((std::size_t)coreStart.y() + y + ((std::size_t)coreStart.z() + z)*tile.size.y())*tile.size.x();
+            const std::size_t destination = tile.coreOffset.x() + ((std::size_t)tile.coreOffset.y() + y + ((std::size_t)tile.coreOffset.z() + z)*volumeSize.y())*volumeSize.x();
+            memcpy(volumeData + voxelSize*destination, tileData + voxelSize*source, voxelSize*tile.coreSize.x());
+        }
+    }
+}
+
+// Number of voxels above the threshold in each slice along each axis
+template <class T>
+static void countVoxelsAboveThreshold(const T* data, Vector3ui size, float threshold, std::vector<std::size_t> counts[3]) {
+    for(int i = 0; i < 3; i++)
+        counts[i].assign(size[i], 0);
+    for(uint z = 0; z < size.z(); z++) {
+    for(uint y = 0; y < size.y(); y++) {
+    for(uint x = 0; x < size.x(); x++) {
+        if(data[x + ((std::size_t)y + (std::size_t)z*size.y())*size.x()] > threshold) {
+            counts[0][x]++;
+            counts[1][y]++;
+            counts[2][z]++;
+        }
+    }}}
+}
+
+// Distance from a voxel which the blur and the tube detection filters read
+uint TubeSegmentationAndCenterlineExtraction::getFilterRadius() {
+    return (uint)ceil(mMaximumRadius + 3*std::max(mStDevBlurSmall, mStDevBlurLarge)) + 1;
+}
+
+// The halo of the tiles has to contain the filter radius. The GVF spreads the
+// gradients over the whole volume, so its reach is not bounded, but near the
+// tubes it is dominated by the gradients of the tube walls. When the GVF is
+// used, the halo is therefore extended by three times the maximum radius. In
+// a converged GVF of a curved tube of radius 4, this keeps the difference to
+// the GVF of the whole volume at about 0.003 inside the tube and 0.025 outside.
+uint TubeSegmentationAndCenterlineExtraction::getHaloSize() {
+    uint halo = getFilterRadius();
+    if(mMaximumRadius >= 1.5)
+        halo += (uint)ceil(3*mMaximumRadius);
+    return halo;
+}
+
+Image::pointer TubeSegmentationAndCenterlineExtraction::cropWithThreshold(Image::pointer input, float threshold) {
+    const Vector3ui size = input->getSize();
+    std::vector<std::size_t> counts[3];
+    {
+        ImageAccess::pointer access = input->getImageAccess(ACCESS_READ);
+        switch(input->getDataType()) {
+            fastSwitchTypeMacro(countVoxelsAboveThreshold<FAST_TYPE>((const FAST_TYPE*)access->get(), size, threshold, counts));
+        }
+    }
+
+    // Keep the slices with at least 1% of the voxels above the threshold, and
+    // a margin so that tubes at the border are not cut
+    const uint margin = getFilterRadius();
+    Vector3ui offset, croppedSize;
+    for(int i = 0; i < 3; i++) {
+        const std::size_t sliceSize = (std::size_t)size.prod() / size[i];
+        int start = 0;
+        while(start < size[i] && counts[i][start] < sliceSize / 100)
+            start++;
+        int end = size[i] - 1;
+        while(end > start && counts[i][end] < sliceSize / 100)
+            end--;
+        if(start == size[i]) {
+            reportWarning() << "No voxels above the threshold " << threshold << ", the volume is not cropped" << Reporter::end;
+            return input;
+        }
+        offset[i] = std::max(start - (int)margin, 0);
+        croppedSize[i] = std::min(end + margin + 1, size[i]) - offset[i];
+    }
+    reportInfo() << "Cropping volume to offset " << offset.transpose() << " size " << croppedSize.transpose() << Reporter::end;
+    return extractRegion<Image>(input, offset, croppedSize);
+}
 
 void TubeSegmentationAndCenterlineExtraction::execute() {
     Image::pointer input = getStaticInputData<Image>();
@@ -207,7 +340,19 @@ void TubeSegmentationAndCenterlineExtraction::execute() {
     float smallestSpacing = spacing.minCoeff();
     float largestSpacing = spacing.maxCoeff();
 
-    // TODO automatic cropping
+    // The intensity range is found before cropping and tiling, so that it is
+    // the same for the whole volume
+    float minimumIntensity = mMinimumIntensity;
+    if(minimumIntensity == -std::numeric_limits<float>::max()) {
+        minimumIntensity = input->calculateMinimumIntensity();
+        std::cout << "min intensity " << minimumIntensity << std::endl;
+    }
+    float maximumIntensity = mMaximumIntensity;
+    if(maximumIntensity == std::numeric_limits<float>::max()) {
+        maximumIntensity = input->calculateMaximumIntensity();
+        std::cout << "max intensity " << maximumIntensity << std::endl;
+    }
+
     if(mLungCropping) {
         // Cut away 20% on all sides
         float fraction = 0.2;
@@ -225,13 +370,104 @@ void TubeSegmentationAndCenterlineExtraction::execute() {
 
         Image::pointer croppedImage = input->crop(Vector3ui(startX, startY, startZ), Vector3ui(sizeX, sizeY, sizeZ));
         input = croppedImage;
+    } else if(mThresholdCropping) {
+        float threshold = mCroppingThreshold;
+        if(threshold == -std::numeric_limits<float>::max())
+            threshold = (minimumIntensity + maximumIntensity)*0.5f;
+        input = cropWithThreshold(input, threshold);
     }
 
-    // If max radius is larger than 2.5 voxels
     Image::pointer gradients;
     Image::pointer largeTDF;
     Image::pointer largeRadius;
     Image::pointer GVFfield;
+    Image::pointer smallTDF;
+    Image::pointer smallRadius;
+    // When the volume is processed in tiles, the stitched volumes are on the
+    // host, and the rest of the steps are run on the host as well
+    const bool tiling = mTileSize > 0 && input->getSize().maxCoeff() > mTileSize;
+    if(tiling) {
+        runFiltersInTiles(input, minimumIntensity, maximumIntensity, gradients, GVFfield, smallTDF, smallRadius, largeTDF, largeRadius);
+    } else {
+        runFilters(input, minimumIntensity, maximumIntensity, gradients, GVFfield, smallTDF, smallRadius, largeTDF, largeRadius);
+    }
+
+    Image::pointer TDF;
+    Image::pointer vectorField;
+    Segmentation::pointer centerlineVolume;
+    LineSet::pointer centerline;
+    {
+        RidgeTraversalCenterlineExtraction::pointer centerlineExtraction = RidgeTraversalCenterlineExtraction::New();
+        if(tiling)
+            centerlineExtraction->setMainDevice(Host::getInstance());
+        if(smallTDF.isValid() && largeTDF.isValid()) {
+            // Both small and large TDF has been executed, need to merge the two.
+            TDF = largeTDF;
+            // First, extract centerlines from largeTDF and GVF
+            // Then extract centerlines from smallTDF using large centerlines as input
+            centerlineExtraction->setInputData(0, largeTDF);
+            centerlineExtraction->setInputData(1, GVFfield);
+            centerlineExtraction->setInputData(2, largeRadius);
+            centerlineExtraction->setInputData(3, smallTDF);
+            centerlineExtraction->setInputData(4, gradients);
+            centerlineExtraction->setInputData(5, smallRadius);
+            // TODO: Use only dilation for smallTDF
+            vectorField = GVFfield;
+        } else {
+            // Only small or large TDF has been used
+            if(smallTDF.isValid()) {
+                TDF = smallTDF;
+                centerlineExtraction->setInputData(0, smallTDF);
+                centerlineExtraction->setInputData(1, gradients);
+                centerlineExtraction->setInputData(2, smallRadius);
+                vectorField = gradients;
+            } else {
+                TDF = largeTDF;
+                centerlineExtraction->setInputData(0, largeTDF);
+                centerlineExtraction->setInputData(1, GVFfield);
+                centerlineExtraction->setInputData(2, largeRadius);
+                vectorField = GVFfield;
+            }
+        }
+        centerlineExtraction->update();
+        centerline = centerlineExtraction->getOutputData<LineSet>();
+        centerlineVolume = centerlineExtraction->getOutputData<Segmentation>(1);
+    }
+
+    // The centerline extraction holds no references to the intermediate
+    // volumes anymore, free the ones which the segmentation doesn't use
+    gradients = Image::pointer();
+    GVFfield = Image::pointer();
+    smallTDF = Image::pointer();
+    smallRadius = Image::pointer();
+    largeTDF = Image::pointer();
+    largeRadius = Image::pointer();
+
+    // Segmentation
+    Segmentation::pointer segmentationVolume = runSegmentation(centerlineVolume, vectorField, tiling);
+    vectorField = Image::pointer();
+
+    // TODO get largest segmentation object
+    reportInfo() << "Removing small objects..." << Reporter::end;
+    keepLargestObject(segmentationVolume, centerline);
+
+    setStaticOutputData<Segmentation>(0, segmentationVolume);
+    setStaticOutputData<LineSet>(1, centerline);
+    setStaticOutputData<Image>(2, TDF);
+}
+
+
+void TubeSegmentationAndCenterlineExtraction::runFilters(
+        Image::pointer input,
+        float minimumIntensity,
+        float maximumIntensity,
+        Image::pointer& gradients,
+        Image::pointer& GVFfield,
+        Image::pointer& smallTDF,
+        Image::pointer& smallRadius,
+        Image::pointer& largeTDF,
+        Image::pointer& largeRadius) {
+    // If max radius is larger than 2.5 voxels
     if(mMaximumRadius /*/ largestSpacing*/ >= 1.5) {
         std::cout << "Running large TDF" << std::endl;
         // Find large structures, if max radius is large enough
@@ -245,14 +481,14 @@ void TubeSegmentationAndCenterlineExtraction::execute() {
             filter->setOutputType(TYPE_FLOAT);
             filter->update();
             smoothedImage = filter->getOutputData<Image>();
-            smoothedImage->setSpacing(spacing);
+            smoothedImage->setSpacing(input->getSpacing());
         } else {
             smoothedImage = input;
         }
         reportInfo() << "finished smoothing" << Reporter::end;
 
         // Create gradients and cap intensity
-        GVFfield = createGradients(smoothedImage);
+        GVFfield = createGradients(smoothedImage, minimumIntensity, maximumIntensity);
         reportInfo() << "finished gradients" << Reporter::end;
 
         // GVF
@@ -263,8 +499,6 @@ void TubeSegmentationAndCenterlineExtraction::execute() {
     }
 
     // If min radius is larger than 2.5 voxels
-    Image::pointer smallTDF;
-    Image::pointer smallRadius;
     if(mMinimumRadius /*/ smallestSpacing*/ < 1.5) {
         std::cout << "Running small TDF" << std::endl;
         // Find small structures
@@ -278,75 +512,65 @@ void TubeSegmentationAndCenterlineExtraction::execute() {
             filter->setOutputType(TYPE_FLOAT);
             filter->update();
             smoothedImage = filter->getOutputData<Image>();
-            smoothedImage->setSpacing(spacing);
+            smoothedImage->setSpacing(input->getSpacing());
         } else {
             smoothedImage = input;
         }
 
         // Create gradients and cap intensity
-        gradients = createGradients(smoothedImage);
+        gradients = createGradients(smoothedImage, minimumIntensity, maximumIntensity);
 
         // TDF
         runTubeDetectionFilter(gradients, mMinimumRadius, 1.5, smallTDF, smallRadius);
     }
+}
 
-    RidgeTraversalCenterlineExtraction::pointer centerlineExtraction = RidgeTraversalCenterlineExtraction::New();
-    Image::pointer TDF;
-    InverseGradientSegmentation::pointer segmentation = InverseGradientSegmentation::New();
-    LineSet::pointer centerline;
-    if(smallTDF.isValid() && largeTDF.isValid()) {
-        // Both small and large TDF has been executed, need to merge the two.
-        TDF = largeTDF;
-        // First, extract centerlines from largeTDF and GVF
-        // Then extract centerlines from smallTDF using large centerlines as input
-        centerlineExtraction->setInputData(0, largeTDF);
-        centerlineExtraction->setInputData(1, GVFfield);
-        centerlineExtraction->setInputData(2, largeRadius);
-        centerlineExtraction->setInputData(3, smallTDF);
-        centerlineExtraction->setInputData(4, gradients);
-        centerlineExtraction->setInputData(5, smallRadius);
-        centerlineExtraction->update();
-        centerline = centerlineExtraction->getOutputData<LineSet>();
-
-        // Segmentation
-        // TODO: Use only dilation for smallTDF
-        segmentation->setInputConnection(centerlineExtraction->getOutputPort(1));
-        segmentation->setInputData(1, GVFfield);
-        segmentation->update();
-    } else {
-        // Only small or large TDF has been used
-        if(smallTDF.isValid()) {
-            TDF = smallTDF;
-            centerlineExtraction->setInputData(0, smallTDF);
-            centerlineExtraction->setInputData(1, gradients);
-            centerlineExtraction->setInputData(2, smallRadius);
-        } else {
-            TDF = largeTDF;
-            centerlineExtraction->setInputData(0, largeTDF);
-            centerlineExtraction->setInputData(1, GVFfield);
-            centerlineExtraction->setInputData(2, largeRadius);
-            gradients = GVFfield;
+void TubeSegmentationAndCenterlineExtraction::runFiltersInTiles(
+        Image::pointer input,
+        float minimumIntensity,
+        float maximumIntensity,
+        Image::pointer& gradients,
+        Image::pointer& GVFfield,
+        Image::pointer& smallTDF,
+        Image::pointer& smallRadius,
+        Image::pointer& largeTDF,
+        Image::pointer& largeRadius) {
+    const Vector3ui size = input->getSize();
+    std::vector<Tile> tiles = createTiles(size, mTileSize, getHaloSize());
+    reportInfo() << "Processing the volume in " << tiles.size() << " tiles" << Reporter::end;
+
+    // The results are stitched on the host
+    Image::pointer* volumes[6] = {&gradients, &GVFfield, &smallTDF, &smallRadius, &largeTDF, &largeRadius};
+    for(int i = 0; i < tiles.size(); i++) {
+        // The images of the tile are freed at the end of each iteration
+        Image::pointer tile = extractRegion<Image>(input, tiles[i].offset, tiles[i].size);
+        Image::pointer tileResults[6];
+        runFilters(tile, minimumIntensity, maximumIntensity, tileResults[0], tileResults[1], tileResults[2], tileResults[3], tileResults[4], tileResults[5]);
+        for(int j = 0; j < 6; j++) {
+            if(tileResults[j].isValid())
+                insertTileCore(tileResults[j], tiles[i], *volumes[j], size);
         }
-        centerlineExtraction->update();
-        centerline = centerlineExtraction->getOutputData<LineSet>();
-
-        // Segmentation
-        segmentation->setInputConnection(centerlineExtraction->getOutputPort(1));
-        segmentation->setInputData(1, gradients);
-        segmentation->update();
     }
-
-    Segmentation::pointer segmentationVolume = segmentation->getOutputData<Segmentation>();
-
-    // TODO get largest segmentation object
-    reportInfo() << "Removing small objects..." << Reporter::end;
-    keepLargestObject(segmentationVolume, centerline);
-
-    setStaticOutputData<Segmentation>(0, segmentationVolume);
-    setStaticOutputData<LineSet>(1, centerline);
-    setStaticOutputData<Image>(2, TDF);
+    for(int i = 0; i < 6; i++) {
+        if(volumes[i]->isValid())
+            SceneGraph::setParentNode(*volumes[i], input);
+    }
 }
 
+// The segmentation grows from the centerlines along increasing vector field
+// magnitude until it converges, which is not bounded by the maximum radius,
+// so it is not run in tiles. When the filters have been run in tiles, it is
+// run on the host, where only the voxels at the front of the growing are
+// processed in each iteration.
+Segmentation::pointer TubeSegmentationAndCenterlineExtraction::runSegmentation(Segmentation::pointer centerlines, Image::pointer vectorField, bool onHost) {
+    InverseGradientSegmentation::pointer segmentation = InverseGradientSegmentation::New();
+    if(onHost)
+        segmentation->setMainDevice(Host::getInstance());
+    segmentation->setInputData(0, centerlines);
+    segmentation->setInputData(1, vectorField);
+    segmentation->update();
+    return segmentation->getOutputData<Segmentation>();
+}
 
 Image::pointer TubeSegmentationAndCenterlineExtraction::runGradientVectorFlow(Image::pointer vectorField) {
     OpenCLDevice::pointer device = getMainDevice();
@@ -362,7 +586,7 @@ Image::pointer TubeSegmentationAndCenterlineExtraction::runGradientVectorFlow(Im
     return gvf->getOutputData<Image>();
 }
 
-Image::pointer TubeSegmentationAndCenterlineExtraction::createGradients(Image::pointer image) {
+Image::pointer TubeSegmentationAndCenterlineExtraction::createGradients(Image::pointer image, float minimumIntensity, float maximumIntensity) {
     OpenCLDevice::pointer device = getMainDevice();
     Image::pointer floatImage = Image::New();
     floatImage->create(image->getWidth(), image->getHeight(), image->getDepth(), TYPE_FLOAT, 1);
@@ -381,20 +605,6 @@ Image::pointer TubeSegmentationAndCenterlineExtraction::createGradients(Image::p
     // Convert to float 0-1
     cl::Kernel toFloatKernel(program, "toFloat");
 
-    float minimumIntensity;
-    if(mMinimumIntensity > -std::numeric_limits<float>::max()) {
-        minimumIntensity = mMinimumIntensity;
-    } else {
-        minimumIntensity = image->calculateMinimumIntensity();
-        std::cout << "min intensity " << minimumIntensity << std::endl;
-    }
-    float maximumIntensity;
-    if(mMaximumIntensity < std::numeric_limits<float>::max()) {
-        maximumIntensity = mMaximumIntensity;
-    } else {
-        maximumIntensity = image->calculateMaximumIntensity();
-        std::cout << "max intensity " << maximumIntensity << std::endl;
-    }
     std::cout << image->getSize().transpose() << std::endl;
 
     toFloatKernel.setArg(0, *(access->get3DImage()));
@@ -3,6 +3,7 @@
 
 #include "FAST/ProcessObject.hpp"
 #include "FAST/Data/Image.hpp"
+#include "FAST/Data/Segmentation.hpp"
 
 namespace fast {
 
@@ -25,6 +26,24 @@ class TubeSegmentationAndCenterlineExtraction : public ProcessObject {
         // TODO move cropping out of this algorithm
         void disableAutomaticCropping();
         void enableAutomaticCropping(bool lungCropping = false);
+        /**
+         * The threshold cropping removes the slices on each side with less
+         * than 1% of the voxels above this threshold. Default is the middle
+         * of the intensity range.
+         */
+        void setCroppingThreshold(float threshold);
+        /**
+         * Run the blur, GVF and tube detection filters on overlapping tiles
+         * of at most size^3 voxels, so that their device memory is bounded by
+         * the tile size. The volume is only split along the axes where it is
+         * larger than the tile size. The tiles overlap by the maximum radius
+         * and the blur, and three times the maximum radius for the GVF, which
+         * is not bounded but approximated at the tile borders. The results
+         * are stitched together on the host, and the centerline extraction
+         * and the segmentation are run on the host on the whole volume.
+         * 0 (default) processes the whole volume at once on the device.
+         */
+        void setTileSize(uint size);
         ProcessObjectPort getSegmentationOutputPort();
         ProcessObjectPort getCenterlineOutputPort();
         ProcessObjectPort getTDFOutputPort();
@@ -32,7 +51,13 @@ class TubeSegmentationAndCenterlineExtraction : public ProcessObject {
         TubeSegmentationAndCenterlineExtraction();
         void execute();
 
-        Image::pointer createGradients(Image::pointer image);
+        void runFilters(Image::pointer input, float minimumIntensity, float maximumIntensity, Image::pointer& gradients, Image::pointer& GVFfield, Image::pointer& smallTDF, Image::pointer& smallRadius, Image::pointer& largeTDF, Image::pointer& largeRadius);
+        void runFiltersInTiles(Image::pointer input, float minimumIntensity, float maximumIntensity, Image::pointer& gradients, Image::pointer& GVFfield, Image::pointer& smallTDF, Image::pointer& smallRadius, Image::pointer& largeTDF, Image::pointer& largeRadius);
+        Segmentation::pointer runSegmentation(Segmentation::pointer centerlines, Image::pointer vectorField, bool onHost);
+        Image::pointer cropWithThreshold(Image::pointer input, float threshold);
+        uint getFilterRadius();
+        uint getHaloSize();
+        Image::pointer createGradients(Image::pointer image, float minimumIntensity, float maximumIntensity);
         void runTubeDetectionFilter(Image::pointer gradients, float minimumRadius, float maximumRadius, Image::pointer& TDF, Image::pointer& radius);
         void runNonCircularTubeDetectionFilter(Image::pointer gradients, float minimumRadius, float maximumRadius, Image::pointer& TDF, Image::pointer& radius);
         Image::pointer runGradientVectorFlow(Image::pointer vectorField);
@@ -41,6 +66,8 @@ class TubeSegmentationAndCenterlineExtraction : public ProcessObject {
 
         // General
         bool mSegmentation, mThresholdCropping, mLungCropping;
+        float mCroppingThreshold;
+        uint mTileSize;
         float mStDevBlurSmall, mStDevBlurLarge; // This should be tuned to the amount of noise in the image.
         float mMinimumIntensity, mMaximumIntensity; // The voxel intensities are capped to these values
         bool mExtractDarkStructures; // true and this extract dark structures, false and it extract bright structures
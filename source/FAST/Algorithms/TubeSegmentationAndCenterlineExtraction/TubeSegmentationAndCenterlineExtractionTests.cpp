@@ -1,5 +1,7 @@
 #include "FAST/Testing.hpp"
 #include "TubeSegmentationAndCenterlineExtraction.hpp"
+#include "InverseGradientSegmentation.hpp"
+#include "FAST/DeviceManager.hpp"
 #include "FAST/Importers/ImageFileImporter.hpp"
 #include "FAST/Visualization/SliceRenderer/SliceRenderer.hpp"
 #include "FAST/Visualization/LineRenderer/LineRenderer.hpp"
@@ -7,6 +9,8 @@
 #include "FAST/Visualization/MeshRenderer/MeshRenderer.hpp"
 #include "FAST/Visualization/SimpleWindow.hpp"
 #include "FAST/Algorithms/ImageCropper/ImageCropper.hpp"
+#include "FAST/Data/Segmentation.hpp"
+#include "FAST/Data/LineSet.hpp"
 
 namespace fast {
 
@@ -92,4 +96,166 @@ TEST_CASE("TSF Airway", "[tsf][airway][visual][broken_on_mac]") {
     tubeExtraction->getRuntime()->print();
 }
 
+// Bright tube along the z axis with a radius of 4 voxels. If curved, the
+// center of the tube moves back and forth in the x direction.
+static Image::pointer createTubeVolume(uint width, uint height, uint depth, bool curved = false) {
+    std::vector<float> data(width*height*depth);
+    for(uint z = 0; z < depth; z++) {
+    for(uint y = 0; y < height; y++) {
+    for(uint x = 0; x < width; x++) {
+        const float centerX = width*0.5f + (curved ? 6.0f*sin(z*0.08f) : 0.0f);
+        const float dx = x - centerX, dy = y - height*0.5f;
+        data[x + (y + z*height)*width] = dx*dx + dy*dy <= 16 ? 1.0f : 0.0f;
+    }}}
+    Image::pointer image = Image::New();
+    image->create(width, height, depth, TYPE_FLOAT, 1, Host::getInstance(), data.data());
+    return image;
+}
+
+TEST_CASE("TSF with threshold cropping and tiles", "[tsf]") {
+    Image::pointer image = createTubeVolume(40, 40, 120);
+
+    TubeSegmentationAndCenterlineExtraction::pointer tubeExtraction = TubeSegmentationAndCenterlineExtraction::New();
+    tubeExtraction->setInputData(image);
+    tubeExtraction->extractBrightTubes();
+    tubeExtraction->setMinimumIntensity(0);
+    tubeExtraction->setMaximumIntensity(1);
+    tubeExtraction->setMinimumRadius(2);
+    tubeExtraction->setMaximumRadius(5);
+    tubeExtraction->enableAutomaticCropping();
+    tubeExtraction->setTileSize(64);
+    Segmentation::pointer segmentation = tubeExtraction->getOutputData<Segmentation>(0);
+    LineSet::pointer centerlines = tubeExtraction->getOutputData<LineSet>(1);
+    tubeExtraction->update();
+
+    // The empty sides of the volume are cropped away
+    CHECK(segmentation->getWidth() < 40);
+    CHECK(segmentation->getHeight() < 40);
+    CHECK(segmentation->getDepth() == 120);
+    CHECK(centerlines->getAccess(ACCESS_READ)->getNrOfLines() > 0);
+
+    std::size_t nrOfSegmentedVoxels = 0;
+    ImageAccess::pointer access = segmentation->getImageAccess(ACCESS_READ);
+    const uchar* data = (const uchar*)access->get();
+    for(uint i = 0; i < segmentation->getWidth()*segmentation->getHeight()*segmentation->getDepth(); i++) {
+        if(data[i] > 0)
+            nrOfSegmentedVoxels++;
+    }
+    CHECK(nrOfSegmentedVoxels > 0);
+}
+
+static Image::pointer runTDF(Image::pointer image, uint tileSize) {
+    TubeSegmentationAndCenterlineExtraction::pointer tubeExtraction = TubeSegmentationAndCenterlineExtraction::New();
+    tubeExtraction->setInputData(image);
+    tubeExtraction->extractBrightTubes();
+    tubeExtraction->setMinimumIntensity(0);
+    tubeExtraction->setMaximumIntensity(1);
+    tubeExtraction->setMinimumRadius(2);
+    tubeExtraction->setMaximumRadius(5);
+    tubeExtraction->setTileSize(tileSize);
+    Image::pointer TDF = tubeExtraction->getOutputData<Image>(2);
+    tubeExtraction->update();
+    return TDF;
+}
+
+TEST_CASE("TSF with tiles gives the same TDF as without tiles", "[tsf]") {
+    // The tube is curved, so that the GVF differs along the z axis, and the
+    // volume is split in tiles along the z axis only
+    Image::pointer image = createTubeVolume(40, 40, 120, true);
+    Image::pointer TDF = runTDF(image, 0);
+    Image::pointer tiledTDF = runTDF(image, 64);
+    REQUIRE(tiledTDF->getSize() == TDF->getSize());
+
+    ImageAccess::pointer access = TDF->getImageAccess(ACCESS_READ);
+    ImageAccess::pointer tiledAccess = tiledTDF->getImageAccess(ACCESS_READ);
+    const float* data = (const float*)access->get();
+    const float* tiledData = (const float*)tiledAccess->get();
+    float maxDifference = 0;
+    for(uint i = 0; i < 40*40*120; i++)
+        maxDifference = std::max(maxDifference, std::fabs(data[i] - tiledData[i]));
+    // The GVF is approximated at the tile borders
+    CHECK(maxDifference < 0.02f);
+}
+
+TEST_CASE("TSF with tiles smaller than the halo throws exception", "[tsf]") {
+    TubeSegmentationAndCenterlineExtraction::pointer tubeExtraction = TubeSegmentationAndCenterlineExtraction::New();
+    tubeExtraction->setInputData(createTubeVolume(40, 40, 40));
+    tubeExtraction->setMinimumRadius(2);
+    tubeExtraction->setMaximumRadius(5);
+    tubeExtraction->setTileSize(8);
+    CHECK_THROWS(tubeExtraction->update());
+}
+
+// Centerline along the z axis in the middle of a size^3 volume, and a vector
+// field pointing towards it with the largest magnitude at the given radius
+static void createTubeCenterlineAndVectorField(int size, float radius, Segmentation::pointer& centerline, Image::pointer& vectorField) {
+    std::vector<uchar> centerlineData(size*size*size, 0);
+    std::vector<float> vectorFieldData(size*size*size*3, 0.0f);
+    const int center = size/2;
+    for(int z = 0; z < size; z++) {
+    for(int y = 0; y < size; y++) {
+    for(int x = 0; x < size; x++) {
+        const int i = x + (y + z*size)*size;
+        const float dx = x - center, dy = y - center;
+        const float distance = std::sqrt(dx*dx + dy*dy);
+        if(distance == 0) {
+            centerlineData[i] = 1;
+            continue;
+        }
+        const float magnitude = distance <= radius ? distance / radius : radius / distance;
+        vectorFieldData[i*3] = -dx / distance * magnitude;
+        vectorFieldData[i*3 + 1] = -dy / distance * magnitude;
+    }}}
+    centerline = Segmentation::New();
+    centerline->create(Vector3ui(size, size, size), TYPE_UINT8, 1, Host::getInstance(), centerlineData.data());
+    vectorField = Image::New();
+    vectorField->create(Vector3ui(size, size, size), TYPE_FLOAT, 3, Host::getInstance(), vectorFieldData.data());
+}
+
+static std::vector<uchar> runInverseGradientSegmentation(Segmentation::pointer centerline, Image::pointer vectorField, ExecutionDevice::pointer device) {
+    InverseGradientSegmentation::pointer segmentation = InverseGradientSegmentation::New();
+    segmentation->setMainDevice(device);
+    segmentation->setInputData(0, centerline);
+    segmentation->setInputData(1, vectorField);
+    Segmentation::pointer output = segmentation->getOutputData<Segmentation>();
+    segmentation->update();
+    ImageAccess::pointer access = output->getImageAccess(ACCESS_READ);
+    const uchar* data = (const uchar*)access->get();
+    return std::vector<uchar>(data, data + output->getWidth()*output->getHeight()*output->getDepth());
+}
+
+TEST_CASE("InverseGradientSegmentation on Host grows from the centerline to the tube wall", "[tsf]") {
+    const int size = 32;
+    Segmentation::pointer centerline;
+    Image::pointer vectorField;
+    createTubeCenterlineAndVectorField(size, 6, centerline, vectorField);
+    std::vector<uchar> result = runInverseGradientSegmentation(centerline, vectorField, Host::getInstance());
+
+    const int z = size/2, center = size/2;
+    CHECK(result[center + (center + z*size)*size] == 1);
+    CHECK(result[center + 4 + (center + z*size)*size] == 1);
+    CHECK(result[center + (center - 4 + z*size)*size] == 1);
+    CHECK(result[center + 9 + (center + z*size)*size] == 0);
+    CHECK(result[center + (center - 9 + z*size)*size] == 0);
+}
+
+TEST_CASE("InverseGradientSegmentation on OpenCL devices gives the same result as on Host", "[tsf]") {
+    Segmentation::pointer centerline;
+    Image::pointer vectorField;
+    createTubeCenterlineAndVectorField(32, 6, centerline, vectorField);
+    std::vector<uchar> host = runInverseGradientSegmentation(centerline, vectorField, Host::getInstance());
+
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        std::vector<uchar> device = runInverseGradientSegmentation(centerline, vectorField, devices[i]);
+        std::size_t nrOfDifferentVoxels = 0;
+        for(int j = 0; j < host.size(); j++) {
+            if(device[j] != host[j])
+                nrOfDifferentVoxels++;
+        }
+        CHECK(nrOfDifferentVoxels == 0);
+    }
+}
+
 }
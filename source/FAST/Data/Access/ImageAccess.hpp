@@ -3,6 +3,7 @@
 
 #include "FAST/SmartPointers.hpp"
 #include "FAST/Data/DataTypes.hpp"
+#include "FAST/Data/Access/ImageView.hpp"
 
 namespace fast {
 
@@ -12,12 +13,26 @@ class ImageAccess {
     public:
         ImageAccess(void* data, SharedPointer<Image> image);
         void* get();
-        float getScalar(uint position, uchar channel = 0) const;
+        float getScalar(std::size_t position, uchar channel = 0) const;
         float getScalar(VectorXi position, uchar channel = 0) const;
         Vector4f getVector(VectorXi position) const;
-        void setScalar(uint position, float value, uchar channel = 0);
+        void setScalar(std::size_t position, float value, uchar channel = 0);
         void setScalar(VectorXi position, float value, uchar channel = 0);
         void setVector(VectorXi position, Vector4f value);
+        /**
+         * Typed view of the data, see ImageView. Throws if T is not the C
+         * type of the image data, or Components is not the number of
+         * components of the image.
+         */
+        template <class T, int Components>
+        ImageView<T, Components> getView();
+        /**
+         * Call visitor(view) with an ImageView of the data type of the image.
+         * The type is switched on once, and visitor is compiled for each
+         * type, so it can loop over the data with typed access.
+         */
+        template <int Components, class Visitor>
+        void visit(Visitor& visitor);
         void release();
         ~ImageAccess();
 		typedef UniquePointer<ImageAccess> pointer;
@@ -27,8 +42,25 @@ class ImageAccess {
         void* mData;
 
         SharedPointer<Image> mImage;
+        Vector3i mSize;
+        DataType mDataType;
+        int mNrOfComponents;
 };
 
+template <class T, int Components>
+ImageView<T, Components> ImageAccess::getView() {
+    if(!isCTypeOf<T>(mDataType) || Components != mNrOfComponents)
+        throw Exception("The type or number of components of the ImageView does not match the image");
+    return ImageView<T, Components>((T*)mData, mSize, mDataType);
+}
+
+template <int Components, class Visitor>
+void ImageAccess::visit(Visitor& visitor) {
+    switch(mDataType) {
+        fastSwitchTypeMacro(visitor(getView<FAST_TYPE, Components>()))
+    }
+}
+
 } // end namespace fast
 
 
@@ -0,0 +1,165 @@
+#ifndef IMAGE_VIEW_HPP_
+#define IMAGE_VIEW_HPP_
+
+#include "FAST/Data/DataTypes.hpp"
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+
+namespace fast {
+
+// True if T is the C type used for data of the given type
+template <class T>
+inline bool isCTypeOf(DataType type) { return false; }
+template <>
+inline bool isCTypeOf<float>(DataType type) { return type == TYPE_FLOAT; }
+template <>
+inline bool isCTypeOf<char>(DataType type) { return type == TYPE_INT8; }
+template <>
+inline bool isCTypeOf<uchar>(DataType type) { return type == TYPE_UINT8; }
+template <>
+inline bool isCTypeOf<short>(DataType type) { return type == TYPE_INT16 || type == TYPE_SNORM_INT16; }
+template <>
+inline bool isCTypeOf<ushort>(DataType type) { return type == TYPE_UINT16 || type == TYPE_UNORM_INT16; }
+
+/**
+ * Iterator with a constant stride in elements, for instance over one channel
+ * of all voxels, or over the voxels of a row or column.
+ */
+template <class T>
+class StridedIterator {
+    public:
+        StridedIterator(T* data, std::ptrdiff_t stride) : mData(data), mStride(stride) {};
+        T& operator*() const { return *mData; };
+        T& operator[](std::ptrdiff_t i) const { return mData[i*mStride]; };
+        StridedIterator& operator++() { mData += mStride; return *this; };
+        StridedIterator& operator+=(std::ptrdiff_t i) { mData += i*mStride; return *this; };
+        bool operator==(const StridedIterator& other) const { return mData == other.mData; };
+        bool operator!=(const StridedIterator& other) const { return mData != other.mData; };
+        T* get() const { return mData; };
+    private:
+        T* mData;
+        std::ptrdiff_t mStride;
+};
+
+template <class T, int Components>
+class ImageView;
+
+/**
+ * Iterator over the 26 neighbors of a voxel, or the 8 neighbors in a 2D
+ * image. Neighbor i has the offset (i%3-1, (i/3)%3-1, i/9-1). The neighbors
+ * are not bounds checked.
+ */
+template <class T, int Components>
+class NeighborhoodIterator {
+    public:
+        NeighborhoodIterator(const ImageView<T, Components>* view, Vector3i position, int neighbor) :
+            mView(view), mPosition(position), mNeighbor(neighbor) {
+            if(mNeighbor == 13)
+                mNeighbor++;
+        };
+        NeighborhoodIterator& operator++() {
+            mNeighbor++;
+            if(mNeighbor == 13)
+                mNeighbor++;
+            return *this;
+        };
+        bool operator!=(const NeighborhoodIterator& other) const { return mNeighbor != other.mNeighbor; };
+        bool operator==(const NeighborhoodIterator& other) const { return mNeighbor == other.mNeighbor; };
+        Vector3i getOffset() const { return Vector3i(mNeighbor % 3 - 1, (mNeighbor / 3) % 3 - 1, mNeighbor / 9 - 1); };
+        Vector3i getPosition() const { return mPosition + getOffset(); };
+        // First component of the neighbor
+        T& operator*() const { return (*mView)(getPosition()); };
+        // Components of the neighbor converted as ImageView::getVector
+        Eigen::Matrix<float, Components, 1> getVector() const { return mView->getVector(getPosition()); };
+    private:
+        const ImageView<T, Components>* mView;
+        Vector3i mPosition;
+        int mNeighbor;
+};
+
+/**
+ * Typed view of the data of an image on the host, created with
+ * ImageAccess::getView or ImageAccess::visit. T is the C type of the data
+ * and Components the number of components, so the addresses are computed
+ * without any type switch or bounds check, and the accessors can be inlined
+ * in the loops of host algorithms.
+ *
+ * operator() gives the stored values. getScalar and getVector convert the
+ * values to float as ImageAccess::getScalar, that is, TYPE_SNORM_INT16 and
+ * TYPE_UNORM_INT16 values are normalized.
+ *
+ * The view is only valid while the ImageAccess it was created from exists.
+ */
+template <class T, int Components = 1>
+class ImageView {
+    public:
+        typedef T ValueType;
+        static const int NrOfComponents = Components;
+        typedef NeighborhoodIterator<T, Components> Neighborhood;
+
+        ImageView(T* data, Vector3i size, DataType type) : mData(data), mSize(size) {
+            mStrideY = (std::ptrdiff_t)size.x()*Components;
+            mStrideZ = mStrideY*size.y();
+            mScale = 1.0f;
+            mMinimum = -std::numeric_limits<float>::max();
+            if(type == TYPE_SNORM_INT16) {
+                mScale = 1.0f / 32767.0f;
+                mMinimum = -1.0f;
+            } else if(type == TYPE_UNORM_INT16) {
+                mScale = 1.0f / 65535.0f;
+            }
+        };
+        T* get() const { return mData; };
+        Vector3i getSize() const { return mSize; };
+        std::size_t getNrOfVoxels() const { return (std::size_t)mSize.x()*mSize.y()*mSize.z(); };
+        bool isInside(const Vector3i& position) const {
+            return (position.array() >= 0).all() && (position.array() < mSize.array()).all();
+        };
+        // Index of the first component of the voxel in the data
+        std::size_t getIndex(int x, int y, int z = 0) const {
+            return (std::size_t)(x*Components + y*mStrideY + z*mStrideZ);
+        };
+        T& operator()(int x, int y, int z = 0, int channel = 0) const {
+            return mData[x*Components + y*mStrideY + z*mStrideZ + channel];
+        };
+        T& operator()(const Vector3i& position, int channel = 0) const {
+            return (*this)(position.x(), position.y(), position.z(), channel);
+        };
+        // Value of voxel number i in the data
+        T& operator[](std::size_t i) const { return mData[i*Components]; };
+        float toFloat(T value) const { return std::max(mMinimum, value*mScale); };
+        float getScalar(const Vector3i& position, int channel = 0) const {
+            return toFloat((*this)(position, channel));
+        };
+        float getScalar(std::size_t i, int channel = 0) const {
+            return toFloat(mData[i*Components + channel]);
+        };
+        Eigen::Matrix<float, Components, 1> getVector(const Vector3i& position) const {
+            const T* voxel = &(*this)(position);
+            Eigen::Matrix<float, Components, 1> vector;
+            for(int i = 0; i < Components; i++)
+                vector[i] = toFloat(voxel[i]);
+            return vector;
+        };
+        // One channel of all the voxels
+        StridedIterator<T> beginChannel(int channel = 0) const { return StridedIterator<T>(mData + channel, Components); };
+        StridedIterator<T> endChannel(int channel = 0) const { return StridedIterator<T>(mData + channel + getNrOfVoxels()*Components, Components); };
+        StridedIterator<T> beginRow(int y, int z = 0, int channel = 0) const { return StridedIterator<T>(&(*this)(0, y, z, channel), Components); };
+        StridedIterator<T> endRow(int y, int z = 0, int channel = 0) const { return StridedIterator<T>(&(*this)(mSize.x(), y, z, channel), Components); };
+        StridedIterator<T> beginColumn(int x, int z = 0, int channel = 0) const { return StridedIterator<T>(&(*this)(x, 0, z, channel), mStrideY); };
+        StridedIterator<T> endColumn(int x, int z = 0, int channel = 0) const { return StridedIterator<T>(&(*this)(x, mSize.y(), z, channel), mStrideY); };
+        Neighborhood beginNeighborhood(const Vector3i& position) const { return Neighborhood(this, position, mSize.z() > 1 ? 0 : 9); };
+        Neighborhood endNeighborhood(const Vector3i& position) const { return Neighborhood(this, position, mSize.z() > 1 ? 27 : 18); };
+    private:
+        T* mData;
+        Vector3i mSize;
+        std::ptrdiff_t mStrideY;
+        std::ptrdiff_t mStrideZ;
+        float mScale;
+        float mMinimum;
+};
+
+} // end namespace fast
+
+#endif
@@ -4,12 +4,14 @@
 namespace fast {
 
 MeshAccess::MeshAccess(
-        std::vector<MeshVertex>* vertices,
-        std::vector<Vector3ui>* triangles,
+        std::vector<float>* positions,
+        std::vector<float>* normals,
+        std::vector<uint>* indices,
         SharedPointer<Mesh> mesh) {
-    mVertices = vertices;
-    mTriangles = triangles;
-    mMesh = mesh;;
+    mPositions = positions;
+    mNormals = normals;
+    mIndices = indices;
+    mMesh = mesh;
 }
 
 void MeshAccess::release() {
@@ -20,23 +22,66 @@ MeshAccess::~MeshAccess() {
 	release();
 }
 
+uint MeshAccess::getNrOfVertices() const {
+    return mPositions->size()/3;
+}
+
+uint MeshAccess::getNrOfTriangles() const {
+    return mIndices->size()/3;
+}
+
+float* MeshAccess::getPositions() {
+    return mPositions->data();
+}
+
+float* MeshAccess::getNormals() {
+    return mNormals->data();
+}
+
+uint* MeshAccess::getIndices() {
+    return mIndices->data();
+}
+
+Vector3f MeshAccess::getPosition(uint i) {
+    return Vector3f((*mPositions)[i*3], (*mPositions)[i*3+1], (*mPositions)[i*3+2]);
+}
+
+Vector3f MeshAccess::getNormal(uint i) {
+    return Vector3f((*mNormals)[i*3], (*mNormals)[i*3+1], (*mNormals)[i*3+2]);
+}
+
+std::vector<uint> MeshAccess::getVertexTriangles(uint i) {
+    mMesh->createAdjacency();
+    return std::vector<uint>(
+            mMesh->mAdjacency.begin() + mMesh->mAdjacencyOffsets[i],
+            mMesh->mAdjacency.begin() + mMesh->mAdjacencyOffsets[i+1]
+    );
+}
 
 MeshVertex MeshAccess::getVertex(uint i) {
-    return (*mVertices)[i];
+    MeshVertex vertex;
+    vertex.position = getPosition(i);
+    vertex.normal = getNormal(i);
+    vertex.triangles = getVertexTriangles(i);
+    return vertex;
 }
 
 Vector3ui MeshAccess::getTriangle(uint i) {
-    return (*mTriangles)[i];
+    return Vector3ui((*mIndices)[i*3], (*mIndices)[i*3+1], (*mIndices)[i*3+2]);
 }
 
 std::vector<MeshVertex> MeshAccess::getVertices() {
-    std::vector<MeshVertex> copy = *mVertices;
-    return copy;
+    std::vector<MeshVertex> vertices(getNrOfVertices());
+    for(uint i = 0; i < vertices.size(); i++)
+        vertices[i] = getVertex(i);
+    return vertices;
 }
 
 std::vector<Vector3ui> MeshAccess::getTriangles() {
-    std::vector<Vector3ui> copy = *mTriangles;
-    return copy;
+    std::vector<Vector3ui> triangles(getNrOfTriangles());
+    for(uint i = 0; i < triangles.size(); i++)
+        triangles[i] = getTriangle(i);
+    return triangles;
 }
 
 } // end namespace fast
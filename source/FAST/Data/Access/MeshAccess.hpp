@@ -12,7 +12,21 @@ class Mesh;
 
 class MeshAccess {
     public:
-        MeshAccess(std::vector<MeshVertex>* vertices, std::vector<Vector3ui>* triangles, SharedPointer<Mesh> mesh);
+        MeshAccess(std::vector<float>* positions, std::vector<float>* normals, std::vector<uint>* indices, SharedPointer<Mesh> mesh);
+        uint getNrOfVertices() const;
+        uint getNrOfTriangles() const;
+        /**
+         * Contiguous arrays with three floats for each vertex and three
+         * vertex indices for each triangle. They can be written to with
+         * ACCESS_READ_WRITE, but not resized.
+         */
+        float* getPositions();
+        float* getNormals();
+        uint* getIndices();
+        Vector3f getPosition(uint i);
+        Vector3f getNormal(uint i);
+        // Triangles which use the vertex. These are found for all vertices when first requested.
+        std::vector<uint> getVertexTriangles(uint i);
         MeshVertex getVertex(uint i);
         Vector3ui getTriangle(uint i);
         std::vector<Vector3ui> getTriangles();
@@ -21,8 +35,9 @@ class MeshAccess {
         ~MeshAccess();
 		typedef UniquePointer<MeshAccess> pointer;
     private:
-        std::vector<MeshVertex>* mVertices;
-        std::vector<Vector3ui>* mTriangles;
+        std::vector<float>* mPositions;
+        std::vector<float>* mNormals;
+        std::vector<uint>* mIndices;
         SharedPointer<Mesh> mMesh;
 };
 
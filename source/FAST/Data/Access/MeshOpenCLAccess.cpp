@@ -0,0 +1,37 @@
+#include "MeshOpenCLAccess.hpp"
+#include "FAST/Data/Mesh.hpp"
+
+namespace fast {
+
+MeshOpenCLAccess::MeshOpenCLAccess(cl::Buffer* vertexBuffer, cl::Buffer* indexBuffer, SharedPointer<Mesh> mesh) {
+    mVertexBuffer = new cl::Buffer(*vertexBuffer);
+    mIndexBuffer = indexBuffer == NULL ? NULL : new cl::Buffer(*indexBuffer);
+    mIsDeleted = false;
+    mMesh = mesh;
+}
+
+cl::Buffer* MeshOpenCLAccess::getVertexBuffer() const {
+    return mVertexBuffer;
+}
+
+cl::Buffer* MeshOpenCLAccess::getIndexBuffer() const {
+    return mIndexBuffer;
+}
+
+void MeshOpenCLAccess::release() {
+    if(!mIsDeleted) {
+        delete mVertexBuffer;
+        delete mIndexBuffer;
+        mVertexBuffer = new cl::Buffer(); // assign a new blank object
+        mIndexBuffer = NULL;
+        mIsDeleted = true;
+    }
+	mMesh->accessFinished();
+}
+
+MeshOpenCLAccess::~MeshOpenCLAccess() {
+    if(!mIsDeleted)
+        release();
+}
+
+} // end namespace fast
@@ -0,0 +1,33 @@
+#ifndef MESHOPENCLACCESS_HPP_
+#define MESHOPENCLACCESS_HPP_
+
+#include "CL/OpenCL.hpp"
+#include "FAST/SmartPointers.hpp"
+
+namespace fast {
+
+class Mesh;
+
+class MeshOpenCLAccess {
+    public:
+        MeshOpenCLAccess(cl::Buffer* vertexBuffer, cl::Buffer* indexBuffer, SharedPointer<Mesh> mesh);
+        // Position and normal of each vertex after each other, 6 floats per vertex
+        cl::Buffer* getVertexBuffer() const;
+        // Vertex indices of each triangle, 3 uints per triangle. NULL if the mesh
+        // is not indexed, then the vertices of each triangle are stored after each other.
+        cl::Buffer* getIndexBuffer() const;
+        void release();
+        ~MeshOpenCLAccess();
+		typedef UniquePointer<MeshOpenCLAccess> pointer;
+    private:
+		MeshOpenCLAccess(const MeshOpenCLAccess& other);
+		MeshOpenCLAccess& operator=(const MeshOpenCLAccess& other);
+        cl::Buffer* mVertexBuffer;
+        cl::Buffer* mIndexBuffer;
+        bool mIsDeleted;
+        SharedPointer<Mesh> mMesh;
+};
+
+} // end namespace fast
+
+#endif /* MESHOPENCLACCESS_HPP_ */
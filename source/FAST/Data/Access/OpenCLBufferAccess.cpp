@@ -1,6 +1,6 @@
 #include "OpenCLBufferAccess.hpp"
 #include <iostream>
-#include "FAST/Data/Image.hpp"
+#include "FAST/Data/DataObject.hpp"
 #include "FAST/ExecutionDevice.hpp"
 
 namespace fast {
@@ -9,11 +9,29 @@ cl::Buffer* OpenCLBufferAccess::get() const {
     return mBuffer;
 }
 
-OpenCLBufferAccess::OpenCLBufferAccess(cl::Buffer* buffer,  SharedPointer<Image> image) {
-    // Copy the image
+OpenCLBufferAccess::OpenCLBufferAccess(cl::Buffer* buffer, SharedPointer<DataObject> dataObject, cl::Event event) {
+    // Copy the buffer
     mBuffer = new cl::Buffer(*buffer);
+    if(event() != NULL)
+        mEvents.push_back(event);
     mIsDeleted = false;
-    mImage = image;
+    mDataObject = dataObject;
+}
+
+bool OpenCLBufferAccess::hasEvent() const {
+    return mEvents.size() > 0;
+}
+
+cl::Event OpenCLBufferAccess::getEvent() const {
+    if(!hasEvent())
+        return cl::Event();
+    return mEvents[0];
+}
+
+const VECTOR_CLASS<cl::Event>* OpenCLBufferAccess::getEventWaitList() const {
+    if(!hasEvent())
+        return NULL;
+    return &mEvents;
 }
 
 void OpenCLBufferAccess::release() {
@@ -22,7 +40,7 @@ void OpenCLBufferAccess::release() {
         mBuffer = new cl::Buffer(); // assign a new blank object
         mIsDeleted = true;
     }
-	mImage->accessFinished();
+	mDataObject->accessFinished();
 }
 
 OpenCLBufferAccess::~OpenCLBufferAccess() {
@@ -6,13 +6,19 @@
 
 namespace fast {
 
-class Image;
+class DataObject;
 class OpenCLDevice;
 
 class OpenCLBufferAccess {
     public:
         cl::Buffer* get() const;
-        OpenCLBufferAccess(cl::Buffer* buffer,  SharedPointer<Image> image);
+        OpenCLBufferAccess(cl::Buffer* buffer, SharedPointer<DataObject> dataObject, cl::Event event = cl::Event());
+        // Returns true if a transfer of data to this buffer may still be running
+        bool hasEvent() const;
+        // Event of the last transfer to this buffer, commands using the buffer should wait on it
+        cl::Event getEvent() const;
+        // Wait list for enqueue functions, NULL if there is no event
+        const VECTOR_CLASS<cl::Event>* getEventWaitList() const;
         void release();
         ~OpenCLBufferAccess();
 		typedef UniquePointer<OpenCLBufferAccess> pointer;
@@ -20,8 +26,9 @@ class OpenCLBufferAccess {
 		OpenCLBufferAccess(const OpenCLBufferAccess& other);
 		OpenCLBufferAccess& operator=(const OpenCLBufferAccess& other);
         cl::Buffer* mBuffer;
+        VECTOR_CLASS<cl::Event> mEvents;
         bool mIsDeleted;
-        SharedPointer<Image> mImage;
+        SharedPointer<DataObject> mDataObject;
 };
 
 } // end namespace fast
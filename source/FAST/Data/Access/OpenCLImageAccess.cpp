@@ -16,20 +16,40 @@ cl::Image3D* OpenCLImageAccess::get3DImage() const {
 }
 
 
-OpenCLImageAccess::OpenCLImageAccess(cl::Image3D* image, SharedPointer<Image> object) {
+OpenCLImageAccess::OpenCLImageAccess(cl::Image3D* image, SharedPointer<Image> object, cl::Event event) {
     // Copy the image
     mImage = new cl::Image3D(*image);
+    if(event() != NULL)
+        mEvents.push_back(event);
     mIsDeleted = false;
     mImageObject = object;
 }
 
-OpenCLImageAccess::OpenCLImageAccess(cl::Image2D* image, SharedPointer<Image> object) {
+OpenCLImageAccess::OpenCLImageAccess(cl::Image2D* image, SharedPointer<Image> object, cl::Event event) {
     // Copy the image
     mImage = new cl::Image2D(*image);
+    if(event() != NULL)
+        mEvents.push_back(event);
     mIsDeleted = false;
     mImageObject = object;
 }
 
+bool OpenCLImageAccess::hasEvent() const {
+    return mEvents.size() > 0;
+}
+
+cl::Event OpenCLImageAccess::getEvent() const {
+    if(!hasEvent())
+        return cl::Event();
+    return mEvents[0];
+}
+
+const VECTOR_CLASS<cl::Event>* OpenCLImageAccess::getEventWaitList() const {
+    if(!hasEvent())
+        return NULL;
+    return &mEvents;
+}
+
 void OpenCLImageAccess::release() {
 	mImageObject->accessFinished();
     if(!mIsDeleted) {
@@ -15,8 +15,14 @@ class OpenCLImageAccess {
         cl::Image* get() const;
         cl::Image2D* get2DImage() const;
         cl::Image3D* get3DImage() const;
-        OpenCLImageAccess(cl::Image2D* image, SharedPointer<Image> object);
-        OpenCLImageAccess(cl::Image3D* image, SharedPointer<Image> object);
+        OpenCLImageAccess(cl::Image2D* image, SharedPointer<Image> object, cl::Event event = cl::Event());
+        OpenCLImageAccess(cl::Image3D* image, SharedPointer<Image> object, cl::Event event = cl::Event());
+        // Returns true if a transfer of data to this image may still be running
+        bool hasEvent() const;
+        // Event of the last transfer to this image, commands using the image should wait on it
+        cl::Event getEvent() const;
+        // Wait list for enqueue functions, NULL if there is no event
+        const VECTOR_CLASS<cl::Event>* getEventWaitList() const;
         void release();
         ~OpenCLImageAccess();
 		typedef UniquePointer<OpenCLImageAccess> pointer;
@@ -24,6 +30,7 @@ class OpenCLImageAccess {
 		OpenCLImageAccess(const OpenCLImageAccess& other);
 		OpenCLImageAccess& operator=(const OpenCLImageAccess& other);
         cl::Image* mImage;
+        VECTOR_CLASS<cl::Event> mEvents;
         bool mIsDeleted;
         SharedPointer<Image> mImageObject;
 
@@ -7,13 +7,29 @@ GLuint* VertexBufferObjectAccess::get() const {
     return mVBOID;
 }
 
+GLuint* VertexBufferObjectAccess::getIndexBuffer() const {
+    return mEBOID;
+}
+
+bool VertexBufferObjectAccess::isCompressed() const {
+    return mIsCompressed;
+}
+
 VertexBufferObjectAccess::VertexBufferObjectAccess(
         GLuint VBOID,
-        SharedPointer<Mesh> mesh) {
+        SharedPointer<Mesh> mesh,
+        GLuint EBOID,
+        bool compressed) {
 
     mVBOID = new GLuint;
     *mVBOID = VBOID;
+    mEBOID = NULL;
+    if(EBOID != 0) {
+        mEBOID = new GLuint;
+        *mEBOID = EBOID;
+    }
 
+    mIsCompressed = compressed;
     mIsDeleted = false;
     mMesh = mesh;
 }
@@ -22,6 +38,7 @@ void VertexBufferObjectAccess::release() {
 	mMesh->accessFinished();
     if(!mIsDeleted) {
         delete mVBOID;
+        delete mEBOID;
         mIsDeleted = true;
     }
 }
@@ -21,12 +21,19 @@ class Mesh;
 class VertexBufferObjectAccess {
     public:
         GLuint* get() const;
-        VertexBufferObjectAccess(GLuint VBOID, SharedPointer<Mesh> mesh);
+        // Element buffer with the vertex indices of each triangle, NULL if the mesh is not indexed
+        GLuint* getIndexBuffer() const;
+        // Compressed vertices are 16 bytes: positions as four half floats and normals as four signed normalized shorts.
+        // Else they are 24 bytes: three position and three normal floats.
+        bool isCompressed() const;
+        VertexBufferObjectAccess(GLuint VBOID, SharedPointer<Mesh> mesh, GLuint EBOID = 0, bool compressed = false);
         void release();
         ~VertexBufferObjectAccess();
 		typedef UniquePointer<VertexBufferObjectAccess> pointer;
     private:
         GLuint* mVBOID;
+        GLuint* mEBOID;
+        bool mIsCompressed;
         bool mIsDeleted;
         SharedPointer<Mesh> mMesh;
 };
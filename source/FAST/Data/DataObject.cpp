@@ -22,7 +22,7 @@ void DataObject::blockIfBeingWrittenTo() {
 void DataObject::blockIfBeingAccessed() {
     boost::unique_lock<boost::mutex> lock(mDataIsBeingAccessedMutex);
     while(mDataIsBeingAccessed) {
-        mDataIsBeingWrittenToCondition.wait(lock);
+        mDataIsBeingAccessedCondition.wait(lock);
     }
 }
 
@@ -31,13 +31,13 @@ void DataObject::accessFinished() {
         boost::unique_lock<boost::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = false;
 	}
-	mDataIsBeingWrittenToCondition.notify_one();
+	mDataIsBeingWrittenToCondition.notify_all();
 
 	{
         boost::unique_lock<boost::mutex> lock(mDataIsBeingAccessedMutex);
         mDataIsBeingAccessed = false;
 	}
-	mDataIsBeingAccessedCondition.notify_one();
+	mDataIsBeingAccessedCondition.notify_all();
 }
 
 bool DataObject::isDynamicData() const {
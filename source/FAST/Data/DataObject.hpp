@@ -47,6 +47,9 @@ class DataObject : public Object {
     private:
         boost::unordered_map<WeakPointer<ExecutionDevice>, unsigned int> mReferenceCount;
 
+        // Buffer access is shared by several data objects
+        friend class OpenCLBufferAccess;
+
         // This is only used for dynamic data, it is defined here for to make the convienice function getStaticOutput/InputData to work
         WeakPointer<Streamer> mStreamer;
 
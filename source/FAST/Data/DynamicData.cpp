@@ -1,69 +1,117 @@
 #include "DynamicData.hpp"
 #include "FAST/ProcessObject.hpp"
+#include <boost/thread.hpp>
 
 namespace fast {
 
 
 DynamicData::~DynamicData() {
-    delete fillCount;
     delete emptyCount;
 
 #if defined(__APPLE__) || defined(__MACOSX)
-    std::string name = "FAST_fill_count_" + boost::lexical_cast<std::string>(mSemaphoreNumber);
-    boost::interprocess::named_semaphore::remove(name.c_str());
-    name = "FAST_empty_count_" + boost::lexical_cast<std::string>(mSemaphoreNumber);
+    std::string name = "FAST_empty_count_" + boost::lexical_cast<std::string>(mSemaphoreNumber);
     boost::interprocess::named_semaphore::remove(name.c_str());
 #endif
 }
 
+DynamicData::Consumer::Consumer() {
+    nextFrame = 0;
+    nrOfFramesRetrieved = 0;
+    nrOfFramesSkipped = 0;
+    totalLatency = 0;
+    maximumLatency = 0;
+}
+
 void DynamicData::setMaximumNumberOfFrames(uint nrOfFrames) {
     mMaximumNrOfFrames = nrOfFrames;
-    if(mFrames2.size() > 0)
+    if(mCurrentFrameCounter > 0)
         throw Exception("Must call setMaximumNumberOfFrames before streaming is started");
     if(mMaximumNrOfFrames > 0) {
-        delete fillCount;
         delete emptyCount;
 
         // Use named semaphore if Mac
 #if defined(__APPLE__) || defined(__MACOSX)
-        std::string name = "FAST_fill_count_" + boost::lexical_cast<std::string>(mSemaphoreNumber);
+        std::string name = "FAST_empty_count_" + boost::lexical_cast<std::string>(mSemaphoreNumber);
         boost::interprocess::named_semaphore::remove(name.c_str());
-        std::string name2 = "FAST_empty_count_" + boost::lexical_cast<std::string>(mSemaphoreNumber);
-        boost::interprocess::named_semaphore::remove(name2.c_str());
-        fillCount = new boost::interprocess::named_semaphore(boost::interprocess::create_only, name.c_str(), 0);
-        emptyCount = new boost::interprocess::named_semaphore(boost::interprocess::create_only, name2.c_str(), nrOfFrames);
+        emptyCount = new boost::interprocess::named_semaphore(boost::interprocess::create_only, name.c_str(), nrOfFrames);
 #else
-        fillCount = new boost::interprocess::interprocess_semaphore(0);
         emptyCount = new boost::interprocess::interprocess_semaphore(nrOfFrames);
 #endif
+
+        // The ring never has to grow when the nr of frames is limited
+        boost::lock_guard<boost::mutex> lock(mStreamMutex);
+        mFrames.resize(nrOfFrames);
+        mFrameAddedTimes.resize(nrOfFrames);
+        mRemainingConsumers.resize(nrOfFrames);
     }
 }
 
-uint DynamicData::getLowestFrameCount() const {
-    if(mConsumerFrameCounters.size() == 0)
+unsigned long DynamicData::getLowestFrameCount() const {
+    if(mConsumers.size() == 0)
         return 0;
 
-    boost::unordered_map<WeakPointer<Object>, uint>::const_iterator it;
-    uint lowestFrameCount = std::numeric_limits<uint>::max();
-    for(it = mConsumerFrameCounters.begin(); it != mConsumerFrameCounters.end(); it++) {
-        if(it->second < lowestFrameCount) {
-            lowestFrameCount = it->second;
+    boost::unordered_map<WeakPointer<Object>, Consumer>::const_iterator it;
+    unsigned long lowestFrameCount = std::numeric_limits<unsigned long>::max();
+    for(it = mConsumers.begin(); it != mConsumers.end(); it++) {
+        if(it->second.nextFrame < lowestFrameCount) {
+            lowestFrameCount = it->second.nextFrame;
         }
     }
 
     return lowestFrameCount;
 }
 
-void DynamicData::removeOldFrames(uint frameCounter) {
-    // TODO this could be implemented in a faster way
-    boost::unordered_map<uint, DataObject::pointer>::iterator it = mFrames2.begin();
-    while(it != mFrames2.end()) {
-        if(it->first < frameCounter) {
-            it = mFrames2.erase(it);
-		} else {
-			it++;
-		}
+uint DynamicData::retireFrames() {
+    uint nrOfFramesRetired = 0;
+    while(mOldestFrame < mCurrentFrameCounter) {
+        const std::size_t slot = mOldestFrame % mFrames.size();
+        if(mRemainingConsumers[slot] > 0)
+            break;
+        mFrames[slot] = DataObject::pointer();
+        mOldestFrame++;
+        nrOfFramesRetired++;
     }
+
+    return nrOfFramesRetired;
+}
+
+void DynamicData::growRing() {
+    const std::size_t oldSize = mFrames.size();
+    const std::size_t newSize = std::max<std::size_t>(oldSize*2, 8);
+    std::vector<DataObject::pointer> frames(newSize);
+    std::vector<std::chrono::steady_clock::time_point> frameAddedTimes(newSize);
+    std::vector<uint> remainingConsumers(newSize);
+    for(unsigned long i = mOldestFrame; i < mCurrentFrameCounter; i++) {
+        frames[i % newSize] = mFrames[i % oldSize];
+        frameAddedTimes[i % newSize] = mFrameAddedTimes[i % oldSize];
+        remainingConsumers[i % newSize] = mRemainingConsumers[i % oldSize];
+    }
+    mFrames.swap(frames);
+    mFrameAddedTimes.swap(frameAddedTimes);
+    mRemainingConsumers.swap(remainingConsumers);
+}
+
+DynamicData::Consumer& DynamicData::getConsumer(WeakPointer<Object> processObject, StreamingMode mode) {
+    boost::unordered_map<WeakPointer<Object>, Consumer>::iterator it = mConsumers.find(processObject);
+    if(it != mConsumers.end())
+        return it->second;
+
+    Consumer consumer;
+    if(mode == STREAMING_MODE_NEWEST_FRAME_ONLY) {
+        consumer.nextFrame = mCurrentFrameCounter > 0 ? mCurrentFrameCounter-1 : 0;
+    } else if(mode == STREAMING_MODE_STORE_ALL_FRAMES) {
+        consumer.nextFrame = 0;
+    } else {
+        // This must be assigned to a variable first to ensure correct result!
+        unsigned long lowestFrameCount = std::max(getLowestFrameCount(), (unsigned long)mOldestFrame);
+        consumer.nextFrame = lowestFrameCount;
+        // The new consumer has not got any of the remaining frames
+        for(unsigned long i = lowestFrameCount; i < mCurrentFrameCounter; i++)
+            mRemainingConsumers[i % mFrames.size()]++;
+        if(lowestFrameCount == mCurrentFrameCounter)
+            mConsumersAtHead.push_back(processObject);
+    }
+    return mConsumers[processObject] = consumer;
 }
 
 void DynamicData::registerConsumer(Object::pointer processObject) {
@@ -72,17 +120,8 @@ void DynamicData::registerConsumer(Object::pointer processObject) {
 
 void DynamicData::registerConsumer(WeakPointer<Object> processObject) {
     Streamer::pointer streamer = getStreamer();
-    mStreamMutex.lock();
-     if(mConsumerFrameCounters.count(processObject) == 0) {
-        if(streamer->getStreamingMode() == STREAMING_MODE_NEWEST_FRAME_ONLY) {
-            mConsumerFrameCounters[processObject] = mCurrentFrameCounter;
-        } else if(streamer->getStreamingMode() == STREAMING_MODE_STORE_ALL_FRAMES) {
-            mConsumerFrameCounters[processObject] = 0;
-        } else {
-            mConsumerFrameCounters[processObject] = getLowestFrameCount();
-        }
-     }
-    mStreamMutex.unlock();
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
+    getConsumer(processObject, streamer->getStreamingMode());
 }
 
 DataObject::pointer DynamicData::getNextFrame(Object::pointer processObject) {
@@ -90,13 +129,11 @@ DataObject::pointer DynamicData::getNextFrame(Object::pointer processObject) {
 }
 
 
-void DynamicData::setAllConsumersUpToDate() {
-    unsigned long timestamp = getTimestamp();
-    boost::unordered_map<WeakPointer<Object>, uint>::iterator it;
-    for(it = mConsumerFrameCounters.begin(); it != mConsumerFrameCounters.end(); it++) {
-        ProcessObject::pointer consumer = ProcessObject::pointer(it->first.lock());
-        consumer->updateTimestamp(mPtr.lock());
-    }
+void DynamicData::addLatency(Consumer& consumer, std::size_t slot) {
+    std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - mFrameAddedTimes[slot];
+    consumer.nrOfFramesRetrieved++;
+    consumer.totalLatency += latency.count();
+    consumer.maximumLatency = std::max(consumer.maximumLatency, latency.count());
 }
 
 DataObject::pointer DynamicData::getNextFrame(WeakPointer<Object> processObject) {
@@ -106,123 +143,76 @@ DataObject::pointer DynamicData::getNextFrame(WeakPointer<Object> processObject)
         throw Exception("Streamer has been deleted, but someone has called getNextFrame");
         //return getCurrentFrame();
     }
+    const StreamingMode mode = streamer->getStreamingMode();
 
-    // Producer consumer model
-    if(mMaximumNrOfFrames > 0 && streamer->getStreamingMode() == STREAMING_MODE_PROCESS_ALL_FRAMES) {
-        bool frameShouldBeRemoved = true;
-
-        if(mConsumerFrameCounters.count(processObject) > 0) {
-            uint thisFrameCounter = mConsumerFrameCounters[processObject]; // Current consumer frame counter
-
-            // If any other frame counters are less or equal, we do not want to remove frame
-            boost::unordered_map<WeakPointer<Object>, uint>::const_iterator it;
-            for(it = mConsumerFrameCounters.begin(); it != mConsumerFrameCounters.end(); it++) {
-                if(it->second <= thisFrameCounter) {
-                    frameShouldBeRemoved = false;
-                    break;
-                }
+    DataObject::pointer returnData;
+    uint nrOfFramesRetired = 0;
+    {
+        boost::lock_guard<boost::mutex> lock(mStreamMutex);
+        Consumer& consumer = getConsumer(processObject, mode);
+
+        if(mode == STREAMING_MODE_NEWEST_FRAME_ONLY) {
+            // Always return last frame
+            if(mCurrentFrameCounter == 0)
+                throw Exception("Trying to get next frame, when no frame has ever been given to dynamic data.");
+            const unsigned long newestFrame = mCurrentFrameCounter-1;
+            if(newestFrame >= consumer.nextFrame) {
+                consumer.nrOfFramesSkipped += newestFrame - consumer.nextFrame;
+                addLatency(consumer, newestFrame % mFrames.size());
+                consumer.nextFrame = newestFrame+1;
             }
+            return mCurrentFrame2;
         }
 
-        if(frameShouldBeRemoved)
-            fillCount->wait(); // decrement
-    }
-
-    mStreamMutex.lock();
-    if(streamer->getStreamingMode() == STREAMING_MODE_NEWEST_FRAME_ONLY) {
-        // Always return last frame
-        if(mCurrentFrameCounter == 0) {
-            mStreamMutex.unlock();
-            throw Exception("Trying to get next frame, when no frame has ever been given to dynamic data.");
-        }
-        DataObject::pointer returnData = mCurrentFrame2;
-        mStreamMutex.unlock();
-        return mCurrentFrame2;
-    }
-    // If process object is not registered, register it
-    if(mConsumerFrameCounters.count(processObject) == 0) {
-        if(streamer->getStreamingMode() == STREAMING_MODE_NEWEST_FRAME_ONLY) {
-            mConsumerFrameCounters[processObject] = mCurrentFrameCounter;
-        } else if(streamer->getStreamingMode() == STREAMING_MODE_STORE_ALL_FRAMES) {
-            mConsumerFrameCounters[processObject] = 0;
-        } else {
-            uint lowestFrameCount = getLowestFrameCount(); // This must be assigned to a variable first to ensure correct result!
-            mConsumerFrameCounters[processObject] = lowestFrameCount;
-        }
-    }
-    // Return frame
-    DataObject::pointer returnData;
-    if(mFrames2.count(mConsumerFrameCounters[processObject]) > 0) {
-        returnData = mFrames2[mConsumerFrameCounters[processObject]];
-    } else {
-        mStreamMutex.unlock();
-        throw Exception("Frame in dynamic data was not found");
-    }
-
-
-    // Increment
-    mConsumerFrameCounters[processObject] = mConsumerFrameCounters[processObject]+1;
-
-    // If PROCESS_ALL and this has smallest frame counter, remove old frame
-    if(streamer->getStreamingMode() == STREAMING_MODE_PROCESS_ALL_FRAMES) {
-        removeOldFrames(getLowestFrameCount());
-        if(mFrames2.size() > 0) { // Update timestamp if there are more frames available
-            updateModifiedTimestamp();
-            // For each consumer
-            boost::unordered_map<WeakPointer<Object>, uint>::iterator it;
-            for(it = mConsumerFrameCounters.begin(); it != mConsumerFrameCounters.end(); it++) {
-                // Check if next frame is available
-                if(mFrames2.count(it->second) == 0) {
-                    // Set consumer up to date, so that it will not request data yet
-                    ProcessObject::pointer consumer = it->first.lock();
-                    consumer->updateTimestamp(mPtr.lock());
+        // Return frame
+        if(consumer.nextFrame < mOldestFrame || consumer.nextFrame >= mCurrentFrameCounter)
+            throw Exception("Frame in dynamic data was not found");
+        const std::size_t slot = consumer.nextFrame % mFrames.size();
+        returnData = mFrames[slot];
+        addLatency(consumer, slot);
+
+        // Increment
+        consumer.nextFrame++;
+
+        // If PROCESS_ALL and all consumers have got this frame, remove it
+        if(mode == STREAMING_MODE_PROCESS_ALL_FRAMES) {
+            mRemainingConsumers[slot]--;
+            nrOfFramesRetired = retireFrames();
+            if(consumer.nextFrame == mCurrentFrameCounter)
+                mConsumersAtHead.push_back(processObject);
+            if(getSize() > 0) { // Update timestamp if there are more frames available
+                updateModifiedTimestamp();
+                // Set the consumers which have got all frames up to date, so that they will not request data yet
+                for(int i = 0; i < mConsumersAtHead.size(); i++) {
+                    ProcessObject::pointer consumerAtHead = mConsumersAtHead[i].lock();
+                    consumerAtHead->updateTimestamp(mPtr.lock());
                 }
+            } else {
+                // All frames are gone. The other consumers were set up to date
+                // when they got their last frame, and the timestamp is unchanged.
+                ProcessObject::pointer po = processObject.lock();
+                po->updateTimestamp(mPtr.lock());
             }
         } else {
-            // All frames are gone, make sure timestamps that all POs have are up to date
-            setAllConsumersUpToDate();
-        }
-    } else if(streamer->getStreamingMode() == STREAMING_MODE_NEWEST_FRAME_ONLY) {
-        // With newest frame only, always remove?
-        //mFrames2.erase(removeFrame);
-    } else {
-        // Update timestamp if there are more frames available
-        if(mConsumerFrameCounters[processObject] < mFrames2.size()) {
-            updateModifiedTimestamp();
+            // Update timestamp if there are more frames available
+            if(consumer.nextFrame < mCurrentFrameCounter) {
+                updateModifiedTimestamp();
+            }
         }
     }
 
-    mStreamMutex.unlock();
-    // Producer consumer
-    if(mMaximumNrOfFrames > 0 && streamer->getStreamingMode() == STREAMING_MODE_PROCESS_ALL_FRAMES) {
-        emptyCount->post(); // increment
+    // Producer consumer: the slots of removed frames are free
+    if(mMaximumNrOfFrames > 0 && mode == STREAMING_MODE_PROCESS_ALL_FRAMES) {
+        for(uint i = 0; i < nrOfFramesRetired; i++)
+            emptyCount->post(); // increment
     }
 
     return returnData;
 }
 
 DataObject::pointer DynamicData::getCurrentFrame() {
-    Streamer::pointer streamer = getStreamer();
-    mStreamMutex.lock();
-    /*
-    if(mFrames.size() == 0 || mFrames.size() <= mCurrentFrame) {
-        if(!streamer.isValid()) {
-            mStreamMutex.unlock();
-            throw Exception("Streamer does not exist (anymore), stop.");
-        } else {
-            if(streamer->hasReachedEnd()) {
-                mStreamMutex.unlock();
-                throw Exception("Streamer has reached the end.");
-            } else {
-                mStreamMutex.unlock();
-                throw Exception("This exception should not have occured. ");
-            }
-        }
-    }
-    */
-    DataObject::pointer ret = mCurrentFrame2;
-    mStreamMutex.unlock();
-    return ret;
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
+    return mCurrentFrame2;
 }
 
 void DynamicData::addFrame(DataObject::pointer frame) {
@@ -231,37 +221,42 @@ void DynamicData::addFrame(DataObject::pointer frame) {
         //throw Exception("A DynamicImage must have a streamer set before it can be used.");
         return;
     }
+    const StreamingMode mode = streamer->getStreamingMode();
     if(mMaximumNrOfFrames > 0) {
-        if(streamer->getStreamingMode() == STREAMING_MODE_PROCESS_ALL_FRAMES) {
+        if(mode == STREAMING_MODE_PROCESS_ALL_FRAMES) {
             // Producer consumer model using semaphores
             emptyCount->wait(); // decrement
-            //down(mutex);
-        } else if(streamer->getStreamingMode() == STREAMING_MODE_STORE_ALL_FRAMES) {
-            if(mFrames2.size() >= mMaximumNrOfFrames)
+        } else if(mode == STREAMING_MODE_STORE_ALL_FRAMES) {
+            if(getSize() >= mMaximumNrOfFrames)
                 throw NoMoreFramesException("Maximum number of frames reached. You can change the this number using the setMaximumNumberOfFrames method on the streamer/dynamic data objects.");
         }
     }
-    mStreamMutex.lock();
 
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
     updateModifiedTimestamp();
-    if(getStreamer()->getStreamingMode() == STREAMING_MODE_NEWEST_FRAME_ONLY) {
-        mFrames2.clear();
+    if(mode == STREAMING_MODE_NEWEST_FRAME_ONLY && getSize() > 0) {
+        mFrames[mOldestFrame % mFrames.size()] = DataObject::pointer();
+        mOldestFrame = mCurrentFrameCounter.load();
     }
-    mFrames2[mCurrentFrameCounter] = frame;
+    if(getSize() == mFrames.size())
+        growRing();
+    const std::size_t slot = mCurrentFrameCounter % mFrames.size();
+    mFrames[slot] = frame;
+    mFrameAddedTimes[slot] = std::chrono::steady_clock::now();
+    mRemainingConsumers[slot] = mode == STREAMING_MODE_PROCESS_ALL_FRAMES ? mConsumers.size() : 0;
     mCurrentFrame2 = frame;
+    // No consumer has got the new frame
+    mConsumersAtHead.clear();
+    // Publish the frame
     mCurrentFrameCounter++;
-    mStreamMutex.unlock();
-    if(mMaximumNrOfFrames > 0 && streamer->getStreamingMode() == STREAMING_MODE_PROCESS_ALL_FRAMES) {
-        fillCount->post(); // increment
-    }
 }
 
 DynamicData::DynamicData() {
     mCurrentFrameCounter = 0;
+    mOldestFrame = 0;
     mMaximumNrOfFrames = 0;
     mIsDynamicData = true;
     mHasReachedEnd = false;
-    fillCount = NULL;
     emptyCount = NULL;
     updateModifiedTimestamp();
 
@@ -274,7 +269,9 @@ DynamicData::DynamicData() {
 
 
 unsigned int DynamicData::getSize() const {
-    return mFrames2.size();
+    // Read the oldest frame first, so that the size is never negative
+    const unsigned long oldestFrame = mOldestFrame;
+    return mCurrentFrameCounter - oldestFrame;
 }
 
 
@@ -283,7 +280,7 @@ bool DynamicData::hasReachedEnd() {
     if(!streamer.isValid()) {
         throw Exception("A DynamicData must have a streamer set before it can be used.");
     }
-    mStreamMutex.lock();
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
     // Check if has reached end can be changed to true
     if(!mHasReachedEnd) {
         // TODO the checks for NEWEST_FRAME AND PROCESS_ALL are not necessarily correct, for a pipeline with several steps
@@ -294,7 +291,7 @@ bool DynamicData::hasReachedEnd() {
                 mHasReachedEnd = true;
             break;
         case STREAMING_MODE_PROCESS_ALL_FRAMES:
-            if(streamer->hasReachedEnd() && mFrames2.size() == 0)
+            if(streamer->hasReachedEnd() && getSize() == 0)
                 mHasReachedEnd = true;
             break;
         case STREAMING_MODE_STORE_ALL_FRAMES:
@@ -303,7 +300,6 @@ bool DynamicData::hasReachedEnd() {
             break;
         }
     }
-    mStreamMutex.unlock();
     return mHasReachedEnd;
 }
 
@@ -312,7 +308,7 @@ bool DynamicData::hasReachedEnd(Object::pointer PO) {
     if(!streamer.isValid()) {
         throw Exception("A DynamicData must have a streamer set before it can be used.");
     }
-    mStreamMutex.lock();
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
     // Check if has reached end can be changed to true
     if(!mHasReachedEnd) {
         // TODO the checks for NEWEST_FRAME AND PROCESS_ALL are not necessarily correct, for a pipeline with several steps
@@ -323,7 +319,7 @@ bool DynamicData::hasReachedEnd(Object::pointer PO) {
                 mHasReachedEnd = true;
             break;
         case STREAMING_MODE_PROCESS_ALL_FRAMES:
-            if(streamer->hasReachedEnd() && mFrames2.count(mConsumerFrameCounters[PO]) == 0)
+            if(streamer->hasReachedEnd() && getConsumer(PO, streamer->getStreamingMode()).nextFrame >= mCurrentFrameCounter)
                 mHasReachedEnd = true;
             break;
         case STREAMING_MODE_STORE_ALL_FRAMES:
@@ -332,10 +328,52 @@ bool DynamicData::hasReachedEnd(Object::pointer PO) {
             break;
         }
     }
-    mStreamMutex.unlock();
     return mHasReachedEnd;
 }
 
+double DynamicData::getAverageLatency(Object::pointer processObject) {
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
+    boost::unordered_map<WeakPointer<Object>, Consumer>::const_iterator it = mConsumers.find(WeakPointer<Object>(processObject));
+    if(it == mConsumers.end() || it->second.nrOfFramesRetrieved == 0)
+        return 0;
+    return it->second.totalLatency / it->second.nrOfFramesRetrieved;
+}
+
+double DynamicData::getMaximumLatency(Object::pointer processObject) {
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
+    boost::unordered_map<WeakPointer<Object>, Consumer>::const_iterator it = mConsumers.find(WeakPointer<Object>(processObject));
+    if(it == mConsumers.end())
+        return 0;
+    return it->second.maximumLatency;
+}
+
+unsigned long DynamicData::getNrOfFramesRetrieved(Object::pointer processObject) {
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
+    boost::unordered_map<WeakPointer<Object>, Consumer>::const_iterator it = mConsumers.find(WeakPointer<Object>(processObject));
+    if(it == mConsumers.end())
+        return 0;
+    return it->second.nrOfFramesRetrieved;
+}
+
+unsigned long DynamicData::getNrOfFramesSkipped(Object::pointer processObject) {
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
+    boost::unordered_map<WeakPointer<Object>, Consumer>::const_iterator it = mConsumers.find(WeakPointer<Object>(processObject));
+    if(it == mConsumers.end())
+        return 0;
+    return it->second.nrOfFramesSkipped;
+}
+
+void DynamicData::resetLatencyCounters() {
+    boost::lock_guard<boost::mutex> lock(mStreamMutex);
+    boost::unordered_map<WeakPointer<Object>, Consumer>::iterator it;
+    for(it = mConsumers.begin(); it != mConsumers.end(); it++) {
+        it->second.nrOfFramesRetrieved = 0;
+        it->second.nrOfFramesSkipped = 0;
+        it->second.totalLatency = 0;
+        it->second.maximumLatency = 0;
+    }
+}
+
 
 
 }
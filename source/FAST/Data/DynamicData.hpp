@@ -4,6 +4,8 @@
 #include "FAST/Streamers/Streamer.hpp"
 #include "FAST/Data/DataObject.hpp"
 #include <vector>
+#include <atomic>
+#include <chrono>
 #include <boost/unordered_map.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/interprocess/sync/interprocess_semaphore.hpp>
@@ -27,37 +29,61 @@ class DynamicData : public DataObject {
         DataObject::pointer getCurrentFrame();
         void registerConsumer(WeakPointer<Object> processObject);
         void registerConsumer(Object::pointer processObject);
+        /**
+         * Latency statistics of a consumer. The latency is the time in
+         * milliseconds from a frame is added until the consumer gets it.
+         * With streaming mode NEWEST_FRAME_ONLY, frames which were replaced
+         * before the consumer got them are counted as skipped.
+         */
+        double getAverageLatency(Object::pointer processObject);
+        double getMaximumLatency(Object::pointer processObject);
+        unsigned long getNrOfFramesRetrieved(Object::pointer processObject);
+        unsigned long getNrOfFramesSkipped(Object::pointer processObject);
+        void resetLatencyCounters();
     private:
+        struct Consumer {
+            // Frame number of the next frame this consumer will get
+            unsigned long nextFrame;
+            unsigned long nrOfFramesRetrieved;
+            unsigned long nrOfFramesSkipped;
+            double totalLatency;
+            double maximumLatency;
+            Consumer();
+        };
 
+        // The consumer object of a process object, which is registered if needed. Stream mutex must be locked.
+        Consumer& getConsumer(WeakPointer<Object> processObject, StreamingMode mode);
+        void addLatency(Consumer& consumer, std::size_t slot);
+        unsigned long getLowestFrameCount() const;
+        // Remove the oldest frames which all consumers have got, returns the nr of frames removed
+        uint retireFrames();
+        void growRing();
 
-        // If the flag mKeepAllFrames is set to false, this vector will have
-        // a max size of 1
-        //std::vector<typename T::pointer> mFrames;
+        boost::unordered_map<WeakPointer<Object>, Consumer> mConsumers;
+        // Consumers which have got all frames, only used with PROCESS_ALL_FRAMES.
+        // Their timestamps are updated when the modified timestamp changes.
+        std::vector<WeakPointer<Object> > mConsumersAtHead;
 
-        // Keep track of which frame is next, only used when mKeepAllFrames is
-        // set to true
-        //unsigned long mCurrentFrame;
-
-        boost::unordered_map<WeakPointer<Object>, uint> mConsumerFrameCounters;
-        uint getLowestFrameCount() const;
-        void removeOldFrames(uint frameCounter);
-        void setAllConsumersUpToDate();
-        // Maps frame counter to a data
-        boost::unordered_map<uint, DataObject::pointer> mFrames2;
+        // Ring buffer of frames. Frame number n is stored in slot n % mFrames.size(),
+        // and the frames from mOldestFrame up to mCurrentFrameCounter are stored.
+        std::vector<DataObject::pointer> mFrames;
+        std::vector<std::chrono::steady_clock::time_point> mFrameAddedTimes;
+        // Nr of consumers which have not got the frame of each slot yet, only used with PROCESS_ALL_FRAMES
+        std::vector<uint> mRemainingConsumers;
         // This is the frame number of HEAD
-        unsigned long mCurrentFrameCounter;
+        std::atomic<unsigned long> mCurrentFrameCounter;
+        std::atomic<unsigned long> mOldestFrame;
         // Only used with newest frame only:
         DataObject::pointer mCurrentFrame2;
 
         uint mMaximumNrOfFrames;
 
+        // Counts free slots when the nr of frames is limited with PROCESS_ALL_FRAMES.
         // Use named semaphore if Mac
 #if defined(__APPLE__) || defined(__MACOSX)
         uint mSemaphoreNumber;
-        boost::interprocess::named_semaphore* fillCount;
         boost::interprocess::named_semaphore* emptyCount;
 #else
-        boost::interprocess::interprocess_semaphore* fillCount;
         boost::interprocess::interprocess_semaphore* emptyCount;
 #endif
 
@@ -3,87 +3,100 @@
 #include "FAST/Exception.hpp"
 #include "FAST/Utility.hpp"
 #include "FAST/SceneGraph.hpp"
+#include "FAST/Data/ImagePool.hpp"
+#include "FAST/Data/ImageReduction.hpp"
+#include <algorithm>
+#include <cstdlib>
 
 namespace fast {
 
-// Pad data with 1, 2 or 3 channels to 4 channels with 0
-template <class T>
-void * padData(T * data, unsigned int size, unsigned int nrOfComponents) {
-    T * newData = new T[size*4]();
-    for(unsigned int i = 0; i < size; i++) {
-    	if(nrOfComponents == 1) {
-            newData[i*4] = data[i];
-    	} else if(nrOfComponents == 2) {
-            newData[i*4] = data[i*2];
-            newData[i*4+1] = data[i*2+1];
-    	} else {
-            newData[i*4] = data[i*3];
-            newData[i*4+1] = data[i*3+1];
-            newData[i*4+2] = data[i*3+2];
-    	}
-    }
-    return (void *)newData;
-}
-
-void * adaptDataToImage(void * data, cl_channel_order order, unsigned int size, DataType type, unsigned int nrOfComponents) {
-    // Because no OpenCL images support 3 channels,
-    // the data has to be padded to 4 channels if the nr of components is 3
-    // Also, not all CL platforms support CL_R and CL_RG images
-    if(order == CL_RGBA && nrOfComponents != 4) {
-        switch(type) {
-            fastSwitchTypeMacro(return padData<FAST_TYPE>((FAST_TYPE*)data, size, nrOfComponents))
-        }
+// Pad each pixel of N components to 4 channels with 0. N is a template
+// parameter so that the compiler can unroll and vectorize the inner loops
+template <class T, int N>
+void packToRGBA(const T * data, T * paddedData, std::size_t size) {
+    for(std::size_t i = 0; i < size; i++) {
+        for(int c = 0; c < N; c++)
+            paddedData[i*4+c] = data[i*N+c];
+        for(int c = N; c < 4; c++)
+            paddedData[i*4+c] = 0;
     }
+}
 
-    return data;
+// Remove padding from a data array created by packToRGBA
+template <class T, int N>
+void unpackFromRGBA(const T * paddedData, T * data, std::size_t size) {
+    for(std::size_t i = 0; i < size; i++) {
+        for(int c = 0; c < N; c++)
+            data[i*N+c] = paddedData[i*4+c];
+    }
+}
+
+template <class T>
+void padData(const T * data, T * paddedData, std::size_t size, unsigned int nrOfComponents) {
+    if(nrOfComponents == 1) {
+        packToRGBA<T, 1>(data, paddedData, size);
+    } else if(nrOfComponents == 2) {
+        packToRGBA<T, 2>(data, paddedData, size);
+    } else {
+        packToRGBA<T, 3>(data, paddedData, size);
+    }
 }
 
-// Remove padding from a data array created by padData
 template <class T>
-void * removePadding(T * data, unsigned int size, unsigned int nrOfComponents) {
-     T * newData = new T[size*nrOfComponents];
-    for(unsigned int i = 0; i < size; i++) {
-    	if(nrOfComponents == 1) {
-            newData[i] = data[i*4];
-    	} else if(nrOfComponents == 2) {
-            newData[i*2] = data[i*4];
-            newData[i*2+1] = data[i*4+1];
-    	} else {
-            newData[i*3] = data[i*4];
-            newData[i*3+1] = data[i*4+1];
-            newData[i*3+2] = data[i*4+2];
-    	}
-    }
-    return (void *)newData;
-}
-
-void * adaptImageDataToHostData(void * data, cl_channel_order order, unsigned int size, DataType type, unsigned int nrOfComponents) {
+void removePadding(const T * paddedData, T * data, std::size_t size, unsigned int nrOfComponents) {
+    if(nrOfComponents == 1) {
+        unpackFromRGBA<T, 1>(paddedData, data, size);
+    } else if(nrOfComponents == 2) {
+        unpackFromRGBA<T, 2>(paddedData, data, size);
+    } else {
+        unpackFromRGBA<T, 3>(paddedData, data, size);
+    }
+}
+
+void * adaptDataToImage(void * data, cl_channel_order order, std::size_t size, DataType type, unsigned int nrOfComponents) {
     // Because no OpenCL images support 3 channels,
-    // the data has to be padded to 4 channels if the nr of components is 3.
+    // the data has to be padded to 4 channels if the nr of components is 3
     // Also, not all CL platforms support CL_R and CL_RG images
-    // This function removes that padding
     if(order == CL_RGBA && nrOfComponents != 4) {
+        void * paddedData = allocateDataArray(size, type, 4);
         switch(type) {
-            fastSwitchTypeMacro(return removePadding<FAST_TYPE>((FAST_TYPE*)data, size, nrOfComponents))
+            fastSwitchTypeMacro(padData<FAST_TYPE>((FAST_TYPE*)data, (FAST_TYPE*)paddedData, size, nrOfComponents))
         }
+        return paddedData;
     }
 
     return data;
 }
 
-
-
 void Image::transferCLImageFromHost(OpenCLDevice::pointer device) {
 
     // Special treatment for images with 3 components because an OpenCL image can only have 1, 2 or 4 channels
 	// And if the device does not support 1 or 2 channels
-    cl::ImageFormat format = getOpenCLImageFormat(device, mDimensions == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D, mType, mComponents);
-    if(format.image_channel_order == CL_RGBA && mComponents != 4) {
-        void * tempData = adaptDataToImage(mHostData, CL_RGBA, mWidth*mHeight*mDepth, mType, mComponents);
+    if(isImageFormatPadded(device)) {
+        if(isPaddingOnDeviceSupported(device, true)) {
+            // Upload to the buffer on the device, and add the padding there
+            if(mCLBuffers.count(device) == 0) {
+                mCLBuffers[device] = allocateOpenCLBuffer(device);
+            }
+            transferCLBufferFromHost(device);
+            mCLBuffersIsUpToDate[device] = true;
+            padCLBufferToImage(device);
+        } else {
+            if(mPaddedHostData == NULL)
+                mPaddedHostData = allocateDataArray((std::size_t)mWidth*mHeight*mDepth, mType, 4);
+            switch(mType) {
+                fastSwitchTypeMacro(padData<FAST_TYPE>((FAST_TYPE*)mHostData, (FAST_TYPE*)mPaddedHostData, (std::size_t)mWidth*mHeight*mDepth, mComponents))
+            }
+            device->getCommandQueue().enqueueWriteImage(*(cl::Image*)mCLImages[device],
+            CL_TRUE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
+                    0, mPaddedHostData);
+        }
+    } else if(mAsynchronousTransfers) {
+        cl::Event event;
         device->getCommandQueue().enqueueWriteImage(*(cl::Image*)mCLImages[device],
-        CL_TRUE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
-                0, tempData);
-        deleteArray(tempData, mType);
+        CL_FALSE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
+                0, mHostData, NULL, &event);
+        mCLImagesEvents[device] = event;
     } else {
         device->getCommandQueue().enqueueWriteImage(*(cl::Image*)mCLImages[device],
         CL_TRUE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
@@ -94,18 +107,34 @@ void Image::transferCLImageFromHost(OpenCLDevice::pointer device) {
 void Image::transferCLImageToHost(OpenCLDevice::pointer device) {
     // Special treatment for images with 3 components because an OpenCL image can only have 1, 2 or 4 channels
 	// And if the device does not support 1 or 2 channels
-    cl::ImageFormat format = getOpenCLImageFormat(device, mDimensions == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D, mType, mComponents);
-    if(format.image_channel_order == CL_RGBA && mComponents != 4) {
-        void * tempData = allocateDataArray(mWidth*mHeight*mDepth,mType,4);
-        device->getCommandQueue().enqueueReadImage(*(cl::Image*)mCLImages[device],
-        CL_TRUE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
-                0, tempData);
-        mHostData = adaptImageDataToHostData(tempData,CL_RGBA, mWidth*mHeight*mDepth,mType,mComponents);
-        deleteArray(tempData, mType);
+    if(isImageFormatPadded(device)) {
+        if(isPaddingOnDeviceSupported(device, false)) {
+            // Remove the padding on the device, and download the buffer
+            if(mCLBuffers.count(device) == 0) {
+                mCLBuffers[device] = allocateOpenCLBuffer(device);
+            }
+            unpadCLImageToBuffer(device);
+            mCLBuffersIsUpToDate[device] = true;
+            transferCLBufferToHost(device);
+        } else {
+            if(!mHostHasData) {
+                // Must allocate memory for host data
+                mHostData = allocateHostData();
+                mHostHasData = true;
+            }
+            if(mPaddedHostData == NULL)
+                mPaddedHostData = allocateDataArray((std::size_t)mWidth*mHeight*mDepth, mType, 4);
+            device->getCommandQueue().enqueueReadImage(*(cl::Image*)mCLImages[device],
+            CL_TRUE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
+                    0, mPaddedHostData);
+            switch(mType) {
+                fastSwitchTypeMacro(removePadding<FAST_TYPE>((FAST_TYPE*)mPaddedHostData, (FAST_TYPE*)mHostData, (std::size_t)mWidth*mHeight*mDepth, mComponents))
+            }
+        }
     } else {
         if(!mHostHasData) {
             // Must allocate memory for host data
-            mHostData = allocateDataArray(mWidth*mHeight*mDepth,mType,mComponents);
+            mHostData = allocateHostData();
 			mHostHasData = true;
         }
         device->getCommandQueue().enqueueReadImage(*(cl::Image*)mCLImages[device],
@@ -114,6 +143,202 @@ void Image::transferCLImageToHost(OpenCLDevice::pointer device) {
     }
 }
 
+bool Image::isPaddingOnDeviceSupported(OpenCLDevice::pointer device, bool toImage) const {
+    // The normalized integer types are converted when read and written, and can't be padded by the kernels
+    if(mType == TYPE_UNORM_INT16 || mType == TYPE_SNORM_INT16)
+        return false;
+    // Adding padding requires writing to the image
+    if(toImage && mDimensions == 3 && !device->isWritingTo3DTexturesSupported())
+        return false;
+
+    return true;
+}
+
+static cl::Kernel getPaddingKernel(OpenCLDevice::pointer device, DataType type, std::string kernelName) {
+    std::string buildOptions;
+    switch(type) {
+    case TYPE_FLOAT:
+        buildOptions = "-DTYPE_FLOAT";
+        break;
+    case TYPE_UINT8:
+        buildOptions = "-DTYPE_UINT8";
+        break;
+    case TYPE_INT8:
+        buildOptions = "-DTYPE_INT8";
+        break;
+    case TYPE_UINT16:
+        buildOptions = "-DTYPE_UINT16";
+        break;
+    case TYPE_INT16:
+        buildOptions = "-DTYPE_INT16";
+        break;
+    default:
+        throw Exception("Data type not supported by the image padding kernels");
+    }
+    std::string sourceFilename = std::string(FAST_SOURCE_DIR) + "/ImagePadding.cl";
+    std::string programName = sourceFilename + buildOptions;
+    // Only create program if it doesn't exist for this device from before
+    if(!device->hasProgram(programName))
+        device->createProgramFromSourceWithName(programName, sourceFilename, buildOptions);
+    return cl::Kernel(device->getProgram(programName), kernelName.c_str());
+}
+
+void Image::padCLBufferToImage(OpenCLDevice::pointer device) {
+    cl::Kernel kernel = getPaddingKernel(device, mType, mDimensions == 2 ? "padBufferToImage2D" : "padBufferToImage3D");
+    kernel.setArg(0, *mCLBuffers[device]);
+    if(mDimensions == 2) {
+        kernel.setArg(1, *(cl::Image2D*)mCLImages[device]);
+    } else {
+        kernel.setArg(1, *(cl::Image3D*)mCLImages[device]);
+    }
+    kernel.setArg(2, (int)mComponents);
+    cl::NDRange globalSize = mDimensions == 2 ? cl::NDRange(mWidth, mHeight) : cl::NDRange(mWidth, mHeight, mDepth);
+    if(mAsynchronousTransfers) {
+        cl::Event event;
+        device->getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, cl::NullRange, NULL, &event);
+        mCLImagesEvents[device] = event;
+    } else {
+        device->getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, cl::NullRange);
+    }
+}
+
+void Image::unpadCLImageToBuffer(OpenCLDevice::pointer device) {
+    cl::Kernel kernel = getPaddingKernel(device, mType, mDimensions == 2 ? "unpadImage2DToBuffer" : "unpadImage3DToBuffer");
+    if(mDimensions == 2) {
+        kernel.setArg(0, *(cl::Image2D*)mCLImages[device]);
+    } else {
+        kernel.setArg(0, *(cl::Image3D*)mCLImages[device]);
+    }
+    kernel.setArg(1, *mCLBuffers[device]);
+    kernel.setArg(2, (int)mComponents);
+    cl::NDRange globalSize = mDimensions == 2 ? cl::NDRange(mWidth, mHeight) : cl::NDRange(mWidth, mHeight, mDepth);
+    device->getCommandQueue().enqueueNDRangeKernel(kernel, cl::NullRange, globalSize, cl::NullRange);
+}
+
+static boost::mutex transferCountersMutex;
+static unsigned long long transferCounters[4] = {0, 0, 0, 0};
+
+void Image::addBytesTransferred(ImageTransferPath path, unsigned long long bytes) {
+    boost::lock_guard<boost::mutex> lock(transferCountersMutex);
+    transferCounters[path] += bytes;
+}
+
+unsigned long long Image::getNrOfBytesTransferred(ImageTransferPath path) {
+    boost::lock_guard<boost::mutex> lock(transferCountersMutex);
+    return transferCounters[path];
+}
+
+void Image::resetTransferCounters() {
+    boost::lock_guard<boost::mutex> lock(transferCountersMutex);
+    for(int i = 0; i < 4; i++)
+        transferCounters[i] = 0;
+}
+
+bool Image::isImageFormatPadded(OpenCLDevice::pointer device) const {
+    // Images with 3 components, or 1-2 components on devices without support for those channel orders,
+    // are stored as RGBA and thus have a different layout than the buffer and host data
+    cl::ImageFormat format = getOpenCLImageFormat(device, mDimensions == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D, mType, mComponents);
+    return format.image_channel_order == CL_RGBA && mComponents != 4;
+}
+
+static bool isInSameContext(OpenCLDevice::pointer device1, OpenCLDevice::pointer device2) {
+    return device1->getContext()() == device2->getContext()();
+}
+
+/**
+ * Copy up to date data from an OpenCL image or buffer in the same context as device
+ * to the image (toImage = true) or buffer on device without going through the host.
+ * Returns false if no such data exists or it can't be copied directly.
+ */
+bool Image::transferCLDataWithinContext(OpenCLDevice::pointer device, bool toImage) {
+    // Find up to date data in the same context, prefer data on the same device
+    OpenCLDevice::pointer source;
+    bool sourceIsImage = false;
+    bool found = false;
+    for(auto iterator : mCLImagesIsUpToDate) {
+        if(iterator.second && isInSameContext(iterator.first, device) && (!found || iterator.first == device)) {
+            source = iterator.first;
+            sourceIsImage = true;
+            found = true;
+        }
+    }
+    for(auto iterator : mCLBuffersIsUpToDate) {
+        if(iterator.second && isInSameContext(iterator.first, device) && (!found || (iterator.first == device && source != device))) {
+            source = iterator.first;
+            sourceIsImage = false;
+            found = true;
+        }
+    }
+    if(!found)
+        return false;
+
+    // Image layouts must match for a direct copy
+    if(sourceIsImage && toImage) {
+        cl_mem_object_type imageType = mDimensions == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D;
+        cl::ImageFormat sourceFormat = getOpenCLImageFormat(source, imageType, mType, mComponents);
+        cl::ImageFormat destinationFormat = getOpenCLImageFormat(device, imageType, mType, mComponents);
+        if(sourceFormat.image_channel_order != destinationFormat.image_channel_order ||
+                sourceFormat.image_channel_data_type != destinationFormat.image_channel_data_type)
+            return false;
+    } else if((sourceIsImage && isImageFormatPadded(source)) || (toImage && isImageFormatPadded(device))) {
+        // Padding has to be added or removed by a kernel on the device
+        if(source != device || !isPaddingOnDeviceSupported(device, toImage))
+            return false;
+        if(toImage) {
+            padCLBufferToImage(device);
+        } else {
+            unpadCLImageToBuffer(device);
+        }
+        addBytesTransferred(TRANSFER_WITHIN_CONTEXT, getBufferSize());
+        return true;
+    }
+
+    // The copy is enqueued on the destination queue, make sure the source data is finished when it is on another device
+    if(source != device)
+        source->getCommandQueue().finish();
+
+    cl::CommandQueue queue = device->getCommandQueue();
+    cl::size_t<3> region = createRegion(mWidth, mHeight, mDimensions == 2 ? 1 : mDepth);
+    if(sourceIsImage && toImage) {
+        queue.enqueueCopyImage(*mCLImages[source], *mCLImages[device], createOrigoRegion(), createOrigoRegion(), region);
+    } else if(sourceIsImage) {
+        queue.enqueueCopyImageToBuffer(*mCLImages[source], *mCLBuffers[device], createOrigoRegion(), region, 0);
+    } else if(toImage) {
+        queue.enqueueCopyBufferToImage(*mCLBuffers[source], *mCLImages[device], 0, createOrigoRegion(), region);
+    } else {
+        queue.enqueueCopyBuffer(*mCLBuffers[source], *mCLBuffers[device], 0, 0, getBufferSize());
+    }
+    addBytesTransferred(TRANSFER_WITHIN_CONTEXT, getBufferSize());
+
+    return true;
+}
+
+/**
+ * Copy up to date data from any OpenCL image or buffer to the image (toImage = true)
+ * or buffer on device by downloading it to the host first. The host data is
+ * up to date afterwards.
+ */
+void Image::transferCLDataThroughHost(OpenCLDevice::pointer device, bool toImage) {
+    ExecutionDevice::pointer source;
+    bool sourceIsImage;
+    findDeviceWithUptodateData(&source, &sourceIsImage);
+    if(source->isHost())
+        throw Exception("Data was not updated because no data was marked as up to date");
+
+    if(sourceIsImage) {
+        transferCLImageToHost(source);
+    } else {
+        transferCLBufferToHost(source);
+    }
+    if(toImage) {
+        transferCLImageFromHost(device);
+    } else {
+        transferCLBufferFromHost(device);
+    }
+    mHostDataIsUpToDate = true;
+    addBytesTransferred(TRANSFER_STAGED_THROUGH_HOST, getBufferSize());
+}
+
 bool Image::hasAnyData() {
     return mHostHasData || mCLImages.size() > 0 || mCLBuffers.size() > 0;
 }
@@ -128,14 +353,7 @@ void Image::updateOpenCLImageData(OpenCLDevice::pointer device) {
     bool updated = false;
     if (mCLImagesIsUpToDate.count(device) == 0) {
         // Data is not on device, create it
-        cl::Image * newImage;
-        if(mDimensions == 2) {
-            newImage = new cl::Image2D(device->getContext(),
-            CL_MEM_READ_WRITE, getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE2D, mType,mComponents), mWidth, mHeight);
-        } else {
-            newImage = new cl::Image3D(device->getContext(),
-            CL_MEM_READ_WRITE, getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE3D, mType,mComponents), mWidth, mHeight, mDepth);
-        }
+        cl::Image * newImage = allocateOpenCLImage(device);
 
         if(hasAnyData()) {
             mCLImagesIsUpToDate[device] = false;
@@ -151,33 +369,13 @@ void Image::updateOpenCLImageData(OpenCLDevice::pointer device) {
 		if (mHostDataIsUpToDate) {
 			// Transfer host data to this device
 			transferCLImageFromHost(device);
+			addBytesTransferred(TRANSFER_HOST_TO_DEVICE, getBufferSize());
+			updated = true;
+		} else if(transferCLDataWithinContext(device, true)) {
 			updated = true;
 		} else {
-			boost::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
-			for (it = mCLImagesIsUpToDate.begin(); it != mCLImagesIsUpToDate.end();
-				it++) {
-				if (it->second == true) {
-					// Transfer from this device(it->first) to device
-					// TODO should use copy image to image here, if possible
-					transferCLImageToHost(it->first);
-					transferCLImageFromHost(device);
-					mHostDataIsUpToDate = true;
-					updated = true;
-					break;
-				}
-			}
-			for (it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end();
-				it++) {
-				if (it->second == true) {
-					// Transfer from this device(it->first) to device
-					// TODO should use copy buffer to image here, if possible
-					transferCLBufferToHost(it->first);
-					transferCLImageFromHost(device);
-					mHostDataIsUpToDate = true;
-					updated = true;
-					break;
-				}
-			}
+			transferCLDataThroughHost(device, true);
+			updated = true;
 		}
 	}
 
@@ -200,24 +398,31 @@ OpenCLBufferAccess::pointer Image::getOpenCLBufferAccess(
         boost::unique_lock<boost::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = true;
     }
-    updateOpenCLBufferData(device);
-    if(type == ACCESS_READ_WRITE) {
-        setAllDataToOutOfDate();
-        updateModifiedTimestamp();
+    {
+        // Several readers may update the data at the same time
+        boost::lock_guard<boost::mutex> lock(mTransferMutex);
+        updateOpenCLBufferData(device);
+        if(type == ACCESS_READ_WRITE) {
+            setAllDataToOutOfDate();
+            updateModifiedTimestamp();
+        }
+        mCLBuffersIsUpToDate[device] = true;
     }
-    mCLBuffersIsUpToDate[device] = true;
     {
         boost::unique_lock<boost::mutex> lock(mDataIsBeingAccessedMutex);
         mDataIsBeingAccessed = true;
     }
 
     // Now it is guaranteed that the data is on the device and that it is up to date
-	OpenCLBufferAccess::pointer accessObject(new OpenCLBufferAccess(mCLBuffers[device],  mPtr.lock()));
+    cl::Event event;
+    if(mCLBuffersEvents.count(device) > 0)
+        event = mCLBuffersEvents[device];
+	OpenCLBufferAccess::pointer accessObject(new OpenCLBufferAccess(mCLBuffers[device],  mPtr.lock(), event));
 	return std::move(accessObject);
 }
 
-unsigned int Image::getBufferSize() const {
-    unsigned int bufferSize = mWidth*mHeight;
+std::size_t Image::getBufferSize() const {
+    std::size_t bufferSize = (std::size_t)mWidth*mHeight;
     if(mDimensions == 3) {
         bufferSize *= mDepth;
     }
@@ -236,9 +441,7 @@ void Image::updateOpenCLBufferData(OpenCLDevice::pointer device) {
     bool updated = false;
     if (mCLBuffers.count(device) == 0) {
         // Data is not on device, create it
-        unsigned int bufferSize = getBufferSize();
-        cl::Buffer * newBuffer = new cl::Buffer(device->getContext(),
-        CL_MEM_READ_WRITE, bufferSize);
+        cl::Buffer * newBuffer = allocateOpenCLBuffer(device);
 
         if(hasAnyData()) {
             mCLBuffersIsUpToDate[device] = false;
@@ -255,31 +458,13 @@ void Image::updateOpenCLBufferData(OpenCLDevice::pointer device) {
         if (mHostDataIsUpToDate) {
             // Transfer host data to this device
             transferCLBufferFromHost(device);
+            addBytesTransferred(TRANSFER_HOST_TO_DEVICE, getBufferSize());
+            updated = true;
+        } else if(transferCLDataWithinContext(device, false)) {
             updated = true;
         } else {
-            boost::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
-            for (it = mCLImagesIsUpToDate.begin(); it != mCLImagesIsUpToDate.end();
-                    it++) {
-                if (it->second == true) {
-                    // Transfer from this device(it->first) to device
-                    transferCLImageToHost(it->first);
-                    transferCLBufferFromHost(device);
-                    mHostDataIsUpToDate = true;
-                    updated = true;
-                    break;
-                }
-            }
-            for (it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end();
-                    it++) {
-                if (it->second == true) {
-                    // Transfer from this device(it->first) to device
-                    transferCLBufferToHost(it->first);
-                    transferCLBufferFromHost(device);
-                    mHostDataIsUpToDate = true;
-                    updated = true;
-                    break;
-                }
-            }
+            transferCLDataThroughHost(device, false);
+            updated = true;
         }
     }
 
@@ -291,34 +476,75 @@ void Image::updateOpenCLBufferData(OpenCLDevice::pointer device) {
 }
 
 void Image::transferCLBufferFromHost(OpenCLDevice::pointer device) {
-    unsigned int bufferSize = getBufferSize();
-    device->getCommandQueue().enqueueWriteBuffer(*mCLBuffers[device],
-        CL_TRUE, 0, bufferSize, mHostData);
+    if(isHostDataSharedWith(device)) {
+        synchronizeSharedHostData(device, CL_MAP_WRITE);
+        return;
+    }
+    std::size_t bufferSize = getBufferSize();
+    if(mAsynchronousTransfers) {
+        cl::Event event;
+        device->getCommandQueue().enqueueWriteBuffer(*mCLBuffers[device],
+            CL_FALSE, 0, bufferSize, mHostData, NULL, &event);
+        mCLBuffersEvents[device] = event;
+    } else {
+        device->getCommandQueue().enqueueWriteBuffer(*mCLBuffers[device],
+            CL_TRUE, 0, bufferSize, mHostData);
+    }
+}
+
+void Image::waitForPendingTransfers() {
+    boost::unordered_map<OpenCLDevice::pointer, cl::Event>::iterator it;
+    for(it = mCLImagesEvents.begin(); it != mCLImagesEvents.end(); it++) {
+        it->second.wait();
+    }
+    mCLImagesEvents.clear();
+    for(it = mCLBuffersEvents.begin(); it != mCLBuffersEvents.end(); it++) {
+        it->second.wait();
+    }
+    mCLBuffersEvents.clear();
 }
 
 void Image::transferCLBufferToHost(OpenCLDevice::pointer device) {
 	if (!mHostHasData) {
 		// Must allocate memory for host data
-		mHostData = allocateDataArray(mWidth*mHeight*mDepth, mType, mComponents);
+		mHostData = allocateHostData();
 		mHostHasData = true;
 	}
-    unsigned int bufferSize = getBufferSize();
+    if(isHostDataSharedWith(device)) {
+        synchronizeSharedHostData(device, CL_MAP_READ);
+        return;
+    }
+    std::size_t bufferSize = getBufferSize();
     device->getCommandQueue().enqueueReadBuffer(*mCLBuffers[device],
         CL_TRUE, 0, bufferSize, mHostData);
 }
 
+bool Image::isHostDataSharedWith(OpenCLDevice::pointer device) const {
+    boost::unordered_map<OpenCLDevice::pointer, bool>::const_iterator it = mCLBuffersUseHostData.find(device);
+    return mHostHasData && it != mCLBuffersUseHostData.end() && it->second;
+}
+
+void Image::synchronizeSharedHostData(OpenCLDevice::pointer device, cl_map_flags flags) {
+    // The buffer uses the host data as storage, mapping and unmapping it
+    // makes the content coherent and does not copy anything on CPU devices
+    cl::CommandQueue queue = device->getCommandQueue();
+    void* ptr = queue.enqueueMapBuffer(*mCLBuffers[device], CL_TRUE, flags, 0, getBufferSize());
+    queue.enqueueUnmapMemObject(*mCLBuffers[device], ptr);
+    queue.finish();
+}
+
 void Image::updateHostData() {
     // It is the host data that has been modified, no need to update
     if (mHostDataIsUpToDate)
         return;
 
+    // Pending uploads may still be reading the host data which is about to be overwritten
+    waitForPendingTransfers();
+
     bool updated = false;
     if (!mHostHasData) {
         // Data is not initialized, do that first
-        unsigned int size = mWidth*mHeight*mComponents;
-        if(mDimensions == 3)
-            size *= mDepth;
-        mHostData = allocateDataArray(mWidth*mHeight*mDepth,mType,mComponents);
+        mHostData = allocateHostData();
         if(hasAnyData()) {
             mHostDataIsUpToDate = false;
         } else {
@@ -335,15 +561,17 @@ void Image::updateHostData() {
         if (it->second == true) {
             // transfer from this device to host
             transferCLImageToHost(it->first);
+            addBytesTransferred(TRANSFER_DEVICE_TO_HOST, getBufferSize());
             updated = true;
             break;
         }
     }
-    for (it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end();
+    for (it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end() && !updated;
             it++) {
         if (it->second == true) {
             // transfer from this device to host
             transferCLBufferToHost(it->first);
+            addBytesTransferred(TRANSFER_DEVICE_TO_HOST, getBufferSize());
             updated = true;
             break;
         }
@@ -381,23 +609,30 @@ OpenCLImageAccess::pointer Image::getOpenCLImageAccess(
     	boost::lock_guard<boost::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = true;
     }
-    updateOpenCLImageData(device);
-    if (type == ACCESS_READ_WRITE) {
-        setAllDataToOutOfDate();
-        updateModifiedTimestamp();
+    {
+        // Several readers may update the data at the same time
+        boost::lock_guard<boost::mutex> lock(mTransferMutex);
+        updateOpenCLImageData(device);
+        if (type == ACCESS_READ_WRITE) {
+            setAllDataToOutOfDate();
+            updateModifiedTimestamp();
+        }
+        mCLImagesIsUpToDate[device] = true;
     }
     {
         boost::lock_guard<boost::mutex> lock(mDataIsBeingAccessedMutex);
         mDataIsBeingAccessed = true;
     }
-    mCLImagesIsUpToDate[device] = true;
 
     // Now it is guaranteed that the data is on the device and that it is up to date
+    cl::Event event;
+    if(mCLImagesEvents.count(device) > 0)
+        event = mCLImagesEvents[device];
     if(mDimensions == 2) {
-        OpenCLImageAccess::pointer accessObject(new OpenCLImageAccess((cl::Image2D*)mCLImages[device], mPtr.lock()));
+        OpenCLImageAccess::pointer accessObject(new OpenCLImageAccess((cl::Image2D*)mCLImages[device], mPtr.lock(), event));
         return accessObject;
     } else {
-        OpenCLImageAccess::pointer accessObject(new OpenCLImageAccess((cl::Image3D*)mCLImages[device], mPtr.lock()));
+        OpenCLImageAccess::pointer accessObject(new OpenCLImageAccess((cl::Image3D*)mCLImages[device], mPtr.lock(), event));
         return accessObject;
     }
 }
@@ -408,9 +643,14 @@ Image::Image() {
     mHostDataIsUpToDate = false;
     mIsDynamicData = false;
     mSpacing = Vector3f(1,1,1);
-    mMaxMinInitialized = false;
-    mAverageInitialized = false;
+    mStatisticsInitialized = false;
+    mHistogramInitialized = false;
     mIsInitialized = false;
+    mUseStoragePool = false;
+    mAsynchronousTransfers = false;
+    mPinnedHostBuffer = NULL;
+    mHostDataIsAligned = false;
+    mPaddedHostData = NULL;
 }
 
 ImageAccess::pointer Image::getImageAccess(accessType type) {
@@ -424,12 +664,18 @@ ImageAccess::pointer Image::getImageAccess(accessType type) {
         boost::unique_lock<boost::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = true;
     }
-    updateHostData();
-    if(type == ACCESS_READ_WRITE) {
-        setAllDataToOutOfDate();
-        updateModifiedTimestamp();
+    {
+        // Several readers may update the data at the same time
+        boost::lock_guard<boost::mutex> lock(mTransferMutex);
+        updateHostData();
+        if(type == ACCESS_READ_WRITE) {
+            // Host data can't be changed before all uploads of it have finished
+            waitForPendingTransfers();
+            setAllDataToOutOfDate();
+            updateModifiedTimestamp();
+        }
+        mHostDataIsUpToDate = true;
     }
-    mHostDataIsUpToDate = true;
     {
         boost::unique_lock<boost::mutex> lock(mDataIsBeingAccessedMutex);
         mDataIsBeingAccessed = true;
@@ -510,14 +756,14 @@ void Image::create(
     mType = type;
     mComponents = nrOfComponents;
     if(device->isHost()) {
-        mHostData = allocateDataArray(width*height*depth, type, nrOfComponents);
+        mHostData = allocateHostData();
         memcpy(mHostData, data, getSizeOfDataType(type, nrOfComponents)*width*height*depth);
         mHostHasData = true;
         mHostDataIsUpToDate = true;
     } else {
         OpenCLDevice::pointer clDevice = device;
         cl::Image3D* clImage;
-        void * tempData = adaptDataToImage((void *)data, getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE3D, type, nrOfComponents).image_channel_order, width*height*depth, type, nrOfComponents);
+        void * tempData = adaptDataToImage((void *)data, getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE3D, type, nrOfComponents).image_channel_order, (std::size_t)width*height*depth, type, nrOfComponents);
         clImage = new cl::Image3D(
             clDevice->getContext(),
             CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
@@ -578,14 +824,14 @@ void Image::create(
     mType = type;
     mComponents = nrOfComponents;
     if(device->isHost()) {
-        mHostData = allocateDataArray(width*height, type, nrOfComponents);
+        mHostData = allocateHostData();
         memcpy(mHostData, data, getSizeOfDataType(type, nrOfComponents) * width * height);
         mHostHasData = true;
         mHostDataIsUpToDate = true;
     } else {
         OpenCLDevice::pointer clDevice = device;
         cl::Image2D* clImage;
-        void * tempData = adaptDataToImage((void *)data, getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE2D, type, nrOfComponents).image_channel_order, width*height, type, nrOfComponents);
+        void * tempData = adaptDataToImage((void *)data, getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE2D, type, nrOfComponents).image_channel_order, (std::size_t)width*height, type, nrOfComponents);
         clImage = new cl::Image2D(
             clDevice->getContext(),
             CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
@@ -608,21 +854,200 @@ bool Image::isInitialized() const {
     return mIsInitialized;
 }
 
+void Image::enableStoragePooling() {
+    mUseStoragePool = true;
+}
+
+void Image::disableStoragePooling() {
+    mUseStoragePool = false;
+}
+
+bool Image::isStoragePoolingEnabled() const {
+    return mUseStoragePool;
+}
+
+void Image::enableAsynchronousTransfers() {
+    mAsynchronousTransfers = true;
+}
+
+void Image::disableAsynchronousTransfers() {
+    waitForPendingTransfers();
+    mAsynchronousTransfers = false;
+}
+
+bool Image::isAsynchronousTransfersEnabled() const {
+    return mAsynchronousTransfers;
+}
+
+static bool isCPUDevice(OpenCLDevice::pointer device) {
+    return device->getDevice().getInfo<CL_DEVICE_TYPE>() == CL_DEVICE_TYPE_CPU;
+}
+
+// CPU runtimes only use host memory as buffer storage without copying if it
+// is aligned to CL_DEVICE_MEM_BASE_ADDR_ALIGN, which is given in bits
+static void* allocateAlignedDataArray(std::size_t size, OpenCLDevice::pointer device) {
+    std::size_t alignment = std::max<std::size_t>(device->getDevice().getInfo<CL_DEVICE_MEM_BASE_ADDR_ALIGN>() / 8, sizeof(void*));
+    size = ((size + alignment - 1) / alignment)*alignment;
+    void* data = NULL;
+#ifdef _WIN32
+    data = _aligned_malloc(size, alignment);
+#else
+    if(posix_memalign(&data, alignment, size) != 0)
+        data = NULL;
+#endif
+    if(data == NULL)
+        throw Exception("Failed to allocate aligned host data for the image");
+    return data;
+}
+
+static void deleteAlignedDataArray(void* data) {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    std::free(data);
+#endif
+}
+
+void Image::enablePinnedHostMemory(OpenCLDevice::pointer device) {
+    mPinnedMemoryDevice = device;
+}
+
+void Image::disablePinnedHostMemory() {
+    mPinnedMemoryDevice = OpenCLDevice::pointer();
+}
+
+bool Image::isPinnedHostMemoryEnabled() const {
+    return mPinnedMemoryDevice.isValid();
+}
+
+void* Image::allocateHostData() {
+    mHostDataDevice = mPinnedMemoryDevice;
+    if(mPinnedMemoryDevice.isValid() && !isCPUDevice(mPinnedMemoryDevice)) {
+        // Let the driver allocate page locked memory and map it to the host permanently
+        mPinnedHostBuffer = new cl::Buffer(mPinnedMemoryDevice->getContext(),
+                CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, getBufferSize());
+        return mPinnedMemoryDevice->getCommandQueue().enqueueMapBuffer(*mPinnedHostBuffer,
+                CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, getBufferSize());
+    }
+
+    if(mPinnedMemoryDevice.isValid()) {
+        // May be used as storage of the buffer of the CPU device
+        mHostDataIsAligned = true;
+        return allocateAlignedDataArray(getBufferSize(), mPinnedMemoryDevice);
+    }
+
+    if(mUseStoragePool)
+        return ImagePool::getInstance().getHostData(Vector3ui(mWidth, mHeight, mDepth), mType, mComponents);
+
+    return allocateDataArray((std::size_t)mWidth*mHeight*mDepth, mType, mComponents);
+}
+
+cl::Image* Image::allocateOpenCLImage(OpenCLDevice::pointer device) {
+    if(mUseStoragePool)
+        return ImagePool::getInstance().getOpenCLImage(device, mDimensions, Vector3ui(mWidth, mHeight, mDepth), mType, mComponents);
+
+    cl::Image* image;
+    if(mDimensions == 2) {
+        image = new cl::Image2D(device->getContext(),
+        CL_MEM_READ_WRITE, getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE2D, mType,mComponents), mWidth, mHeight);
+    } else {
+        image = new cl::Image3D(device->getContext(),
+        CL_MEM_READ_WRITE, getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE3D, mType,mComponents), mWidth, mHeight, mDepth);
+    }
+    return image;
+}
+
+cl::Buffer* Image::allocateOpenCLBuffer(OpenCLDevice::pointer device) {
+    mCLBuffersUseHostData[device] = false;
+    if(mPinnedMemoryDevice.isValid() && mPinnedMemoryDevice == device && isCPUDevice(device)) {
+        // Use the host data as storage for the buffer
+        if(!mHostHasData) {
+            bool hasOtherData = hasAnyData();
+            mHostData = allocateHostData();
+            mHostHasData = true;
+            mHostDataIsUpToDate = !hasOtherData;
+        }
+        // Host data allocated before pinned memory was enabled can't be used
+        if(mHostDataIsAligned && mHostDataDevice == device) {
+            mCLBuffersUseHostData[device] = true;
+            return new cl::Buffer(device->getContext(), CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, getBufferSize(), mHostData);
+        }
+    }
+
+    if(mUseStoragePool)
+        return ImagePool::getInstance().getOpenCLBuffer(device, Vector3ui(mWidth, mHeight, mDepth), mType, mComponents);
+
+    return new cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, getBufferSize());
+}
+
+void Image::deleteHostData() {
+    waitForPendingTransfers();
+    if(mPinnedHostBuffer != NULL) {
+        cl::CommandQueue queue = mHostDataDevice->getCommandQueue();
+        queue.enqueueUnmapMemObject(*mPinnedHostBuffer, mHostData);
+        queue.finish();
+        delete mPinnedHostBuffer;
+        mPinnedHostBuffer = NULL;
+        mHostDataDevice = OpenCLDevice::pointer();
+        mHostData = NULL;
+        return;
+    }
+    if(isHostDataSharedWith(mHostDataDevice) && mCLBuffers.count(mHostDataDevice) > 0) {
+        // The buffer using the host data as storage can't outlive it
+        delete mCLBuffers[mHostDataDevice];
+        mCLBuffers.erase(mHostDataDevice);
+        mCLBuffersIsUpToDate.erase(mHostDataDevice);
+        mCLBuffersEvents.erase(mHostDataDevice);
+        mCLBuffersUseHostData.erase(mHostDataDevice);
+    }
+    mHostDataDevice = OpenCLDevice::pointer();
+    if(mHostDataIsAligned) {
+        deleteAlignedDataArray(mHostData);
+        mHostDataIsAligned = false;
+    } else if(mUseStoragePool) {
+        ImagePool::getInstance().returnHostData(mHostData, Vector3ui(mWidth, mHeight, mDepth), mType, mComponents);
+    } else {
+        deleteArray(mHostData, mType);
+    }
+    mHostData = NULL;
+}
+
+void Image::deleteOpenCLImage(OpenCLDevice::pointer device, cl::Image* image) {
+    if(mUseStoragePool) {
+        ImagePool::getInstance().returnOpenCLImage(image, device, mDimensions, Vector3ui(mWidth, mHeight, mDepth), mType, mComponents);
+    } else {
+        delete image;
+    }
+}
+
+void Image::deleteOpenCLBuffer(OpenCLDevice::pointer device, cl::Buffer* buffer) {
+    if(mUseStoragePool && !isHostDataSharedWith(device)) {
+        ImagePool::getInstance().returnOpenCLBuffer(buffer, device, Vector3ui(mWidth, mHeight, mDepth), mType, mComponents);
+    } else {
+        delete buffer;
+    }
+}
+
 void Image::free(ExecutionDevice::pointer device) {
     // Delete data on a specific device
     if(device->isHost()) {
-        deleteArray(mHostData, mType);
+        deleteHostData();
         mHostHasData = false;
     } else {
         OpenCLDevice::pointer clDevice = device;
         // Delete any OpenCL images
-        delete mCLImages[clDevice];
+        if(mCLImages.count(clDevice) > 0)
+            deleteOpenCLImage(clDevice, mCLImages[clDevice]);
         mCLImages.erase(clDevice);
         mCLImagesIsUpToDate.erase(clDevice);
+        mCLImagesEvents.erase(clDevice);
         // Delete any OpenCL buffers
-        delete mCLBuffers[clDevice];
+        if(mCLBuffers.count(clDevice) > 0)
+            deleteOpenCLBuffer(clDevice, mCLBuffers[clDevice]);
         mCLBuffers.erase(clDevice);
         mCLBuffersIsUpToDate.erase(clDevice);
+        mCLBuffersEvents.erase(clDevice);
+        mCLBuffersUseHostData.erase(clDevice);
     }
 }
 
@@ -630,7 +1055,7 @@ void Image::freeAll() {
     // Delete OpenCL Images
     boost::unordered_map<OpenCLDevice::pointer, cl::Image*>::iterator it;
     for (it = mCLImages.begin(); it != mCLImages.end(); it++) {
-        delete it->second;
+        deleteOpenCLImage(it->first, it->second);
     }
     mCLImages.clear();
     mCLImagesIsUpToDate.clear();
@@ -638,15 +1063,20 @@ void Image::freeAll() {
     // Delete OpenCL buffers
     boost::unordered_map<OpenCLDevice::pointer, cl::Buffer*>::iterator it2;
     for (it2 = mCLBuffers.begin(); it2 != mCLBuffers.end(); it2++) {
-        delete it2->second;
+        deleteOpenCLBuffer(it2->first, it2->second);
     }
     mCLBuffers.clear();
     mCLBuffersIsUpToDate.clear();
+    mCLBuffersUseHostData.clear();
 
     // Delete host data
     if(mHostHasData) {
         this->free(Host::getInstance());
     }
+    if(mPaddedHostData != NULL) {
+        deleteArray(mPaddedHostData, mType);
+        mPaddedHostData = NULL;
+    }
 }
 
 unsigned int Image::getWidth() const {
@@ -699,184 +1129,104 @@ void fast::Image::setSpacing(Vector3f spacing) {
     mSpacing = spacing;
 }
 
-void Image::calculateMaxAndMinIntensity() {
-    // Calculate max and min if image has changed or it is the first time
-    if(!mMaxMinInitialized || mMaxMinTimestamp != getTimestamp()) {
+void Image::calculateStatistics() {
+    if(!isInitialized())
+        throw Exception("Image has not been initialized.");
 
-        unsigned int nrOfElements = mWidth*mHeight*mDepth*mComponents;
-        if(mHostHasData && mHostDataIsUpToDate) {
-            // Host data is up to date, calculate min and max on host
-            ImageAccess::pointer access = getImageAccess(ACCESS_READ);
-            void* data = access->get();
-            switch(mType) {
-            case TYPE_FLOAT:
-            case TYPE_SNORM_INT16:
-            case TYPE_UNORM_INT16:
-                getMaxAndMinFromData<float>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            case TYPE_INT8:
-                getMaxAndMinFromData<char>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            case TYPE_UINT8:
-                getMaxAndMinFromData<uchar>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            case TYPE_INT16:
-                getMaxAndMinFromData<short>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            case TYPE_UINT16:
-                getMaxAndMinFromData<ushort>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            }
-        } else {
-            // TODO the logic here can be improved. For instance choose the best device
-            // Find some OpenCL image data or buffer data that is up to date
-            bool found = false;
-            boost::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
-            for (it = mCLImagesIsUpToDate.begin(); it != mCLImagesIsUpToDate.end(); it++) {
-                if(it->second == true) {
-                    OpenCLDevice::pointer device = it->first;
-                    if(mDimensions == 2) {
-                        OpenCLImageAccess::pointer access = getOpenCLImageAccess(ACCESS_READ, device);
-                        cl::Image2D* clImage = access->get2DImage();
-                        getMaxAndMinFromOpenCLImage(device, *clImage, mType, &mMinimumIntensity, &mMaximumIntensity);
-                    } else {
-                        if(device->getDevice().getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_3d_image_writes") == std::string::npos) {
-                            // Writing to 3D images is not supported on this device
-                            // Copy data to buffer instead and do the max min calculation on the buffer instead
-                            OpenCLBufferAccess::pointer access = getOpenCLBufferAccess(ACCESS_READ, device);
-                            cl::Buffer* buffer = access->get();
-                            getMaxAndMinFromOpenCLBuffer(device, *buffer, nrOfElements, mType, &mMinimumIntensity, &mMaximumIntensity);
-                        } else {
-                            OpenCLImageAccess::pointer access = getOpenCLImageAccess(ACCESS_READ, device);
-                            cl::Image3D* clImage = access->get3DImage();
-                            getMaxAndMinFromOpenCLImage(device, *clImage, mType, &mMinimumIntensity, &mMaximumIntensity);
-                        }
-                    }
-                    found = true;
-                }
-            }
+    // Only calculate the statistics again if the image has changed
+    if(mStatisticsInitialized && mStatisticsTimestamp == getTimestamp())
+        return;
 
-            if(!found) {
-                for (it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end(); it++) {
-                    if(it->second == true) {
-                        OpenCLDevice::pointer device = it->first;
-                        OpenCLBufferAccess::pointer access = getOpenCLBufferAccess(ACCESS_READ, device);
-                        cl::Buffer* buffer = access->get();
-                        getMaxAndMinFromOpenCLBuffer(device, *buffer, nrOfElements, mType, &mMinimumIntensity, &mMaximumIntensity);
-                        found = true;
-                    }
-                }
-            }
+    ImageReduction& reduction = ImageReduction::getInstance();
+    const std::size_t nrOfElements = getBufferSize() / getSizeOfDataType(mType, 1);
+    if(mHostHasData && mHostDataIsUpToDate) {
+        // Host data is up to date, calculate on host
+        ImageAccess::pointer access = getImageAccess(ACCESS_READ);
+        mStatistics = reduction.calculateStatistics(access->get(), nrOfElements, mType);
+    } else {
+        ExecutionDevice::pointer device;
+        bool isOpenCLImage;
+        findDeviceWithUptodateData(&device, &isOpenCLImage);
+        OpenCLDevice::pointer clDevice = device;
+        if(isOpenCLImage) {
+            OpenCLImageAccess::pointer access = getOpenCLImageAccess(ACCESS_READ, clDevice);
+            mStatistics = reduction.calculateStatistics(clDevice, access->get(), mDimensions, mType, mComponents, access->getEventWaitList());
+        } else {
+            OpenCLBufferAccess::pointer access = getOpenCLBufferAccess(ACCESS_READ, clDevice);
+            mStatistics = reduction.calculateStatistics(clDevice, access->get(), nrOfElements, mType, access->getEventWaitList());
         }
-
-        // Update timestamp
-        mMaxMinTimestamp = getTimestamp();
-        mMaxMinInitialized = true;
     }
+
+    mStatisticsTimestamp = getTimestamp();
+    mStatisticsInitialized = true;
 }
 
 float Image::calculateAverageIntensity() {
-     if(!isInitialized())
-        throw Exception("Image has not been initialized.");
-
-    // Calculate max and min if image has changed or it is the first time
-    if(!mAverageInitialized || mAverageIntensityTimestamp != getTimestamp()) {
-        unsigned int nrOfElements = mWidth*mHeight*mDepth;
-        if(mHostHasData && mHostDataIsUpToDate) {
-            reportInfo() << "calculating sum on host" << Reporter::end;
-            // Host data is up to date, calculate min and max on host
-            ImageAccess::pointer access = getImageAccess(ACCESS_READ);
-            void* data = access->get();
-            switch(mType) {
-            case TYPE_FLOAT:
-                mAverageIntensity = getSumFromData<float>(data,nrOfElements) / nrOfElements;
-                break;
-            case TYPE_INT8:
-                mAverageIntensity = getSumFromData<char>(data,nrOfElements) / nrOfElements;
-                break;
-            case TYPE_UINT8:
-                mAverageIntensity = getSumFromData<uchar>(data,nrOfElements) / nrOfElements;
-                break;
-            case TYPE_INT16:
-                mAverageIntensity = getSumFromData<short>(data,nrOfElements) / nrOfElements;
-                break;
-            case TYPE_UINT16:
-                mAverageIntensity = getSumFromData<ushort>(data,nrOfElements) / nrOfElements;
-                break;
-            }
-        } else {
-            reportInfo() << "calculating sum with OpenCL" << Reporter::end;
-            // TODO the logic here can be improved. For instance choose the best device
-            // Find some OpenCL image data or buffer data that is up to date
-            bool found = false;
-            boost::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
-            for (it = mCLImagesIsUpToDate.begin(); it != mCLImagesIsUpToDate.end(); it++) {
-                if(it->second == true) {
-                    OpenCLDevice::pointer device = it->first;
-                    float sum;
-                    if(mDimensions == 2) {
-                        OpenCLImageAccess::pointer access = getOpenCLImageAccess(ACCESS_READ, device);
-                        cl::Image2D* clImage = access->get2DImage();
-                        getIntensitySumFromOpenCLImage(device, *clImage, mType, &sum);
-                    } else {
-                        if(!device->isWritingTo3DTexturesSupported()) {
-                            // Writing to 3D images is not supported on this device
-                            // Copy data to buffer instead and do the max min calculation on the buffer instead
-                            OpenCLBufferAccess::pointer access = getOpenCLBufferAccess(ACCESS_READ, device);
-                            cl::Buffer* buffer = access->get();
-                            // TODO
-                            throw Exception("Not implemented yet");
-                            //getMaxAndMinFromOpenCLBuffer(device, *buffer, nrOfElements, mType, &mMinimumIntensity, &mMaximumIntensity);
-                        } else {
-                            OpenCLImageAccess::pointer access = getOpenCLImageAccess(ACCESS_READ, device);
-                            cl::Image3D* clImage = access->get3DImage();
-                            // TODO
-                            throw Exception("Not implemented yet");
-                            //getIntensitySumFromOpenCLImage(device, *clImage, mType, &sum);
-                        }
-                    }
-                    mAverageIntensity = sum / nrOfElements;
-                    found = true;
-                }
-            }
+    calculateStatistics();
+    return mStatistics.getMean();
+}
 
-            if(!found) {
-                for (it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end(); it++) {
-                    if(it->second == true) {
-                        OpenCLDevice::pointer device = it->first;
-                        OpenCLBufferAccess::pointer access = getOpenCLBufferAccess(ACCESS_READ, device);
-                        cl::Buffer* buffer = access->get();
-                        // TODO
-                            throw Exception("Not implemented yet");
-                        //getMaxAndMinFromOpenCLBuffer(device, *buffer, nrOfElements, mType, &mMinimumIntensity, &mMaximumIntensity);
-                        found = true;
-                    }
-                }
-            }
-        }
+float Image::calculateMaximumIntensity() {
+    calculateStatistics();
+    return mStatistics.maximum;
+}
 
-        // Update timestamp
-        mAverageIntensityTimestamp = getTimestamp();
-        mAverageInitialized = true;
-    }
+float Image::calculateMinimumIntensity() {
+    calculateStatistics();
+    return mStatistics.minimum;
+}
 
-    return mAverageIntensity;
+float Image::calculateIntensityVariance() {
+    calculateStatistics();
+    return mStatistics.getVariance();
 }
 
-float Image::calculateMaximumIntensity() {
-    if(!isInitialized())
-        throw Exception("Image has not been initialized.");
-    calculateMaxAndMinIntensity();
+double Image::calculateIntensitySum() {
+    calculateStatistics();
+    return mStatistics.getSum();
+}
 
-    return mMaximumIntensity;
+std::vector<uint> Image::calculateHistogram(uint nrOfBins) {
+    float minimum = calculateMinimumIntensity();
+    float maximum = calculateMaximumIntensity();
+    // All values of a constant image go in the first bin
+    if(maximum <= minimum)
+        maximum = minimum + 1.0f;
+    return calculateHistogram(nrOfBins, minimum, maximum);
 }
 
-float Image::calculateMinimumIntensity() {
+std::vector<uint> Image::calculateHistogram(uint nrOfBins, float minimum, float maximum) {
     if(!isInitialized())
         throw Exception("Image has not been initialized.");
-    calculateMaxAndMinIntensity();
 
-    return mMinimumIntensity;
+    if(mHistogramInitialized && mHistogramTimestamp == getTimestamp() && mHistogram.size() == nrOfBins &&
+            mHistogramMinimum == minimum && mHistogramMaximum == maximum)
+        return mHistogram;
+
+    ImageReduction& reduction = ImageReduction::getInstance();
+    const std::size_t nrOfElements = getBufferSize() / getSizeOfDataType(mType, 1);
+    if(mHostHasData && mHostDataIsUpToDate) {
+        ImageAccess::pointer access = getImageAccess(ACCESS_READ);
+        mHistogram = reduction.calculateHistogram(access->get(), nrOfElements, mType, nrOfBins, minimum, maximum);
+    } else {
+        ExecutionDevice::pointer device;
+        bool isOpenCLImage;
+        findDeviceWithUptodateData(&device, &isOpenCLImage);
+        OpenCLDevice::pointer clDevice = device;
+        if(isOpenCLImage) {
+            OpenCLImageAccess::pointer access = getOpenCLImageAccess(ACCESS_READ, clDevice);
+            mHistogram = reduction.calculateHistogram(clDevice, access->get(), mDimensions, mType, mComponents, nrOfBins, minimum, maximum, access->getEventWaitList());
+        } else {
+            OpenCLBufferAccess::pointer access = getOpenCLBufferAccess(ACCESS_READ, clDevice);
+            mHistogram = reduction.calculateHistogram(clDevice, access->get(), nrOfElements, mType, nrOfBins, minimum, maximum, access->getEventWaitList());
+        }
+    }
+
+    mHistogramMinimum = minimum;
+    mHistogramMaximum = maximum;
+    mHistogramTimestamp = getTimestamp();
+    mHistogramInitialized = true;
+    return mHistogram;
 }
 
 void Image::createFromImage(
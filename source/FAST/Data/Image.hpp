@@ -4,6 +4,7 @@
 #include "SpatialDataObject.hpp"
 #include "DynamicData.hpp"
 #include "DataTypes.hpp"
+#include "ImageReduction.hpp"
 #include "FAST/SmartPointers.hpp"
 #include "FAST/ExecutionDevice.hpp"
 #include "FAST/Data/Access/OpenCLImageAccess.hpp"
@@ -13,6 +14,14 @@
 #include <boost/unordered_set.hpp>
 namespace fast {
 
+// The different ways data can be moved between the storages of an image
+enum ImageTransferPath {
+    TRANSFER_HOST_TO_DEVICE,
+    TRANSFER_DEVICE_TO_HOST,
+    TRANSFER_WITHIN_CONTEXT, // Direct copy between images/buffers in the same OpenCL context
+    TRANSFER_STAGED_THROUGH_HOST // Copy between OpenCL contexts, or layouts that can't be copied directly
+};
+
 class Image : public SpatialDataObject {
     FAST_OBJECT(Image)
     public:
@@ -40,9 +49,24 @@ class Image : public SpatialDataObject {
         Vector3f getSpacing() const;
         void setSpacing(Vector3f spacing);
 
+        /**
+         * Intensity statistics of all components. The minimum, maximum, average,
+         * variance and sum are calculated together in one pass over the data
+         * where it is up to date, and are not calculated again until the image
+         * is modified.
+         */
         float calculateMaximumIntensity();
         float calculateMinimumIntensity();
         float calculateAverageIntensity();
+        float calculateIntensityVariance();
+        double calculateIntensitySum();
+        /**
+         * Histogram of the intensities of all components in the range
+         * [minimum, maximum], with the maximum in the last bin. Without a range
+         * the minimum and maximum intensity of the image is used.
+         */
+        std::vector<uint> calculateHistogram(uint nrOfBins);
+        std::vector<uint> calculateHistogram(uint nrOfBins, float minimum, float maximum);
 
         // Copy image and put contents to specific device
         Image::pointer copy(ExecutionDevice::pointer device);
@@ -53,6 +77,44 @@ class Image : public SpatialDataObject {
         // Override
         BoundingBox getTransformedBoundingBox() const;
 
+        /**
+         * When storage pooling is enabled, host data, OpenCL images and buffers
+         * are taken from and given back to the ImagePool instead of being
+         * allocated and deleted.
+         */
+        void enableStoragePooling();
+        void disableStoragePooling();
+        bool isStoragePoolingEnabled() const;
+
+        /**
+         * When asynchronous transfers are enabled, uploads from host to OpenCL
+         * devices do not block. The access objects carry the event of the upload
+         * so that commands using the data can wait on it instead of the host thread.
+         */
+        void enableAsynchronousTransfers();
+        void disableAsynchronousTransfers();
+        bool isAsynchronousTransfersEnabled() const;
+
+        /**
+         * Allocate host data as pinned memory (a CL_MEM_ALLOC_HOST_PTR buffer
+         * mapped to the host) in the context of the given device, which makes
+         * transfers to and from OpenCL devices faster. On CPU devices the host
+         * data is instead aligned to CL_DEVICE_MEM_BASE_ADDR_ALIGN and used as
+         * storage of the OpenCL buffer of the device (CL_MEM_USE_HOST_PTR), so
+         * that host and buffer access use the same memory without copies.
+         * Affects host data and buffers allocated after this call.
+         */
+        void enablePinnedHostMemory(OpenCLDevice::pointer device);
+        void disablePinnedHostMemory();
+        bool isPinnedHostMemoryEnabled() const;
+
+        /**
+         * Total nr of bytes moved by all images through the given transfer path
+         * since the program started or the counters were reset.
+         */
+        static unsigned long long getNrOfBytesTransferred(ImageTransferPath path);
+        static void resetTransferCounters();
+
     protected:
         Image();
 
@@ -65,11 +127,35 @@ class Image : public SpatialDataObject {
         // OpenCL Buffers
         boost::unordered_map<OpenCLDevice::pointer, cl::Buffer*> mCLBuffers;
         boost::unordered_map<OpenCLDevice::pointer, bool> mCLBuffersIsUpToDate;
+        // True for buffers created with the host data as storage (CL_MEM_USE_HOST_PTR)
+        boost::unordered_map<OpenCLDevice::pointer, bool> mCLBuffersUseHostData;
+
+        // Events of non-blocking uploads to the OpenCL images and buffers
+        boost::unordered_map<OpenCLDevice::pointer, cl::Event> mCLImagesEvents;
+        boost::unordered_map<OpenCLDevice::pointer, cl::Event> mCLBuffersEvents;
 
         // Host data
         void * mHostData;
         bool mHostHasData;
         bool mHostDataIsUpToDate;
+        // Device requested for pinned host memory, and the device the current host data was allocated with
+        OpenCLDevice::pointer mPinnedMemoryDevice;
+        OpenCLDevice::pointer mHostDataDevice;
+        // Mapped buffer backing the host data in pinned mode
+        cl::Buffer* mPinnedHostBuffer;
+        // Host data allocated aligned to the base address alignment of a CPU device, so it can back a buffer
+        bool mHostDataIsAligned;
+        // Staging array for images stored with a padded 4 channel layout, reused between transfers
+        void * mPaddedHostData;
+
+        void* allocateHostData();
+        bool isHostDataSharedWith(OpenCLDevice::pointer device) const;
+        void synchronizeSharedHostData(OpenCLDevice::pointer device, cl_map_flags flags);
+        cl::Image* allocateOpenCLImage(OpenCLDevice::pointer device);
+        cl::Buffer* allocateOpenCLBuffer(OpenCLDevice::pointer device);
+        void deleteHostData();
+        void deleteOpenCLImage(OpenCLDevice::pointer device, cl::Image* image);
+        void deleteOpenCLBuffer(OpenCLDevice::pointer device, cl::Buffer* buffer);
 
         void setAllDataToOutOfDate();
         bool isInitialized() const;
@@ -84,24 +170,43 @@ class Image : public SpatialDataObject {
         void transferCLBufferFromHost(OpenCLDevice::pointer device);
         void transferCLBufferToHost(OpenCLDevice::pointer device);
 
+        bool transferCLDataWithinContext(OpenCLDevice::pointer device, bool toImage);
+        void transferCLDataThroughHost(OpenCLDevice::pointer device, bool toImage);
+        bool isImageFormatPadded(OpenCLDevice::pointer device) const;
+        bool isPaddingOnDeviceSupported(OpenCLDevice::pointer device, bool toImage) const;
+        void padCLBufferToImage(OpenCLDevice::pointer device);
+        void unpadCLImageToBuffer(OpenCLDevice::pointer device);
+        static void addBytesTransferred(ImageTransferPath path, unsigned long long bytes);
+
         void updateHostData();
+        // Block until all non-blocking uploads of the host data have finished
+        void waitForPendingTransfers();
 
         bool hasAnyData();
 
-        uint getBufferSize() const;
+        std::size_t getBufferSize() const;
 
         uint mWidth, mHeight, mDepth;
         uchar mDimensions;
         DataType mType;
         uint mComponents;
         bool mIsInitialized;
+        bool mUseStoragePool;
+        bool mAsynchronousTransfers;
+        // Serializes the updating of the storages when the image is accessed from several threads
+        boost::mutex mTransferMutex;
 
         Vector3f mSpacing;
 
-        float mMaximumIntensity, mMinimumIntensity, mAverageIntensity;
-        unsigned long mMaxMinTimestamp, mAverageIntensityTimestamp;
-        bool mMaxMinInitialized, mAverageInitialized;
-        void calculateMaxAndMinIntensity();
+        ImageStatistics mStatistics;
+        unsigned long mStatisticsTimestamp;
+        bool mStatisticsInitialized;
+        void calculateStatistics();
+
+        std::vector<uint> mHistogram;
+        float mHistogramMinimum, mHistogramMaximum;
+        unsigned long mHistogramTimestamp;
+        bool mHistogramInitialized;
 
         // Declare as friends so they can get access to the accessFinished methods
         friend class ImageAccess;
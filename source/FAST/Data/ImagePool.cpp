@@ -0,0 +1,199 @@
+#include "FAST/Data/ImagePool.hpp"
+#include "FAST/Utility.hpp"
+
+namespace fast {
+
+ImagePool& ImagePool::getInstance() {
+    static ImagePool instance;
+    return instance;
+}
+
+ImagePool::ImagePool() {
+    mMaximumNrOfFreeObjects = 4;
+    mHits = 0;
+    mMisses = 0;
+}
+
+ImagePool::~ImagePool() {
+    clear();
+}
+
+bool ImagePool::Key::operator<(const Key& other) const {
+    if(device != other.device)
+        return device < other.device;
+    if(dimensions != other.dimensions)
+        return dimensions < other.dimensions;
+    if(width != other.width)
+        return width < other.width;
+    if(height != other.height)
+        return height < other.height;
+    if(depth != other.depth)
+        return depth < other.depth;
+    if(type != other.type)
+        return type < other.type;
+    return components < other.components;
+}
+
+ImagePool::Key ImagePool::createKey(std::size_t device, uchar dimensions, Vector3ui size, DataType type, uint nrOfComponents) const {
+    Key key;
+    key.device = device;
+    key.dimensions = dimensions;
+    key.width = size.x();
+    key.height = size.y();
+    key.depth = size.z();
+    key.type = type;
+    key.components = nrOfComponents;
+    return key;
+}
+
+void* ImagePool::getHostData(Vector3ui size, DataType type, uint nrOfComponents) {
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        Key key = createKey(0, 0, size, type, nrOfComponents);
+        std::map<Key, std::vector<void*> >::iterator it = mHostData.find(key);
+        if(it != mHostData.end() && it->second.size() > 0) {
+            void* data = it->second.back();
+            it->second.pop_back();
+            mHits++;
+            return data;
+        }
+        mMisses++;
+    }
+
+    return allocateDataArray((std::size_t)size.x()*size.y()*size.z(), type, nrOfComponents);
+}
+
+void ImagePool::returnHostData(void* data, Vector3ui size, DataType type, uint nrOfComponents) {
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        std::vector<void*>& freeObjects = mHostData[createKey(0, 0, size, type, nrOfComponents)];
+        if(freeObjects.size() < mMaximumNrOfFreeObjects) {
+            freeObjects.push_back(data);
+            return;
+        }
+    }
+
+    // Pool is full, delete the data instead
+    deleteArray(data, type);
+}
+
+cl::Image* ImagePool::getOpenCLImage(OpenCLDevice::pointer device, uchar dimensions, Vector3ui size, DataType type, uint nrOfComponents) {
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        Key key = createKey((std::size_t)device.getPtr().get(), dimensions, size, type, nrOfComponents);
+        std::map<Key, std::vector<cl::Image*> >::iterator it = mCLImages.find(key);
+        if(it != mCLImages.end() && it->second.size() > 0) {
+            cl::Image* image = it->second.back();
+            it->second.pop_back();
+            mHits++;
+            return image;
+        }
+        mMisses++;
+    }
+
+    cl::Image* image;
+    if(dimensions == 2) {
+        image = new cl::Image2D(device->getContext(),
+        CL_MEM_READ_WRITE, getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE2D, type, nrOfComponents), size.x(), size.y());
+    } else {
+        image = new cl::Image3D(device->getContext(),
+        CL_MEM_READ_WRITE, getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE3D, type, nrOfComponents), size.x(), size.y(), size.z());
+    }
+    return image;
+}
+
+void ImagePool::returnOpenCLImage(cl::Image* image, OpenCLDevice::pointer device, uchar dimensions, Vector3ui size, DataType type, uint nrOfComponents) {
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        std::vector<cl::Image*>& freeObjects = mCLImages[createKey((std::size_t)device.getPtr().get(), dimensions, size, type, nrOfComponents)];
+        if(freeObjects.size() < mMaximumNrOfFreeObjects) {
+            freeObjects.push_back(image);
+            return;
+        }
+    }
+
+    delete image;
+}
+
+cl::Buffer* ImagePool::getOpenCLBuffer(OpenCLDevice::pointer device, Vector3ui size, DataType type, uint nrOfComponents) {
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        Key key = createKey((std::size_t)device.getPtr().get(), 0, size, type, nrOfComponents);
+        std::map<Key, std::vector<cl::Buffer*> >::iterator it = mCLBuffers.find(key);
+        if(it != mCLBuffers.end() && it->second.size() > 0) {
+            cl::Buffer* buffer = it->second.back();
+            it->second.pop_back();
+            mHits++;
+            return buffer;
+        }
+        mMisses++;
+    }
+
+    return new cl::Buffer(device->getContext(), CL_MEM_READ_WRITE,
+            getSizeOfDataType(type, nrOfComponents)*size.x()*size.y()*size.z());
+}
+
+void ImagePool::returnOpenCLBuffer(cl::Buffer* buffer, OpenCLDevice::pointer device, Vector3ui size, DataType type, uint nrOfComponents) {
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        std::vector<cl::Buffer*>& freeObjects = mCLBuffers[createKey((std::size_t)device.getPtr().get(), 0, size, type, nrOfComponents)];
+        if(freeObjects.size() < mMaximumNrOfFreeObjects) {
+            freeObjects.push_back(buffer);
+            return;
+        }
+    }
+
+    delete buffer;
+}
+
+void ImagePool::setMaximumNumberOfFreeObjects(uint nrOfObjects) {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    mMaximumNrOfFreeObjects = nrOfObjects;
+}
+
+uint ImagePool::getMaximumNumberOfFreeObjects() const {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return mMaximumNrOfFreeObjects;
+}
+
+unsigned long ImagePool::getNumberOfHits() const {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return mHits;
+}
+
+unsigned long ImagePool::getNumberOfMisses() const {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return mMisses;
+}
+
+void ImagePool::resetCounters() {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    mHits = 0;
+    mMisses = 0;
+}
+
+void ImagePool::clear() {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    std::map<Key, std::vector<void*> >::iterator it;
+    for(it = mHostData.begin(); it != mHostData.end(); it++) {
+        for(int i = 0; i < it->second.size(); i++)
+            deleteArray(it->second[i], it->first.type);
+    }
+    mHostData.clear();
+
+    std::map<Key, std::vector<cl::Image*> >::iterator it2;
+    for(it2 = mCLImages.begin(); it2 != mCLImages.end(); it2++) {
+        for(int i = 0; i < it2->second.size(); i++)
+            delete it2->second[i];
+    }
+    mCLImages.clear();
+
+    std::map<Key, std::vector<cl::Buffer*> >::iterator it3;
+    for(it3 = mCLBuffers.begin(); it3 != mCLBuffers.end(); it3++) {
+        for(int i = 0; i < it3->second.size(); i++)
+            delete it3->second[i];
+    }
+    mCLBuffers.clear();
+}
+
+} // end namespace fast
@@ -0,0 +1,72 @@
+#ifndef IMAGE_POOL_HPP_
+#define IMAGE_POOL_HPP_
+
+#include "FAST/Object.hpp"
+#include "FAST/ExecutionDevice.hpp"
+#include "FAST/Data/DataTypes.hpp"
+#include <boost/thread.hpp>
+#include <map>
+#include <vector>
+
+namespace fast {
+
+/**
+ * Singleton class which keeps the storage (host arrays, OpenCL images and buffers)
+ * of deleted images so that it can be reused by new images with the same
+ * size, data type, nr of components and device. This avoids constant allocation
+ * and deallocation in streaming pipelines where each frame is a new image.
+ */
+class ImagePool : public Object {
+    public:
+        static ImagePool& getInstance();
+
+        void* getHostData(Vector3ui size, DataType type, uint nrOfComponents);
+        void returnHostData(void* data, Vector3ui size, DataType type, uint nrOfComponents);
+        cl::Image* getOpenCLImage(OpenCLDevice::pointer device, uchar dimensions, Vector3ui size, DataType type, uint nrOfComponents);
+        void returnOpenCLImage(cl::Image* image, OpenCLDevice::pointer device, uchar dimensions, Vector3ui size, DataType type, uint nrOfComponents);
+        cl::Buffer* getOpenCLBuffer(OpenCLDevice::pointer device, Vector3ui size, DataType type, uint nrOfComponents);
+        void returnOpenCLBuffer(cl::Buffer* buffer, OpenCLDevice::pointer device, Vector3ui size, DataType type, uint nrOfComponents);
+
+        /**
+         * Set the maximum number of unused objects which are kept in the pool
+         * for each combination of size, type, components and device.
+         */
+        void setMaximumNumberOfFreeObjects(uint nrOfObjects);
+        uint getMaximumNumberOfFreeObjects() const;
+
+        // Counters
+        unsigned long getNumberOfHits() const;
+        unsigned long getNumberOfMisses() const;
+        void resetCounters();
+
+        // Delete all unused objects in the pool
+        void clear();
+        ~ImagePool();
+    private:
+        ImagePool();
+        ImagePool(ImagePool const&); // Don't implement
+        void operator=(ImagePool const&); // Don't implement
+
+        struct Key {
+            std::size_t device; // 0 for host
+            uchar dimensions;
+            uint width, height, depth;
+            DataType type;
+            uint components;
+            bool operator<(const Key& other) const;
+        };
+        Key createKey(std::size_t device, uchar dimensions, Vector3ui size, DataType type, uint nrOfComponents) const;
+
+        std::map<Key, std::vector<void*> > mHostData;
+        std::map<Key, std::vector<cl::Image*> > mCLImages;
+        std::map<Key, std::vector<cl::Buffer*> > mCLBuffers;
+
+        uint mMaximumNrOfFreeObjects;
+        unsigned long mHits;
+        unsigned long mMisses;
+        mutable boost::mutex mMutex;
+};
+
+} // end namespace fast
+
+#endif
@@ -0,0 +1,366 @@
+#include "FAST/Data/ImageReduction.hpp"
+#include "FAST/Exception.hpp"
+#include <limits>
+#include <algorithm>
+
+namespace fast {
+
+ImageStatistics::ImageStatistics() :
+        minimum(std::numeric_limits<float>::max()),
+        maximum(-std::numeric_limits<float>::max()),
+        mean(0),
+        sumOfSquaredDifferences(0),
+        nrOfElements(0) {
+}
+
+void ImageStatistics::add(float value) {
+    if(value < minimum)
+        minimum = value;
+    if(value > maximum)
+        maximum = value;
+    nrOfElements++;
+    const double delta = value - mean;
+    mean += delta / nrOfElements;
+    sumOfSquaredDifferences += delta*(value - mean);
+}
+
+void ImageStatistics::add(const ImageStatistics& other) {
+    if(other.nrOfElements == 0)
+        return;
+    if(other.minimum < minimum)
+        minimum = other.minimum;
+    if(other.maximum > maximum)
+        maximum = other.maximum;
+    const double count = (double)nrOfElements + other.nrOfElements;
+    const double delta = other.mean - mean;
+    mean += delta*other.nrOfElements/count;
+    sumOfSquaredDifferences += other.sumOfSquaredDifferences + delta*delta*nrOfElements*other.nrOfElements/count;
+    nrOfElements += other.nrOfElements;
+}
+
+float ImageStatistics::getMean() const {
+    if(nrOfElements == 0)
+        throw Exception("Can't calculate the mean of zero elements");
+    return mean;
+}
+
+float ImageStatistics::getVariance() const {
+    if(nrOfElements == 0)
+        throw Exception("Can't calculate the variance of zero elements");
+    return sumOfSquaredDifferences / nrOfElements;
+}
+
+double ImageStatistics::getSum() const {
+    return mean*nrOfElements;
+}
+
+ImageReduction& ImageReduction::getInstance() {
+    static ImageReduction instance;
+    return instance;
+}
+
+ImageReduction::ImageReduction() {
+}
+
+void ImageReduction::clear() {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    mKernels.clear();
+    mResultBuffers.clear();
+    mResultBufferSizes.clear();
+}
+
+// The 16 bit normalized types are given in the same range as read_imagef gives them
+template <class T>
+inline float getNormalizedValue(T value, DataType type) {
+    if(type == TYPE_UNORM_INT16)
+        return (float)value / 65535.0f;
+    if(type == TYPE_SNORM_INT16)
+        return std::max((float)value / 32767.0f, -1.0f);
+    return (float)value;
+}
+
+template <class T>
+static ImageStatistics calculateStatisticsFromData(const void* voidData, std::size_t nrOfElements, DataType type) {
+    const T* data = (const T*)voidData;
+    ImageStatistics statistics;
+    #pragma omp parallel
+    {
+        ImageStatistics threadStatistics;
+        #pragma omp for
+        for(long long i = 0; i < (long long)nrOfElements; i++) {
+            threadStatistics.add(getNormalizedValue(data[i], type));
+        }
+        #pragma omp critical
+        statistics.add(threadStatistics);
+    }
+    return statistics;
+}
+
+template <class T>
+static std::vector<uint> calculateHistogramFromData(const void* voidData, std::size_t nrOfElements, DataType type, uint nrOfBins, float minimum, float maximum) {
+    const T* data = (const T*)voidData;
+    std::vector<uint> histogram(nrOfBins, 0);
+    #pragma omp parallel
+    {
+        std::vector<uint> threadHistogram(nrOfBins, 0);
+        #pragma omp for
+        for(long long i = 0; i < (long long)nrOfElements; i++) {
+            const float value = getNormalizedValue(data[i], type);
+            if(value >= minimum && value <= maximum) {
+                const uint bin = (uint)((value - minimum)*nrOfBins/(maximum - minimum));
+                threadHistogram[std::min(bin, nrOfBins-1)]++;
+            }
+        }
+        #pragma omp critical
+        for(uint i = 0; i < nrOfBins; i++)
+            histogram[i] += threadHistogram[i];
+    }
+    return histogram;
+}
+
+static void checkHistogramParameters(uint nrOfBins, float minimum, float maximum) {
+    if(nrOfBins == 0)
+        throw Exception("A histogram must have at least one bin");
+    if(maximum <= minimum)
+        throw Exception("The maximum of the histogram range must be larger than the minimum");
+}
+
+ImageStatistics ImageReduction::calculateStatistics(const void* data, std::size_t nrOfElements, DataType type) {
+    switch(type) {
+        fastSwitchTypeMacro(return calculateStatisticsFromData<FAST_TYPE>(data, nrOfElements, type))
+    }
+    throw Exception("Unknown data type in ImageReduction");
+}
+
+std::vector<uint> ImageReduction::calculateHistogram(const void* data, std::size_t nrOfElements, DataType type, uint nrOfBins, float minimum, float maximum) {
+    checkHistogramParameters(nrOfBins, minimum, maximum);
+    switch(type) {
+        fastSwitchTypeMacro(return calculateHistogramFromData<FAST_TYPE>(data, nrOfElements, type, nrOfBins, minimum, maximum))
+    }
+    throw Exception("Unknown data type in ImageReduction");
+}
+
+static std::string getTypeDefine(DataType type) {
+    switch(type) {
+    case TYPE_FLOAT:
+        return "-DTYPE_FLOAT";
+    case TYPE_UINT8:
+        return "-DTYPE_UINT8";
+    case TYPE_INT8:
+        return "-DTYPE_INT8";
+    case TYPE_UINT16:
+        return "-DTYPE_UINT16";
+    case TYPE_INT16:
+        return "-DTYPE_INT16";
+    case TYPE_UNORM_INT16:
+        return "-DTYPE_UNORM_INT16";
+    case TYPE_SNORM_INT16:
+        return "-DTYPE_SNORM_INT16";
+    }
+    throw Exception("Unknown data type in ImageReduction");
+}
+
+static bool hasDoublePrecision(OpenCLDevice::pointer device) {
+    return device->getDevice().getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != std::string::npos;
+}
+
+cl::Kernel ImageReduction::getKernel(OpenCLDevice::pointer device, std::string name, DataType type) {
+    std::string buildOptions = getTypeDefine(type);
+    if(hasDoublePrecision(device))
+        buildOptions += " -DDOUBLE_ACCUMULATION";
+    const std::string key = name + buildOptions;
+    std::map<std::string, cl::Kernel>& kernels = mKernels[device];
+    if(kernels.count(key) == 0) {
+        std::string sourceFilename = std::string(FAST_SOURCE_DIR) + "/ImageReduction.cl";
+        std::string programName = sourceFilename + buildOptions;
+        // Only create program if it doesn't exist for this device from before
+        if(!device->hasProgram(programName))
+            device->createProgramFromSourceWithName(programName, sourceFilename, buildOptions);
+        kernels[key] = cl::Kernel(device->getProgram(programName), name.c_str());
+    }
+    return kernels[key];
+}
+
+void ImageReduction::getNDRange(OpenCLDevice::pointer device, cl::Kernel kernel, std::size_t nrOfItems, std::size_t* workGroupSize, std::size_t* nrOfWorkGroups) {
+    *workGroupSize = std::min(
+            (std::size_t)256,
+            kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device->getDevice())
+    );
+    // A few work groups per compute unit is enough to keep the device busy,
+    // each work item loops over the rest of the data
+    const std::size_t maxNrOfWorkGroups = 8*device->getDevice().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    *nrOfWorkGroups = std::max((std::size_t)1, std::min(
+            maxNrOfWorkGroups,
+            (nrOfItems + *workGroupSize - 1) / *workGroupSize
+    ));
+}
+
+cl::Buffer ImageReduction::getResultBuffer(OpenCLDevice::pointer device, std::size_t size) {
+    if(mResultBufferSizes.count(device) == 0 || mResultBufferSizes[device] < size) {
+        mResultBuffers[device] = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, size);
+        mResultBufferSizes[device] = size;
+    }
+    return mResultBuffers[device];
+}
+
+ImageStatistics ImageReduction::runStatisticsKernel(
+        OpenCLDevice::pointer device,
+        cl::Kernel kernel,
+        std::size_t nrOfItems,
+        std::size_t nrOfElements,
+        const VECTOR_CLASS<cl::Event>* waitList) {
+    std::size_t workGroupSize, nrOfWorkGroups;
+    getNDRange(device, kernel, nrOfItems, &workGroupSize, &nrOfWorkGroups);
+
+    // Each work group writes minimum, maximum, number of values, mean and sum
+    // of squared differences from the mean, in double precision if supported
+    const std::size_t nrOfStatistics = 5;
+    const bool doublePrecision = hasDoublePrecision(device);
+    const std::size_t accumulatorSize = doublePrecision ? sizeof(cl_double) : sizeof(cl_float);
+    const std::size_t resultSize = nrOfWorkGroups*nrOfStatistics*accumulatorSize;
+    cl::Buffer result = getResultBuffer(device, resultSize);
+    kernel.setArg(2, cl::__local(workGroupSize*nrOfStatistics*accumulatorSize));
+    kernel.setArg(3, result);
+
+    cl::CommandQueue queue = device->getCommandQueue();
+    queue.enqueueNDRangeKernel(
+            kernel,
+            cl::NullRange,
+            cl::NDRange(nrOfWorkGroups*workGroupSize),
+            cl::NDRange(workGroupSize),
+            waitList
+    );
+    std::vector<double> groupResults(nrOfWorkGroups*nrOfStatistics);
+    if(doublePrecision) {
+        queue.enqueueReadBuffer(result, CL_TRUE, 0, resultSize, groupResults.data());
+    } else {
+        std::vector<float> floatResults(nrOfWorkGroups*nrOfStatistics);
+        queue.enqueueReadBuffer(result, CL_TRUE, 0, resultSize, floatResults.data());
+        std::copy(floatResults.begin(), floatResults.end(), groupResults.begin());
+    }
+
+    // Work item j visits item j and every global size'th item after it, so the
+    // exact number of values of each group is known, also in single precision
+    const std::size_t globalSize = nrOfWorkGroups*workGroupSize;
+    const std::size_t valuesPerItem = nrOfItems > 0 ? nrOfElements / nrOfItems : 0;
+    ImageStatistics statistics;
+    for(std::size_t i = 0; i < nrOfWorkGroups; i++) {
+        const double* groupResult = &groupResults[i*nrOfStatistics];
+        ImageStatistics groupStatistics;
+        groupStatistics.minimum = groupResult[0];
+        groupStatistics.maximum = groupResult[1];
+        for(std::size_t j = i*workGroupSize; j < (i+1)*workGroupSize && j < nrOfItems; j++)
+            groupStatistics.nrOfElements += ((nrOfItems - 1 - j) / globalSize + 1)*valuesPerItem;
+        groupStatistics.mean = groupResult[3];
+        groupStatistics.sumOfSquaredDifferences = groupResult[4];
+        statistics.add(groupStatistics);
+    }
+    return statistics;
+}
+
+ImageStatistics ImageReduction::calculateStatistics(
+        OpenCLDevice::pointer device,
+        cl::Image* image,
+        uchar dimensions,
+        DataType type,
+        uint nrOfComponents,
+        const VECTOR_CLASS<cl::Event>* waitList) {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    cl::Kernel kernel = getKernel(device, dimensions == 2 ? "calculateStatisticsImage2D" : "calculateStatisticsImage3D", type);
+    std::size_t nrOfPixels = image->getImageInfo<CL_IMAGE_WIDTH>()*image->getImageInfo<CL_IMAGE_HEIGHT>();
+    if(dimensions == 3)
+        nrOfPixels *= image->getImageInfo<CL_IMAGE_DEPTH>();
+    cl_mem mem = (*image)();
+    kernel.setArg(0, sizeof(cl_mem), &mem);
+    kernel.setArg(1, (int)nrOfComponents);
+    return runStatisticsKernel(device, kernel, nrOfPixels, nrOfPixels*nrOfComponents, waitList);
+}
+
+ImageStatistics ImageReduction::calculateStatistics(
+        OpenCLDevice::pointer device,
+        cl::Buffer* buffer,
+        std::size_t nrOfElements,
+        DataType type,
+        const VECTOR_CLASS<cl::Event>* waitList) {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    cl::Kernel kernel = getKernel(device, "calculateStatisticsBuffer", type);
+    kernel.setArg(0, *buffer);
+    kernel.setArg(1, (cl_ulong)nrOfElements);
+    return runStatisticsKernel(device, kernel, nrOfElements, nrOfElements, waitList);
+}
+
+std::vector<uint> ImageReduction::runHistogramKernel(
+        OpenCLDevice::pointer device,
+        cl::Kernel kernel,
+        std::size_t nrOfItems,
+        uint nrOfBins,
+        const VECTOR_CLASS<cl::Event>* waitList) {
+    if(nrOfBins*sizeof(cl_uint) > device->getDevice().getInfo<CL_DEVICE_LOCAL_MEM_SIZE>())
+        throw Exception("Too many histogram bins for the local memory of the OpenCL device");
+    std::size_t workGroupSize, nrOfWorkGroups;
+    getNDRange(device, kernel, nrOfItems, &workGroupSize, &nrOfWorkGroups);
+
+    cl::CommandQueue queue = device->getCommandQueue();
+    std::vector<uint> histogram(nrOfBins, 0);
+    cl::Buffer result = getResultBuffer(device, nrOfBins*sizeof(cl_uint));
+    queue.enqueueWriteBuffer(result, CL_FALSE, 0, nrOfBins*sizeof(cl_uint), histogram.data());
+    kernel.setArg(5, cl::__local(nrOfBins*sizeof(cl_uint)));
+    kernel.setArg(6, result);
+
+    queue.enqueueNDRangeKernel(
+            kernel,
+            cl::NullRange,
+            cl::NDRange(nrOfWorkGroups*workGroupSize),
+            cl::NDRange(workGroupSize),
+            waitList
+    );
+    queue.enqueueReadBuffer(result, CL_TRUE, 0, nrOfBins*sizeof(cl_uint), histogram.data());
+    return histogram;
+}
+
+std::vector<uint> ImageReduction::calculateHistogram(
+        OpenCLDevice::pointer device,
+        cl::Image* image,
+        uchar dimensions,
+        DataType type,
+        uint nrOfComponents,
+        uint nrOfBins,
+        float minimum,
+        float maximum,
+        const VECTOR_CLASS<cl::Event>* waitList) {
+    checkHistogramParameters(nrOfBins, minimum, maximum);
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    cl::Kernel kernel = getKernel(device, dimensions == 2 ? "calculateHistogramImage2D" : "calculateHistogramImage3D", type);
+    std::size_t nrOfPixels = image->getImageInfo<CL_IMAGE_WIDTH>()*image->getImageInfo<CL_IMAGE_HEIGHT>();
+    if(dimensions == 3)
+        nrOfPixels *= image->getImageInfo<CL_IMAGE_DEPTH>();
+    cl_mem mem = (*image)();
+    kernel.setArg(0, sizeof(cl_mem), &mem);
+    kernel.setArg(1, (int)nrOfComponents);
+    kernel.setArg(2, minimum);
+    kernel.setArg(3, maximum);
+    kernel.setArg(4, (int)nrOfBins);
+    return runHistogramKernel(device, kernel, nrOfPixels, nrOfBins, waitList);
+}
+
+std::vector<uint> ImageReduction::calculateHistogram(
+        OpenCLDevice::pointer device,
+        cl::Buffer* buffer,
+        std::size_t nrOfElements,
+        DataType type,
+        uint nrOfBins,
+        float minimum,
+        float maximum,
+        const VECTOR_CLASS<cl::Event>* waitList) {
+    checkHistogramParameters(nrOfBins, minimum, maximum);
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    cl::Kernel kernel = getKernel(device, "calculateHistogramBuffer", type);
+    kernel.setArg(0, *buffer);
+    kernel.setArg(1, (cl_ulong)nrOfElements);
+    kernel.setArg(2, minimum);
+    kernel.setArg(3, maximum);
+    kernel.setArg(4, (int)nrOfBins);
+    return runHistogramKernel(device, kernel, nrOfElements, nrOfBins, waitList);
+}
+
+} // end namespace fast
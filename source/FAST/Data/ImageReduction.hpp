@@ -0,0 +1,117 @@
+#ifndef IMAGE_REDUCTION_HPP_
+#define IMAGE_REDUCTION_HPP_
+
+#include "FAST/Object.hpp"
+#include "FAST/ExecutionDevice.hpp"
+#include "FAST/Data/DataTypes.hpp"
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
+#include <map>
+#include <vector>
+
+namespace fast {
+
+/**
+ * Intensity statistics of all components of an image. 16 bit normalized
+ * types are given in the normalized range, as when read from OpenCL images.
+ */
+struct ImageStatistics {
+    ImageStatistics();
+    void add(float value);
+    void add(const ImageStatistics& other);
+    float getMean() const;
+    float getVariance() const;
+    double getSum() const;
+
+    float minimum;
+    float maximum;
+    // Single values are added with the update of Welford and statistics are
+    // merged with the pairwise update of Chan et al., so the variance doesn't
+    // suffer from cancellation as with the sum of squares
+    double mean;
+    double sumOfSquaredDifferences;
+    unsigned long long nrOfElements;
+};
+
+/**
+ * Singleton class which calculates intensity statistics and histograms of
+ * image data on the host, in OpenCL images and in OpenCL buffers, in 2D and 3D.
+ * Minimum, maximum, mean and variance are calculated in a single pass.
+ * The OpenCL kernels do a reduction within each work group, so no padding of
+ * the data is needed, and the kernels and result buffers are kept per device.
+ * The work groups accumulate in double precision if the device supports it,
+ * and with compensated single precision sums otherwise.
+ */
+class ImageReduction : public Object {
+    public:
+        static ImageReduction& getInstance();
+
+        ImageStatistics calculateStatistics(const void* data, std::size_t nrOfElements, DataType type);
+        ImageStatistics calculateStatistics(
+                OpenCLDevice::pointer device,
+                cl::Image* image,
+                uchar dimensions,
+                DataType type,
+                uint nrOfComponents,
+                const VECTOR_CLASS<cl::Event>* waitList = NULL
+        );
+        ImageStatistics calculateStatistics(
+                OpenCLDevice::pointer device,
+                cl::Buffer* buffer,
+                std::size_t nrOfElements,
+                DataType type,
+                const VECTOR_CLASS<cl::Event>* waitList = NULL
+        );
+
+        /**
+         * Histograms count the values in [minimum, maximum], with the maximum
+         * in the last bin. Values outside the range are not counted.
+         */
+        std::vector<uint> calculateHistogram(const void* data, std::size_t nrOfElements, DataType type, uint nrOfBins, float minimum, float maximum);
+        std::vector<uint> calculateHistogram(
+                OpenCLDevice::pointer device,
+                cl::Image* image,
+                uchar dimensions,
+                DataType type,
+                uint nrOfComponents,
+                uint nrOfBins,
+                float minimum,
+                float maximum,
+                const VECTOR_CLASS<cl::Event>* waitList = NULL
+        );
+        std::vector<uint> calculateHistogram(
+                OpenCLDevice::pointer device,
+                cl::Buffer* buffer,
+                std::size_t nrOfElements,
+                DataType type,
+                uint nrOfBins,
+                float minimum,
+                float maximum,
+                const VECTOR_CLASS<cl::Event>* waitList = NULL
+        );
+
+        // Release the kernels and buffers kept for all devices
+        void clear();
+    private:
+        ImageReduction();
+        ImageReduction(const ImageReduction&);
+        ImageReduction& operator=(const ImageReduction&);
+
+        cl::Kernel getKernel(OpenCLDevice::pointer device, std::string name, DataType type);
+        void getNDRange(OpenCLDevice::pointer device, cl::Kernel kernel, std::size_t nrOfItems, std::size_t* workGroupSize, std::size_t* nrOfWorkGroups);
+        cl::Buffer getResultBuffer(OpenCLDevice::pointer device, std::size_t size);
+        ImageStatistics runStatisticsKernel(OpenCLDevice::pointer device, cl::Kernel kernel, std::size_t nrOfItems, std::size_t nrOfElements, const VECTOR_CLASS<cl::Event>* waitList);
+        std::vector<uint> runHistogramKernel(OpenCLDevice::pointer device, cl::Kernel kernel, std::size_t nrOfItems, uint nrOfBins, const VECTOR_CLASS<cl::Event>* waitList);
+
+        // Compiled kernels for each device, by kernel name and data type
+        boost::unordered_map<OpenCLDevice::pointer, std::map<std::string, cl::Kernel> > mKernels;
+        // Buffers the work groups write their results to, grown when needed
+        boost::unordered_map<OpenCLDevice::pointer, cl::Buffer> mResultBuffers;
+        boost::unordered_map<OpenCLDevice::pointer, std::size_t> mResultBufferSizes;
+        // Kernel arguments are shared, so only one reduction runs at a time
+        boost::mutex mMutex;
+};
+
+} // end namespace fast
+
+#endif /* IMAGE_REDUCTION_HPP_ */
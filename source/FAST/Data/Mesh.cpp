@@ -1,5 +1,6 @@
 #include <GL/glew.h>
 #include "Mesh.hpp"
+#include "FAST/Data/MeshCompression.hpp"
 #include "FAST/Visualization/SimpleWindow.hpp"
 #include <QApplication>
 #include <boost/thread.hpp>
@@ -26,27 +27,25 @@ void Mesh::create(
         freeAll();
     }
     mIsInitialized = true;
+    mIsIndexed = true;
 
+    mPositions.resize(vertices.size()*3);
+    mNormals.resize(vertices.size()*3);
     for(unsigned int i = 0; i < vertices.size(); i++) {
-        MeshVertex v;
-        v.position(0) = vertices[i].x();
-        v.position(1) = vertices[i].y();
-        v.position(2) = vertices[i].z();
-        v.normal(0) = normals[i].x();
-        v.normal(1) = normals[i].y();
-        v.normal(2) = normals[i].z();
-        mVertices.push_back(v);
+        for(unsigned int k = 0; k < 3; k++) {
+            mPositions[i*3+k] = vertices[i][k];
+            mNormals[i*3+k] = normals[i][k];
+        }
     }
-
+    mIndices.resize(triangles.size()*3);
     for(unsigned int i = 0; i < triangles.size(); i++) {
-        mVertices[triangles[i].x()].triangles.push_back(i);
-        mVertices[triangles[i].y()].triangles.push_back(i);
-        mVertices[triangles[i].z()].triangles.push_back(i);
+        for(unsigned int k = 0; k < 3; k++)
+            mIndices[i*3+k] = triangles[i][k];
     }
 
     mBoundingBox = BoundingBox(vertices);
     mNrOfTriangles = triangles.size();
-    mTriangles = triangles;
+    mNrOfVertices = vertices.size();
     mHostHasData = true;
     mHostDataIsUpToDate = true;
     updateModifiedTimestamp();
@@ -54,21 +53,13 @@ void Mesh::create(
 
 
 void Mesh::create(std::vector<MeshVertex> vertices, std::vector<Vector3ui> triangles) {
-     if(mIsInitialized) {
-        // Delete old data
-        freeAll();
-    }
-    mIsInitialized = true;
-    mVertices = vertices;
     std::vector<Vector3f> positions;
+    std::vector<Vector3f> normals;
     for(unsigned int i = 0; i < vertices.size(); i++) {
         positions.push_back(vertices[i].position);
+        normals.push_back(vertices[i].normal);
     }
-    mBoundingBox = BoundingBox(positions);
-    mNrOfTriangles = triangles.size();
-    mTriangles = triangles;
-    mHostHasData = true;
-    mHostDataIsUpToDate = true;
+    create(positions, normals, triangles);
 }
 
 void Mesh::create(unsigned int nrOfTriangles) {
@@ -77,7 +68,48 @@ void Mesh::create(unsigned int nrOfTriangles) {
         freeAll();
     }
     mIsInitialized = true;
+    mIsIndexed = false;
     mNrOfTriangles = nrOfTriangles;
+    mNrOfVertices = nrOfTriangles*3;
+}
+
+void Mesh::create(unsigned int nrOfVertices, unsigned int nrOfTriangles) {
+    if(mIsInitialized) {
+        // Delete old data
+        freeAll();
+    }
+    mIsInitialized = true;
+    mIsIndexed = true;
+    mNrOfTriangles = nrOfTriangles;
+    mNrOfVertices = nrOfVertices;
+}
+
+void Mesh::create(unsigned int nrOfTriangles, cl::Buffer vertexBuffer, OpenCLDevice::pointer device) {
+    create(nrOfTriangles);
+    mCLVertexBuffers[device] = vertexBuffer;
+    mCLBuffersIsUpToDate[device] = true;
+    updateModifiedTimestamp();
+}
+
+void Mesh::create(
+        unsigned int nrOfVertices,
+        unsigned int nrOfTriangles,
+        cl::Buffer vertexBuffer,
+        cl::Buffer indexBuffer,
+        OpenCLDevice::pointer device) {
+    create(nrOfVertices, nrOfTriangles);
+    mCLVertexBuffers[device] = vertexBuffer;
+    mCLIndexBuffers[device] = indexBuffer;
+    mCLBuffersIsUpToDate[device] = true;
+    updateModifiedTimestamp();
+}
+
+void Mesh::setCompressedVertices(bool compressed) {
+    mCompressedVertices = compressed;
+}
+
+bool Mesh::isCompressedVertices() const {
+    return mCompressedVertices;
 }
 
 VertexBufferObjectAccess::pointer Mesh::getVertexBufferObjectAccess(
@@ -94,10 +126,8 @@ VertexBufferObjectAccess::pointer Mesh::getVertexBufferObjectAccess(
             boost::unique_lock<boost::mutex> lock(mDataIsBeingWrittenToMutex);
             mDataIsBeingWrittenTo = true;
     	}
-        updateModifiedTimestamp();
     }
     if(!mVBOHasData) {
-        // TODO create VBO
         // Have to have a drawable available before glewInit and glGenBuffers
 #if defined(__APPLE__) || defined(__MACOSX)
 #else
@@ -119,82 +149,356 @@ VertexBufferObjectAccess::pointer Mesh::getVertexBufferObjectAccess(
         if(err != GLEW_OK)
             throw Exception("GLEW init error");
         glGenBuffers(1, &mVBOID);
-        glBindBuffer(GL_ARRAY_BUFFER, mVBOID);
-        if(mHostHasData) {
-            // If host has data, transfer it.
-            // Create data arrays with vertices and normals interleaved
-            uint counter = 0;
-            float* data = new float[mNrOfTriangles*18];
-            for(uint i = 0; i < mNrOfTriangles; i++) {
-                Vector3ui triangle = mTriangles[i];
-                for(uint j = 0; j < 3; j++) {
-                    MeshVertex vertex = mVertices[triangle[j]];
-                    for(uint k = 0; k < 3; k++) {
-                        data[counter+k] = vertex.position[k];
-                        //reportInfo() << data[counter+k] << Reporter::end;
-                        data[counter+3+k] = vertex.normal[k];
-                    }
-                    //reportInfo() << "...." << Reporter::end;
-                    counter += 6;
-                }
+        if(mIsIndexed)
+            glGenBuffers(1, &mEBOID);
+        allocateVBO(mCompressedVertices && (GLEW_VERSION_3_0 || GLEW_ARB_half_float_vertex));
+    } else {
+        // Half precision vertices need OpenGL 3.0 or the half float vertex extension
+        const bool compressed = mCompressedVertices && (GLEW_VERSION_3_0 || GLEW_ARB_half_float_vertex);
+        if(compressed != mVBOIsCompressed) {
+            if(mVBODataIsUpToDate && !(mHostHasData && mHostDataIsUpToDate)) {
+                // Keep the data on the host before the VBO is replaced
+                std::vector<float> vertexData;
+                std::vector<uint> indexData;
+                getDeviceData(vertexData, indexData);
+                setHostData(vertexData, indexData);
+                mHostHasData = true;
+                mHostDataIsUpToDate = true;
             }
-            glBufferData(GL_ARRAY_BUFFER, mNrOfTriangles*18*sizeof(float), data, GL_STATIC_DRAW);
-            delete[] data;
-        } else {
-            glBufferData(GL_ARRAY_BUFFER, mNrOfTriangles*18*sizeof(float), NULL, GL_STATIC_DRAW);
+            allocateVBO(compressed);
         }
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glFinish();
-        if(glGetError() == GL_OUT_OF_MEMORY) {
-        	throw Exception("OpenGL out of memory while creating mesh data for VBO");
+    }
+
+    if(!mVBODataIsUpToDate && isAnyDataUpToDate()) {
+        // Copy on the device if OpenCL shares context with OpenGL, else through the host
+        if(!copyOpenCLBuffersToVBO(device)) {
+            std::vector<float> vertexData;
+            std::vector<uint> indexData;
+            getDeviceData(vertexData, indexData);
+            glBindBuffer(GL_ARRAY_BUFFER, mVBOID);
+            if(mVBOIsCompressed) {
+                std::vector<ushort> compressedData = createCompressedVertexBufferObjectData(vertexData);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, compressedData.size()*sizeof(ushort), compressedData.data());
+            } else {
+                glBufferSubData(GL_ARRAY_BUFFER, 0, vertexData.size()*sizeof(float), vertexData.data());
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            if(mIsIndexed) {
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBOID);
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexData.size()*sizeof(uint), indexData.data());
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            }
+            glFinish();
         }
-        //reportInfo() << "Created VBO with ID " << mVBOID << " and " << mNrOfTriangles << " of triangles" << Reporter::end;
-        // TODO Transfer data if any exist
+    }
+    if(type == ACCESS_READ_WRITE) {
+        setAllDataToOutOfDate();
+        updateModifiedTimestamp();
+    }
+    mVBODataIsUpToDate = true;
+
+    {
+        boost::unique_lock<boost::mutex> lock(mDataIsBeingAccessedMutex);
+        mDataIsBeingAccessed = true;
+    }
 
-        mVBOHasData = true;
-        mVBODataIsUpToDate = true;
+	VertexBufferObjectAccess::pointer accessObject(new VertexBufferObjectAccess(mVBOID, mPtr.lock(), mIsIndexed ? mEBOID : 0, mVBOIsCompressed));
+	return std::move(accessObject);
+}
 
-    } else {
-        if(!mVBODataIsUpToDate) {
-            // TODO Update data
+void Mesh::allocateVBO(bool compressed) {
+    // Compressed vertices have 8 16 bit values, else 6 floats
+    const std::size_t vertexSize = compressed ? 8*sizeof(ushort) : 6*sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, mVBOID);
+    glBufferData(GL_ARRAY_BUFFER, mNrOfVertices*vertexSize, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if(mIsIndexed) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBOID);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mNrOfTriangles*3*sizeof(uint), NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    glFinish();
+    if(glGetError() == GL_OUT_OF_MEMORY) {
+    	throw Exception("OpenGL out of memory while creating mesh data for VBO");
+    }
+    mVBOHasData = true;
+    mVBODataIsUpToDate = false;
+    mVBOIsCompressed = compressed;
+}
+
+bool Mesh::copyOpenCLBuffersToVBO(OpenCLDevice::pointer device) {
+    if(mNrOfTriangles == 0 || mCLBuffersIsUpToDate.count(device) == 0 || !mCLBuffersIsUpToDate[device])
+        return false;
+
+    try {
+        cl::CommandQueue queue = device->getCommandQueue();
+        std::vector<cl::Memory> v;
+        cl::BufferGL VBOBuffer(device->getContext(), CL_MEM_WRITE_ONLY, mVBOID);
+        v.push_back(VBOBuffer);
+        cl::BufferGL EBOBuffer;
+        if(mIsIndexed) {
+            EBOBuffer = cl::BufferGL(device->getContext(), CL_MEM_WRITE_ONLY, mEBOID);
+            v.push_back(EBOBuffer);
         }
+        queue.enqueueAcquireGLObjects(&v);
+        if(mVBOIsCompressed) {
+            cl::Kernel kernel = getCompressionKernel(device, "createCompressedVertexBufferObject");
+            kernel.setArg(0, mCLVertexBuffers[device]);
+            kernel.setArg(1, mNrOfVertices);
+            kernel.setArg(2, VBOBuffer);
+            queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(mNrOfVertices), cl::NullRange);
+        } else {
+            queue.enqueueCopyBuffer(mCLVertexBuffers[device], VBOBuffer, 0, 0, sizeof(float)*mNrOfVertices*6);
+        }
+        if(mIsIndexed)
+            queue.enqueueCopyBuffer(mCLIndexBuffers[device], EBOBuffer, 0, 0, sizeof(uint)*mNrOfTriangles*3);
+        queue.enqueueReleaseGLObjects(&v);
+        queue.finish();
+    } catch(cl::Error &e) {
+        // The OpenCL context was not created with OpenGL sharing
+        return false;
     }
+    return true;
+}
+
+cl::Kernel Mesh::getCompressionKernel(OpenCLDevice::pointer device, std::string name) {
+    const std::string filename = std::string(FAST_SOURCE_DIR) + "/MeshCompression.cl";
+    // Only create program if it doesn't exist for this device from before
+    if(!device->hasProgram(filename))
+        device->createProgramFromSourceWithName(filename, filename);
+    return cl::Kernel(device->getProgram(filename), name.c_str());
+}
+
+MeshOpenCLAccess::pointer Mesh::getOpenCLAccess(
+        accessType type,
+        OpenCLDevice::pointer device) {
+    if(!mIsInitialized)
+        throw Exception("Mesh has not been initialized.");
+
+    blockIfBeingWrittenTo();
+
+    if(type == ACCESS_READ_WRITE) {
+    	blockIfBeingAccessed();
+    	{
+            boost::unique_lock<boost::mutex> lock(mDataIsBeingWrittenToMutex);
+            mDataIsBeingWrittenTo = true;
+    	}
+    }
+    if(mCLVertexBuffers.count(device) == 0) {
+        // OpenCL buffers can't be empty
+        mCLVertexBuffers[device] = cl::Buffer(
+                device->getContext(),
+                CL_MEM_READ_WRITE,
+                sizeof(float)*std::max(mNrOfVertices*6, 1u)
+        );
+        if(mIsIndexed) {
+            mCLIndexBuffers[device] = cl::Buffer(
+                    device->getContext(),
+                    CL_MEM_READ_WRITE,
+                    sizeof(uint)*std::max(mNrOfTriangles*3, 1u)
+            );
+        }
+        mCLBuffersIsUpToDate[device] = false;
+    }
+    if(!mCLBuffersIsUpToDate[device] && isAnyDataUpToDate()) {
+        std::vector<float> vertexData;
+        std::vector<uint> indexData;
+        getDeviceData(vertexData, indexData);
+        cl::CommandQueue queue = device->getCommandQueue();
+        if(vertexData.size() > 0)
+            queue.enqueueWriteBuffer(mCLVertexBuffers[device], CL_TRUE, 0, vertexData.size()*sizeof(float), vertexData.data());
+        if(indexData.size() > 0)
+            queue.enqueueWriteBuffer(mCLIndexBuffers[device], CL_TRUE, 0, indexData.size()*sizeof(uint), indexData.data());
+    }
+    if(type == ACCESS_READ_WRITE) {
+        setAllDataToOutOfDate();
+        updateModifiedTimestamp();
+    }
+    mCLBuffersIsUpToDate[device] = true;
 
     {
         boost::unique_lock<boost::mutex> lock(mDataIsBeingAccessedMutex);
         mDataIsBeingAccessed = true;
     }
 
-	VertexBufferObjectAccess::pointer accessObject(new VertexBufferObjectAccess(mVBOID, mPtr.lock()));
+	MeshOpenCLAccess::pointer accessObject(new MeshOpenCLAccess(
+	        &mCLVertexBuffers[device],
+	        mIsIndexed ? &mCLIndexBuffers[device] : NULL,
+	        mPtr.lock()
+	));
 	return std::move(accessObject);
 }
 
+void Mesh::setAllDataToOutOfDate() {
+    mHostDataIsUpToDate = false;
+    mVBODataIsUpToDate = false;
+    boost::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
+    for(it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end(); it++) {
+        it->second = false;
+    }
+}
 
-// Hasher for the MeshVertex class
-class KeyHasher {
+bool Mesh::isAnyDataUpToDate() {
+    if(mHostHasData && mHostDataIsUpToDate)
+        return true;
+    if(mVBOHasData && mVBODataIsUpToDate)
+        return true;
+    boost::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
+    for(it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end(); it++) {
+        if(it->second)
+            return true;
+    }
+    return false;
+}
+
+void Mesh::getDeviceData(std::vector<float>& vertexData, std::vector<uint>& indexData) {
+    vertexData.resize(mNrOfVertices*6);
+    indexData.resize(mIsIndexed ? mNrOfTriangles*3 : 0);
+    if(mNrOfTriangles == 0)
+        return;
+
+    if(mHostHasData && mHostDataIsUpToDate) {
+        if(mIsIndexed) {
+            for(uint i = 0; i < mNrOfVertices; i++) {
+                for(uint k = 0; k < 3; k++) {
+                    vertexData[i*6+k] = mPositions[i*3+k];
+                    vertexData[i*6+3+k] = mNormals[i*3+k];
+                }
+            }
+            indexData = mIndices;
+        } else {
+            // Create data array with vertices and normals of each triangle interleaved
+            for(uint i = 0; i < mNrOfTriangles*3; i++) {
+                const uint vertex = mIndices[i];
+                for(uint k = 0; k < 3; k++) {
+                    vertexData[i*6+k] = mPositions[vertex*3+k];
+                    vertexData[i*6+3+k] = mNormals[vertex*3+k];
+                }
+            }
+        }
+        return;
+    }
+
+    // Prefer OpenCL buffers over the VBO, as they don't need an OpenGL context
+    boost::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
+    for(it = mCLBuffersIsUpToDate.begin(); it != mCLBuffersIsUpToDate.end(); it++) {
+        if(it->second) {
+            readOpenCLBuffers(it->first, vertexData, indexData);
+            return;
+        }
+    }
+
+    if(mVBOHasData && mVBODataIsUpToDate) {
+        glBindBuffer(GL_ARRAY_BUFFER, mVBOID);
+        if(mVBOIsCompressed) {
+            std::vector<ushort> compressedData(mNrOfVertices*8);
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, compressedData.size()*sizeof(ushort), compressedData.data());
+            decodeCompressedVertexBufferObjectData(compressedData, vertexData);
+        } else {
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertexData.size()*sizeof(float), vertexData.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if(mIsIndexed) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBOID);
+            glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexData.size()*sizeof(uint), indexData.data());
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+        return;
+    }
+
+    throw Exception("Mesh has no data which is up to date");
+}
+
+void Mesh::readOpenCLBuffers(OpenCLDevice::pointer device, std::vector<float>& vertexData, std::vector<uint>& indexData) {
+    cl::CommandQueue queue = device->getCommandQueue();
+    if(mCompressedVertices) {
+        // Compress on the device to transfer 10 instead of 24 bytes per vertex
+        cl::Buffer compressedBuffer(device->getContext(), CL_MEM_WRITE_ONLY, sizeof(ushort)*mNrOfVertices*5);
+        cl::Kernel kernel = getCompressionKernel(device, "compressVertices");
+        kernel.setArg(0, mCLVertexBuffers[device]);
+        kernel.setArg(1, mNrOfVertices);
+        kernel.setArg(2, compressedBuffer);
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(mNrOfVertices), cl::NullRange);
+        std::vector<ushort> compressedData(mNrOfVertices*5);
+        queue.enqueueReadBuffer(compressedBuffer, CL_TRUE, 0, compressedData.size()*sizeof(ushort), compressedData.data());
+        decodeCompressedTransferData(compressedData, vertexData);
+    } else {
+        queue.enqueueReadBuffer(mCLVertexBuffers[device], CL_TRUE, 0, vertexData.size()*sizeof(float), vertexData.data());
+    }
+    if(mIsIndexed)
+        queue.enqueueReadBuffer(mCLIndexBuffers[device], CL_TRUE, 0, indexData.size()*sizeof(uint), indexData.data());
+}
+
+// Hasher for vertex positions
+class PositionHasher {
     public:
-        std::size_t operator()(const MeshVertex& v) const {
+        std::size_t operator()(const Vector3f& position) const {
             using boost::hash_value;
             using boost::hash_combine;
 
-            // Start with a hash value of 0    .
             std::size_t seed = 0;
-
-            // Modify 'seed' by XORing and bit-shifting in
-            // one member of 'Key' after the other:
-            hash_combine(seed,hash_value(v.position[0]));
-            hash_combine(seed,hash_value(v.position[1]));
-            hash_combine(seed,hash_value(v.position[2]));
-
-            // Return the result.
+            hash_combine(seed,hash_value(position[0]));
+            hash_combine(seed,hash_value(position[1]));
+            hash_combine(seed,hash_value(position[2]));
             return seed;
         }
 };
 
-bool operator==(const MeshVertex& a, const MeshVertex& b) {
-    return a.position[0] == b.position[0] &&
-    a.position[1] == b.position[1] &&
-    a.position[2] == b.position[2];
+void Mesh::setHostData(const std::vector<float>& vertexData, const std::vector<uint>& indexData) {
+    mPositions.clear();
+    mNormals.clear();
+    mAdjacencyIsUpToDate = false;
+    if(mIsIndexed) {
+        mPositions.resize(mNrOfVertices*3);
+        mNormals.resize(mNrOfVertices*3);
+        for(uint i = 0; i < mNrOfVertices; i++) {
+            for(uint k = 0; k < 3; k++) {
+                mPositions[i*3+k] = vertexData[i*6+k];
+                mNormals[i*3+k] = vertexData[i*6+3+k];
+            }
+        }
+        mIndices = indexData;
+    } else {
+        // The data has all vertices with normals of each triangle (including
+        // duplicates), vertices with the same position are merged
+        boost::unordered_map<Vector3f, uint, PositionHasher> vertexList;
+        mIndices.resize(mNrOfTriangles*3);
+        for(uint i = 0; i < mNrOfTriangles*3; i++) {
+            const Vector3f position(vertexData[i*6], vertexData[i*6+1], vertexData[i*6+2]);
+            boost::unordered_map<Vector3f, uint, PositionHasher>::iterator duplicate = vertexList.find(position);
+            if(duplicate != vertexList.end()) {
+                mIndices[i] = duplicate->second;
+            } else {
+                const uint index = mPositions.size()/3;
+                for(uint k = 0; k < 3; k++) {
+                    mPositions.push_back(vertexData[i*6+k]);
+                    mNormals.push_back(vertexData[i*6+3+k]);
+                }
+                vertexList[position] = index;
+                mIndices[i] = index;
+            }
+        }
+    }
+}
+
+void Mesh::createAdjacency() {
+    // Several read accesses may request the adjacency at the same time
+    boost::lock_guard<boost::mutex> lock(mAdjacencyMutex);
+    if(mAdjacencyIsUpToDate)
+        return;
+
+    // Count the triangles of each vertex, and put the triangles of each vertex after each other
+    const uint nrOfVertices = mPositions.size()/3;
+    mAdjacencyOffsets.assign(nrOfVertices+1, 0);
+    for(uint i = 0; i < mIndices.size(); i++)
+        mAdjacencyOffsets[mIndices[i]+1]++;
+    for(uint i = 0; i < nrOfVertices; i++)
+        mAdjacencyOffsets[i+1] += mAdjacencyOffsets[i];
+    mAdjacency.resize(mIndices.size());
+    std::vector<uint> next(mAdjacencyOffsets.begin(), mAdjacencyOffsets.end()-1);
+    for(uint i = 0; i < mIndices.size(); i++)
+        mAdjacency[next[mIndices[i]]++] = i/3;
+    mAdjacencyIsUpToDate = true;
 }
 
 MeshAccess::pointer Mesh::getMeshAccess(accessType type) {
@@ -210,65 +514,30 @@ MeshAccess::pointer Mesh::getMeshAccess(accessType type) {
     		boost::lock_guard<boost::mutex> lock(mDataIsBeingWrittenToMutex);
             mDataIsBeingWrittenTo = true;
     	}
-        updateModifiedTimestamp();
     }
-    if(!mHostHasData) {
-        // Get all vertices with normals from VBO (including duplicates)
-        float* data = new float[mNrOfTriangles*18];
-        glBindBuffer(GL_ARRAY_BUFFER, mVBOID);
-        glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float)*mNrOfTriangles*18, data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        std::vector<MeshVertex> vertices;
-        std::vector<Vector3ui> triangles;
-        boost::unordered_map<MeshVertex, uint, KeyHasher> vertexList;
-        for(int t = 0; t < mNrOfTriangles; t++) {
-            Vector3ui triangle;
-            for(int v = 0; v < 3; v++) {
-                MeshVertex vertex;
-                vertex.position[0] = data[t*18+v*6];
-                vertex.position[1] = data[t*18+v*6+1];
-                vertex.position[2] = data[t*18+v*6+2];
-                vertex.normal[0] = data[t*18+v*6+3];
-                vertex.normal[1] = data[t*18+v*6+4];
-                vertex.normal[2] = data[t*18+v*6+5];
-                vertex.triangles.push_back(t);
-
-                // Only add if not a duplicate
-                if(vertexList.count(vertex) > 0) {
-                    // Found a duplicate
-                    // Get index of duplicate
-                    const uint duplicateIndex = vertexList[vertex];
-                    // Add this triangle to the duplicate
-                    MeshVertex& duplicate = vertices[duplicateIndex];
-                    duplicate.triangles.push_back(t);
-                    // Add the vertex to this triangle
-                    triangle[v] = duplicateIndex;
-                } else {
-                    // If duplicate was not found, add it to the list
-                    vertices.push_back(vertex);
-                    triangle[v] = vertices.size()-1;
-                    vertexList[vertex] = vertices.size()-1;
-                }
-            }
-            triangles.push_back(triangle);
+    if(!mHostHasData || !mHostDataIsUpToDate) {
+        if(isAnyDataUpToDate()) {
+            std::vector<float> vertexData;
+            std::vector<uint> indexData;
+            getDeviceData(vertexData, indexData);
+            setHostData(vertexData, indexData);
         }
-        mTriangles = triangles;
-        mVertices = vertices;
         mHostHasData = true;
-        mHostDataIsUpToDate = true;
-        delete[] data;
-    } else {
-        if(!mHostDataIsUpToDate) {
-            throw Exception("Not implemented yet!");
-        }
     }
+    if(type == ACCESS_READ_WRITE) {
+        setAllDataToOutOfDate();
+        updateModifiedTimestamp();
+        // The indices may be changed
+        mAdjacencyIsUpToDate = false;
+    }
+    mHostDataIsUpToDate = true;
 
     {
         boost::lock_guard<boost::mutex> lock(mDataIsBeingAccessedMutex);
         mDataIsBeingAccessed = true;
     }
 
-    MeshAccess::pointer accessObject(new MeshAccess(&mVertices,&mTriangles,mPtr.lock()));
+    MeshAccess::pointer accessObject(new MeshAccess(&mPositions, &mNormals, &mIndices, mPtr.lock()));
 	return std::move(accessObject);
 }
 
@@ -278,22 +547,46 @@ Mesh::~Mesh() {
 
 Mesh::Mesh() {
     mIsInitialized = false;
+    mIsIndexed = false;
+    mCompressedVertices = false;
     mVBOHasData = false;
+    mVBODataIsUpToDate = false;
+    mVBOIsCompressed = false;
     mHostHasData = false;
+    mHostDataIsUpToDate = false;
+    mAdjacencyIsUpToDate = false;
+    mNrOfTriangles = 0;
+    mNrOfVertices = 0;
 }
 
 void Mesh::freeAll() {
-    // TODO finish
+    mCLVertexBuffers.clear();
+    mCLIndexBuffers.clear();
+    mCLBuffersIsUpToDate.clear();
+    mPositions.clear();
+    mNormals.clear();
+    mIndices.clear();
+    mAdjacencyOffsets.clear();
+    mAdjacency.clear();
+    mAdjacencyIsUpToDate = false;
+    mHostHasData = false;
+    mHostDataIsUpToDate = false;
     if(mVBOHasData) {
         // glDeleteBuffer is not used due to multi-threading issues..
         //glDeleteBuffers(1, &mVBOID);
-        glBindBuffer(GL_ARRAY_BUFFER, mVBOID);
         // This should delete the data, by replacing it with 1 byte buffer
         // Ideally it should be 0, but then the data is not deleted..
+        glBindBuffer(GL_ARRAY_BUFFER, mVBOID);
         glBufferData(GL_ARRAY_BUFFER, 1, NULL, GL_STATIC_DRAW);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if(mIsIndexed) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBOID);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, 1, NULL, GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
     }
     mVBOHasData = false;
+    mVBODataIsUpToDate = false;
 }
 
 void Mesh::free(ExecutionDevice::pointer device) {
@@ -305,7 +598,13 @@ unsigned int Mesh::getNrOfTriangles() const {
 }
 
 unsigned int Mesh::getNrOfVertices() const {
-    return mVertices.size();
+    if(mIsIndexed)
+        return mNrOfVertices;
+    return mPositions.size()/3;
+}
+
+bool Mesh::isIndexed() const {
+    return mIsIndexed;
 }
 
 void Mesh::setBoundingBox(BoundingBox box) {
@@ -313,4 +612,3 @@ void Mesh::setBoundingBox(BoundingBox box) {
 }
 
 } // end namespace fast
-
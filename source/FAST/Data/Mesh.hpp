@@ -8,7 +8,10 @@
 #include "FAST/Data/DataTypes.hpp"
 #include "FAST/Data/Access/VertexBufferObjectAccess.hpp"
 #include "FAST/Data/Access/MeshAccess.hpp"
+#include "FAST/Data/Access/MeshOpenCLAccess.hpp"
+#include <boost/unordered_map.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace fast {
 
@@ -17,35 +20,108 @@ class Mesh : public SpatialDataObject {
     public:
         void create(std::vector<Vector3f> vertices, std::vector<Vector3f> normals, std::vector<Vector3ui> triangles);
         void create(std::vector<MeshVertex> vertices, std::vector<Vector3ui> triangles);
+        /**
+         * Create a mesh where the vertices of each triangle are stored after
+         * each other. Duplicate vertices are merged when the mesh is read on the host.
+         */
         void create(unsigned int nrOfTriangles);
+        /**
+         * Create an indexed mesh where the triangles share vertices
+         */
+        void create(unsigned int nrOfVertices, unsigned int nrOfTriangles);
+        /**
+         * Create a mesh from OpenCL buffers which already have the data on the
+         * device. The buffers are used directly and may be larger than needed,
+         * so that they can be reused for several meshes.
+         */
+        void create(unsigned int nrOfTriangles, cl::Buffer vertexBuffer, OpenCLDevice::pointer device);
+        void create(unsigned int nrOfVertices, unsigned int nrOfTriangles, cl::Buffer vertexBuffer, cl::Buffer indexBuffer, OpenCLDevice::pointer device);
+        /**
+         * The vertex buffer object is created when it is first requested,
+         * so an OpenGL context is only needed when the mesh is rendered.
+         */
         VertexBufferObjectAccess::pointer getVertexBufferObjectAccess(accessType access, OpenCLDevice::pointer device);
+        /**
+         * OpenCL buffers with the same layout as the vertex buffer objects.
+         * No OpenGL context is needed.
+         */
+        MeshOpenCLAccess::pointer getOpenCLAccess(accessType access, OpenCLDevice::pointer device);
+        /**
+         * The host data is stored as contiguous arrays of positions, normals
+         * and triangle indices. The triangles of each vertex are found when
+         * they are first requested.
+         */
         MeshAccess::pointer getMeshAccess(accessType access);
         unsigned int getNrOfTriangles() const;
         unsigned int getNrOfVertices() const;
+        bool isIndexed() const;
         void setBoundingBox(BoundingBox box);
+        /**
+         * Use half precision positions in the vertex buffer object and when
+         * the mesh is transferred from the device to the host. Normals are
+         * 16 bit integers in the vertex buffer object and octahedral encoded
+         * in transfers. This reduces the size of the vertex buffer object
+         * from 24 to 16 bytes per vertex and transfers from 24 to 10 bytes,
+         * while positions only keep about three significant digits.
+         * The vertex buffer object is not compressed if OpenGL doesn't support
+         * half precision vertices. Default is false.
+         */
+        void setCompressedVertices(bool compressed);
+        bool isCompressedVertices() const;
         ~Mesh();
     private:
         Mesh();
         void freeAll();
         void free(ExecutionDevice::pointer device);
+        void setAllDataToOutOfDate();
+        bool isAnyDataUpToDate();
+        // Get vertices and normals interleaved, and the indices if the mesh
+        // is indexed, from storage which is up to date
+        void getDeviceData(std::vector<float>& vertexData, std::vector<uint>& indexData);
+        void readOpenCLBuffers(OpenCLDevice::pointer device, std::vector<float>& vertexData, std::vector<uint>& indexData);
+        void setHostData(const std::vector<float>& vertexData, const std::vector<uint>& indexData);
+        bool copyOpenCLBuffersToVBO(OpenCLDevice::pointer device);
+        void allocateVBO(bool compressed);
+        cl::Kernel getCompressionKernel(OpenCLDevice::pointer device, std::string name);
+        // Find the triangles of each vertex, if not done since the indices changed
+        void createAdjacency();
 
         bool mIsInitialized;
+        bool mIsIndexed;
+        bool mCompressedVertices;
         unsigned int mNrOfTriangles;
+        // Nr of vertices on the device, 3 per triangle if the mesh is not indexed
+        unsigned int mNrOfVertices;
 
         // VBO data
         bool mVBOHasData;
         bool mVBODataIsUpToDate;
         GLuint mVBOID;
+        GLuint mEBOID;
+        bool mVBOIsCompressed;
+
+        // OpenCL buffer data
+        boost::unordered_map<OpenCLDevice::pointer, cl::Buffer> mCLVertexBuffers;
+        boost::unordered_map<OpenCLDevice::pointer, cl::Buffer> mCLIndexBuffers;
+        boost::unordered_map<OpenCLDevice::pointer, bool> mCLBuffersIsUpToDate;
 
         // Host data
         bool mHostHasData;
         bool mHostDataIsUpToDate;
-        std::vector<MeshVertex> mVertices;
-        std::vector<Vector3ui> mTriangles;
+        // Three values for each vertex and triangle
+        std::vector<float> mPositions;
+        std::vector<float> mNormals;
+        std::vector<uint> mIndices;
+        // The triangles of vertex i are mAdjacency[mAdjacencyOffsets[i]] to mAdjacency[mAdjacencyOffsets[i+1]-1]
+        bool mAdjacencyIsUpToDate;
+        std::vector<uint> mAdjacencyOffsets;
+        std::vector<uint> mAdjacency;
+        boost::mutex mAdjacencyMutex;
 
         // Declare as friends so they can get access to the accessFinished methods
         friend class MeshAccess;
         friend class VertexBufferObjectAccess;
+        friend class MeshOpenCLAccess;
 };
 
 } // end namespace fast
@@ -0,0 +1,138 @@
+#include "FAST/Data/MeshCompression.hpp"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace fast {
+
+ushort floatToHalf(float value) {
+    uint bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    const ushort sign = (bits >> 16) & 0x8000;
+    const int floatExponent = (bits >> 23) & 0xff;
+    uint mantissa = bits & 0x7fffff;
+
+    if(floatExponent == 0xff) // Infinity and NaN
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+
+    const int exponent = floatExponent - 127 + 15;
+    if(exponent >= 31) // Too large, becomes infinity
+        return sign | 0x7c00;
+
+    if(exponent <= 0) {
+        // Subnormal half, or zero if too small
+        if(exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        const int shift = 14 - exponent;
+        ushort half = mantissa >> shift;
+        if((mantissa >> (shift - 1)) & 1)
+            half++;
+        return sign | half;
+    }
+
+    ushort half = sign | (exponent << 10) | (mantissa >> 13);
+    // Round to nearest, a carry into the exponent gives the correct result
+    if(mantissa & 0x1000)
+        half++;
+    return half;
+}
+
+float halfToFloat(ushort value) {
+    const uint sign = (uint)(value & 0x8000) << 16;
+    const int exponent = (value >> 10) & 0x1f;
+    const uint mantissa = value & 0x3ff;
+
+    uint bits;
+    if(exponent == 0) {
+        // Zero and subnormals
+        const float magnitude = std::ldexp((float)mantissa, -24);
+        return sign != 0 ? -magnitude : magnitude;
+    } else if(exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+inline float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+inline short toSignedNormalized(float value) {
+    return (short)std::floor(std::max(-1.0f, std::min(1.0f, value))*32767.0f + 0.5f);
+}
+
+void encodeOctahedralNormal(Vector3f normal, short* encoded) {
+    const float sum = std::fabs(normal.x()) + std::fabs(normal.y()) + std::fabs(normal.z());
+    if(sum == 0) {
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+    float x = normal.x() / sum;
+    float y = normal.y() / sum;
+    if(normal.z() < 0) {
+        // Fold the lower half of the octahedron over the upper half
+        const float foldedX = (1.0f - std::fabs(y))*signNotZero(x);
+        y = (1.0f - std::fabs(x))*signNotZero(y);
+        x = foldedX;
+    }
+    encoded[0] = toSignedNormalized(x);
+    encoded[1] = toSignedNormalized(y);
+}
+
+Vector3f decodeOctahedralNormal(const short* encoded) {
+    float x = std::max(encoded[0] / 32767.0f, -1.0f);
+    float y = std::max(encoded[1] / 32767.0f, -1.0f);
+    const float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if(z < 0) {
+        const float unfoldedX = (1.0f - std::fabs(y))*signNotZero(x);
+        y = (1.0f - std::fabs(x))*signNotZero(y);
+        x = unfoldedX;
+    }
+    return Vector3f(x, y, z).normalized();
+}
+
+std::vector<ushort> createCompressedVertexBufferObjectData(const std::vector<float>& vertexData) {
+    const std::size_t nrOfVertices = vertexData.size() / 6;
+    std::vector<ushort> compressedData(nrOfVertices*8);
+    for(std::size_t i = 0; i < nrOfVertices; i++) {
+        for(int k = 0; k < 3; k++) {
+            compressedData[i*8+k] = floatToHalf(vertexData[i*6+k]);
+            compressedData[i*8+4+k] = (ushort)toSignedNormalized(vertexData[i*6+3+k]);
+        }
+        compressedData[i*8+3] = floatToHalf(1.0f);
+        compressedData[i*8+7] = 0;
+    }
+    return compressedData;
+}
+
+void decodeCompressedTransferData(const std::vector<ushort>& compressedData, std::vector<float>& vertexData) {
+    const std::size_t nrOfVertices = compressedData.size() / 5;
+    vertexData.resize(nrOfVertices*6);
+    for(std::size_t i = 0; i < nrOfVertices; i++) {
+        for(int k = 0; k < 3; k++)
+            vertexData[i*6+k] = halfToFloat(compressedData[i*5+k]);
+        const short encoded[2] = {(short)compressedData[i*5+3], (short)compressedData[i*5+4]};
+        const Vector3f normal = decodeOctahedralNormal(encoded);
+        for(int k = 0; k < 3; k++)
+            vertexData[i*6+3+k] = normal[k];
+    }
+}
+
+void decodeCompressedVertexBufferObjectData(const std::vector<ushort>& compressedData, std::vector<float>& vertexData) {
+    const std::size_t nrOfVertices = compressedData.size() / 8;
+    vertexData.resize(nrOfVertices*6);
+    for(std::size_t i = 0; i < nrOfVertices; i++) {
+        for(int k = 0; k < 3; k++) {
+            vertexData[i*6+k] = halfToFloat(compressedData[i*8+k]);
+            vertexData[i*6+3+k] = std::max((short)compressedData[i*8+4+k] / 32767.0f, -1.0f);
+        }
+    }
+}
+
+} // end namespace fast
@@ -0,0 +1,34 @@
+#ifndef MESH_COMPRESSION_HPP_
+#define MESH_COMPRESSION_HPP_
+
+#include "FAST/Data/DataTypes.hpp"
+
+namespace fast {
+
+/**
+ * Encodings used by meshes with compressed vertices. The same encodings are
+ * done on the device in MeshCompression.cl.
+ *
+ * Compressed transfers use 5 16 bit values per vertex: the position as half
+ * precision floats and the normal octahedral encoded as two signed
+ * normalized 16 bit integers. Compressed vertex buffer objects use 8 16 bit
+ * values per vertex, the position as half floats padded with 1 and the
+ * normal as signed normalized 16 bit integers padded with 0, which the
+ * fixed function pipeline can draw directly.
+ */
+ushort floatToHalf(float value);
+float halfToFloat(ushort value);
+
+// Normal on the unit sphere mapped to the octahedron and unfolded to a square
+void encodeOctahedralNormal(Vector3f normal, short* encoded);
+Vector3f decodeOctahedralNormal(const short* encoded);
+
+// Compress interleaved vertex data with three position and three normal floats per vertex
+std::vector<ushort> createCompressedVertexBufferObjectData(const std::vector<float>& vertexData);
+// Decode data of compressed transfers or vertex buffer objects to three position and three normal floats per vertex
+void decodeCompressedTransferData(const std::vector<ushort>& compressedData, std::vector<float>& vertexData);
+void decodeCompressedVertexBufferObjectData(const std::vector<ushort>& compressedData, std::vector<float>& vertexData);
+
+} // end namespace fast
+
+#endif /* MESH_COMPRESSION_HPP_ */
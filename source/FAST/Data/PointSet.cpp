@@ -34,10 +34,12 @@ PointSetAccess::pointer PointSet::getAccess(accessType access) {
 }
 
 PointSet::PointSet() {
+    mIndexTimestamp = 0;
 }
 
 void PointSet::freeAll() {
     mPointSet.clear();
+    mIndex.reset();
 }
 
 void PointSet::free(ExecutionDevice::pointer device) {
@@ -55,6 +57,16 @@ BoundingBox PointSet::getBoundingBox() const {
     return BoundingBox(list);
 }
 
+PointSetIndex::pointer PointSet::getIndex() {
+    blockIfBeingWrittenTo();
+    boost::lock_guard<boost::mutex> lock(mIndexMutex);
+    if(!mIndex || mIndexTimestamp != getTimestamp()) {
+        mIndex = PointSetIndex::pointer(new PointSetIndex(mPointSet));
+        mIndexTimestamp = getTimestamp();
+    }
+    return mIndex;
+}
+
 PointSet::~PointSet() {
     freeAll();
 }
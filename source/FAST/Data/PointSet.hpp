@@ -4,6 +4,7 @@
 #include "SpatialDataObject.hpp"
 #include "DynamicData.hpp"
 #include "FAST/Data/Access/PointSetAccess.hpp"
+#include "FAST/Data/PointSetIndex.hpp"
 
 namespace fast {
 
@@ -14,6 +15,11 @@ class PointSet : public SpatialDataObject {
         uint getNrOfPoints() const;
         PointSetAccess::pointer getAccess(accessType access);
         BoundingBox getBoundingBox() const;
+        /**
+         * Nearest neighbor index of the points. The index is built the first
+         * time it is requested, and kept until the point set is modified.
+         */
+        PointSetIndex::pointer getIndex();
         ~PointSet();
     private:
         PointSet();
@@ -23,6 +29,10 @@ class PointSet : public SpatialDataObject {
         // Host data
         std::vector<Vector3f> mPointSet;
 
+        PointSetIndex::pointer mIndex;
+        unsigned long mIndexTimestamp;
+        boost::mutex mIndexMutex;
+
         // Necessary to give PointSetAccess access to the accessFinished method
         friend class PointSetAccess;
 };
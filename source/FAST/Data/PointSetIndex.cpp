@@ -0,0 +1,193 @@
+#include "FAST/Data/PointSetIndex.hpp"
+#include "FAST/Exception.hpp"
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <limits>
+
+namespace fast {
+
+// Nodes with this many points or fewer are not split
+static const uint LEAF_SIZE = 8;
+
+PointSetIndex::PointSetIndex(const std::vector<Vector3f>& points) {
+    mPoints = points;
+    mIndices.resize(points.size());
+    for(uint i = 0; i < points.size(); i++)
+        mIndices[i] = i;
+    mNormalsNrOfNeighbors = 0;
+    if(points.size() > 0) {
+        mNodes.reserve(2*points.size()/LEAF_SIZE + 1);
+        build(0, points.size());
+    }
+
+    // Sort the points in the order of the tree, so that the points of each
+    // leaf are next to each other in memory
+    mSortedPositions.resize(points.size());
+    for(uint i = 0; i < points.size(); i++) {
+        mPoints[i] = points[mIndices[i]];
+        mSortedPositions[mIndices[i]] = i;
+    }
+}
+
+// Comparison of the points at two indices along one axis
+class AxisComparison {
+    public:
+        AxisComparison(const std::vector<Vector3f>& points, uchar axis) : mPoints(points), mAxis(axis) {};
+        bool operator()(uint a, uint b) const {
+            return mPoints[a][mAxis] < mPoints[b][mAxis];
+        };
+    private:
+        const std::vector<Vector3f>& mPoints;
+        uchar mAxis;
+};
+
+// The points of each node are split at the median along the axis where they
+// have the largest extent
+int PointSetIndex::build(uint begin, uint end) {
+    const int nodeIndex = mNodes.size();
+    Node node;
+    node.begin = begin;
+    node.end = end;
+    node.left = -1;
+    node.right = -1;
+    node.axis = 0;
+    node.split = 0;
+    mNodes.push_back(node);
+
+    if(end - begin <= LEAF_SIZE)
+        return nodeIndex;
+
+    Vector3f minimum = mPoints[mIndices[begin]];
+    Vector3f maximum = minimum;
+    for(uint i = begin + 1; i < end; i++) {
+        minimum = minimum.cwiseMin(mPoints[mIndices[i]]);
+        maximum = maximum.cwiseMax(mPoints[mIndices[i]]);
+    }
+    int axis;
+    (maximum - minimum).maxCoeff(&axis);
+
+    const uint middle = (begin + end) / 2;
+    std::nth_element(mIndices.begin() + begin, mIndices.begin() + middle, mIndices.begin() + end, AxisComparison(mPoints, axis));
+    mNodes[nodeIndex].axis = axis;
+    mNodes[nodeIndex].split = mPoints[mIndices[middle]][axis];
+    const int left = build(begin, middle);
+    const int right = build(middle, end);
+    mNodes[nodeIndex].left = left;
+    mNodes[nodeIndex].right = right;
+    return nodeIndex;
+}
+
+uint PointSetIndex::getNrOfPoints() const {
+    return mPoints.size();
+}
+
+Vector3f PointSetIndex::getPoint(uint i) const {
+    return mPoints.at(mSortedPositions.at(i));
+}
+
+void PointSetIndex::findNearestNeighbor(int nodeIndex, const Vector3f& position, uint& closest, float& closestDistance) const {
+    const Node& node = mNodes[nodeIndex];
+    if(node.left < 0) {
+        for(uint i = node.begin; i < node.end; i++) {
+            const float distance = (mPoints[i] - position).squaredNorm();
+            if(distance < closestDistance) {
+                closestDistance = distance;
+                closest = mIndices[i];
+            }
+        }
+        return;
+    }
+
+    // Search the side of the split containing the position first, and the
+    // other side only if it can have closer points
+    const float difference = position[node.axis] - node.split;
+    findNearestNeighbor(difference < 0 ? node.left : node.right, position, closest, closestDistance);
+    if(difference*difference < closestDistance)
+        findNearestNeighbor(difference < 0 ? node.right : node.left, position, closest, closestDistance);
+}
+
+uint PointSetIndex::findNearestNeighbor(const Vector3f& position, float* squaredDistance) const {
+    if(mPoints.size() == 0)
+        throw Exception("Can't find nearest neighbor in an empty point set");
+
+    uint closest = 0;
+    float closestDistance = std::numeric_limits<float>::max();
+    findNearestNeighbor(0, position, closest, closestDistance);
+    if(squaredDistance != NULL)
+        *squaredDistance = closestDistance;
+    return closest;
+}
+
+// The closest points are kept sorted as (squared distance, index) pairs
+void PointSetIndex::findNearestNeighbors(int nodeIndex, const Vector3f& position, uint k, std::vector<std::pair<float, uint> >& closest) const {
+    const Node& node = mNodes[nodeIndex];
+    if(node.left < 0) {
+        for(uint i = node.begin; i < node.end; i++) {
+            const std::pair<float, uint> candidate((mPoints[i] - position).squaredNorm(), mIndices[i]);
+            if(closest.size() == k && candidate.first >= closest.back().first)
+                continue;
+            closest.insert(std::upper_bound(closest.begin(), closest.end(), candidate), candidate);
+            if(closest.size() > k)
+                closest.pop_back();
+        }
+        return;
+    }
+
+    const float difference = position[node.axis] - node.split;
+    findNearestNeighbors(difference < 0 ? node.left : node.right, position, k, closest);
+    if(closest.size() < k || difference*difference < closest.back().first)
+        findNearestNeighbors(difference < 0 ? node.right : node.left, position, k, closest);
+}
+
+std::vector<uint> PointSetIndex::findNearestNeighbors(const Vector3f& position, uint k) const {
+    std::vector<std::pair<float, uint> > closest;
+    if(k > 0 && mPoints.size() > 0) {
+        closest.reserve(k + 1);
+        findNearestNeighbors(0, position, k, closest);
+    }
+
+    std::vector<uint> indices(closest.size());
+    for(uint i = 0; i < closest.size(); i++)
+        indices[i] = closest[i].second;
+    return indices;
+}
+
+void PointSetIndex::findNearestNeighbors(const MatrixXf& positions, std::vector<uint>& indices, std::vector<float>& squaredDistances) const {
+    indices.resize(positions.cols());
+    squaredDistances.resize(positions.cols());
+    #pragma omp parallel for
+    for(long long i = 0; i < (long long)positions.cols(); i++) {
+        indices[i] = findNearestNeighbor(positions.col(i), &squaredDistances[i]);
+    }
+}
+
+const std::vector<Vector3f>& PointSetIndex::getNormals(uint nrOfNeighbors) {
+    boost::lock_guard<boost::mutex> lock(mNormalsMutex);
+    if(mNormalsNrOfNeighbors == nrOfNeighbors && mNormals.size() == mPoints.size())
+        return mNormals;
+    if(nrOfNeighbors < 3)
+        throw Exception("At least 3 neighbors are needed to estimate normals of a point set");
+
+    mNormals.resize(mPoints.size());
+    #pragma omp parallel for
+    for(long long i = 0; i < (long long)mPoints.size(); i++) {
+        const std::vector<uint> neighbors = findNearestNeighbors(getPoint(i), nrOfNeighbors);
+        Vector3f centroid = Vector3f::Zero();
+        for(uint j = 0; j < neighbors.size(); j++)
+            centroid += getPoint(neighbors[j]);
+        centroid /= neighbors.size();
+        Matrix3f covariance = Matrix3f::Zero();
+        for(uint j = 0; j < neighbors.size(); j++) {
+            const Vector3f deviation = getPoint(neighbors[j]) - centroid;
+            covariance += deviation*deviation.transpose();
+        }
+        // Eigenvalues are sorted in increasing order
+        Eigen::SelfAdjointEigenSolver<Matrix3f> solver(covariance);
+        mNormals[i] = solver.eigenvectors().col(0).normalized();
+    }
+    mNormalsNrOfNeighbors = nrOfNeighbors;
+
+    return mNormals;
+}
+
+} // end namespace fast
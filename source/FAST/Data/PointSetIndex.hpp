@@ -0,0 +1,69 @@
+#ifndef POINT_SET_INDEX_HPP_
+#define POINT_SET_INDEX_HPP_
+
+#include "FAST/Data/DataTypes.hpp"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <vector>
+
+namespace fast {
+
+/**
+ * A k-d tree over a set of points for nearest neighbor queries. The tree is
+ * built once, and can be queried from several threads at the same time.
+ */
+class PointSetIndex {
+    public:
+        typedef boost::shared_ptr<PointSetIndex> pointer;
+        PointSetIndex(const std::vector<Vector3f>& points);
+        uint getNrOfPoints() const;
+        Vector3f getPoint(uint i) const;
+        /**
+         * Returns the index of the point closest to position, and stores the
+         * squared distance to it if squaredDistance is given
+         */
+        uint findNearestNeighbor(const Vector3f& position, float* squaredDistance = NULL) const;
+        /**
+         * Returns the indices of the k points closest to position, closest first
+         */
+        std::vector<uint> findNearestNeighbors(const Vector3f& position, uint k) const;
+        /**
+         * Finds the closest point of each column in positions, in parallel
+         */
+        void findNearestNeighbors(const MatrixXf& positions, std::vector<uint>& indices, std::vector<float>& squaredDistances) const;
+        /**
+         * Unit normals of the points, estimated as the direction of least
+         * variance of the nearest neighbors of each point. The sign of the
+         * normals is arbitrary. The normals are calculated once and kept.
+         */
+        const std::vector<Vector3f>& getNormals(uint nrOfNeighbors = 10);
+    private:
+        struct Node {
+            uint begin;
+            uint end;
+            // Children of the node, or -1 for leaves
+            int left;
+            int right;
+            uchar axis;
+            float split;
+        };
+        int build(uint begin, uint end);
+        void findNearestNeighbor(int node, const Vector3f& position, uint& closest, float& closestDistance) const;
+        void findNearestNeighbors(int node, const Vector3f& position, uint k, std::vector<std::pair<float, uint> >& closest) const;
+
+        // The points, sorted in the order of the leaves of the tree
+        std::vector<Vector3f> mPoints;
+        // Index of each sorted point in the original point set, and the
+        // position of each original point among the sorted points
+        std::vector<uint> mIndices;
+        std::vector<uint> mSortedPositions;
+        std::vector<Node> mNodes;
+
+        std::vector<Vector3f> mNormals;
+        uint mNormalsNrOfNeighbors;
+        boost::mutex mNormalsMutex;
+};
+
+} // end namespace fast
+
+#endif /* POINT_SET_INDEX_HPP_ */
@@ -540,3 +540,68 @@ TEST_CASE("DynamicData with more than one consumer object returns correct frame
 }
 
 
+
+TEST_CASE("DynamicData with PROCESS_ALL keeps frames until all consumers have got them", "[fast][DynamicData]") {
+    DynamicData::pointer image = DynamicData::New();
+    DummyStreamer::pointer streamer = DummyStreamer::New();
+    streamer->setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    image->setStreamer(streamer);
+
+    DummyProcessObject::pointer PO1 = DummyProcessObject::New();
+    DummyProcessObject::pointer PO2 = DummyProcessObject::New();
+    image->registerConsumer(PO1);
+    image->registerConsumer(PO2);
+
+    Image::pointer frame1 = Image::New();
+    Image::pointer frame2 = Image::New();
+    image->addFrame(frame1);
+    image->addFrame(frame2);
+    CHECK(image->getNextFrame(PO1) == frame1);
+    CHECK(image->getSize() == 2);
+    CHECK(image->getNextFrame(PO1) == frame2);
+    CHECK(image->getSize() == 2);
+    CHECK(image->getNextFrame(PO2) == frame1);
+    CHECK(image->getSize() == 1);
+    CHECK(image->getNextFrame(PO2) == frame2);
+    CHECK(image->getSize() == 0);
+}
+
+TEST_CASE("DynamicData with STORE_ALL returns all frames in order when many frames are added", "[fast][DynamicData]") {
+    DynamicData::pointer image = DynamicData::New();
+    DummyStreamer::pointer streamer = DummyStreamer::New();
+    DummyProcessObject::pointer PO = DummyProcessObject::New();
+    streamer->setStreamingMode(STREAMING_MODE_STORE_ALL_FRAMES);
+    image->setStreamer(streamer);
+
+    std::vector<Image::pointer> frames;
+    for(int i = 0; i < 100; i++) {
+        frames.push_back(Image::New());
+        image->addFrame(frames[i]);
+    }
+    CHECK(image->getSize() == 100);
+    for(int i = 0; i < 100; i++)
+        CHECK(image->getNextFrame(PO) == frames[i]);
+}
+
+TEST_CASE("DynamicData counts retrieved and skipped frames for each consumer", "[fast][DynamicData]") {
+    DynamicData::pointer image = DynamicData::New();
+    DummyStreamer::pointer streamer = DummyStreamer::New();
+    DummyProcessObject::pointer PO = DummyProcessObject::New();
+    streamer->setStreamingMode(STREAMING_MODE_NEWEST_FRAME_ONLY);
+    image->setStreamer(streamer);
+    image->registerConsumer(PO);
+
+    image->addFrame(Image::New());
+    image->addFrame(Image::New());
+    image->addFrame(Image::New());
+    image->getNextFrame(PO);
+    image->getNextFrame(PO); // Same frame again is not counted
+    CHECK(image->getNrOfFramesRetrieved(PO) == 1);
+    CHECK(image->getNrOfFramesSkipped(PO) == 2);
+    CHECK(image->getAverageLatency(PO) >= 0);
+    CHECK(image->getMaximumLatency(PO) >= image->getAverageLatency(PO));
+
+    image->resetLatencyCounters();
+    CHECK(image->getNrOfFramesRetrieved(PO) == 0);
+    CHECK(image->getNrOfFramesSkipped(PO) == 0);
+}
@@ -1,5 +1,6 @@
 #include "FAST/Testing.hpp"
 #include "FAST/Data/Image.hpp"
+#include "FAST/Data/ImagePool.hpp"
 #include "FAST/DeviceManager.hpp"
 #include "FAST/Tests/DataComparison.hpp"
 #include "FAST/Utility.hpp"
@@ -1355,11 +1356,186 @@ TEST_CASE("calculateMaximum/MinimumIntensity returns the maximum/minimum intensi
 }
 
 TEST_CASE("calculateMaximum/MinimumIntensity returns the maximum/minimum intensity of a 2D image stored as OpenCL buffer" , "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+    unsigned int width = 31;
+    unsigned int height = 64;
+
+    for(unsigned int nrOfComponents = 1; nrOfComponents <= 4; nrOfComponents++) {
+        for(unsigned int typeNr = 0; typeNr < 5; typeNr++) {
+            DataType type = (DataType)typeNr;
+            void* data = allocateRandomData(width*height*nrOfComponents, type);
 
+            Image::pointer image = Image::New();
+            image->create(width, height, type, nrOfComponents, Host::getInstance(), data);
+            // Make the buffer the only storage which is up to date
+            {
+                OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+            }
+
+            float min,max;
+            getMaxAndMinFromData(data, width*height*nrOfComponents, &min, &max, type);
+            CHECK(image->calculateMaximumIntensity() == Approx(max));
+            CHECK(image->calculateMinimumIntensity() == Approx(min));
+            deleteArray(data, type);
+        }
+    }
 }
 
 TEST_CASE("calculateMaximum/MinimumIntensity returns the maximum/minimum intensity of a 3D image stored as OpenCL buffer" , "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+    unsigned int width = 32;
+    unsigned int height = 43;
+    unsigned int depth = 11;
+
+    for(unsigned int nrOfComponents = 1; nrOfComponents <= 4; nrOfComponents++) {
+        for(unsigned int typeNr = 0; typeNr < 5; typeNr++) {
+            DataType type = (DataType)typeNr;
+            void* data = allocateRandomData(width*height*depth*nrOfComponents, type);
+
+            Image::pointer image = Image::New();
+            image->create(width, height, depth, type, nrOfComponents, Host::getInstance(), data);
+            // Make the buffer the only storage which is up to date
+            {
+                OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+            }
+
+            float min,max;
+            getMaxAndMinFromData(data, width*height*depth*nrOfComponents, &min, &max, type);
+            CHECK(image->calculateMaximumIntensity() == Approx(max));
+            CHECK(image->calculateMinimumIntensity() == Approx(min));
+            deleteArray(data, type);
+        }
+    }
+}
+
+template <class T>
+inline void getMeanAndVarianceFromData(void* voidData, std::size_t nrOfElements, double* mean, double* variance) {
+    T* data = (T*)voidData;
+    double sum = 0;
+    for(std::size_t i = 0; i < nrOfElements; i++)
+        sum += data[i];
+    *mean = sum / nrOfElements;
+    double squaredDifferences = 0;
+    for(std::size_t i = 0; i < nrOfElements; i++)
+        squaredDifferences += (data[i] - *mean)*(data[i] - *mean);
+    *variance = squaredDifferences / nrOfElements;
+}
+
+inline void getMeanAndVarianceFromData(void* data, std::size_t nrOfElements, DataType type, double* mean, double* variance) {
+    switch(type) {
+        fastSwitchTypeMacro(getMeanAndVarianceFromData<FAST_TYPE>(data, nrOfElements, mean, variance))
+    }
+}
+
+TEST_CASE("calculateAverageIntensity and calculateIntensityVariance of a 3D image stored as OpenCL image" , "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+    unsigned int width = 32;
+    unsigned int height = 43;
+    unsigned int depth = 11;
+
+    for(unsigned int nrOfComponents = 1; nrOfComponents <= 4; nrOfComponents++) {
+        for(unsigned int typeNr = 0; typeNr < 5; typeNr++) {
+            DataType type = (DataType)typeNr;
+            void* data = allocateRandomData(width*height*depth*nrOfComponents, type);
+
+            Image::pointer image = Image::New();
+            image->create(width, height, depth, type, nrOfComponents, device, data);
+
+            double mean, variance;
+            getMeanAndVarianceFromData(data, width*height*depth*nrOfComponents, type, &mean, &variance);
+            CHECK(image->calculateAverageIntensity() == Approx(mean).epsilon(0.001));
+            CHECK(image->calculateIntensityVariance() == Approx(variance).epsilon(0.001));
+            deleteArray(data, type);
+        }
+    }
+}
+
+TEST_CASE("calculateAverageIntensity and calculateIntensityVariance of a 2D image stored as OpenCL buffer and on host" , "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+    unsigned int width = 67;
+    unsigned int height = 45;
+
+    for(unsigned int nrOfComponents = 1; nrOfComponents <= 4; nrOfComponents++) {
+        for(unsigned int typeNr = 0; typeNr < 5; typeNr++) {
+            DataType type = (DataType)typeNr;
+            void* data = allocateRandomData(width*height*nrOfComponents, type);
+            double mean, variance;
+            getMeanAndVarianceFromData(data, width*height*nrOfComponents, type, &mean, &variance);
+
+            Image::pointer image = Image::New();
+            image->create(width, height, type, nrOfComponents, Host::getInstance(), data);
+            CHECK(image->calculateAverageIntensity() == Approx(mean).epsilon(0.001));
+            CHECK(image->calculateIntensityVariance() == Approx(variance).epsilon(0.001));
+
+            // Make the buffer the only storage which is up to date
+            {
+                OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+            }
+            CHECK(image->calculateAverageIntensity() == Approx(mean).epsilon(0.001));
+            CHECK(image->calculateIntensityVariance() == Approx(variance).epsilon(0.001));
+            deleteArray(data, type);
+        }
+    }
+}
+
+TEST_CASE("calculateIntensityVariance of an image with a large mean and a small variance" , "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+    const unsigned int width = 512;
+    const unsigned int height = 512;
+    // Alternating 1000 +/- 0.25 has mean 1000 and variance 0.0625, which
+    // is lost when the variance is the mean of squares minus the squared mean
+    std::vector<float> data(width*height);
+    for(unsigned int i = 0; i < width*height; i++)
+        data[i] = i % 2 == 0 ? 1000.25f : 999.75f;
+
+    Image::pointer image = Image::New();
+    image->create(width, height, TYPE_FLOAT, 1, Host::getInstance(), data.data());
+    CHECK(image->calculateAverageIntensity() == Approx(1000));
+    CHECK(image->calculateIntensityVariance() == Approx(0.0625).epsilon(0.001));
+
+    // Make the buffer the only storage which is up to date
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+    }
+    CHECK(image->calculateAverageIntensity() == Approx(1000));
+    CHECK(image->calculateIntensityVariance() == Approx(0.0625).epsilon(0.001));
+
+    Image::pointer image2 = Image::New();
+    image2->create(width, height, TYPE_FLOAT, 1, device, data.data());
+    CHECK(image2->calculateAverageIntensity() == Approx(1000));
+    CHECK(image2->calculateIntensityVariance() == Approx(0.0625).epsilon(0.001));
+}
+
+TEST_CASE("calculateHistogram gives the same result on host, OpenCL image and OpenCL buffer" , "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+    unsigned int width = 64;
+    unsigned int height = 37;
+    unsigned int depth = 19;
+    unsigned int nrOfComponents = 2;
+    void* data = allocateRandomData(width*height*depth*nrOfComponents, TYPE_UINT8);
+
+    Image::pointer hostImage = Image::New();
+    hostImage->create(width, height, depth, TYPE_UINT8, nrOfComponents, Host::getInstance(), data);
+    std::vector<uint> histogram = hostImage->calculateHistogram(16, 0, 256);
+    uint total = 0;
+    for(int i = 0; i < histogram.size(); i++)
+        total += histogram[i];
+    CHECK(total == width*height*depth*nrOfComponents);
 
+    Image::pointer image = Image::New();
+    image->create(width, height, depth, TYPE_UINT8, nrOfComponents, device, data);
+    CHECK(image->calculateHistogram(16, 0, 256) == histogram);
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+    }
+    CHECK(image->calculateHistogram(16, 0, 256) == histogram);
+    deleteArray(data, TYPE_UINT8);
 }
 
 TEST_CASE("calculateMaximum/MinimumIntensity returns the maximum/minimum intensity of a 2D image stored as host array" , "[fast][image]") {
@@ -1481,3 +1657,279 @@ TEST_CASE("createFromImage on 3D image", "[fast][image]") {
 }
 
 
+
+TEST_CASE("Image with storage pooling reuses host data of deleted image with same size", "[fast][image][pool]") {
+    ImagePool& pool = ImagePool::getInstance();
+    pool.clear();
+    pool.resetCounters();
+
+    void* firstData;
+    {
+        Image::pointer image = Image::New();
+        image->enableStoragePooling();
+        CHECK(image->isStoragePoolingEnabled() == true);
+        image->create(256, 256, TYPE_FLOAT, 1);
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+        firstData = access->get();
+        CHECK(pool.getNumberOfMisses() == 1);
+        CHECK(pool.getNumberOfHits() == 0);
+    } // image is deleted here and the data is returned to the pool
+
+    Image::pointer image = Image::New();
+    image->enableStoragePooling();
+    image->create(256, 256, TYPE_FLOAT, 1);
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+    CHECK(access->get() == firstData);
+    CHECK(pool.getNumberOfHits() == 1);
+    CHECK(pool.getNumberOfMisses() == 1);
+    access->release();
+
+    pool.clear();
+}
+
+TEST_CASE("Image with storage pooling does not reuse data of different size or type", "[fast][image][pool]") {
+    ImagePool& pool = ImagePool::getInstance();
+    pool.clear();
+    pool.resetCounters();
+
+    {
+        Image::pointer image = Image::New();
+        image->enableStoragePooling();
+        image->create(256, 256, TYPE_FLOAT, 1);
+        image->getImageAccess(ACCESS_READ_WRITE)->release();
+    }
+    {
+        Image::pointer image = Image::New();
+        image->enableStoragePooling();
+        image->create(256, 128, TYPE_FLOAT, 1);
+        image->getImageAccess(ACCESS_READ_WRITE)->release();
+    }
+    {
+        Image::pointer image = Image::New();
+        image->enableStoragePooling();
+        image->create(256, 256, TYPE_UINT8, 1);
+        image->getImageAccess(ACCESS_READ_WRITE)->release();
+    }
+
+    CHECK(pool.getNumberOfHits() == 0);
+    CHECK(pool.getNumberOfMisses() == 3);
+
+    pool.clear();
+}
+
+TEST_CASE("Image without storage pooling does not use the pool", "[fast][image][pool]") {
+    ImagePool& pool = ImagePool::getInstance();
+    pool.clear();
+    pool.resetCounters();
+
+    for(int i = 0; i < 2; i++) {
+        Image::pointer image = Image::New();
+        CHECK(image->isStoragePoolingEnabled() == false);
+        image->create(256, 256, TYPE_FLOAT, 1);
+        image->getImageAccess(ACCESS_READ_WRITE)->release();
+    }
+
+    CHECK(pool.getNumberOfHits() == 0);
+    CHECK(pool.getNumberOfMisses() == 0);
+}
+
+TEST_CASE("Switching between OpenCL image and buffer on same device does not go through host", "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+
+    unsigned int width = 256;
+    unsigned int height = 512;
+    DataType type = TYPE_FLOAT;
+    void* data = allocateRandomData(width*height*4, type);
+    unsigned long long size = width*height*getSizeOfDataType(type, 4);
+
+    Image::pointer image = Image::New();
+    image->create(width, height, type, 4, device, data);
+    Image::resetTransferCounters();
+
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+        CHECK(compareBufferWithDataArray(*access->get(), device, data, width*height*4, type) == true);
+    }
+    CHECK(Image::getNrOfBytesTransferred(TRANSFER_WITHIN_CONTEXT) == size);
+    {
+        OpenCLImageAccess::pointer access = image->getOpenCLImageAccess(ACCESS_READ, device);
+        CHECK(compareImage2DWithDataArray(*access->get2DImage(), device, data, width, height, 4, type) == true);
+    }
+    CHECK(Image::getNrOfBytesTransferred(TRANSFER_WITHIN_CONTEXT) == 2*size);
+    CHECK(Image::getNrOfBytesTransferred(TRANSFER_STAGED_THROUGH_HOST) == 0);
+    CHECK(Image::getNrOfBytesTransferred(TRANSFER_DEVICE_TO_HOST) == 0);
+    CHECK(Image::getNrOfBytesTransferred(TRANSFER_HOST_TO_DEVICE) == 0);
+
+    deleteArray(data, type);
+}
+
+TEST_CASE("Asynchronous upload of host image gives access object with event and correct data", "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+
+    unsigned int width = 256;
+    unsigned int height = 512;
+    DataType type = TYPE_FLOAT;
+    void* data = allocateRandomData(width*height, type);
+
+    Image::pointer image = Image::New();
+    image->create(width, height, type, 1, Host::getInstance(), data);
+    image->enableAsynchronousTransfers();
+    CHECK(image->isAsynchronousTransfersEnabled() == true);
+
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ, device);
+        CHECK(access->hasEvent() == true);
+        CHECK(access->getEventWaitList() != NULL);
+        access->getEvent().wait();
+        CHECK(compareBufferWithDataArray(*access->get(), device, data, width*height, type) == true);
+    }
+
+    // Host data must be safe to change after write access is given
+    {
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+        CHECK(compareDataArrays(access->get(), data, width*height, type) == true);
+    }
+
+    deleteArray(data, type);
+}
+
+TEST_CASE("Image with pinned host memory keeps host and OpenCL buffer data consistent", "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+
+    unsigned int width = 256;
+    unsigned int height = 512;
+    DataType type = TYPE_UINT8;
+    void* data = allocateRandomData(width*height*2, type);
+
+    Image::pointer image = Image::New();
+    image->enablePinnedHostMemory(device);
+    CHECK(image->isPinnedHostMemoryEnabled() == true);
+    image->create(width, height, type, 2, Host::getInstance(), data);
+
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ, device);
+        CHECK(compareBufferWithDataArray(*access->get(), device, data, width*height*2, type) == true);
+    }
+
+    // Change host data and check that the buffer is updated
+    void* data2 = allocateRandomData(width*height*2, type);
+    {
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+        memcpy(access->get(), data2, width*height*2);
+    }
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+        CHECK(compareBufferWithDataArray(*access->get(), device, data2, width*height*2, type) == true);
+        device->getCommandQueue().enqueueWriteBuffer(*access->get(), CL_TRUE, 0, width*height*2, data);
+    }
+
+    // Change buffer data and check that host is updated
+    {
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+        CHECK(compareDataArrays(access->get(), data, width*height*2, type) == true);
+    }
+
+    deleteArray(data, type);
+    deleteArray(data2, type);
+}
+
+TEST_CASE("Image with pinned host memory created on host without data", "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+
+    Image::pointer image = Image::New();
+    image->enablePinnedHostMemory(device);
+    image->create(64, 64, 64, TYPE_FLOAT, 1);
+    void* data = allocateRandomData(64*64*64, TYPE_FLOAT);
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+        device->getCommandQueue().enqueueWriteBuffer(*access->get(), CL_TRUE, 0, 64*64*64*sizeof(float), data);
+    }
+    {
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+        CHECK(compareDataArrays(access->get(), data, 64*64*64, TYPE_FLOAT) == true);
+    }
+    deleteArray(data, TYPE_FLOAT);
+}
+
+TEST_CASE("Image with pinned host memory enabled after the OpenCL buffer was created", "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+
+    Image::pointer image = Image::New();
+    image->create(64, 64, 64, TYPE_FLOAT, 1);
+    void* data = allocateRandomData(64*64*64, TYPE_FLOAT);
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+        device->getCommandQueue().enqueueWriteBuffer(*access->get(), CL_TRUE, 0, 64*64*64*sizeof(float), data);
+    }
+    // The existing buffer does not use the host data allocated now as storage
+    image->enablePinnedHostMemory(device);
+    {
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+        CHECK(compareDataArrays(access->get(), data, 64*64*64, TYPE_FLOAT) == true);
+        ((float*)access->get())[0] = -1.0f;
+        ((float*)data)[0] = -1.0f;
+    }
+    {
+        OpenCLBufferAccess::pointer access = image->getOpenCLBufferAccess(ACCESS_READ, device);
+        CHECK(compareBufferWithDataArray(*access->get(), device, data, 64*64*64, TYPE_FLOAT) == true);
+    }
+    deleteArray(data, TYPE_FLOAT);
+}
+
+TEST_CASE("Repeated transfers of 3 component image between host and OpenCL image keep data correct", "[fast][image]") {
+    DeviceManager& deviceManager = DeviceManager::getInstance();
+    OpenCLDevice::pointer device = deviceManager.getOneOpenCLDevice();
+
+    unsigned int width = 64;
+    unsigned int height = 32;
+    unsigned int depth = 16;
+    for(unsigned int typeNr = 0; typeNr < 5; typeNr++) {
+        DataType type = (DataType)typeNr;
+        void* data = allocateRandomData(width*height*depth*3, type);
+
+        Image::pointer image = Image::New();
+        image->create(width, height, depth, type, 3, Host::getInstance(), data);
+        for(int i = 0; i < 2; i++) {
+            {
+                OpenCLImageAccess::pointer access = image->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
+                CHECK(compareImage3DWithDataArray(*access->get3DImage(), device, data, width, height, depth, 3, type) == true);
+            }
+            {
+                ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+                CHECK(compareDataArrays(access->get(), data, width*height*depth*3, type) == true);
+            }
+        }
+
+        deleteArray(data, type);
+    }
+}
+
+// This test needs more than 4 GB of memory and is therefore hidden, run it with the [large] tag
+TEST_CASE("Image with more than 4 Gi voxels can be created and accessed on host", "[fast][image][.][large]") {
+    unsigned int width = 2048;
+    unsigned int height = 2048;
+    unsigned int depth = 1025; // 2048*2048*1025 > 2^32
+    std::size_t nrOfVoxels = (std::size_t)width*height*depth;
+
+    Image::pointer image = Image::New();
+    image->create(width, height, depth, TYPE_UINT8, 1);
+    {
+        ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+        memset(access->get(), 1, nrOfVoxels);
+        access->setScalar(Vector3i(width-1, height-1, depth-1), 255);
+        access->setScalar(Vector3i(0, 0, depth-1), 0);
+    }
+
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+    CHECK(access->getScalar(nrOfVoxels-1) == 255);
+    CHECK(access->getScalar((std::size_t)width*height*(depth-1)) == 0);
+    CHECK(((uchar*)access->get())[nrOfVoxels-1] == 255);
+    access->release();
+    CHECK(image->calculateMaximumIntensity() == 255);
+    CHECK(image->calculateMinimumIntensity() == 0);
+}
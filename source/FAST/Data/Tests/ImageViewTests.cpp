@@ -0,0 +1,133 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Data/Image.hpp"
+#include "FAST/Data/Access/ImageAccess.hpp"
+
+using namespace fast;
+
+TEST_CASE("ImageView gives the same values as ImageAccess::getScalar", "[fast][image][ImageView]") {
+    const int width = 5, height = 4, depth = 3, components = 3;
+    short* data = new short[width*height*depth*components];
+    for(int i = 0; i < width*height*depth*components; i++)
+        data[i] = (short)(i*331 - 12000);
+    Image::pointer image = Image::New();
+    image->create(width, height, depth, TYPE_SNORM_INT16, components, Host::getInstance(), data);
+    delete[] data;
+
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+    ImageView<short, 3> view = access->getView<short, 3>();
+    CHECK(view.getSize() == Vector3i(width, height, depth));
+    CHECK(view.getNrOfVoxels() == width*height*depth);
+    for(int z = 0; z < depth; z++) {
+    for(int y = 0; y < height; y++) {
+    for(int x = 0; x < width; x++) {
+        const Vector3i position(x, y, z);
+        for(int c = 0; c < components; c++)
+            CHECK(view.getScalar(position, c) == Approx(access->getScalar(position, c)));
+        Vector3f vector = view.getVector(position);
+        CHECK(vector.x() == Approx(access->getScalar(position, 0)));
+        CHECK(vector.z() == Approx(access->getScalar(position, 2)));
+    }}}
+}
+
+TEST_CASE("ImageView with wrong type or number of components throws", "[fast][image][ImageView]") {
+    Image::pointer image = Image::New();
+    image->create(4, 4, TYPE_UINT8, 2);
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+    CHECK_THROWS((access->getView<float, 2>()));
+    CHECK_THROWS((access->getView<uchar, 1>()));
+    CHECK_NOTHROW((access->getView<uchar, 2>()));
+}
+
+TEST_CASE("ImageView row, column and channel iterators", "[fast][image][ImageView]") {
+    const int width = 4, height = 3;
+    float* data = new float[width*height*2];
+    for(int i = 0; i < width*height; i++) {
+        data[i*2] = i;
+        data[i*2 + 1] = -i;
+    }
+    Image::pointer image = Image::New();
+    image->create(width, height, TYPE_FLOAT, 2, Host::getInstance(), data);
+    delete[] data;
+
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ_WRITE);
+    ImageView<float, 2> view = access->getView<float, 2>();
+
+    int count = 0;
+    for(StridedIterator<float> it = view.beginRow(1); it != view.endRow(1); ++it) {
+        CHECK(*it == Approx(width + count));
+        count++;
+    }
+    CHECK(count == width);
+
+    count = 0;
+    for(StridedIterator<float> it = view.beginColumn(2, 0, 1); it != view.endColumn(2, 0, 1); ++it) {
+        CHECK(*it == Approx(-(2 + count*width)));
+        count++;
+    }
+    CHECK(count == height);
+
+    float sum = 0;
+    for(StridedIterator<float> it = view.beginChannel(1); it != view.endChannel(1); ++it)
+        sum += *it;
+    CHECK(sum == Approx(-(width*height - 1)*width*height/2.0f));
+
+    // Writes are visible through the access
+    view(3, 2, 0, 1) = 42;
+    CHECK(access->getScalar(Vector3i(3, 2, 0), 1) == Approx(42));
+}
+
+TEST_CASE("ImageView neighborhood iterator", "[fast][image][ImageView]") {
+    Image::pointer volume = Image::New();
+    volume->create(3, 3, 3, TYPE_UINT8, 1);
+    ImageAccess::pointer volumeAccess = volume->getImageAccess(ACCESS_READ_WRITE);
+    ImageView<uchar> volumeView = volumeAccess->getView<uchar, 1>();
+    for(std::size_t i = 0; i < volumeView.getNrOfVoxels(); i++)
+        volumeView[i] = i;
+
+    const Vector3i center(1, 1, 1);
+    int count = 0;
+    int sum = 0;
+    for(ImageView<uchar>::Neighborhood n = volumeView.beginNeighborhood(center); n != volumeView.endNeighborhood(center); ++n) {
+        CHECK(n.getOffset() != Vector3i::Zero());
+        CHECK(*n == volumeView.getIndex(n.getPosition().x(), n.getPosition().y(), n.getPosition().z()));
+        count++;
+        sum += *n;
+    }
+    CHECK(count == 26);
+    CHECK(sum == 26*27/2 - 13);
+
+    Image::pointer image = Image::New();
+    image->create(3, 3, TYPE_UINT8, 1);
+    ImageAccess::pointer imageAccess = image->getImageAccess(ACCESS_READ);
+    ImageView<uchar> imageView = imageAccess->getView<uchar, 1>();
+    count = 0;
+    for(ImageView<uchar>::Neighborhood n = imageView.beginNeighborhood(Vector3i(1, 1, 0)); n != imageView.endNeighborhood(Vector3i(1, 1, 0)); ++n) {
+        CHECK(n.getOffset().z() == 0);
+        count++;
+    }
+    CHECK(count == 8);
+}
+
+struct SumVisitor {
+    float sum;
+    int size;
+    template <class View>
+    void operator()(const View& view) {
+        size = sizeof(typename View::ValueType);
+        for(std::size_t i = 0; i < view.getNrOfVoxels(); i++)
+            sum += view.getScalar(i);
+    }
+};
+
+TEST_CASE("ImageAccess visit dispatches on the data type", "[fast][image][ImageView]") {
+    ushort data[4] = {1, 2, 3, 4};
+    Image::pointer image = Image::New();
+    image->create(2, 2, TYPE_UINT16, 1, Host::getInstance(), data);
+    ImageAccess::pointer access = image->getImageAccess(ACCESS_READ);
+
+    SumVisitor visitor = {0, 0};
+    access->visit<1>(visitor);
+    CHECK(visitor.sum == Approx(10));
+    CHECK(visitor.size == sizeof(ushort));
+    CHECK_THROWS(access->visit<2>(visitor));
+}
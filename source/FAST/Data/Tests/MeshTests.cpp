@@ -0,0 +1,187 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Data/Mesh.hpp"
+#include "FAST/Data/MeshCompression.hpp"
+#include "FAST/DeviceManager.hpp"
+
+using namespace fast;
+
+// Two triangles sharing an edge
+static Mesh::pointer createSquareMesh() {
+    std::vector<Vector3f> vertices;
+    vertices.push_back(Vector3f(0, 0, 0));
+    vertices.push_back(Vector3f(1, 0, 0));
+    vertices.push_back(Vector3f(1, 1, 0));
+    vertices.push_back(Vector3f(0, 1, 0));
+    std::vector<Vector3f> normals(4, Vector3f(0, 0, 1));
+    std::vector<Vector3ui> triangles;
+    triangles.push_back(Vector3ui(0, 1, 2));
+    triangles.push_back(Vector3ui(0, 2, 3));
+    Mesh::pointer mesh = Mesh::New();
+    mesh->create(vertices, normals, triangles);
+    return mesh;
+}
+
+// Position and normal of each vertex of each triangle of the square mesh
+static std::vector<float> createSquareTriangleData() {
+    const float positions[6][3] = {{0,0,0}, {1,0,0}, {1,1,0}, {0,0,0}, {1,1,0}, {0,1,0}};
+    std::vector<float> data;
+    for(int i = 0; i < 6; i++) {
+        for(int j = 0; j < 3; j++)
+            data.push_back(positions[i][j]);
+        data.push_back(0);
+        data.push_back(0);
+        data.push_back(1);
+    }
+    return data;
+}
+
+TEST_CASE("Mesh host data is transferred to OpenCL buffers", "[fast][Mesh]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        Mesh::pointer mesh = createSquareMesh();
+        CHECK(mesh->isIndexed() == true);
+        MeshOpenCLAccess::pointer access = mesh->getOpenCLAccess(ACCESS_READ, devices[i]);
+        REQUIRE(access->getIndexBuffer() != NULL);
+        std::vector<float> vertices(4*6);
+        std::vector<uint> indices(2*3);
+        devices[i]->getCommandQueue().enqueueReadBuffer(*access->getVertexBuffer(), CL_TRUE, 0, vertices.size()*sizeof(float), vertices.data());
+        devices[i]->getCommandQueue().enqueueReadBuffer(*access->getIndexBuffer(), CL_TRUE, 0, indices.size()*sizeof(uint), indices.data());
+        // Third vertex and its normal
+        CHECK(vertices[2*6] == 1);
+        CHECK(vertices[2*6+1] == 1);
+        CHECK(vertices[2*6+2] == 0);
+        CHECK(vertices[2*6+5] == 1);
+        CHECK(indices[3] == 0);
+        CHECK(indices[4] == 2);
+        CHECK(indices[5] == 3);
+    }
+}
+
+TEST_CASE("Mesh written in OpenCL buffer is welded on the host", "[fast][Mesh]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        std::vector<float> data = createSquareTriangleData();
+        Mesh::pointer mesh = Mesh::New();
+        mesh->create(2);
+        CHECK(mesh->isIndexed() == false);
+        {
+            MeshOpenCLAccess::pointer access = mesh->getOpenCLAccess(ACCESS_READ_WRITE, devices[i]);
+            CHECK(access->getIndexBuffer() == NULL);
+            devices[i]->getCommandQueue().enqueueWriteBuffer(*access->getVertexBuffer(), CL_TRUE, 0, data.size()*sizeof(float), data.data());
+        }
+
+        MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+        std::vector<MeshVertex> vertices = access->getVertices();
+        std::vector<Vector3ui> triangles = access->getTriangles();
+        REQUIRE(vertices.size() == 4);
+        REQUIRE(triangles.size() == 2);
+        CHECK(vertices[triangles[1][2]].position == Vector3f(0, 1, 0));
+        CHECK(vertices[triangles[0][0]].triangles.size() == 2);
+    }
+}
+
+TEST_CASE("Indexed mesh written in OpenCL buffers is read on the host", "[fast][Mesh]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        std::vector<float> data = createSquareTriangleData();
+        // Remove the duplicates
+        std::vector<float> vertexData(data.begin(), data.begin()+3*6);
+        vertexData.insert(vertexData.end(), data.begin()+5*6, data.end());
+        const uint indexData[6] = {0, 1, 2, 0, 2, 3};
+        Mesh::pointer mesh = Mesh::New();
+        mesh->create(4, 2);
+        {
+            MeshOpenCLAccess::pointer access = mesh->getOpenCLAccess(ACCESS_READ_WRITE, devices[i]);
+            devices[i]->getCommandQueue().enqueueWriteBuffer(*access->getVertexBuffer(), CL_TRUE, 0, vertexData.size()*sizeof(float), vertexData.data());
+            devices[i]->getCommandQueue().enqueueWriteBuffer(*access->getIndexBuffer(), CL_TRUE, 0, 6*sizeof(uint), indexData);
+        }
+
+        MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+        std::vector<MeshVertex> vertices = access->getVertices();
+        std::vector<Vector3ui> triangles = access->getTriangles();
+        REQUIRE(vertices.size() == 4);
+        REQUIRE(triangles.size() == 2);
+        CHECK(triangles[1] == Vector3ui(0, 2, 3));
+        CHECK(vertices[3].position == Vector3f(0, 1, 0));
+        CHECK(vertices[0].triangles.size() == 2);
+        CHECK(vertices[1].triangles.size() == 1);
+    }
+}
+
+TEST_CASE("Mesh host data is stored in contiguous arrays", "[fast][Mesh]") {
+    Mesh::pointer mesh = createSquareMesh();
+    MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+    REQUIRE(access->getNrOfVertices() == 4);
+    REQUIRE(access->getNrOfTriangles() == 2);
+    float* positions = access->getPositions();
+    float* normals = access->getNormals();
+    uint* indices = access->getIndices();
+    CHECK(positions[2*3] == 1);
+    CHECK(positions[2*3+1] == 1);
+    CHECK(normals[3*3+2] == 1);
+    CHECK(indices[5] == 3);
+}
+
+TEST_CASE("Mesh vertex triangles are created on demand", "[fast][Mesh]") {
+    Mesh::pointer mesh = createSquareMesh();
+    {
+        MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+        std::vector<uint> triangles = access->getVertexTriangles(2);
+        REQUIRE(triangles.size() == 2);
+        CHECK(triangles[0] == 0);
+        CHECK(triangles[1] == 1);
+        REQUIRE(access->getVertexTriangles(1).size() == 1);
+        CHECK(access->getVertexTriangles(3)[0] == 1);
+    }
+    {
+        // Writing invalidates the adjacency
+        MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ_WRITE);
+        access->getIndices()[5] = 1;
+        CHECK(access->getVertexTriangles(1).size() == 2);
+        CHECK(access->getVertexTriangles(3).size() == 0);
+    }
+}
+
+TEST_CASE("Half precision and octahedral normal encodings", "[fast][Mesh]") {
+    CHECK(halfToFloat(floatToHalf(1.5f)) == 1.5f);
+    CHECK(halfToFloat(floatToHalf(-2048.0f)) == -2048.0f);
+    CHECK(halfToFloat(floatToHalf(0.0f)) == 0.0f);
+    CHECK(halfToFloat(floatToHalf(0.1f)) == Approx(0.1f).epsilon(0.001));
+    CHECK(halfToFloat(floatToHalf(100000.0f)) == std::numeric_limits<float>::infinity());
+
+    std::vector<Vector3f> normals;
+    normals.push_back(Vector3f(0, 0, 1));
+    normals.push_back(Vector3f(0, 0, -1));
+    normals.push_back(Vector3f(1, -2, 3).normalized());
+    normals.push_back(Vector3f(-3, 1, -2).normalized());
+    for(int i = 0; i < normals.size(); i++) {
+        short encoded[2];
+        encodeOctahedralNormal(normals[i], encoded);
+        const Vector3f decoded = decodeOctahedralNormal(encoded);
+        CHECK((decoded - normals[i]).norm() < 0.001f);
+    }
+}
+
+TEST_CASE("Mesh with compressed vertices written in OpenCL buffer is read on the host", "[fast][Mesh]") {
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        std::vector<float> data = createSquareTriangleData();
+        Mesh::pointer mesh = Mesh::New();
+        mesh->setCompressedVertices(true);
+        mesh->create(2);
+        {
+            MeshOpenCLAccess::pointer access = mesh->getOpenCLAccess(ACCESS_READ_WRITE, devices[i]);
+            devices[i]->getCommandQueue().enqueueWriteBuffer(*access->getVertexBuffer(), CL_TRUE, 0, data.size()*sizeof(float), data.data());
+        }
+
+        MeshAccess::pointer access = mesh->getMeshAccess(ACCESS_READ);
+        REQUIRE(access->getNrOfVertices() == 4);
+        REQUIRE(access->getNrOfTriangles() == 2);
+        CHECK(access->getPosition(access->getIndices()[5]) == Vector3f(0, 1, 0));
+        CHECK(access->getNormal(0).z() == Approx(1));
+    }
+}
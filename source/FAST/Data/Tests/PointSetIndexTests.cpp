@@ -0,0 +1,96 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Data/PointSet.hpp"
+#include <cstdlib>
+#include <limits>
+
+namespace fast {
+
+static std::vector<Vector3f> createRandomPoints(uint nrOfPoints) {
+    std::srand(0);
+    std::vector<Vector3f> points;
+    for(uint i = 0; i < nrOfPoints; i++)
+        points.push_back(Vector3f(std::rand() % 1000, std::rand() % 500, std::rand() % 100) / 10.0f);
+    return points;
+}
+
+static uint findNearestNeighborByBruteForce(const std::vector<Vector3f>& points, Vector3f position) {
+    uint closest = 0;
+    float closestDistance = std::numeric_limits<float>::max();
+    for(uint i = 0; i < points.size(); i++) {
+        if((points[i] - position).squaredNorm() < closestDistance) {
+            closestDistance = (points[i] - position).squaredNorm();
+            closest = i;
+        }
+    }
+    return closest;
+}
+
+TEST_CASE("PointSetIndex finds same nearest neighbors as brute force", "[fast][PointSetIndex]") {
+    std::vector<Vector3f> points = createRandomPoints(5000);
+    PointSetIndex index(points);
+    REQUIRE(index.getNrOfPoints() == points.size());
+    CHECK(index.getPoint(10) == points[10]);
+
+    MatrixXf positions(3, 200);
+    for(uint i = 0; i < positions.cols(); i++)
+        positions.col(i) = Vector3f(std::rand() % 1200 - 100, std::rand() % 600 - 50, std::rand() % 200 - 50) / 10.0f;
+    std::vector<uint> indices;
+    std::vector<float> squaredDistances;
+    index.findNearestNeighbors(positions, indices, squaredDistances);
+    REQUIRE(indices.size() == positions.cols());
+    bool equal = true;
+    for(uint i = 0; i < positions.cols(); i++) {
+        const Vector3f position = positions.col(i);
+        // Several points may be equally close, so the distances are compared
+        const float closestDistance = (points[findNearestNeighborByBruteForce(points, position)] - position).squaredNorm();
+        if(squaredDistances[i] != closestDistance || (points[indices[i]] - position).squaredNorm() != closestDistance)
+            equal = false;
+    }
+    CHECK(equal);
+}
+
+TEST_CASE("PointSetIndex finds k nearest neighbors in order", "[fast][PointSetIndex]") {
+    std::vector<Vector3f> points;
+    for(uint i = 0; i < 100; i++)
+        points.push_back(Vector3f(i, 0, 0));
+    PointSetIndex index(points);
+
+    std::vector<uint> neighbors = index.findNearestNeighbors(Vector3f(50.2, 1, 0), 4);
+    REQUIRE(neighbors.size() == 4);
+    CHECK(neighbors[0] == 50);
+    CHECK(neighbors[1] == 51);
+    CHECK(neighbors[2] == 49);
+    CHECK(neighbors[3] == 52);
+    CHECK(index.findNearestNeighbors(Vector3f(0, 0, 0), 200).size() == 100);
+}
+
+TEST_CASE("PointSetIndex estimates normals of a plane", "[fast][PointSetIndex]") {
+    std::vector<Vector3f> points;
+    for(uint x = 0; x < 20; x++) {
+    for(uint y = 0; y < 20; y++) {
+        points.push_back(Vector3f(x, y, 0.5f*x));
+    }}
+    PointSetIndex index(points);
+    const std::vector<Vector3f>& normals = index.getNormals(8);
+    REQUIRE(normals.size() == points.size());
+    const Vector3f expectedNormal = Vector3f(-0.5f, 0, 1).normalized();
+    for(uint i = 0; i < normals.size(); i += 37)
+        CHECK(fabs(normals[i].dot(expectedNormal)) == Approx(1.0f));
+}
+
+TEST_CASE("PointSet keeps its index until it is modified", "[fast][PointSetIndex]") {
+    PointSet::pointer pointSet = PointSet::New();
+    pointSet->create(createRandomPoints(100));
+    PointSetIndex::pointer index = pointSet->getIndex();
+    CHECK(index->getNrOfPoints() == 100);
+    CHECK(pointSet->getIndex() == index);
+
+    {
+        PointSetAccess::pointer access = pointSet->getAccess(ACCESS_READ_WRITE);
+        access->addPoint(Vector3f(0, 0, 0));
+    }
+    CHECK(pointSet->getIndex() != index);
+    CHECK(pointSet->getIndex()->getNrOfPoints() == 101);
+}
+
+} // end namespace fast
@@ -0,0 +1,57 @@
+/**
+ * Examples/Utility/prewarmKernelCache.cpp
+ *
+ * Builds OpenCL programs for all devices and stores the binaries in the
+ * kernel binary cache, so that applications start without compiling them.
+ *
+ * Usage: prewarmKernelCache [--directory dir] [--options "build options"] file.cl ...
+ * Relative filenames are relative to the FAST source directory.
+ */
+#include "FAST/KernelBinaryCache.hpp"
+#include "FAST/DeviceManager.hpp"
+#include <boost/filesystem.hpp>
+#include <iostream>
+
+using namespace fast;
+
+int main(int argc, char** argv) {
+    KernelBinaryCache& cache = KernelBinaryCache::getInstance();
+    std::string buildOptions = "";
+    std::vector<std::string> filenames;
+    for(int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        if(argument == "--directory" && i+1 < argc) {
+            cache.setDirectory(argv[++i]);
+        } else if(argument == "--options" && i+1 < argc) {
+            buildOptions = argv[++i];
+        } else if(boost::filesystem::path(argument).is_absolute()) {
+            filenames.push_back(argument);
+        } else {
+            filenames.push_back(std::string(FAST_SOURCE_DIR) + argument);
+        }
+    }
+    if(filenames.size() == 0) {
+        // Programs used for rendering, which are built without build options
+        filenames.push_back(std::string(FAST_SOURCE_DIR) + "Visualization/ImageRenderer/ImageRenderer.cl");
+        filenames.push_back(std::string(FAST_SOURCE_DIR) + "Visualization/ImageRenderer/ImageRenderer2D.cl");
+        filenames.push_back(std::string(FAST_SOURCE_DIR) + "MeshCompression.cl");
+    }
+
+    std::cout << "Storing kernel binaries in " << cache.getDirectory() << std::endl;
+    try {
+        cache.prewarm(DeviceManager::getInstance().getAllDevices(), filenames, buildOptions);
+    } catch(Exception &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<KernelBinaryCacheRecord> records = cache.getRecords();
+    for(int i = 0; i < records.size(); i++) {
+        std::cout << records[i].filename << " (" << records[i].deviceName << "): ";
+        if(records[i].loadedFromCache) {
+            std::cout << "loaded from cache in " << records[i].loadTime << " ms" << std::endl;
+        } else {
+            std::cout << "compiled in " << records[i].compileTime << " ms" << std::endl;
+        }
+    }
+}
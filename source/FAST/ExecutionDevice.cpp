@@ -1,11 +1,8 @@
 #include "FAST/ExecutionDevice.hpp"
 #include "FAST/RuntimeMeasurementManager.hpp"
+#include "FAST/KernelBinaryCache.hpp"
 #include "FAST/Utility.hpp"
-#include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
-#include <boost/lexical_cast.hpp>
-#include <boost/filesystem.hpp>
-#include <boost/functional/hash.hpp>
 #include <fstream>
 
 #if defined(__APPLE__) || defined(__MACOSX)
@@ -19,14 +16,10 @@
 #endif
 #endif
 
-// Some include files for reading the modification date of files
 #ifdef WIN32
 #include <windows.h>
 #undef min
 #undef max
-#else
-#include <sys/stat.h>
-#include <time.h>
 #endif
 
 namespace fast {
@@ -97,9 +90,6 @@ OpenCLDevice::OpenCLDevice() {
     mIsHost = false;
 }
 
-
-boost::mutex buildBinaryMutex; // a global mutex
-
 bool OpenCLDevice::isImageFormatSupported(cl_channel_order order, cl_channel_type type, cl_mem_object_type imageType) {
     std::vector<cl::ImageFormat> formats;
     context.getSupportedImageFormats(CL_MEM_READ_WRITE, imageType, &formats);
@@ -209,8 +199,7 @@ int OpenCLDevice::createProgramFromSource(std::string filename, std::string buil
         cl::Program::Sources source(1, std::make_pair(sourceCode.c_str(), sourceCode.length()));
         program = buildSources(source, buildOptions);
     }
-    programs.push_back(program);
-    return programs.size()-1;
+    return addProgram(program);
 }
 
 /**
@@ -226,19 +215,24 @@ int OpenCLDevice::createProgramFromSource(std::vector<std::string> filenames, st
     }
 
     cl::Program program = buildSources(sources, buildOptions);
-    programs.push_back(program);
-    return programs.size()-1;
+    return addProgram(program);
 }
 
 int OpenCLDevice::createProgramFromString(std::string code, std::string buildOptions) {
     cl::Program::Sources source(1, std::make_pair(code.c_str(), code.length()));
 
     cl::Program program = buildSources(source, buildOptions);
+    return addProgram(program);
+}
+
+int OpenCLDevice::addProgram(cl::Program program) {
+    boost::lock_guard<boost::mutex> lock(mProgramMutex);
     programs.push_back(program);
     return programs.size()-1;
 }
 
 cl::Program OpenCLDevice::getProgram(unsigned int i) {
+    boost::lock_guard<boost::mutex> lock(mProgramMutex);
     return programs[i];
 }
 
@@ -271,7 +265,6 @@ cl::Program OpenCLDevice::buildSources(cl::Program::Sources source, std::string
     // Build program for the context devices
     try{
         program.build(devices, buildOptions.c_str());
-        programs.push_back(program);
     } catch(cl::Error &error) {
         if(error.err() == CL_BUILD_PROGRAM_FAILURE) {
             for(unsigned int i=0; i<devices.size(); i++){
@@ -290,198 +283,42 @@ RuntimeMeasurementsManagerPtr OpenCLDevice::getRunTimeMeasurementManager(){
 }
 
 
-cl::Program OpenCLDevice::writeBinary(std::string filename, std::string buildOptions) {
-    // Build program from source file and store the binary file
-    std::string sourceCode = readFile(filename);
-
-    cl::Program::Sources source(1, std::make_pair(sourceCode.c_str(), sourceCode.length()));
-    cl::Program program = buildSources(source, buildOptions);
-
-    VECTOR_CLASS<std::size_t> binarySizes;
-    binarySizes = program.getInfo<CL_PROGRAM_BINARY_SIZES>();
-
-    VECTOR_CLASS<char *> binaries;
-    binaries = program.getInfo<CL_PROGRAM_BINARIES>();
-
-    boost::hash<std::string> hash_function;
-    std::string deviceName = getDevice(0).getInfo<CL_DEVICE_NAME>();
-    std::size_t hash = hash_function(buildOptions + deviceName);
-    std::string binaryPath = std::string(OUL_OPENCL_KERNEL_BINARY_PATH);
-    std::string binaryFilename = binaryPath + filename + "_" + boost::lexical_cast<std::string>(hash) + ".bin";
-    std::string cacheFilename = binaryPath + filename + "_" + boost::lexical_cast<std::string>(hash) + ".cache";
-    if(binaryPath != "") {
-        // Remove shared path from filename
-        for(int i = 0; i < std::min(filename.size(), binaryPath.size()); i++) {
-            if(binaryPath[i] == filename[i]) {
-
-            } else {
-                binaryFilename = binaryPath + filename.substr(i) + "_" + boost::lexical_cast<std::string>(hash) + ".bin";
-                cacheFilename = binaryPath + filename.substr(i) + "_" + boost::lexical_cast<std::string>(hash) + ".cache";
-                break;
-            }
-        }
-    }
-
-    // Create directories if they don't exist
-    if(binaryFilename.rfind("/") != std::string::npos) {
-        std::string directoryPath = binaryFilename.substr(0, binaryFilename.rfind("/"));
-        boost::filesystem::create_directories(directoryPath);
-    }
-    FILE * file = fopen(binaryFilename.c_str(), "wb");
-    if(!file)
-        printf("could not write to file\n");
-    fwrite(binaries[0], sizeof(char), (int)binarySizes[0], file);
-    fclose(file);
-
-    // Write cache file
-    FILE * cacheFile = fopen(cacheFilename.c_str(), "w");
-    std::string timeStr;
-    #ifdef WIN32
-	HANDLE hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
-	FILETIME ftCreate, ftAccess, ftWrite;
-	SYSTEMTIME sysTime;
-	GetFileTime(hFile, &ftCreate, &ftAccess, &ftWrite);
-	FileTimeToSystemTime(&ftWrite, &sysTime);
-	char* buffer = new char[255];
-	sprintf(buffer, "%d%d%d%d%d", sysTime.wYear, sysTime.wMonth, sysTime.wDay, sysTime.wHour, sysTime.wMinute, sysTime.wSecond);
-	timeStr = buffer;
-	delete[] buffer;
-    #else
-    struct stat attrib; // create a file attribute structure
-    stat(filename.c_str(), &attrib);
-    timeStr = ctime(&(attrib.st_mtime));
-    #endif
-    VECTOR_CLASS<cl::Device> devices = context.getInfo<CL_CONTEXT_DEVICES>();
-    timeStr += "-" + devices[0].getInfo<CL_DEVICE_NAME>() + "\n";
-    timeStr += "-" + buildOptions;
-    fwrite(timeStr.c_str(), sizeof(char), timeStr.size(), cacheFile);
-    fclose(cacheFile);
-
-    return program;
-}
-
-cl::Program OpenCLDevice::readBinary(std::string filename) {
-    std::ifstream sourceFile(filename.c_str(), std::ios_base::binary | std::ios_base::in);
-    std::string sourceCode(
-        std::istreambuf_iterator<char>(sourceFile),
-        (std::istreambuf_iterator<char>()));
-    cl::Program::Binaries binary(1, std::make_pair(sourceCode.c_str(), sourceCode.length()));
-
-    VECTOR_CLASS<cl::Device> devices = context.getInfo<CL_CONTEXT_DEVICES>();
-    if(devices.size() > 1) {
-        // Currently only support compiling for one device
-        cl::Device device = devices[0];
-        devices.clear();
-        devices.push_back(device);
-    }
-
-    cl::Program program = cl::Program(context, devices, binary);
-
-    // Build program for these specific devices
-    program.build(devices);
-    return program;
-}
-
 cl::Program OpenCLDevice::buildProgramFromBinary(std::string filename, std::string buildOptions) {
-    boost::lock_guard<boost::mutex> lock(buildBinaryMutex);
-    cl::Program program;
-
-    boost::hash<std::string> hash_function;
-    std::string deviceName = getDevice(0).getInfo<CL_DEVICE_NAME>();
-    std::size_t hash = hash_function(buildOptions + deviceName);
-    std::string binaryPath = std::string(OUL_OPENCL_KERNEL_BINARY_PATH);
-    std::string binaryFilename = binaryPath + filename + "_" + boost::lexical_cast<std::string>(hash) + ".bin";
-    std::string cacheFilename = binaryPath + filename + "_" + boost::lexical_cast<std::string>(hash) + ".cache";
-    if(binaryPath != "") {
-        // Remove shared path from filename
-        for(int i = 0; i < std::min(filename.size(), binaryPath.size()); i++) {
-            if(binaryPath[i] == filename[i]) {
-
-            } else {
-                binaryFilename = binaryPath + filename.substr(i) + "_" + boost::lexical_cast<std::string>(hash) + ".bin";
-                cacheFilename = binaryPath + filename.substr(i) + "_" + boost::lexical_cast<std::string>(hash) + ".cache";
-                break;
-            }
-        }
-    }
-
-    // Check if a binary file exists
-    std::ifstream binaryFile(binaryFilename.c_str(), std::ios_base::binary | std::ios_base::in);
-    if(binaryFile.fail()) {
-        program = writeBinary(filename, buildOptions);
-    } else {
-        // Compare modified dates of binary file and source file
-
-        // Read cache file
-        std::ifstream cacheFile(cacheFilename.c_str());
-        std::string cache(
-            std::istreambuf_iterator<char>(cacheFile),
-            (std::istreambuf_iterator<char>()));
-
-        bool outOfDate = true;
-        bool wrongDeviceID = true;
-        bool buildOptionsChanged = true;
-        const size_t pos = cache.find("-");
-        const size_t pos2 = cache.find("-", pos+1);
-        if(pos != std::string::npos && pos2 != std::string::npos) {
-            // Get modification date of file
-            #ifdef WIN32
-            HANDLE hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
-            FILETIME ftCreate, ftAccess, ftWrite;
-			SYSTEMTIME sysTime;
-            GetFileTime(hFile, &ftCreate, &ftAccess, &ftWrite);
-			FileTimeToSystemTime(&ftWrite, &sysTime);
-			char* buffer = new char[255];
-			sprintf(buffer, "%d%d%d%d%d", sysTime.wYear, sysTime.wMonth, sysTime.wDay, sysTime.wHour,sysTime.wMinute,sysTime.wSecond);
-			outOfDate = strcmp(buffer, cache.substr(0, pos).c_str()) != 0;
-			delete[] buffer;
-            #else
-            struct stat attrib; // create a file attribute structure
-            stat(filename.c_str(), &attrib);
-            outOfDate = strcmp(ctime(&(attrib.st_mtime)), cache.substr(0, pos).c_str()) != 0;
-            #endif
-            VECTOR_CLASS<cl::Device> devices = context.getInfo<CL_CONTEXT_DEVICES>();
-            wrongDeviceID = cache.substr(pos+1, pos2-pos-2) != devices[0].getInfo<CL_DEVICE_NAME>();
-            buildOptionsChanged = cache.substr(pos2+1) != buildOptions;
-        }
-
-        if(outOfDate || wrongDeviceID || buildOptionsChanged) {
-            std::cout << "Binary is out of date. Compiling..." << std::endl;
-            program = writeBinary(filename, buildOptions);
-        } else {
-            //std::cout << "Binary is not out of date." << std::endl;
-            program = readBinary(binaryFilename);
-        }
-    }
-
-    return program;
+    return KernelBinaryCache::getInstance().getProgram(context, devices, filename, buildOptions);
 }
 
 int OpenCLDevice::createProgramFromSourceWithName(
         std::string programName,
         std::string filename,
         std::string buildOptions) {
-    programNames[programName] = createProgramFromSource(filename,buildOptions);
-    return programNames[programName];
+    const int index = createProgramFromSource(filename,buildOptions);
+    boost::lock_guard<boost::mutex> lock(mProgramMutex);
+    programNames[programName] = index;
+    return index;
 }
 
 int OpenCLDevice::createProgramFromSourceWithName(
         std::string programName,
         std::vector<std::string> filenames,
         std::string buildOptions) {
-    programNames[programName] = createProgramFromSource(filenames,buildOptions);
-    return programNames[programName];
+    const int index = createProgramFromSource(filenames,buildOptions);
+    boost::lock_guard<boost::mutex> lock(mProgramMutex);
+    programNames[programName] = index;
+    return index;
 }
 
 int OpenCLDevice::createProgramFromStringWithName(
         std::string programName,
         std::string code,
         std::string buildOptions) {
-    programNames[programName] = createProgramFromString(code,buildOptions);
-    return programNames[programName];
+    const int index = createProgramFromString(code,buildOptions);
+    boost::lock_guard<boost::mutex> lock(mProgramMutex);
+    programNames[programName] = index;
+    return index;
 }
 
 cl::Program OpenCLDevice::getProgram(std::string name) {
+    boost::lock_guard<boost::mutex> lock(mProgramMutex);
     if(programNames.count(name) == 0) {
         std::string msg ="Could not find OpenCL program with the name" + name;
         throw Exception(msg.c_str(), __LINE__, __FILE__);
@@ -491,6 +328,7 @@ cl::Program OpenCLDevice::getProgram(std::string name) {
 }
 
 bool OpenCLDevice::hasProgram(std::string name) {
+    boost::lock_guard<boost::mutex> lock(mProgramMutex);
     return programNames.count(name) > 0;
 }
 
@@ -4,6 +4,7 @@
 #include "FAST/Object.hpp"
 #include "FAST/SmartPointers.hpp"
 #include "RuntimeMeasurementManager.hpp"
+#include <boost/thread/mutex.hpp>
 
 namespace fast {
 
@@ -84,15 +85,15 @@ class OpenCLDevice : public ExecutionDevice {
     private:
         OpenCLDevice();
         unsigned long * mGLContext;
-        cl::Program writeBinary(std::string filename, std::string buildOptions);
-        cl::Program readBinary(std::string filename);
         cl::Program buildProgramFromBinary(std::string filename, std::string buildOptions);
         cl::Program buildSources(cl::Program::Sources source, std::string buildOptions);
+        int addProgram(cl::Program program);
 
         cl::Context context;
         std::vector<cl::CommandQueue> queues;
         std::map<std::string, int> programNames;
         std::vector<cl::Program> programs;
+        boost::mutex mProgramMutex; // guards programs and programNames
         std::vector<cl::Device> devices;
         cl::Platform platform;
 
@@ -20,7 +20,7 @@ MetaImageExporter::MetaImageExporter() {
 }
 
 template <class T>
-inline std::size_t writeToRawFile(std::string filename, T * data, unsigned int numberOfElements, bool useCompression) {
+inline std::size_t writeToRawFile(std::string filename, T * data, std::size_t numberOfElements, bool useCompression) {
     // TODO use mapped_file_sink form boost instead
     FILE* file = fopen(filename.c_str(), "wb");
     if(file == NULL) {
@@ -123,7 +123,7 @@ void MetaImageExporter::execute() {
     }
 #endif
     std::string rawFilename = mFilename.substr(0,mFilename.length()-4) + extension;
-    const unsigned int numberOfElements = input->getWidth()*input->getHeight()*
+    const std::size_t numberOfElements = (std::size_t)input->getWidth()*input->getHeight()*
             input->getDepth()*input->getNrOfComponents();
 
     ImageAccess::pointer access = input->getImageAccess(ACCESS_READ);
@@ -36,35 +36,35 @@ void VTKMeshFileExporter::execute() {
 
     // Write vertices
     MeshAccess::pointer access = surface->getMeshAccess(ACCESS_READ);
-    std::vector<MeshVertex> vertices = access->getVertices();
-    file << "POINTS " << vertices.size() << " float\n";
-    for(int i = 0; i < vertices.size(); i++) {
-        MeshVertex vertex = vertices[i];
-        vertex.position = (transform->matrix()*vertex.position.homogeneous()).head(3);
-        file << vertex.position.x() << " " << vertex.position.y() << " " << vertex.position.z() << "\n";
+    const uint nrOfVertices = access->getNrOfVertices();
+    const float* positions = access->getPositions();
+    file << "POINTS " << nrOfVertices << " float\n";
+    for(uint i = 0; i < nrOfVertices; i++) {
+        Vector3f position(positions[i*3], positions[i*3+1], positions[i*3+2]);
+        position = (transform->matrix()*position.homogeneous()).head(3);
+        file << position.x() << " " << position.y() << " " << position.z() << "\n";
     }
 
     // Write triangles
-    std::vector<Vector3ui> triangles = access->getTriangles();
+    const uint* indices = access->getIndices();
     file << "POLYGONS " << surface->getNrOfTriangles() << " " << surface->getNrOfTriangles()*4 << "\n";
-    for(int i = 0; i < triangles.size(); i++) {
-        Vector3ui triangle = triangles[i];
-        file << "3 " << triangle.x() << " " << triangle.y() << " " << triangle.z() << "\n";
+    for(uint i = 0; i < access->getNrOfTriangles(); i++) {
+        file << "3 " << indices[i*3] << " " << indices[i*3+1] << " " << indices[i*3+2] << "\n";
     }
 
     // Write normals
-    file << "POINT_DATA " << vertices.size() << "\n";
+    const float* normals = access->getNormals();
+    file << "POINT_DATA " << nrOfVertices << "\n";
     file << "NORMALS Normals float\n";
-    for(int i = 0; i < vertices.size(); i++) {
-        MeshVertex vertex = vertices[i];
+    for(uint i = 0; i < nrOfVertices; i++) {
         // Transform it
-        vertex.normal = transform->linear()*vertex.normal;
+        Vector3f normal = transform->linear()*Vector3f(normals[i*3], normals[i*3+1], normals[i*3+2]);
         // Normalize it
-        float length = vertex.normal.norm();
+        float length = normal.norm();
         if(length == 0) { // prevent NaN situations
             file << "0 1 0\n";
         } else {
-            file << (vertex.normal.x()/length) << " " << (vertex.normal.y()/length) << " " << (vertex.normal.z()/length) << "\n";
+            file << (normal.x()/length) << " " << (normal.y()/length) << " " << (normal.z()/length) << "\n";
         }
     }
 
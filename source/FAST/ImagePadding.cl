@@ -0,0 +1,104 @@
+#ifdef cl_khr_3d_image_writes
+#pragma OPENCL EXTENSION cl_khr_3d_image_writes : enable
+#endif
+
+#ifdef TYPE_FLOAT
+#define TYPE float4
+#define BUFFER_TYPE float
+#define READ_IMAGE read_imagef
+#define WRITE_IMAGE write_imagef
+#elif TYPE_UINT8
+#define TYPE uint4
+#define BUFFER_TYPE uchar
+#define READ_IMAGE read_imageui
+#define WRITE_IMAGE write_imageui
+#elif TYPE_INT8
+#define TYPE int4
+#define BUFFER_TYPE char
+#define READ_IMAGE read_imagei
+#define WRITE_IMAGE write_imagei
+#elif TYPE_UINT16
+#define TYPE uint4
+#define BUFFER_TYPE ushort
+#define READ_IMAGE read_imageui
+#define WRITE_IMAGE write_imageui
+#else
+#define TYPE int4
+#define BUFFER_TYPE short
+#define READ_IMAGE read_imagei
+#define WRITE_IMAGE write_imagei
+#endif
+
+__constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE | CLK_FILTER_NEAREST;
+
+// Expand a buffer with 1, 2 or 3 components per pixel to a 4 channel image
+__kernel void padBufferToImage2D(
+        __global const BUFFER_TYPE* buffer,
+        __write_only image2d_t image,
+        __private const int components
+        ) {
+    const int2 pos = {get_global_id(0), get_global_id(1)};
+    const size_t index = (get_global_id(0) + get_global_id(1)*get_global_size(0))*components;
+
+    TYPE value = (TYPE)(0);
+    value.x = buffer[index];
+    if(components > 1)
+        value.y = buffer[index+1];
+    if(components > 2)
+        value.z = buffer[index+2];
+
+    WRITE_IMAGE(image, pos, value);
+}
+
+#ifdef cl_khr_3d_image_writes
+__kernel void padBufferToImage3D(
+        __global const BUFFER_TYPE* buffer,
+        __write_only image3d_t image,
+        __private const int components
+        ) {
+    const int4 pos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
+    const size_t index = (get_global_id(0) + get_global_id(1)*get_global_size(0) + get_global_id(2)*get_global_size(0)*get_global_size(1))*components;
+
+    TYPE value = (TYPE)(0);
+    value.x = buffer[index];
+    if(components > 1)
+        value.y = buffer[index+1];
+    if(components > 2)
+        value.z = buffer[index+2];
+
+    WRITE_IMAGE(image, pos, value);
+}
+#endif
+
+// Remove the padding of a 4 channel image with 1, 2 or 3 components per pixel
+__kernel void unpadImage2DToBuffer(
+        __read_only image2d_t image,
+        __global BUFFER_TYPE* buffer,
+        __private const int components
+        ) {
+    const int2 pos = {get_global_id(0), get_global_id(1)};
+    const size_t index = (get_global_id(0) + get_global_id(1)*get_global_size(0))*components;
+
+    TYPE value = READ_IMAGE(image, sampler, pos);
+    buffer[index] = value.x;
+    if(components > 1)
+        buffer[index+1] = value.y;
+    if(components > 2)
+        buffer[index+2] = value.z;
+}
+
+__kernel void unpadImage3DToBuffer(
+        __read_only image3d_t image,
+        __global BUFFER_TYPE* buffer,
+        __private const int components
+        ) {
+    const int4 pos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
+    const size_t index = (get_global_id(0) + get_global_id(1)*get_global_size(0) + get_global_id(2)*get_global_size(0)*get_global_size(1))*components;
+
+    TYPE value = READ_IMAGE(image, sampler, pos);
+    buffer[index] = value.x;
+    if(components > 1)
+        buffer[index+1] = value.y;
+    if(components > 2)
+        buffer[index+2] = value.z;
+}
@@ -0,0 +1,291 @@
+// The kernels are specialized for the data type at build time with one of
+// TYPE_FLOAT, TYPE_UINT8, TYPE_INT8, TYPE_UINT16, TYPE_INT16,
+// TYPE_UNORM_INT16 and TYPE_SNORM_INT16
+#ifdef TYPE_FLOAT
+#define BUFFER_TYPE float
+#define READ_IMAGE(image, pos) read_imagef(image, sampler, pos)
+#define CONVERT(value) (value)
+#elif defined(TYPE_UINT8)
+#define BUFFER_TYPE uchar
+#define READ_IMAGE(image, pos) convert_float4(read_imageui(image, sampler, pos))
+#define CONVERT(value) (float)(value)
+#elif defined(TYPE_INT8)
+#define BUFFER_TYPE char
+#define READ_IMAGE(image, pos) convert_float4(read_imagei(image, sampler, pos))
+#define CONVERT(value) (float)(value)
+#elif defined(TYPE_UINT16)
+#define BUFFER_TYPE ushort
+#define READ_IMAGE(image, pos) convert_float4(read_imageui(image, sampler, pos))
+#define CONVERT(value) (float)(value)
+#elif defined(TYPE_INT16)
+#define BUFFER_TYPE short
+#define READ_IMAGE(image, pos) convert_float4(read_imagei(image, sampler, pos))
+#define CONVERT(value) (float)(value)
+#elif defined(TYPE_UNORM_INT16)
+#define BUFFER_TYPE ushort
+#define READ_IMAGE(image, pos) read_imagef(image, sampler, pos)
+#define CONVERT(value) ((float)(value)/65535.0f)
+#else
+#define BUFFER_TYPE short
+#define READ_IMAGE(image, pos) read_imagef(image, sampler, pos)
+#define CONVERT(value) max((float)(value)/32767.0f, -1.0f)
+#endif
+
+__constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE | CLK_FILTER_NEAREST;
+
+#ifdef DOUBLE_ACCUMULATION
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+typedef double accumulator;
+#else
+typedef float accumulator;
+#endif
+
+// Statistics of the values visited by one work item. The values are summed
+// relative to the first value, so that the sum of squares doesn't cancel
+// against the squared sum when the variance is small compared to the mean.
+// Without double precision the sums are compensated (Kahan summation).
+typedef struct {
+    float minimum;
+    float maximum;
+    float shift;
+    ulong count;
+    accumulator sum;
+    accumulator sumCompensation;
+    accumulator sumOfSquares;
+    accumulator sumOfSquaresCompensation;
+} Statistics;
+
+Statistics createStatistics() {
+    Statistics statistics;
+    statistics.minimum = FLT_MAX;
+    statistics.maximum = -FLT_MAX;
+    statistics.shift = 0.0f;
+    statistics.count = 0;
+    statistics.sum = 0;
+    statistics.sumCompensation = 0;
+    statistics.sumOfSquares = 0;
+    statistics.sumOfSquaresCompensation = 0;
+    return statistics;
+}
+
+void addToSum(accumulator* sum, accumulator* compensation, accumulator value) {
+#ifdef DOUBLE_ACCUMULATION
+    *sum += value;
+#else
+    const accumulator y = value - *compensation;
+    const accumulator t = *sum + y;
+    *compensation = (t - *sum) - y;
+    *sum = t;
+#endif
+}
+
+void addValue(Statistics* statistics, float value) {
+    statistics->minimum = min(statistics->minimum, value);
+    statistics->maximum = max(statistics->maximum, value);
+    if(statistics->count == 0)
+        statistics->shift = value;
+    const accumulator difference = (accumulator)value - statistics->shift;
+    addToSum(&statistics->sum, &statistics->sumCompensation, difference);
+    addToSum(&statistics->sumOfSquares, &statistics->sumOfSquaresCompensation, difference*difference);
+    statistics->count++;
+}
+
+void addPixel(Statistics* statistics, float4 value, int components) {
+    addValue(statistics, value.x);
+    if(components > 1)
+        addValue(statistics, value.y);
+    if(components > 2)
+        addValue(statistics, value.z);
+    if(components > 3)
+        addValue(statistics, value.w);
+}
+
+// Each work group writes minimum, maximum, number of values, mean and the sum
+// of squared differences from the mean
+#define NR_OF_STATISTICS 5
+
+// Merge the statistics b into a, with the pairwise update of Chan et al.
+void mergeStatistics(__local accumulator* a, __local const accumulator* b) {
+    if(b[2] == 0)
+        return;
+    const accumulator count = a[2] + b[2];
+    const accumulator delta = b[3] - a[3];
+    a[0] = min(a[0], b[0]);
+    a[1] = max(a[1], b[1]);
+    a[3] += delta*b[2]/count;
+    a[4] += b[4] + delta*delta*a[2]*b[2]/count;
+    a[2] = count;
+}
+
+// Combine the statistics of all work items in the work group and write the
+// result of the group. The work group size doesn't have to be a power of two.
+void reduceWorkGroup(Statistics statistics, __local accumulator* scratch, __global accumulator* result) {
+    const int id = get_local_id(0);
+    __local accumulator* own = &scratch[id*NR_OF_STATISTICS];
+    own[0] = statistics.minimum;
+    own[1] = statistics.maximum;
+    own[2] = statistics.count;
+    own[3] = 0;
+    own[4] = 0;
+    if(statistics.count > 0) {
+        const accumulator count = statistics.count;
+        const accumulator sum = statistics.sum - statistics.sumCompensation;
+        const accumulator sumOfSquares = statistics.sumOfSquares - statistics.sumOfSquaresCompensation;
+        own[3] = statistics.shift + sum/count;
+        own[4] = max(sumOfSquares - sum*sum/count, (accumulator)0);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(int size = get_local_size(0); size > 1; ) {
+        const int half = (size+1)/2;
+        if(id < size-half)
+            mergeStatistics(own, &scratch[(id+half)*NR_OF_STATISTICS]);
+        barrier(CLK_LOCAL_MEM_FENCE);
+        size = half;
+    }
+    if(id == 0) {
+        for(int i = 0; i < NR_OF_STATISTICS; i++)
+            result[get_group_id(0)*NR_OF_STATISTICS + i] = scratch[i];
+    }
+}
+
+// Each work item visits every global size'th pixel, so that neighbouring
+// work items read neighbouring pixels
+__kernel void calculateStatisticsImage2D(
+        __read_only image2d_t image,
+        __private int components,
+        __local accumulator* scratch,
+        __global accumulator* result
+        ) {
+    const int width = get_image_width(image);
+    const ulong nrOfPixels = (ulong)width*get_image_height(image);
+
+    Statistics statistics = createStatistics();
+    for(ulong i = get_global_id(0); i < nrOfPixels; i += get_global_size(0)) {
+        const int2 pos = {i % width, i / width};
+        addPixel(&statistics, READ_IMAGE(image, pos), components);
+    }
+
+    reduceWorkGroup(statistics, scratch, result);
+}
+
+__kernel void calculateStatisticsImage3D(
+        __read_only image3d_t image,
+        __private int components,
+        __local accumulator* scratch,
+        __global accumulator* result
+        ) {
+    const int width = get_image_width(image);
+    const int height = get_image_height(image);
+    const ulong nrOfPixels = (ulong)width*height*get_image_depth(image);
+
+    Statistics statistics = createStatistics();
+    for(ulong i = get_global_id(0); i < nrOfPixels; i += get_global_size(0)) {
+        const int4 pos = {i % width, (i / width) % height, i / ((ulong)width*height), 0};
+        addPixel(&statistics, READ_IMAGE(image, pos), components);
+    }
+
+    reduceWorkGroup(statistics, scratch, result);
+}
+
+// Buffers store the components of each pixel after each other, so all elements are used
+__kernel void calculateStatisticsBuffer(
+        __global const BUFFER_TYPE* buffer,
+        __private ulong nrOfElements,
+        __local accumulator* scratch,
+        __global accumulator* result
+        ) {
+    Statistics statistics = createStatistics();
+    for(ulong i = get_global_id(0); i < nrOfElements; i += get_global_size(0))
+        addValue(&statistics, CONVERT(buffer[i]));
+
+    reduceWorkGroup(statistics, scratch, result);
+}
+
+// Values in [minimum, maximum] are counted, the maximum is put in the last bin
+void addToHistogram(__local uint* histogram, float value, float minimum, float maximum, int nrOfBins) {
+    if(value >= minimum && value <= maximum) {
+        const int bin = (int)((value - minimum)*nrOfBins/(maximum - minimum));
+        atomic_inc(&histogram[min(bin, nrOfBins-1)]);
+    }
+}
+
+void addPixelToHistogram(__local uint* histogram, float4 value, int components, float minimum, float maximum, int nrOfBins) {
+    addToHistogram(histogram, value.x, minimum, maximum, nrOfBins);
+    if(components > 1)
+        addToHistogram(histogram, value.y, minimum, maximum, nrOfBins);
+    if(components > 2)
+        addToHistogram(histogram, value.z, minimum, maximum, nrOfBins);
+    if(components > 3)
+        addToHistogram(histogram, value.w, minimum, maximum, nrOfBins);
+}
+
+void clearLocalHistogram(__local uint* histogram, int nrOfBins) {
+    for(int i = get_local_id(0); i < nrOfBins; i += get_local_size(0))
+        histogram[i] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+// Add the histogram of the work group to the global histogram
+void addLocalHistogram(__local uint* localHistogram, __global uint* histogram, int nrOfBins) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(int i = get_local_id(0); i < nrOfBins; i += get_local_size(0)) {
+        if(localHistogram[i] > 0)
+            atomic_add(&histogram[i], localHistogram[i]);
+    }
+}
+
+__kernel void calculateHistogramImage2D(
+        __read_only image2d_t image,
+        __private int components,
+        __private float minimum,
+        __private float maximum,
+        __private int nrOfBins,
+        __local uint* localHistogram,
+        __global uint* histogram
+        ) {
+    const int width = get_image_width(image);
+    const ulong nrOfPixels = (ulong)width*get_image_height(image);
+
+    clearLocalHistogram(localHistogram, nrOfBins);
+    for(ulong i = get_global_id(0); i < nrOfPixels; i += get_global_size(0)) {
+        const int2 pos = {i % width, i / width};
+        addPixelToHistogram(localHistogram, READ_IMAGE(image, pos), components, minimum, maximum, nrOfBins);
+    }
+    addLocalHistogram(localHistogram, histogram, nrOfBins);
+}
+
+__kernel void calculateHistogramImage3D(
+        __read_only image3d_t image,
+        __private int components,
+        __private float minimum,
+        __private float maximum,
+        __private int nrOfBins,
+        __local uint* localHistogram,
+        __global uint* histogram
+        ) {
+    const int width = get_image_width(image);
+    const int height = get_image_height(image);
+    const ulong nrOfPixels = (ulong)width*height*get_image_depth(image);
+
+    clearLocalHistogram(localHistogram, nrOfBins);
+    for(ulong i = get_global_id(0); i < nrOfPixels; i += get_global_size(0)) {
+        const int4 pos = {i % width, (i / width) % height, i / ((ulong)width*height), 0};
+        addPixelToHistogram(localHistogram, READ_IMAGE(image, pos), components, minimum, maximum, nrOfBins);
+    }
+    addLocalHistogram(localHistogram, histogram, nrOfBins);
+}
+
+__kernel void calculateHistogramBuffer(
+        __global const BUFFER_TYPE* buffer,
+        __private ulong nrOfElements,
+        __private float minimum,
+        __private float maximum,
+        __private int nrOfBins,
+        __local uint* localHistogram,
+        __global uint* histogram
+        ) {
+    clearLocalHistogram(localHistogram, nrOfBins);
+    for(ulong i = get_global_id(0); i < nrOfElements; i += get_global_size(0))
+        addToHistogram(localHistogram, CONVERT(buffer[i]), minimum, maximum, nrOfBins);
+    addLocalHistogram(localHistogram, histogram, nrOfBins);
+}
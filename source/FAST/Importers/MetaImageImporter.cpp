@@ -41,17 +41,18 @@ std::vector<std::string> stringSplit(std::string str, std::string delimiter) {
 
 template <class T>
 inline void * readRawData(std::string rawFilename, unsigned int width, unsigned int height, unsigned int depth, unsigned int nrOfComponents, bool compressed, std::size_t compressedFileSize) {
-    T * data = new T[width*height*depth*nrOfComponents];
+    const std::size_t numberOfElements = (std::size_t)width*height*depth*nrOfComponents;
+    T * data = new T[numberOfElements];
     if(compressed) {
 #ifdef ZLIB_ENABLED
         // Read compressed data
         boost::iostreams::mapped_file_source file;
-        file.open(rawFilename, width*height*depth*nrOfComponents*sizeof(T));
+        file.open(rawFilename, numberOfElements*sizeof(T));
         if(!file.is_open())
             throw FileNotFoundException(rawFilename);
         Bytef* fileData = (Bytef*)file.data();
 
-        unsigned long uncompressedSize = sizeof(T)*width*height*depth*nrOfComponents;
+        uLongf uncompressedSize = sizeof(T)*numberOfElements;
         unsigned long fileSize = file.size();
 		int z_result = uncompress(
             (Bytef*)data,       // destination for the uncompressed
@@ -84,11 +85,11 @@ inline void * readRawData(std::string rawFilename, unsigned int width, unsigned
 #endif
     } else {
         boost::iostreams::mapped_file_source file;
-        file.open(rawFilename, width*height*depth*nrOfComponents*sizeof(T));
+        file.open(rawFilename, numberOfElements*sizeof(T));
         if(!file.is_open())
             throw FileNotFoundException(rawFilename);
         T * fileData = (T*)file.data();
-        memcpy(data,fileData,width*height*depth*nrOfComponents*sizeof(T));
+        memcpy(data,fileData,numberOfElements*sizeof(T));
         file.close();
     }
     return data;
@@ -0,0 +1,391 @@
+#include "FAST/KernelBinaryCache.hpp"
+#include "FAST/Utility.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/chrono.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/algorithm/string.hpp>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <set>
+#include <cstdlib>
+#include <ctime>
+
+namespace fast {
+
+static std::string readSourceFile(std::string filename) {
+    std::ifstream file(filename.c_str(), std::ios_base::binary | std::ios_base::in);
+    if(file.fail())
+        throw Exception("Failed to open OpenCL source file " + filename);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+static std::vector<std::string> getIncludeDirectories(std::string buildOptions) {
+    std::vector<std::string> directories;
+    std::istringstream options(buildOptions);
+    std::string option;
+    while(options >> option) {
+        if(option == "-I") {
+            if(options >> option)
+                directories.push_back(option);
+        } else if(option.compare(0, 2, "-I") == 0) {
+            directories.push_back(option.substr(2));
+        }
+    }
+    return directories;
+}
+
+// Append the source of all files included by the source, so that changes in them give a new key
+static void appendIncludedSources(
+        const std::string& source,
+        std::string directory,
+        const std::vector<std::string>& includeDirectories,
+        std::set<std::string>& visited,
+        std::string& result) {
+    std::istringstream lines(source);
+    std::string line;
+    while(std::getline(lines, line)) {
+        boost::trim(line);
+        if(line.size() == 0 || line[0] != '#')
+            continue;
+        line = boost::trim_left_copy(line.substr(1));
+        if(line.compare(0, 7, "include") != 0)
+            continue;
+        const std::size_t begin = line.find_first_of("\"<");
+        if(begin == std::string::npos)
+            continue;
+        const std::size_t end = line.find_first_of("\">", begin+1);
+        if(end == std::string::npos)
+            continue;
+        const std::string name = line.substr(begin+1, end-begin-1);
+
+        std::vector<std::string> candidates(1, directory);
+        candidates.insert(candidates.end(), includeDirectories.begin(), includeDirectories.end());
+        for(int i = 0; i < candidates.size(); i++) {
+            const boost::filesystem::path path = boost::filesystem::path(candidates[i]) / name;
+            if(!boost::filesystem::is_regular_file(path))
+                continue;
+            const std::string canonicalPath = boost::filesystem::canonical(path).string();
+            if(visited.count(canonicalPath) == 0) {
+                visited.insert(canonicalPath);
+                const std::string included = readSourceFile(canonicalPath);
+                result += included;
+                appendIncludedSources(included, path.parent_path().string(), includeDirectories, visited, result);
+            }
+            break;
+        }
+    }
+}
+
+static std::string getSourceWithIncludes(const std::string& source, std::string filename, std::string buildOptions) {
+    std::string result = source;
+    std::set<std::string> visited;
+    appendIncludedSources(
+            source,
+            boost::filesystem::path(filename).parent_path().string(),
+            getIncludeDirectories(buildOptions),
+            visited,
+            result
+    );
+    return result;
+}
+
+// 64 bit FNV-1a hash, which unlike boost::hash is the same on all platforms
+static boost::uint64_t hashString(const std::string& str) {
+    boost::uint64_t hash = 14695981039346656037ULL;
+    for(std::size_t i = 0; i < str.size(); i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static double getMilliseconds(boost::chrono::steady_clock::time_point start) {
+    return boost::chrono::duration<double, boost::milli>(boost::chrono::steady_clock::now() - start).count();
+}
+
+KernelBinaryCache& KernelBinaryCache::getInstance() {
+    static KernelBinaryCache instance;
+    return instance;
+}
+
+KernelBinaryCache::KernelBinaryCache() {
+    const char* directory = std::getenv("FAST_KERNEL_BINARY_PATH");
+    if(directory != NULL && std::string(directory) != "") {
+        mDirectory = directory;
+    } else {
+        mDirectory = std::string(OUL_OPENCL_KERNEL_BINARY_PATH) + "kernel_binaries";
+    }
+    mMaximumSize = 512*1024*1024;
+}
+
+void KernelBinaryCache::setDirectory(std::string directory) {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    mDirectory = directory;
+}
+
+std::string KernelBinaryCache::getDirectory() {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return mDirectory;
+}
+
+void KernelBinaryCache::setMaximumSize(boost::uintmax_t size) {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    mMaximumSize = size;
+}
+
+boost::uintmax_t KernelBinaryCache::getMaximumSize() {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return mMaximumSize;
+}
+
+std::string KernelBinaryCache::createKey(const std::string& source, std::string buildOptions, cl::Device device) {
+    cl::Platform platform = device.getInfo<CL_DEVICE_PLATFORM>();
+    std::string material = source;
+    material += '\0' + buildOptions;
+    material += '\0' + device.getInfo<CL_DEVICE_NAME>();
+    material += '\0' + device.getInfo<CL_DEVICE_VENDOR>();
+    material += '\0' + device.getInfo<CL_DEVICE_VERSION>();
+    material += '\0' + device.getInfo<CL_DRIVER_VERSION>();
+    material += '\0' + platform.getInfo<CL_PLATFORM_VERSION>();
+
+    std::stringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hashString(material);
+    return key.str();
+}
+
+std::string KernelBinaryCache::getKey(std::string filename, std::string buildOptions, cl::Device device) {
+    const std::string source = readSourceFile(filename);
+    return createKey(getSourceWithIncludes(source, filename, buildOptions), buildOptions, device);
+}
+
+std::string KernelBinaryCache::getBinaryFilename(std::string key) {
+    return (boost::filesystem::path(getDirectory()) / (key + ".bin")).string();
+}
+
+cl::Program KernelBinaryCache::getProgram(
+        cl::Context context,
+        std::vector<cl::Device> devices,
+        std::string filename,
+        std::string buildOptions) {
+    const std::string source = readSourceFile(filename);
+    const std::string sourceWithIncludes = getSourceWithIncludes(source, filename, buildOptions);
+    std::vector<std::string> keys;
+    std::string programKey;
+    std::string deviceNames;
+    for(int i = 0; i < devices.size(); i++) {
+        keys.push_back(createKey(sourceWithIncludes, buildOptions, devices[i]));
+        programKey += keys[i];
+        deviceNames += (i > 0 ? ", " : "") + devices[i].getInfo<CL_DEVICE_NAME>();
+    }
+
+    // Builds of the same program wait for each other, so that it is only compiled once
+    boost::shared_ptr<boost::mutex> programMutex;
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        if(mProgramMutexes.count(programKey) == 0)
+            mProgramMutexes[programKey] = boost::make_shared<boost::mutex>();
+        programMutex = mProgramMutexes[programKey];
+    }
+    boost::lock_guard<boost::mutex> programLock(*programMutex);
+
+    KernelBinaryCacheRecord record;
+    record.filename = filename;
+    record.buildOptions = buildOptions;
+    record.deviceName = deviceNames;
+    record.loadedFromCache = false;
+    record.compileTime = 0;
+    record.loadTime = 0;
+
+    // Load the binaries if they exist for all devices
+    boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+    std::vector<std::string> binaries;
+    for(int i = 0; i < keys.size(); i++) {
+        std::ifstream file(getBinaryFilename(keys[i]).c_str(), std::ios_base::binary | std::ios_base::in);
+        if(file.fail())
+            break;
+        binaries.push_back(std::string(
+                std::istreambuf_iterator<char>(file),
+                (std::istreambuf_iterator<char>())));
+    }
+    if(binaries.size() == keys.size()) {
+        cl::Program::Binaries clBinaries;
+        for(int i = 0; i < binaries.size(); i++)
+            clBinaries.push_back(std::make_pair(binaries[i].c_str(), binaries[i].size()));
+        try {
+            cl::Program program(context, devices, clBinaries);
+            program.build(devices, buildOptions.c_str());
+
+            // Mark the binaries as recently used
+            boost::system::error_code error;
+            for(int i = 0; i < keys.size(); i++)
+                boost::filesystem::last_write_time(getBinaryFilename(keys[i]), std::time(NULL), error);
+
+            record.loadedFromCache = true;
+            record.loadTime = getMilliseconds(start);
+            reportInfo() << "Loaded program " << filename << " for " << deviceNames << " from cache in " << record.loadTime << " ms" << Reporter::end;
+            addRecord(record);
+            return program;
+        } catch(cl::Error &error) {
+            reportWarning() << "Failed to load cached binary of program " << filename << ", compiling it again" << Reporter::end;
+        }
+    }
+
+    // Compile from source
+    start = boost::chrono::steady_clock::now();
+    cl::Program::Sources sources(1, std::make_pair(source.c_str(), source.length()));
+    cl::Program program(context, sources);
+    try {
+        program.build(devices, buildOptions.c_str());
+    } catch(cl::Error &error) {
+        if(error.err() == CL_BUILD_PROGRAM_FAILURE) {
+            for(unsigned int i = 0; i < devices.size(); i++) {
+                reportError() << "Build log, device " << i << "\n" << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(devices[i]) << Reporter::end;
+            }
+        }
+        reportError() << getCLErrorString(error.err()) << Reporter::end;
+        throw error;
+    }
+    record.compileTime = getMilliseconds(start);
+    reportInfo() << "Compiled program " << filename << " for " << deviceNames << " in " << record.compileTime << " ms" << Reporter::end;
+
+    // Store the binaries, they are in the order of the program devices
+    VECTOR_CLASS<cl::Device> programDevices = program.getInfo<CL_PROGRAM_DEVICES>();
+    VECTOR_CLASS<std::size_t> binarySizes = program.getInfo<CL_PROGRAM_BINARY_SIZES>();
+    VECTOR_CLASS<char*> programBinaries = program.getInfo<CL_PROGRAM_BINARIES>();
+    for(int j = 0; j < programDevices.size(); j++) {
+        for(int i = 0; i < devices.size(); i++) {
+            if(programDevices[j]() == devices[i]() && binarySizes[j] > 0)
+                writeBinary(keys[i], programBinaries[j], binarySizes[j]);
+        }
+        delete[] programBinaries[j];
+    }
+    removeLeastRecentlyUsed(keys);
+    addRecord(record);
+
+    return program;
+}
+
+void KernelBinaryCache::writeBinary(std::string key, const char* binary, std::size_t size) {
+    const boost::filesystem::path directory(getDirectory());
+    boost::system::error_code error;
+    boost::filesystem::create_directories(directory, error);
+
+    // Write to a temporary file first, so that other processes never read a partially written binary
+    const boost::filesystem::path temporaryFilename = directory / boost::filesystem::unique_path("%%%%-%%%%-%%%%.tmp");
+    {
+        std::ofstream file(temporaryFilename.string().c_str(), std::ios_base::binary | std::ios_base::out);
+        if(file.fail()) {
+            reportWarning() << "Could not write kernel binary to " << temporaryFilename.string() << Reporter::end;
+            return;
+        }
+        file.write(binary, size);
+    }
+    boost::filesystem::rename(temporaryFilename, getBinaryFilename(key), error);
+    if(error)
+        boost::filesystem::remove(temporaryFilename, error);
+}
+
+static bool isOlder(
+        const std::pair<std::time_t, boost::filesystem::path>& a,
+        const std::pair<std::time_t, boost::filesystem::path>& b) {
+    return a.first < b.first;
+}
+
+void KernelBinaryCache::removeLeastRecentlyUsed(const std::vector<std::string>& keep) {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    boost::system::error_code error;
+    if(!boost::filesystem::is_directory(mDirectory, error))
+        return;
+
+    std::vector<std::pair<std::time_t, boost::filesystem::path> > files;
+    boost::uintmax_t totalSize = 0;
+    for(boost::filesystem::directory_iterator it(mDirectory, error), end; it != end; it.increment(error)) {
+        if(error)
+            break;
+        const boost::filesystem::path path = it->path();
+        if(path.extension() != ".bin")
+            continue;
+        const boost::uintmax_t size = boost::filesystem::file_size(path, error);
+        if(error)
+            continue;
+        totalSize += size;
+        if(std::find(keep.begin(), keep.end(), path.stem().string()) == keep.end())
+            files.push_back(std::make_pair(boost::filesystem::last_write_time(path, error), path));
+    }
+
+    std::sort(files.begin(), files.end(), isOlder);
+    for(int i = 0; i < files.size() && totalSize > mMaximumSize; i++) {
+        const boost::uintmax_t size = boost::filesystem::file_size(files[i].second, error);
+        if(!error && boost::filesystem::remove(files[i].second, error))
+            totalSize -= size;
+    }
+}
+
+void KernelBinaryCache::addRecord(KernelBinaryCacheRecord record) {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    mRecords.push_back(record);
+}
+
+std::vector<KernelBinaryCacheRecord> KernelBinaryCache::getRecords() {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return mRecords;
+}
+
+void KernelBinaryCache::clear() {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    boost::system::error_code error;
+    if(!boost::filesystem::is_directory(mDirectory, error))
+        return;
+    std::vector<boost::filesystem::path> paths;
+    for(boost::filesystem::directory_iterator it(mDirectory, error), end; it != end; it.increment(error)) {
+        if(error)
+            break;
+        if(it->path().extension() == ".bin" || it->path().extension() == ".tmp")
+            paths.push_back(it->path());
+    }
+    for(int i = 0; i < paths.size(); i++)
+        boost::filesystem::remove(paths[i], error);
+}
+
+static void prewarmProgram(
+        KernelBinaryCache* cache,
+        OpenCLDevice::pointer device,
+        std::string filename,
+        std::string buildOptions,
+        std::vector<std::string>* failed,
+        boost::mutex* failedMutex) {
+    try {
+        cl::Context context = device->getContext();
+        cache->getProgram(context, context.getInfo<CL_CONTEXT_DEVICES>(), filename, buildOptions);
+    } catch(std::exception &e) {
+        boost::lock_guard<boost::mutex> lock(*failedMutex);
+        failed->push_back(filename + " (" + device->getName() + ")");
+    }
+}
+
+void KernelBinaryCache::prewarm(
+        std::vector<OpenCLDevice::pointer> devices,
+        std::vector<std::string> filenames,
+        std::string buildOptions) {
+    std::vector<std::string> failed;
+    boost::mutex failedMutex;
+    boost::thread_group threads;
+    for(int i = 0; i < devices.size(); i++) {
+        for(int j = 0; j < filenames.size(); j++) {
+            threads.create_thread(boost::bind(&prewarmProgram, this, devices[i], filenames[j], buildOptions, &failed, &failedMutex));
+        }
+    }
+    threads.join_all();
+
+    if(failed.size() > 0)
+        throw Exception("Failed to build the OpenCL programs " + boost::join(failed, ", "));
+}
+
+} // end namespace fast
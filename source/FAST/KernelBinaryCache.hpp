@@ -0,0 +1,82 @@
+#ifndef KERNEL_BINARY_CACHE_HPP_
+#define KERNEL_BINARY_CACHE_HPP_
+
+#include "FAST/ExecutionDevice.hpp"
+#include <boost/thread/mutex.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+#include <map>
+
+namespace fast {
+
+/**
+ * Compile and load time of one program, recorded each time the cache is used
+ */
+struct KernelBinaryCacheRecord {
+    std::string filename;
+    std::string buildOptions;
+    std::string deviceName;
+    bool loadedFromCache;
+    double compileTime; // ms, 0 if loaded from cache
+    double loadTime; // ms, 0 if compiled
+};
+
+/**
+ * Singleton cache of OpenCL program binaries on disk.
+ *
+ * Binaries are stored with one file per device, named by a key which is a
+ * hash of the program source, the source of all included files, the build
+ * options, the device and the driver version. A binary is thus never out of
+ * date, and changed sources simply get a new key. The least recently used
+ * binaries are removed when the size of the directory exceeds the maximum
+ * size.
+ *
+ * The directory is the FAST_KERNEL_BINARY_PATH environment variable if it
+ * is set, otherwise a directory in the kernel binary path set in CMake.
+ *
+ * Programs are built in parallel, only builds of the same program wait for
+ * each other.
+ */
+class KernelBinaryCache : public Object {
+    public:
+        static KernelBinaryCache& getInstance();
+        void setDirectory(std::string directory);
+        std::string getDirectory();
+        // Maximum total size of the binaries in bytes
+        void setMaximumSize(boost::uintmax_t size);
+        boost::uintmax_t getMaximumSize();
+        /**
+         * Load program from the cache if binaries for all devices exist,
+         * otherwise build it from source and store the binaries
+         */
+        cl::Program getProgram(cl::Context context, std::vector<cl::Device> devices, std::string filename, std::string buildOptions = "");
+        /**
+         * Build the programs for all the devices in parallel, so that later
+         * builds with the same options are loaded from the cache
+         */
+        void prewarm(std::vector<OpenCLDevice::pointer> devices, std::vector<std::string> filenames, std::string buildOptions = "");
+        std::string getKey(std::string filename, std::string buildOptions, cl::Device device);
+        std::vector<KernelBinaryCacheRecord> getRecords();
+        // Remove all binaries in the directory
+        void clear();
+    private:
+        KernelBinaryCache();
+        KernelBinaryCache(KernelBinaryCache const&); // Don't implement
+        void operator=(KernelBinaryCache const&); // Don't implement
+        std::string createKey(const std::string& source, std::string buildOptions, cl::Device device);
+        std::string getBinaryFilename(std::string key);
+        void writeBinary(std::string key, const char* binary, std::size_t size);
+        void removeLeastRecentlyUsed(const std::vector<std::string>& keep);
+        void addRecord(KernelBinaryCacheRecord record);
+
+        boost::mutex mMutex;
+        std::string mDirectory;
+        boost::uintmax_t mMaximumSize;
+        std::map<std::string, boost::shared_ptr<boost::mutex> > mProgramMutexes;
+        std::vector<KernelBinaryCacheRecord> mRecords;
+};
+
+} // end namespace fast
+
+#endif /* KERNEL_BINARY_CACHE_HPP_ */
@@ -0,0 +1,57 @@
+// Vertex data is three position and three normal floats per vertex. The
+// encodings are the same as in FAST/Data/MeshCompression.hpp
+
+float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+short toSignedNormalized(float value) {
+    return convert_short_sat_rte(clamp(value, -1.0f, 1.0f)*32767.0f);
+}
+
+// 5 values per vertex: half precision position and octahedral encoded normal
+__kernel void compressVertices(
+        __global const float* vertices,
+        __private uint nrOfVertices,
+        __global ushort* compressed
+        ) {
+    const uint id = get_global_id(0);
+    if(id >= nrOfVertices)
+        return;
+
+    const float3 position = vload3(id*2, vertices);
+    const float3 normal = vload3(id*2 + 1, vertices);
+    vstore_half3(position, 0, (__global half*)&compressed[id*5]);
+
+    const float sum = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+    float2 encoded = sum > 0.0f ? normal.xy / sum : (float2)(0.0f, 0.0f);
+    if(normal.z < 0.0f) {
+        // Fold the lower half of the octahedron over the upper half
+        encoded = (float2)(
+                (1.0f - fabs(encoded.y))*signNotZero(encoded.x),
+                (1.0f - fabs(encoded.x))*signNotZero(encoded.y)
+        );
+    }
+    compressed[id*5+3] = as_ushort(toSignedNormalized(encoded.x));
+    compressed[id*5+4] = as_ushort(toSignedNormalized(encoded.y));
+}
+
+// 8 values per vertex: half precision position padded with 1 and normal as
+// signed normalized integers padded with 0, which OpenGL can draw directly
+__kernel void createCompressedVertexBufferObject(
+        __global const float* vertices,
+        __private uint nrOfVertices,
+        __global ushort* compressed
+        ) {
+    const uint id = get_global_id(0);
+    if(id >= nrOfVertices)
+        return;
+
+    const float3 position = vload3(id*2, vertices);
+    const float3 normal = vload3(id*2 + 1, vertices);
+    vstore_half4((float4)(position, 1.0f), 0, (__global half*)&compressed[id*8]);
+    compressed[id*8+4] = as_ushort(toSignedNormalized(normal.x));
+    compressed[id*8+5] = as_ushort(toSignedNormalized(normal.y));
+    compressed[id*8+6] = as_ushort(toSignedNormalized(normal.z));
+    compressed[id*8+7] = 0;
+}
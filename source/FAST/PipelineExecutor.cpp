@@ -0,0 +1,275 @@
+#include "FAST/PipelineExecutor.hpp"
+#include "FAST/Exception.hpp"
+#include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+
+namespace fast {
+
+PipelineExecutor::PipelineExecutor() :
+        mNrOfThreads(boost::thread::hardware_concurrency()),
+        mPipelineDepth(1),
+        mNrOfUpdates(0),
+        mNrOfPendingTasks(0),
+        mStopThreads(false),
+        mHasError(false) {
+    if(mNrOfThreads == 0)
+        mNrOfThreads = 1;
+}
+
+PipelineExecutor::~PipelineExecutor() {
+    stopThreads();
+}
+
+void PipelineExecutor::addProcessObject(ProcessObject::pointer processObject) {
+    mProcessObjects.push_back(processObject);
+}
+
+void PipelineExecutor::setNumberOfThreads(uint nrOfThreads) {
+    if(nrOfThreads == 0)
+        throw Exception("The number of threads of the PipelineExecutor must be at least 1");
+    if(nrOfThreads != mNrOfThreads) {
+        stopThreads();
+        mNrOfThreads = nrOfThreads;
+    }
+}
+
+uint PipelineExecutor::getNumberOfThreads() const {
+    return mNrOfThreads;
+}
+
+void PipelineExecutor::setPipelineDepth(uint depth) {
+    if(depth == 0)
+        throw Exception("The pipeline depth of the PipelineExecutor must be at least 1");
+    mPipelineDepth = depth;
+}
+
+uint PipelineExecutor::getPipelineDepth() const {
+    return mPipelineDepth;
+}
+
+std::size_t PipelineExecutor::addNode(ProcessObject::pointer processObject, std::vector<char>& isVisiting) {
+    for(std::size_t i = 0; i < mNodes.size(); ++i) {
+        if(mNodes[i].processObject == processObject) {
+            if(isVisiting[i])
+                throw Exception("The pipeline given to the PipelineExecutor contains a cycle");
+            return i;
+        }
+    }
+
+    const std::size_t index = mNodes.size();
+    Node node;
+    node.processObject = processObject;
+    node.nrOfUpdatesFinished = 0;
+    node.isRunning = false;
+    mNodes.push_back(node);
+    isVisiting.push_back(true);
+
+    boost::unordered_map<uint, ProcessObjectPort>::iterator it;
+    for(it = processObject->mInputConnections.begin(); it != processObject->mInputConnections.end(); it++) {
+        const std::size_t parent = addNode(it->second.getProcessObject(), isVisiting);
+        // Several ports may be connected to the same process object
+        if(std::find(mNodes[index].parents.begin(), mNodes[index].parents.end(), parent) == mNodes[index].parents.end()) {
+            mNodes[index].parents.push_back(parent);
+            mNodes[parent].children.push_back(index);
+        }
+    }
+    isVisiting[index] = false;
+
+    return index;
+}
+
+void PipelineExecutor::buildGraph() {
+    mNodes.clear();
+    std::vector<char> isVisiting;
+    for(int i = 0; i < mProcessObjects.size(); ++i) {
+        addNode(mProcessObjects[i], isVisiting);
+    }
+}
+
+bool PipelineExecutor::hasOnlyDynamicOutputData(const Node& node) const {
+    const ProcessObject::pointer processObject = node.processObject;
+    if(processObject->mOutputData.size() == 0)
+        return false;
+    boost::unordered_map<uint, DataObject::pointer>::const_iterator it;
+    for(it = processObject->mOutputData.begin(); it != processObject->mOutputData.end(); it++) {
+        if(!it->second->isDynamicData())
+            return false;
+    }
+    return true;
+}
+
+bool PipelineExecutor::scheduleIfReady(std::size_t index, uint queue) {
+    Node& node = mNodes[index];
+    if(mHasError || node.isRunning || node.nrOfUpdatesFinished == mNrOfUpdates)
+        return false;
+
+    const uint update = node.nrOfUpdatesFinished;
+    // The inputs must have finished this update
+    for(int i = 0; i < node.parents.size(); ++i) {
+        if(mNodes[node.parents[i]].nrOfUpdatesFinished <= update)
+            return false;
+    }
+    // Static output data can't be replaced before all users of it have finished,
+    // while new frames of dynamic data can be produced ahead of them
+    const uint depth = hasOnlyDynamicOutputData(node) ? mPipelineDepth : 1;
+    for(int i = 0; i < node.children.size(); ++i) {
+        if(mNodes[node.children[i]].nrOfUpdatesFinished + depth <= update)
+            return false;
+    }
+
+    Task task;
+    task.node = index;
+    task.update = update;
+    node.isRunning = true;
+    mQueues[queue].push_back(task);
+    mNrOfPendingTasks++;
+    return true;
+}
+
+bool PipelineExecutor::getTask(uint threadNr, Task* task) {
+    // Take the newest task of the thread's own queue, which most likely uses
+    // the data the thread just produced
+    if(!mQueues[threadNr].empty()) {
+        *task = mQueues[threadNr].back();
+        mQueues[threadNr].pop_back();
+        return true;
+    }
+
+    // Otherwise steal the oldest task of one of the other threads
+    for(uint i = 1; i < mQueues.size(); ++i) {
+        std::deque<Task>& queue = mQueues[(threadNr + i) % mQueues.size()];
+        if(!queue.empty()) {
+            *task = queue.front();
+            queue.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PipelineExecutor::workerThread(uint threadNr) {
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    while(true) {
+        Task task;
+        while(!mStopThreads && !getTask(threadNr, &task))
+            mTaskCondition.wait(lock);
+        if(mStopThreads)
+            return;
+
+        // Tasks left in the queues after an error are skipped
+        bool executed = false;
+        std::string errorMessage;
+        if(!mHasError) {
+            bool aParentHasBeenExecuted = false;
+            const std::vector<std::size_t>& parents = mNodes[task.node].parents;
+            for(int i = 0; i < parents.size(); ++i) {
+                if(mNodes[parents[i]].executed[task.update])
+                    aParentHasBeenExecuted = true;
+            }
+            ProcessObject::pointer processObject = mNodes[task.node].processObject;
+
+            lock.unlock();
+            try {
+                executed = processObject->executeIfModified(aParentHasBeenExecuted);
+            } catch(std::exception &e) {
+                errorMessage = std::string(e.what());
+                if(errorMessage.empty())
+                    errorMessage = "Unknown error";
+            }
+            lock.lock();
+        }
+
+        Node& node = mNodes[task.node];
+        node.isRunning = false;
+        node.executed[task.update] = executed;
+        node.nrOfUpdatesFinished++;
+        if(!errorMessage.empty() && !mHasError) {
+            mHasError = true;
+            mErrorMessage = "Executing " + node.processObject->getNameOfClass() + " failed: " + errorMessage;
+        }
+
+        // The next update of this node, its children and its parents may now be ready
+        uint nrOfNewTasks = scheduleIfReady(task.node, threadNr) ? 1 : 0;
+        for(int i = 0; i < node.children.size(); ++i) {
+            if(scheduleIfReady(node.children[i], threadNr))
+                nrOfNewTasks++;
+        }
+        for(int i = 0; i < node.parents.size(); ++i) {
+            if(scheduleIfReady(node.parents[i], threadNr))
+                nrOfNewTasks++;
+        }
+        // This thread takes one of the new tasks itself
+        if(nrOfNewTasks > 1)
+            mTaskCondition.notify_all();
+
+        mNrOfPendingTasks--;
+        if(mNrOfPendingTasks == 0)
+            mFinishedCondition.notify_all();
+    }
+}
+
+void PipelineExecutor::startThreads() {
+    if(mThreads.size() == mNrOfThreads)
+        return;
+
+    mStopThreads = false;
+    mQueues.resize(mNrOfThreads);
+    for(uint i = 0; i < mNrOfThreads; ++i) {
+        mThreads.push_back(new boost::thread(boost::bind(&PipelineExecutor::workerThread, this, i)));
+    }
+}
+
+void PipelineExecutor::stopThreads() {
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        mStopThreads = true;
+    }
+    mTaskCondition.notify_all();
+    for(int i = 0; i < mThreads.size(); ++i) {
+        mThreads[i]->join();
+        delete mThreads[i];
+    }
+    mThreads.clear();
+    mQueues.clear();
+}
+
+void PipelineExecutor::update() {
+    update(1);
+}
+
+void PipelineExecutor::update(uint nrOfUpdates) {
+    if(mProcessObjects.size() == 0)
+        throw Exception("No process objects were given to the PipelineExecutor");
+
+    // The graph is built for each call, as connections may have changed
+    buildGraph();
+    startThreads();
+
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    mNrOfUpdates = nrOfUpdates;
+    mHasError = false;
+    mErrorMessage = "";
+    for(int i = 0; i < mNodes.size(); ++i) {
+        mNodes[i].executed = std::vector<char>(nrOfUpdates, false);
+    }
+
+    // Spread the first tasks over the threads
+    for(int i = 0; i < mNodes.size(); ++i) {
+        scheduleIfReady(i, i % mNrOfThreads);
+    }
+    mTaskCondition.notify_all();
+
+    while(mNrOfPendingTasks > 0)
+        mFinishedCondition.wait(lock);
+
+    if(mHasError)
+        throw Exception(mErrorMessage);
+    for(int i = 0; i < mNodes.size(); ++i) {
+        if(mNodes[i].nrOfUpdatesFinished != mNrOfUpdates)
+            throw Exception("The PipelineExecutor was not able to execute all process objects");
+    }
+}
+
+} // end namespace fast
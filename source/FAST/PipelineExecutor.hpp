@@ -0,0 +1,87 @@
+#ifndef PIPELINE_EXECUTOR_HPP_
+#define PIPELINE_EXECUTOR_HPP_
+
+#include "FAST/Object.hpp"
+#include "FAST/ProcessObject.hpp"
+#include <boost/thread.hpp>
+#include <deque>
+#include <vector>
+
+namespace fast {
+
+/**
+ * Updates a pipeline using several threads. The process objects at the end of
+ * the pipeline are added to the executor, and the rest of the pipeline is found
+ * through their input connections. Process objects which don't depend on each
+ * other, such as separate branches using the same input, are executed at the
+ * same time. As with ProcessObject::update, a process object is only executed
+ * if it or one of its inputs has been modified.
+ *
+ * When the pipeline is updated several times, a process object whose outputs
+ * are dynamic data can start on the next update while the process objects
+ * using its output still work on the previous ones, see setPipelineDepth.
+ */
+class PipelineExecutor : public Object {
+    FAST_OBJECT(PipelineExecutor)
+    public:
+        void addProcessObject(ProcessObject::pointer processObject);
+        void setNumberOfThreads(uint nrOfThreads);
+        uint getNumberOfThreads() const;
+        /**
+         * Set how many updates a process object with dynamic output data may be
+         * ahead of the process objects using its output. The default is 1,
+         * which means that each update is finished before the next one starts.
+         */
+        void setPipelineDepth(uint depth);
+        uint getPipelineDepth() const;
+        void update();
+        void update(uint nrOfUpdates);
+        ~PipelineExecutor();
+    private:
+        PipelineExecutor();
+
+        struct Node {
+            ProcessObject::pointer processObject;
+            std::vector<std::size_t> parents;
+            std::vector<std::size_t> children;
+            uint nrOfUpdatesFinished;
+            bool isRunning;
+            // Whether the process object was executed in each of the updates
+            std::vector<char> executed;
+        };
+        struct Task {
+            std::size_t node;
+            uint update;
+        };
+
+        void buildGraph();
+        std::size_t addNode(ProcessObject::pointer processObject, std::vector<char>& isVisiting);
+        bool hasOnlyDynamicOutputData(const Node& node) const;
+        bool scheduleIfReady(std::size_t node, uint queue);
+        bool getTask(uint threadNr, Task* task);
+        void workerThread(uint threadNr);
+        void startThreads();
+        void stopThreads();
+
+        std::vector<ProcessObject::pointer> mProcessObjects;
+        std::vector<Node> mNodes;
+        uint mNrOfThreads;
+        uint mPipelineDepth;
+        uint mNrOfUpdates;
+
+        // Each thread has its own queue of tasks, and takes tasks from the other queues when it is empty
+        std::vector<boost::thread*> mThreads;
+        std::vector<std::deque<Task> > mQueues;
+        // Protects the nodes and queues
+        boost::mutex mMutex;
+        boost::condition_variable mTaskCondition;
+        boost::condition_variable mFinishedCondition;
+        uint mNrOfPendingTasks;
+        bool mStopThreads;
+        bool mHasError;
+        std::string mErrorMessage;
+};
+
+} // end namespace fast
+
+#endif /* PIPELINE_EXECUTOR_HPP_ */
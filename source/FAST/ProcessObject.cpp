@@ -10,16 +10,22 @@ ProcessObject::ProcessObject() : mIsModified(false), mRuntimeManager(new Runtime
 }
 
 void ProcessObject::update() {
-    bool aParentHasBeenModified = false;
-    // TODO check mInputConnections here instead
+    // Update input connections
+    boost::unordered_map<uint, ProcessObjectPort>::iterator it;
+    for(it = mInputConnections.begin(); it != mInputConnections.end(); it++) {
+        it->second.getProcessObject()->update();
+    }
+
+    executeIfModified();
+}
+
+bool ProcessObject::executeIfModified(bool aParentHasBeenExecuted) {
+    bool aParentHasBeenModified = aParentHasBeenExecuted;
     boost::unordered_map<uint, ProcessObjectPort>::iterator it;
     for(it = mInputConnections.begin(); it != mInputConnections.end(); it++) {
-        // Update input connection
         ProcessObjectPort& port = it->second; // use reference here to make sure timestamp is updated
-        port.getProcessObject()->update();
 
         // Check if the data object has been updated
-        DataObject::pointer data;
         try {
             if(port.isDataModified()) {
                 aParentHasBeenModified = true;
@@ -43,7 +49,10 @@ void ProcessObject::update() {
         if(this->mRuntimeManager->isEnabled())
             this->waitToFinish();
         this->mRuntimeManager->stopRegularTimer("execute");
+        return true;
     }
+
+    return false;
 }
 
 void ProcessObject::enableRuntimeMeasurements() {
@@ -114,6 +114,9 @@ class ProcessObject : public virtual Object {
         );
 
     private:
+        // Execute if this object or one of its inputs has been modified, without updating the inputs first.
+        // Returns true if the object was executed.
+        bool executeIfModified(bool aParentHasBeenExecuted = false);
         void updateTimestamp(DataObject::pointer data);
         void changeDeviceOnInputs(uint deviceNumber, ExecutionDevice::pointer device);
         void preExecute();
@@ -142,6 +145,7 @@ class ProcessObject : public virtual Object {
 
         friend class DynamicData;
         friend class ProcessObjectPort;
+        friend class PipelineExecutor;
 };
 
 
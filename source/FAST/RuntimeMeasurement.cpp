@@ -8,6 +8,7 @@ RuntimeMeasurement::RuntimeMeasurement(){}
 
 RuntimeMeasurement::RuntimeMeasurement(std::string name) {
 	sum = 0.0f;
+	last = 0.0f;
 	samples = 0;
 	this->name = name;
 }
@@ -15,6 +16,7 @@ RuntimeMeasurement::RuntimeMeasurement(std::string name) {
 void RuntimeMeasurement::addSample(double runtime) {
 	samples++;
 	sum += runtime;
+	last = runtime;
 }
 
 std::string RuntimeMeasurement::print() const {
@@ -44,6 +46,10 @@ double RuntimeMeasurement::getSum() const {
 	return sum;
 }
 
+double RuntimeMeasurement::getLastSample() const {
+	return last;
+}
+
 double RuntimeMeasurement::getAverage() const {
 	return sum / samples;
 }
@@ -15,6 +15,7 @@ public:
 	RuntimeMeasurement(std::string name);
 	void addSample(double runtime);
 	double getSum() const;
+	double getLastSample() const;
 	double getAverage() const;
 	double getStdDeviation() const;
 	std::string print() const;
@@ -24,6 +25,7 @@ private:
 	RuntimeMeasurement();
 
 	double sum;
+	double last;
 	unsigned int samples;
 	std::string name;
 };
@@ -128,6 +128,11 @@ void ImageFileStreamer::producerStream() {
             importer->setMainDevice(getMainDevice());
             importer->update();
             Image::pointer image = importer->getOutputData<Image>();
+            if(mUploadDevice.isValid()) {
+                // Enqueue upload of the frame without waiting for it to finish
+                image->enableAsynchronousTransfers();
+                image->getOpenCLImageAccess(ACCESS_READ, mUploadDevice);
+            }
             // Set and use timestamp if available
             if(mTimestampFilename != "") {
                 std::string line;
@@ -240,6 +245,14 @@ void ImageFileStreamer::disableLooping() {
     mLoop = false;
 }
 
+void ImageFileStreamer::enableAsynchronousUpload(OpenCLDevice::pointer device) {
+    mUploadDevice = device;
+}
+
+void ImageFileStreamer::disableAsynchronousUpload() {
+    mUploadDevice = OpenCLDevice::pointer();
+}
+
 void ImageFileStreamer::setStepSize(uint stepSize) {
     if(stepSize == 0)
         throw Exception("Step size given to ImageFileStreamer can't be 0");
@@ -4,6 +4,7 @@
 #include "FAST/SmartPointers.hpp"
 #include "FAST/Streamers/Streamer.hpp"
 #include "FAST/ProcessObject.hpp"
+#include "FAST/ExecutionDevice.hpp"
 #include <boost/thread.hpp>
 
 namespace fast {
@@ -24,6 +25,13 @@ class ImageFileStreamer : public Streamer, public ProcessObject {
          * Set a sleep time after each frame is read
          */
         void setSleepTime(uint milliseconds);
+        /**
+         * Start a non-blocking upload of each frame to the given device as soon
+         * as it is read, so that reading, uploading and processing of
+         * consecutive frames can overlap.
+         */
+        void enableAsynchronousUpload(OpenCLDevice::pointer device);
+        void disableAsynchronousUpload();
         bool hasReachedEnd() const;
         uint getNrOfFrames() const;
         /**
@@ -47,6 +55,7 @@ class ImageFileStreamer : public Streamer, public ProcessObject {
         bool mMaximumNrOfFramesSet;
         uint mSleepTime;
         uint mStepSize;
+        OpenCLDevice::pointer mUploadDevice;
 
         boost::thread *thread;
         boost::mutex mFirstFrameMutex;
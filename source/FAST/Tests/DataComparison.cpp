@@ -5,13 +5,13 @@
 
 namespace fast {
 
-void* allocateRandomData(unsigned int nrOfVoxels, DataType type) {
+void* allocateRandomData(std::size_t nrOfVoxels, DataType type) {
     srand(time(NULL));
     switch(type) {
     case TYPE_FLOAT:
     {
         float* data = new float[nrOfVoxels];
-        for(unsigned int i = 0; i < nrOfVoxels; i++)
+        for(std::size_t i = 0; i < nrOfVoxels; i++)
             data[i] = (float)rand() / RAND_MAX;
         return (void*)data;
     }
@@ -19,7 +19,7 @@ void* allocateRandomData(unsigned int nrOfVoxels, DataType type) {
     case TYPE_INT8:
     {
         char* data = new char[nrOfVoxels];
-        for(unsigned int i = 0; i < nrOfVoxels; i++)
+        for(std::size_t i = 0; i < nrOfVoxels; i++)
             data[i] = rand() % 255 - 128;
         return (void*)data;
     }
@@ -27,7 +27,7 @@ void* allocateRandomData(unsigned int nrOfVoxels, DataType type) {
     case TYPE_UINT8:
     {
         uchar* data = new uchar[nrOfVoxels];
-        for(unsigned int i = 0; i < nrOfVoxels; i++)
+        for(std::size_t i = 0; i < nrOfVoxels; i++)
             data[i] = rand() % 255;
         return (void*)data;
     }
@@ -35,7 +35,7 @@ void* allocateRandomData(unsigned int nrOfVoxels, DataType type) {
     case TYPE_INT16:
     {
         short* data = new short[nrOfVoxels];
-        for(unsigned int i = 0; i < nrOfVoxels; i++)
+        for(std::size_t i = 0; i < nrOfVoxels; i++)
             data[i] = rand() % 255 - 128;
         return (void*)data;
     }
@@ -43,7 +43,7 @@ void* allocateRandomData(unsigned int nrOfVoxels, DataType type) {
     case TYPE_UINT16:
     {
         ushort* data = new ushort[nrOfVoxels];
-        for(unsigned int i = 0; i < nrOfVoxels; i++)
+        for(std::size_t i = 0; i < nrOfVoxels; i++)
             data[i] = rand() % 255;
         return (void*)data;
     }
@@ -52,13 +52,13 @@ void* allocateRandomData(unsigned int nrOfVoxels, DataType type) {
     return NULL;
 }
 
-bool compareDataArrays(void* data1, void* data2, unsigned int nrOfVoxels, DataType type) {
+bool compareDataArrays(void* data1, void* data2, std::size_t nrOfVoxels, DataType type) {
     bool success = true;
     switch(type) {
         fastSwitchTypeMacro(
         FAST_TYPE* data1c = (FAST_TYPE*)data1;
         FAST_TYPE* data2c = (FAST_TYPE*)data2;
-        for(unsigned int i = 0; i < nrOfVoxels; i++) {
+        for(std::size_t i = 0; i < nrOfVoxels; i++) {
             if(data1c[i] != data2c[i]) {
             	/*
                 reportInfo() << i << Reporter::end;
@@ -74,9 +74,9 @@ bool compareDataArrays(void* data1, void* data2, unsigned int nrOfVoxels, DataTy
     return success;
 }
 
-bool compareBufferWithDataArray(cl::Buffer buffer, OpenCLDevice::pointer device, void* data, unsigned int nrOfVoxels, DataType type) {
+bool compareBufferWithDataArray(cl::Buffer buffer, OpenCLDevice::pointer device, void* data, std::size_t nrOfVoxels, DataType type) {
     // First, transfer data from buffer
-    unsigned int elementSize;
+    std::size_t elementSize;
     void* bufferData;
     switch(type) {
         fastSwitchTypeMacro(
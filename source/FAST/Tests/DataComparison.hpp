@@ -7,11 +7,11 @@
 namespace fast {
 
 
-void* allocateRandomData(unsigned int nrOfVoxels, DataType type);
+void* allocateRandomData(std::size_t nrOfVoxels, DataType type);
 
-bool compareDataArrays(void* data1, void* data2, unsigned int nrOfVoxels, DataType type);
+bool compareDataArrays(void* data1, void* data2, std::size_t nrOfVoxels, DataType type);
 
-bool compareBufferWithDataArray(cl::Buffer buffer, OpenCLDevice::pointer device, void* data, unsigned int nrOfVoxels, DataType type);
+bool compareBufferWithDataArray(cl::Buffer buffer, OpenCLDevice::pointer device, void* data, std::size_t nrOfVoxels, DataType type);
 
 
 bool compareImage2DWithDataArray(
@@ -0,0 +1,122 @@
+#include "FAST/Testing.hpp"
+#include "FAST/KernelBinaryCache.hpp"
+#include "FAST/DeviceManager.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <fstream>
+
+using namespace fast;
+
+static void writeFile(boost::filesystem::path path, std::string contents) {
+    std::ofstream file(path.string().c_str());
+    file << contents;
+}
+
+static int countBinaries(boost::filesystem::path directory) {
+    int count = 0;
+    for(boost::filesystem::directory_iterator it(directory), end; it != end; ++it) {
+        if(it->path().extension() == ".bin")
+            count++;
+    }
+    return count;
+}
+
+// Uses a temporary cache directory and restores the cache settings when done
+class TemporaryKernelCache {
+    public:
+        TemporaryKernelCache() {
+            KernelBinaryCache& cache = KernelBinaryCache::getInstance();
+            mDirectory = cache.getDirectory();
+            mMaximumSize = cache.getMaximumSize();
+            path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("FAST-kernel-cache-%%%%-%%%%");
+            boost::filesystem::create_directories(path / "kernels");
+            cache.setDirectory((path / "binaries").string());
+        }
+        ~TemporaryKernelCache() {
+            KernelBinaryCache& cache = KernelBinaryCache::getInstance();
+            cache.setDirectory(mDirectory);
+            cache.setMaximumSize(mMaximumSize);
+            boost::filesystem::remove_all(path);
+        }
+        boost::filesystem::path path;
+    private:
+        std::string mDirectory;
+        boost::uintmax_t mMaximumSize;
+};
+
+TEST_CASE("Kernel binary cache key depends on source, included files and build options", "[fast][KernelBinaryCache]") {
+    TemporaryKernelCache temporary;
+    const boost::filesystem::path kernel = temporary.path / "kernels" / "kernel.cl";
+    const boost::filesystem::path header = temporary.path / "kernels" / "header.h";
+    writeFile(header, "#define VALUE 1\n");
+    writeFile(kernel, "#include \"header.h\"\n__kernel void test(__global int* a) { a[0] = VALUE; }\n");
+
+    KernelBinaryCache& cache = KernelBinaryCache::getInstance();
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        const std::string key = cache.getKey(kernel.string(), "", devices[i]->getDevice());
+        CHECK(key == cache.getKey(kernel.string(), "", devices[i]->getDevice()));
+        CHECK(key != cache.getKey(kernel.string(), "-D SIZE=2", devices[i]->getDevice()));
+        writeFile(header, "#define VALUE 2\n");
+        CHECK(key != cache.getKey(kernel.string(), "", devices[i]->getDevice()));
+        writeFile(header, "#define VALUE 1\n");
+    }
+}
+
+TEST_CASE("Kernel binary cache loads program compiled before", "[fast][KernelBinaryCache]") {
+    TemporaryKernelCache temporary;
+    const boost::filesystem::path kernel = temporary.path / "kernels" / "kernel.cl";
+    writeFile(kernel, "__kernel void test(__global int* a) { a[0] = 1; }\n");
+
+    KernelBinaryCache& cache = KernelBinaryCache::getInstance();
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        cache.clear();
+        std::vector<cl::Device> clDevices(1, devices[i]->getDevice());
+        cache.getProgram(devices[i]->getContext(), clDevices, kernel.string());
+        CHECK(cache.getRecords().back().loadedFromCache == false);
+        cl::Program program = cache.getProgram(devices[i]->getContext(), clDevices, kernel.string());
+        CHECK(cache.getRecords().back().loadedFromCache == true);
+        CHECK_NOTHROW(cl::Kernel(program, "test"));
+    }
+}
+
+TEST_CASE("Kernel binary cache removes least recently used binaries", "[fast][KernelBinaryCache]") {
+    TemporaryKernelCache temporary;
+    const boost::filesystem::path kernel = temporary.path / "kernels" / "kernel.cl";
+    writeFile(kernel, "__kernel void test(__global int* a) { a[0] = SIZE; }\n");
+
+    KernelBinaryCache& cache = KernelBinaryCache::getInstance();
+    cache.setMaximumSize(1);
+    OpenCLDevice::pointer device = DeviceManager::getInstance().getOneOpenCLDevice();
+    std::vector<cl::Device> clDevices(1, device->getDevice());
+    cache.getProgram(device->getContext(), clDevices, kernel.string(), "-D SIZE=1");
+    cache.getProgram(device->getContext(), clDevices, kernel.string(), "-D SIZE=2");
+    // The binary just written is never removed
+    CHECK(countBinaries(cache.getDirectory()) == 1);
+}
+
+TEST_CASE("Kernel binary cache prewarm builds programs for all devices", "[fast][KernelBinaryCache]") {
+    TemporaryKernelCache temporary;
+    std::vector<std::string> filenames;
+    for(int i = 0; i < 3; i++) {
+        const boost::filesystem::path kernel = temporary.path / "kernels" / ("kernel" + boost::lexical_cast<std::string>(i) + ".cl");
+        writeFile(kernel, "__kernel void test(__global int* a) { a[0] = " + boost::lexical_cast<std::string>(i) + "; }\n");
+        filenames.push_back(kernel.string());
+    }
+
+    KernelBinaryCache& cache = KernelBinaryCache::getInstance();
+    std::vector<OpenCLDevice::pointer> devices = DeviceManager::getInstance().getAllDevices();
+    cache.prewarm(devices, filenames);
+    for(int i = 0; i < devices.size(); i++) {
+        INFO("Device " << devices[i]->getName());
+        std::vector<cl::Device> clDevices = devices[i]->getContext().getInfo<CL_CONTEXT_DEVICES>();
+        cache.getProgram(devices[i]->getContext(), clDevices, filenames[1]);
+        CHECK(cache.getRecords().back().loadedFromCache == true);
+    }
+
+    filenames.push_back((temporary.path / "kernels" / "missing.cl").string());
+    CHECK_THROWS(cache.prewarm(devices, filenames));
+}
@@ -0,0 +1,141 @@
+#include "catch.hpp"
+#include "DummyObjects.hpp"
+#include "FAST/PipelineExecutor.hpp"
+#include <atomic>
+
+namespace fast {
+
+// Process object with two inputs which sleeps while executing, and records
+// how many process objects are executing at the same time
+class SlowProcessObject : public ProcessObject {
+    FAST_OBJECT(SlowProcessObject)
+    public:
+        void setIsModified() { mIsModified = true; };
+        void setThrowException() { mThrowException = true; };
+        uint getNrOfExecutions() const { return mNrOfExecutions; };
+        static int getMaximumNrOfConcurrentExecutions() { return mMaximumNrOfConcurrentExecutions; };
+        static void resetConcurrentExecutions() { mMaximumNrOfConcurrentExecutions = 0; };
+    private:
+        SlowProcessObject() : mNrOfExecutions(0), mThrowException(false) {
+            createInputPort<DummyDataObject>(0, false);
+            createInputPort<DummyDataObject>(1, false);
+            createOutputPort<DummyDataObject>(0, OUTPUT_STATIC);
+        };
+        void execute() {
+            const int executing = ++mNrOfConcurrentExecutions;
+            int maximum = mMaximumNrOfConcurrentExecutions;
+            while(executing > maximum && !mMaximumNrOfConcurrentExecutions.compare_exchange_weak(maximum, executing));
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+            mNrOfExecutions++;
+            mNrOfConcurrentExecutions--;
+            if(mThrowException)
+                throw Exception("Process object failed");
+            getOutputData<DummyDataObject>(0)->updateModifiedTimestamp();
+        };
+        uint mNrOfExecutions;
+        bool mThrowException;
+        static std::atomic<int> mNrOfConcurrentExecutions;
+        static std::atomic<int> mMaximumNrOfConcurrentExecutions;
+};
+
+std::atomic<int> SlowProcessObject::mNrOfConcurrentExecutions(0);
+std::atomic<int> SlowProcessObject::mMaximumNrOfConcurrentExecutions(0);
+
+}
+
+using namespace fast;
+
+TEST_CASE("PipelineExecutor executes each process object of a diamond shaped pipeline once", "[fast][PipelineExecutor]") {
+    SlowProcessObject::pointer source = SlowProcessObject::New();
+    source->setIsModified();
+    SlowProcessObject::pointer branch1 = SlowProcessObject::New();
+    branch1->setInputConnection(source->getOutputPort());
+    SlowProcessObject::pointer branch2 = SlowProcessObject::New();
+    branch2->setInputConnection(source->getOutputPort());
+    SlowProcessObject::pointer merge = SlowProcessObject::New();
+    merge->setInputConnection(0, branch1->getOutputPort());
+    merge->setInputConnection(1, branch2->getOutputPort());
+
+    PipelineExecutor::pointer executor = PipelineExecutor::New();
+    executor->addProcessObject(merge);
+    executor->update();
+    CHECK(source->getNrOfExecutions() == 1);
+    CHECK(branch1->getNrOfExecutions() == 1);
+    CHECK(branch2->getNrOfExecutions() == 1);
+    CHECK(merge->getNrOfExecutions() == 1);
+
+    // Nothing has been modified, so nothing is executed the second time
+    executor->update();
+    CHECK(source->getNrOfExecutions() == 1);
+    CHECK(merge->getNrOfExecutions() == 1);
+}
+
+TEST_CASE("PipelineExecutor only executes the modified part of the pipeline", "[fast][PipelineExecutor]") {
+    SlowProcessObject::pointer source = SlowProcessObject::New();
+    source->setIsModified();
+    SlowProcessObject::pointer child = SlowProcessObject::New();
+    child->setInputConnection(source->getOutputPort());
+    PipelineExecutor::pointer executor = PipelineExecutor::New();
+    executor->addProcessObject(child);
+    executor->update();
+
+    child->setIsModified();
+    executor->update();
+    CHECK(source->getNrOfExecutions() == 1);
+    CHECK(child->getNrOfExecutions() == 2);
+}
+
+TEST_CASE("PipelineExecutor executes independent branches at the same time", "[fast][PipelineExecutor]") {
+    SlowProcessObject::pointer source = SlowProcessObject::New();
+    source->setIsModified();
+    SlowProcessObject::pointer branch1 = SlowProcessObject::New();
+    branch1->setInputConnection(source->getOutputPort());
+    SlowProcessObject::pointer branch2 = SlowProcessObject::New();
+    branch2->setInputConnection(source->getOutputPort());
+
+    SlowProcessObject::resetConcurrentExecutions();
+    PipelineExecutor::pointer executor = PipelineExecutor::New();
+    executor->setNumberOfThreads(2);
+    executor->addProcessObject(branch1);
+    executor->addProcessObject(branch2);
+    executor->update();
+    CHECK(branch1->getNrOfExecutions() == 1);
+    CHECK(branch2->getNrOfExecutions() == 1);
+    CHECK(SlowProcessObject::getMaximumNrOfConcurrentExecutions() == 2);
+}
+
+TEST_CASE("PipelineExecutor with one thread never executes process objects at the same time", "[fast][PipelineExecutor]") {
+    SlowProcessObject::pointer source = SlowProcessObject::New();
+    source->setIsModified();
+    SlowProcessObject::pointer branch1 = SlowProcessObject::New();
+    branch1->setInputConnection(source->getOutputPort());
+    SlowProcessObject::pointer branch2 = SlowProcessObject::New();
+    branch2->setInputConnection(source->getOutputPort());
+
+    SlowProcessObject::resetConcurrentExecutions();
+    PipelineExecutor::pointer executor = PipelineExecutor::New();
+    executor->setNumberOfThreads(1);
+    executor->addProcessObject(branch1);
+    executor->addProcessObject(branch2);
+    executor->update();
+    CHECK(branch1->getNrOfExecutions() == 1);
+    CHECK(branch2->getNrOfExecutions() == 1);
+    CHECK(SlowProcessObject::getMaximumNrOfConcurrentExecutions() == 1);
+}
+
+TEST_CASE("PipelineExecutor throws exception when a process object fails and does not execute the rest", "[fast][PipelineExecutor]") {
+    SlowProcessObject::pointer source = SlowProcessObject::New();
+    source->setIsModified();
+    source->setThrowException();
+    SlowProcessObject::pointer child = SlowProcessObject::New();
+    child->setInputConnection(source->getOutputPort());
+    PipelineExecutor::pointer executor = PipelineExecutor::New();
+    executor->addProcessObject(child);
+    CHECK_THROWS(executor->update());
+    CHECK(child->getNrOfExecutions() == 0);
+}
+
+TEST_CASE("PipelineExecutor with no process objects throws exception", "[fast][PipelineExecutor]") {
+    PipelineExecutor::pointer executor = PipelineExecutor::New();
+    CHECK_THROWS(executor->update());
+}
@@ -88,10 +88,22 @@ void MeshRenderer::draw() {
         glEnableClientState(GL_VERTEX_ARRAY);
         glEnableClientState(GL_NORMAL_ARRAY);
 
-        glVertexPointer(3, GL_FLOAT, 24, 0);
-        glNormalPointer(GL_FLOAT, 24, (float*)(sizeof(GLfloat)*3));
+        if(access->isCompressed()) {
+            // Half float positions and normalized short normals
+            glVertexPointer(3, GL_HALF_FLOAT, 16, 0);
+            glNormalPointer(GL_SHORT, 16, (float*)(sizeof(GLshort)*4));
+        } else {
+            glVertexPointer(3, GL_FLOAT, 24, 0);
+            glNormalPointer(GL_FLOAT, 24, (float*)(sizeof(GLfloat)*3));
+        }
 
-        glDrawArrays(GL_TRIANGLES, 0, surfaceToRender->getNrOfTriangles()*3);
+        if(access->getIndexBuffer() != NULL) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *access->getIndexBuffer());
+            glDrawElements(GL_TRIANGLES, surfaceToRender->getNrOfTriangles()*3, GL_UNSIGNED_INT, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        } else {
+            glDrawArrays(GL_TRIANGLES, 0, surfaceToRender->getNrOfTriangles()*3);
+        }
 
         // Release buffer
         glBindBuffer(GL_ARRAY_BUFFER, 0);